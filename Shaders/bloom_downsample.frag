@@ -0,0 +1,82 @@
+#version 430 core
+
+// Bloom mip chain, downsample step: 13-tap filter (Jimenez, "Next Generation Post Processing in Call of Duty", 2014).
+// Its overlapping 4x4 boxes keep bloom stable under motion. The first step (from the HDR scene) also applies the
+// soft brightness threshold and a Karis average, so single very bright particles don't flicker as fireflies.
+in vec2 vUV;
+out vec4 FragColor;
+
+uniform sampler2D u_source;
+uniform vec2  u_sourceTexelSize; // 1 / source size
+uniform int   u_prefilter;       // 1 on the first step
+uniform float u_threshold;       // luminance where bloom starts
+uniform float u_knee;            // soft threshold width
+
+float luminance (vec3 c)
+{
+    return dot (c, vec3 (0.2126, 0.7152, 0.0722));
+}
+
+vec3 sampleSource (vec2 offset)
+{
+    return texture (u_source, vUV + offset * u_sourceTexelSize).rgb;
+}
+
+vec3 prefilter (vec3 c)
+{
+    float brightness = max (c.r, max (c.g, c.b));
+    float soft = clamp (brightness - u_threshold + u_knee, 0.0, 2.0 * u_knee);
+    soft = soft * soft / (4.0 * u_knee + 1.0e-4);
+    float contribution = max (soft, brightness - u_threshold) / max (brightness, 1.0e-4);
+    return c * contribution;
+}
+
+// Karis average: weight each sample of a 2x2 group by 1 / (1 + luma) before averaging.
+vec3 karis (vec3 a, vec3 b, vec3 c, vec3 d)
+{
+    float wa = 1.0 / (1.0 + luminance (a));
+    float wb = 1.0 / (1.0 + luminance (b));
+    float wc = 1.0 / (1.0 + luminance (c));
+    float wd = 1.0 / (1.0 + luminance (d));
+    return (a * wa + b * wb + c * wc + d * wd) / (wa + wb + wc + wd);
+}
+
+void main()
+{
+    vec3 a = sampleSource (vec2 (-2.0,  2.0));
+    vec3 b = sampleSource (vec2 ( 0.0,  2.0));
+    vec3 c = sampleSource (vec2 ( 2.0,  2.0));
+    vec3 d = sampleSource (vec2 (-2.0,  0.0));
+    vec3 e = sampleSource (vec2 ( 0.0,  0.0));
+    vec3 f = sampleSource (vec2 ( 2.0,  0.0));
+    vec3 g = sampleSource (vec2 (-2.0, -2.0));
+    vec3 h = sampleSource (vec2 ( 0.0, -2.0));
+    vec3 i = sampleSource (vec2 ( 2.0, -2.0));
+    vec3 j = sampleSource (vec2 (-1.0,  1.0));
+    vec3 k = sampleSource (vec2 ( 1.0,  1.0));
+    vec3 l = sampleSource (vec2 (-1.0, -1.0));
+    vec3 m = sampleSource (vec2 ( 1.0, -1.0));
+
+    vec3 result;
+
+    if (u_prefilter != 0)
+    {
+        // Five overlapping 2x2 groups, each averaged with Karis weights, then combined with the usual 0.5 / 0.125 split.
+        result = karis (j, k, l, m) * 0.5
+               + karis (a, b, d, e) * 0.125
+               + karis (b, c, e, f) * 0.125
+               + karis (d, e, g, h) * 0.125
+               + karis (e, f, h, i) * 0.125;
+
+        result = prefilter (result);
+    }
+    else
+    {
+        result = e * 0.125
+               + (a + c + g + i) * 0.03125
+               + (b + d + f + h) * 0.0625
+               + (j + k + l + m) * 0.125;
+    }
+
+    FragColor = vec4 (max (result, vec3 (0.0)), 1.0);
+}
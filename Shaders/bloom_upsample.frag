@@ -0,0 +1,21 @@
+#version 430 core
+
+// Bloom mip chain, upsample step: 3x3 tent filter of the smaller level, added (GL_ONE, GL_ONE) onto the next larger one.
+in vec2 vUV;
+out vec4 FragColor;
+
+uniform sampler2D u_source;
+uniform vec2 u_sourceTexelSize; // 1 / source size
+
+void main()
+{
+    vec2 o = u_sourceTexelSize;
+
+    vec3 sum = texture (u_source, vUV).rgb * 4.0;
+    sum += (texture (u_source, vUV + vec2 (-o.x, 0.0)).rgb + texture (u_source, vUV + vec2 (o.x, 0.0)).rgb
+          + texture (u_source, vUV + vec2 (0.0, -o.y)).rgb + texture (u_source, vUV + vec2 (0.0, o.y)).rgb) * 2.0;
+    sum += texture (u_source, vUV + vec2 (-o.x, -o.y)).rgb + texture (u_source, vUV + vec2 (o.x, -o.y)).rgb
+         + texture (u_source, vUV + vec2 (-o.x,  o.y)).rgb + texture (u_source, vUV + vec2 (o.x,  o.y)).rgb;
+
+    FragColor = vec4 (sum / 16.0, 1.0);
+}
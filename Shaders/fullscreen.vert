@@ -0,0 +1,12 @@
+#version 430 core
+
+// Fullscreen triangle from gl_VertexID (no vertex buffers): covers clip space [-1, 1]^2 with one primitive.
+// Shared by all fullscreen passes (OIT composite, bloom, tone mapping).
+out vec2 vUV;
+
+void main()
+{
+    vec2 corner = vec2 (float ((gl_VertexID << 1) & 2), float (gl_VertexID & 2));
+    vUV = corner;
+    gl_Position = vec4 (corner * 2.0 - 1.0, 0.0, 1.0);
+}
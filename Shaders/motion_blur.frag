@@ -0,0 +1,76 @@
+#version 430 core
+
+// Motion blur, step 3: gather along the neighbourhood's dominant velocity (McGuire et al. 2012, "A reconstruction
+// filter for plausible motion blur", without the depth classification: boids are small and mostly translucent).
+// A sample contributes if its own blur reaches this pixel (or this pixel's blur reaches it), so a fast boid smears
+// over the background around it, not just over its own footprint. Fixed cost: at most kSamples taps per pixel.
+in vec2 vUV;
+out vec4 FragColor;
+
+uniform sampler2D u_scene;
+uniform sampler2D u_velocity;     // pixels per frame
+uniform sampler2D u_neighbourMax; // per tile, from motion_neighbourmax.frag
+uniform int   u_tileSize;
+uniform float u_shutter;          // fraction of the frame the virtual shutter is open (0.5 = 180 degrees)
+uniform float u_maxBlur;          // longest blur in pixels (two tiles: the neighbourhood search covers one tile each way)
+
+const int kSamples = 12;
+
+vec2 blurVector (vec2 velocity)
+{
+    vec2 v = velocity * u_shutter;
+    float len = length (v);
+    return (len > u_maxBlur) ? v * (u_maxBlur / len) : v;
+}
+
+// How much a point blurred over `halfExtent` pixels covers a point `dist` pixels away.
+float cone (float dist, float halfExtent)
+{
+    return clamp (1.0 - dist / max (halfExtent, 1.0e-3), 0.0, 1.0);
+}
+
+float cylinder (float dist, float halfExtent)
+{
+    halfExtent = max (halfExtent, 1.0e-3); // smoothstep needs distinct edges
+    return 1.0 - smoothstep (0.95 * halfExtent, 1.05 * halfExtent, dist);
+}
+
+void main()
+{
+    ivec2 x = ivec2 (gl_FragCoord.xy);
+    ivec2 size = textureSize (u_scene, 0);
+    vec4 colorX = texelFetch (u_scene, x, 0);
+
+    vec2 vN = blurVector (texelFetch (u_neighbourMax, x / u_tileSize, 0).rg);
+
+    if (dot (vN, vN) < 0.25)
+    {
+        FragColor = colorX;
+        return;
+    }
+
+    float halfX = 0.5 * length (blurVector (texelFetch (u_velocity, x, 0).rg));
+
+    float weightSum = 1.0 / max (halfX, 1.0);
+    vec4 sum = colorX * weightSum;
+
+    // Per-pixel jitter of the sample positions turns the step pattern into noise.
+    float jitter = fract (52.9829189 * fract (dot (gl_FragCoord.xy, vec2 (0.06711056, 0.00583715)))) - 0.5;
+
+    for (int i = 0; i < kSamples; ++i)
+    {
+        float t = mix (-0.5, 0.5, (float (i) + 0.5 + jitter) / float (kSamples));
+        vec2 offset = vN * t;
+        ivec2 y = clamp (ivec2 (vec2 (x) + 0.5 + offset), ivec2 (0), size - 1);
+
+        float dist = length (offset);
+        float halfY = 0.5 * length (blurVector (texelFetch (u_velocity, y, 0).rg));
+
+        float w = cone (dist, halfY) + cone (dist, halfX) + 2.0 * cylinder (dist, halfY) * cylinder (dist, halfX);
+
+        sum += texelFetch (u_scene, y, 0) * w;
+        weightSum += w;
+    }
+
+    FragColor = sum / weightSum;
+}
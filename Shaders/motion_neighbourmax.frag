@@ -0,0 +1,33 @@
+#version 430 core
+
+// Motion blur, step 2: the largest tile velocity in each tile's 3x3 neighbourhood. A pixel can be covered by a blur
+// starting up to one tile away, so this is the direction the gather pass searches along.
+uniform sampler2D u_tileMax;
+
+out vec4 FragColor;
+
+void main()
+{
+    ivec2 tile = ivec2 (gl_FragCoord.xy);
+    ivec2 size = textureSize (u_tileMax, 0);
+
+    vec2 largest = vec2 (0.0);
+    float largestLength2 = 0.0;
+
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            vec2 v = texelFetch (u_tileMax, clamp (tile + ivec2 (x, y), ivec2 (0), size - 1), 0).rg;
+            float length2 = dot (v, v);
+
+            if (length2 > largestLength2)
+            {
+                largest = v;
+                largestLength2 = length2;
+            }
+        }
+    }
+
+    FragColor = vec4 (largest, 0.0, 1.0);
+}
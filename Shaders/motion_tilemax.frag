@@ -0,0 +1,35 @@
+#version 430 core
+
+// Motion blur, step 1 (McGuire et al. 2012): the largest velocity in each u_tileSize x u_tileSize tile of the
+// velocity target. Drawn at tile resolution, so every velocity texel is read once.
+uniform sampler2D u_velocity; // pixels per frame
+uniform int u_tileSize;
+
+out vec4 FragColor;
+
+void main()
+{
+    ivec2 base = ivec2 (gl_FragCoord.xy) * u_tileSize;
+    ivec2 size = textureSize (u_velocity, 0);
+
+    vec2 largest = vec2 (0.0);
+    float largestLength2 = 0.0;
+
+    for (int y = 0; y < u_tileSize; ++y)
+    {
+        for (int x = 0; x < u_tileSize; ++x)
+        {
+            ivec2 texel = min (base + ivec2 (x, y), size - 1);
+            vec2 v = texelFetch (u_velocity, texel, 0).rg;
+            float length2 = dot (v, v);
+
+            if (length2 > largestLength2)
+            {
+                largest = v;
+                largestLength2 = length2;
+            }
+        }
+    }
+
+    FragColor = vec4 (largest, 0.0, 1.0);
+}
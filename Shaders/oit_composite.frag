@@ -0,0 +1,34 @@
+#version 430 core
+
+// Weighted blended OIT resolve, drawn over the opaque scene with GL_SRC_ALPHA / GL_ONE_MINUS_SRC_ALPHA.
+uniform sampler2D u_accum;  // sum of premultiplied colour * weight (rgb) and alpha * weight (a)
+uniform sampler2D u_reveal; // product of (1 - alpha): how much of the background still shows through
+uniform sampler2D u_velocity; // coverage-blended particle velocity (pixels), if u_hasVelocity
+uniform int u_hasVelocity;
+
+layout (location = 0) out vec4 FragColor;
+layout (location = 2) out vec4 FragVelocity; // scene velocity target (motion blur), blended like the colour
+
+void main()
+{
+    ivec2 texel = ivec2 (gl_FragCoord.xy);
+
+    float reveal = texelFetch (u_reveal, texel, 0).r;
+    vec4 accum = texelFetch (u_accum, texel, 0);
+
+    // Nothing translucent here; leave the opaque pixel untouched.
+    if (reveal >= 1.0)
+        discard;
+
+    // Guard against fp16 overflow in very dense pixels.
+    if (isinf (max (max (abs (accum.r), abs (accum.g)), abs (accum.b))))
+        accum.rgb = vec3 (accum.a);
+
+    vec3 average = accum.rgb / max (accum.a, 1.0e-5);
+    float coverage = 1.0 - reveal;
+    FragColor = vec4 (average, coverage);
+
+    // The velocity was alpha-blended over zero, i.e. it is premultiplied by the coverage.
+    vec2 velocity = (u_hasVelocity != 0) ? texelFetch (u_velocity, texel, 0).rg / max (coverage, 1.0e-3) : vec2 (0.0);
+    FragVelocity = vec4 (velocity, 0.0, u_hasVelocity != 0 ? coverage : 0.0);
+}
@@ -2,11 +2,37 @@
 
 in vec4 vColor;
 in vec2 vDir;
-out vec4 FragColor;
+in vec2 vVelocity;
+
+// Location 0 is the colour target (or the OIT accumulation target), 1 the OIT revealage target,
+// 2 the motion blur velocity target (pixels; alpha-blended by coverage). Targets take only the locations they have.
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out float FragReveal;
+layout (location = 2) out vec4 FragVelocity;
 
 // 0 = square, 1 = circle, 2 = line (aligned to velocity), 3 = cube (fake shaded sprite)
 uniform int u_shape;
 uniform float u_alphaMul;
+uniform int u_oit; // 1: weighted blended OIT (accumulation + revealage outputs), 0: straight alpha
+
+// Weighted blended OIT (McGuire & Bavoil 2013, eq. 10): near fragments get more weight than far ones,
+// so the order-independent average still reads front-to-back. Blending: accum ONE/ONE, reveal ZERO/ONE_MINUS_SRC_COLOR.
+void writeOutput (vec4 color)
+{
+    FragVelocity = vec4 (vVelocity, 0.0, clamp (color.a, 0.0, 1.0));
+
+    if (u_oit == 0)
+    {
+        FragColor = color;
+        return;
+    }
+
+    float a = clamp (color.a, 0.0, 1.0);
+    float w = clamp (a * max (1.0e-2, 3.0e3 * pow (1.0 - gl_FragCoord.z, 3.0)), 1.0e-2, 3.0e3);
+
+    FragColor  = vec4 (color.rgb * a, a) * w;
+    FragReveal = a;
+}
 
 void main()
 {
@@ -55,11 +81,11 @@ void main()
         // Slightly boost edges to read as a cube.
         vec3 rgb = vColor.rgb * shade;
         rgb = mix (rgb, vec3 (1.0), edge * 0.15);
-        FragColor = vec4 (rgb, vColor.a * u_alphaMul);
+        writeOutput (vec4 (rgb, vColor.a * u_alphaMul));
         return;
     }
 
-    FragColor = vec4 (vColor.rgb, vColor.a * u_alphaMul);
+    writeOutput (vec4 (vColor.rgb, vColor.a * u_alphaMul));
 }
 
 
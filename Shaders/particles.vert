@@ -12,19 +12,44 @@ layout (std430, binding = 0) readonly buffer Particles
     Particle p[];
 };
 
-uniform mat4 u_viewProj;
+// Compacted visible indices from particles_cull.comp (used when frustum culling is on).
+layout (std430, binding = 4) readonly buffer VisibleIndices
+{
+    uint visible[];
+};
+
+uniform int u_useVisibleList;
+uniform mat4 u_viewProj; // includes the floating-origin translation (composed in double on the CPU)
 uniform float u_pointSize;
+uniform mat4 u_prevViewProj; // last frame's u_viewProj
+uniform float u_stepSeconds; // simulated time of the last step (positions moved by vel * this)
+uniform vec2 u_viewportSize; // framebuffer pixels
 
 out vec4 vColor;
 out vec2 vDir;
+out vec2 vVelocity;
+
+// Screen-space motion over the last step, in pixels (motion blur velocity target): where the point is now against
+// where it was one step ago, seen through last frame's camera, so camera motion blurs too.
+vec2 screenVelocity (vec4 clip, vec3 pos, vec3 vel)
+{
+    vec4 prevClip = u_prevViewProj * vec4 (pos - vel * u_stepSeconds, 1.0);
+
+    if (clip.w <= 1.0e-6 || prevClip.w <= 1.0e-6)
+        return vec2 (0.0);
+
+    return (clip.xy / clip.w - prevClip.xy / prevClip.w) * 0.5 * u_viewportSize;
+}
 
 void main()
 {
-    Particle particle = p[gl_VertexID];
+    int index = (u_useVisibleList != 0) ? int (visible[gl_VertexID]) : gl_VertexID;
+    Particle particle = p[index];
     vec4 clip1 = u_viewProj * vec4 (particle.pos.xyz, 1.0);
     gl_Position = clip1;
     gl_PointSize = u_pointSize;
     vColor = particle.color;
+    vVelocity = screenVelocity (clip1, particle.pos.xyz, particle.vel.xyz);
 
     // Screen-space direction (for the "line" particle shape).
     // We derive it by projecting a small step along the particle velocity direction.
@@ -0,0 +1,20 @@
+#version 430 core
+
+in vec4 vColor;
+in vec3 vWorldPos;
+in vec2 vVelocity;
+
+layout (location = 0) out vec4 FragColor;
+layout (location = 2) out vec4 FragVelocity; // motion blur velocity target (pixels), when the scene target has one
+
+// Flat shading: the face normal comes from screen-space derivatives, so the meshes need no normal data.
+// Lighting is two-sided because the wings are single triangles.
+void main()
+{
+    vec3 n = normalize (cross (dFdx (vWorldPos), dFdy (vWorldPos)));
+    vec3 lightDir = normalize (vec3 (0.4, 0.8, 0.45));
+
+    float diffuse = abs (dot (n, lightDir));
+    FragColor = vec4 (vColor.rgb * (0.35 + 0.65 * diffuse), 1.0);
+    FragVelocity = vec4 (vVelocity, 0.0, 1.0);
+}
@@ -0,0 +1,103 @@
+#version 430 core
+
+struct Particle
+{
+    vec4 pos;
+    vec4 vel;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer Particles
+{
+    Particle p[];
+};
+
+// LOD bins from particles_cull.comp (JF_LOD variant); this draw reads one bin starting at u_visibleOffset.
+layout (std430, binding = 4) readonly buffer VisibleIndices
+{
+    uint visible[];
+};
+
+uniform mat4  u_viewProj;       // includes the floating-origin translation (composed in double on the CPU)
+uniform int   u_visibleOffset;  // bin * binStride
+uniform int   u_mesh;           // 0 = bird, 1 = tetrahedron
+uniform float u_meshSize;       // half-length in world units
+uniform float u_time;           // seconds, drives the wing flap
+uniform mat4  u_prevViewProj;   // last frame's u_viewProj
+uniform float u_stepSeconds;    // simulated time of the last step (positions moved by vel * this)
+uniform vec2  u_viewportSize;   // framebuffer pixels
+
+out vec4 vColor;
+out vec3 vWorldPos;
+out vec2 vVelocity;
+
+// Screen-space motion over the last step, in pixels (motion blur velocity target): where the vertex is now against
+// where it was one step ago, seen through last frame's camera, so camera motion blurs too.
+// The mesh is treated as translating rigidly (orientation change and wing flap are ignored).
+vec2 screenVelocity (vec4 clip, vec3 pos, vec3 vel)
+{
+    vec4 prevClip = u_prevViewProj * vec4 (pos - vel * u_stepSeconds, 1.0);
+
+    if (clip.w <= 1.0e-6 || prevClip.w <= 1.0e-6)
+        return vec2 (0.0);
+
+    return (clip.xy / clip.w - prevClip.xy / prevClip.w) * 0.5 * u_viewportSize;
+}
+
+// Meshes live in model space with +x forward, +y up, +z right. Non-indexed triangle lists;
+// the vertex counts must match kBirdVertexCount / kTetraVertexCount in MainComponent.cpp.
+const int kBirdVertexCount = 18;
+const vec3 kBird[kBirdVertexCount] = vec3[] (
+    // Body: a stretched tetrahedron (nose, tail top, tail left, tail right)
+    vec3 ( 1.0,  0.0,  0.0), vec3 (-0.7,  0.15,  0.0), vec3 (-0.7, -0.1,  0.18),
+    vec3 ( 1.0,  0.0,  0.0), vec3 (-0.7, -0.1, -0.18), vec3 (-0.7,  0.15,  0.0),
+    vec3 ( 1.0,  0.0,  0.0), vec3 (-0.7, -0.1,  0.18), vec3 (-0.7, -0.1, -0.18),
+    vec3 (-0.7,  0.15, 0.0), vec3 (-0.7, -0.1, -0.18), vec3 (-0.7, -0.1,  0.18),
+    // Wings (double-sided; the tip vertex flaps)
+    vec3 ( 0.3,  0.02,  0.05), vec3 (-0.3,  0.02,  0.08), vec3 (-0.1,  0.0,  1.0),
+    vec3 ( 0.3,  0.02, -0.05), vec3 (-0.1,  0.0,  -1.0), vec3 (-0.3,  0.02, -0.08)
+);
+
+const int kTetraVertexCount = 12;
+const vec3 kTetra[kTetraVertexCount] = vec3[] (
+    vec3 ( 1.0,  0.0,   0.0),  vec3 (-0.5,  0.5,   0.0),  vec3 (-0.5, -0.25,  0.43),
+    vec3 ( 1.0,  0.0,   0.0),  vec3 (-0.5, -0.25, -0.43), vec3 (-0.5,  0.5,   0.0),
+    vec3 ( 1.0,  0.0,   0.0),  vec3 (-0.5, -0.25,  0.43), vec3 (-0.5, -0.25, -0.43),
+    vec3 (-0.5,  0.5,   0.0),  vec3 (-0.5, -0.25, -0.43), vec3 (-0.5, -0.25,  0.43)
+);
+
+void main()
+{
+    int index = int (visible[u_visibleOffset + gl_InstanceID]);
+    Particle particle = p[index];
+
+    vec3 local;
+
+    if (u_mesh == 0)
+    {
+        local = kBird[gl_VertexID];
+
+        // Wing tips (vertices 14 and 16) flap, phase-shifted per boid so the flock doesn't beat in sync.
+        if (gl_VertexID == 14 || gl_VertexID == 16)
+            local.y += 0.45 * sin (u_time * 14.0 + float (index) * 0.61);
+    }
+    else
+    {
+        local = kTetra[gl_VertexID];
+    }
+
+    // Orientation basis from the velocity (falls back to a fixed up axis when flying straight up/down).
+    vec3 vel = particle.vel.xyz;
+    float velLen = length (vel);
+    vec3 forward = (velLen > 1.0e-6) ? (vel / velLen) : vec3 (1.0, 0.0, 0.0);
+    vec3 upRef = (abs (forward.y) > 0.99) ? vec3 (1.0, 0.0, 0.0) : vec3 (0.0, 1.0, 0.0);
+    vec3 right = normalize (cross (forward, upRef));
+    vec3 up = cross (right, forward);
+
+    vec3 worldPos = particle.pos.xyz + (forward * local.x + up * local.y + right * local.z) * u_meshSize;
+
+    gl_Position = u_viewProj * vec4 (worldPos, 1.0);
+    vColor = particle.color;
+    vWorldPos = worldPos;
+    vVelocity = screenVelocity (gl_Position, worldPos, vel);
+}
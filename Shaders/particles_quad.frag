@@ -0,0 +1,90 @@
+#version 430 core
+
+in vec4 vColor;
+in vec2 vUV;
+in vec2 vVelocity;
+
+// Location 0 is the colour target (or the OIT accumulation target), 1 the OIT revealage target,
+// 2 the motion blur velocity target (pixels; alpha-blended by coverage). Targets take only the locations they have.
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out float FragReveal;
+layout (location = 2) out vec4 FragVelocity;
+
+// 0 = square, 1 = circle, 2 = arrow (points along +x of the quad), 3 = cube (fake shaded sprite)
+uniform int u_shape;
+uniform float u_alphaMul;
+uniform int u_oit; // 1: weighted blended OIT (accumulation + revealage outputs), 0: straight alpha
+
+// Weighted blended OIT (McGuire & Bavoil 2013, eq. 10): near fragments get more weight than far ones,
+// so the order-independent average still reads front-to-back. Blending: accum ONE/ONE, reveal ZERO/ONE_MINUS_SRC_COLOR.
+void writeOutput (vec4 color)
+{
+    FragVelocity = vec4 (vVelocity, 0.0, clamp (color.a, 0.0, 1.0));
+
+    if (u_oit == 0)
+    {
+        FragColor = color;
+        return;
+    }
+
+    float a = clamp (color.a, 0.0, 1.0);
+    float w = clamp (a * max (1.0e-2, 3.0e3 * pow (1.0 - gl_FragCoord.z, 3.0)), 1.0e-2, 3.0e3);
+
+    FragColor  = vec4 (color.rgb * a, a) * w;
+    FragReveal = a;
+}
+
+// Coverage from a signed distance (negative inside), antialiased over one pixel via screen-space derivatives.
+float coverage (float signedDistance)
+{
+    float aa = max (fwidth (signedDistance), 1.0e-4);
+    return clamp (0.5 - signedDistance / aa, 0.0, 1.0);
+}
+
+float sdBox (vec2 p, vec2 halfSize)
+{
+    vec2 d = abs (p) - halfSize;
+    return length (max (d, 0.0)) + min (max (d.x, d.y), 0.0);
+}
+
+// No discard anywhere: shapes fade out analytically, so the depth/early-Z path stays enabled.
+void main()
+{
+    vec2 p = vUV;
+    float alpha = 1.0;
+    vec3 rgb = vColor.rgb;
+
+    if (u_shape == 1) // circle
+    {
+        alpha = coverage (length (p) - 1.0);
+    }
+    else if (u_shape == 2) // arrow: same proportions as the point-sprite "line" shape
+    {
+        float body = sdBox (p - vec2 (-0.15, 0.0), vec2 (0.70, 0.16));
+
+        // Head: triangle from x = 0.55 (half width 0.16) to the tip at x = 1.0.
+        float t = clamp ((p.x - 0.55) / 0.45, 0.0, 1.0);
+        float headHalfWidth = mix (0.16, 0.0, t);
+        float head = max (abs (p.y) - headHalfWidth, max (0.55 - p.x, p.x - 1.0));
+
+        alpha = coverage (min (body, head));
+    }
+    else if (u_shape == 3) // cube-ish shaded sprite (square footprint)
+    {
+        float face = step (0.0, p.x + p.y);
+        float shade = mix (0.75, 1.10, face);
+
+        float edge = 0.0;
+        edge = max (edge, step (0.92, abs (p.x)));
+        edge = max (edge, step (0.92, abs (p.y)));
+        edge = max (edge, 1.0 - step (0.06, abs (p.x + p.y)));
+
+        rgb = mix (rgb * shade, vec3 (1.0), edge * 0.15);
+    }
+    else // square
+    {
+        alpha = coverage (sdBox (p, vec2 (1.0)));
+    }
+
+    writeOutput (vec4 (rgb, vColor.a * u_alphaMul * alpha));
+}
@@ -0,0 +1,87 @@
+#version 430 core
+
+struct Particle
+{
+    vec4 pos;
+    vec4 vel;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer Particles
+{
+    Particle p[];
+};
+
+// Compacted visible indices from particles_cull.comp (used when frustum culling is on).
+layout (std430, binding = 4) readonly buffer VisibleIndices
+{
+    uint visible[];
+};
+
+uniform int   u_useVisibleList;
+uniform mat4  u_viewProj;       // includes the floating-origin translation (composed in double on the CPU)
+uniform vec2  u_projScale;      // projection matrix [0][0], [1][1]: view-space size -> clip-space size
+uniform vec2  u_viewportSize;   // framebuffer pixels
+uniform float u_quadSize;       // quad half-size in world units (shrinks with distance like real geometry)
+uniform float u_minPixelSize;   // half-size floor in pixels, so far boids don't vanish into sub-pixel slivers
+uniform int   u_velocityAligned; // 0 = screen-aligned billboard, 1 = long axis along the projected velocity
+uniform mat4  u_prevViewProj;   // last frame's u_viewProj
+uniform float u_stepSeconds;    // simulated time of the last step (positions moved by vel * this)
+
+out vec4 vColor;
+out vec2 vUV;                   // -1..1 across the quad (x = along, y = across when velocity-aligned)
+out vec2 vVelocity;
+
+// Screen-space motion over the last step, in pixels (motion blur velocity target): where the point is now against
+// where it was one step ago, seen through last frame's camera, so camera motion blurs too.
+vec2 screenVelocity (vec4 clip, vec3 pos, vec3 vel)
+{
+    vec4 prevClip = u_prevViewProj * vec4 (pos - vel * u_stepSeconds, 1.0);
+
+    if (clip.w <= 1.0e-6 || prevClip.w <= 1.0e-6)
+        return vec2 (0.0);
+
+    return (clip.xy / clip.w - prevClip.xy / prevClip.w) * 0.5 * u_viewportSize;
+}
+
+// Vertex pulling: one instance per boid, 4 vertices as a triangle strip; no vertex buffers.
+void main()
+{
+    int index = (u_useVisibleList != 0) ? int (visible[gl_InstanceID]) : gl_InstanceID;
+    Particle particle = p[index];
+
+    // Strip order: (-1,-1), (1,-1), (-1,1), (1,1)
+    vec2 corner = vec2 (float (gl_VertexID & 1), float ((gl_VertexID >> 1) & 1)) * 2.0 - 1.0;
+
+    vec4 clip = u_viewProj * vec4 (particle.pos.xyz, 1.0);
+    float w = max (clip.w, 1.0e-6);
+    vVelocity = screenVelocity (clip, particle.pos.xyz, particle.vel.xyz);
+
+    // Work in pixels so the quad stays square on non-square viewports.
+    vec2 halfViewport = 0.5 * u_viewportSize;
+    float halfPx = max (u_quadSize * u_projScale.y / w * halfViewport.y, u_minPixelSize);
+
+    vec2 axisX = vec2 (1.0, 0.0);
+    vec2 axisY = vec2 (0.0, 1.0);
+
+    if (u_velocityAligned != 0)
+    {
+        // Screen-space heading: project a short step along the velocity.
+        vec3 vel = particle.vel.xyz;
+        float velLen = length (vel);
+        vec3 dirW = (velLen > 1.0e-6) ? (vel / velLen) : vec3 (1.0, 0.0, 0.0);
+        vec4 clip2 = u_viewProj * vec4 (particle.pos.xyz + dirW * 0.1, 1.0);
+
+        vec2 d = (clip2.xy / max (abs (clip2.w), 1.0e-6) - clip.xy / w) * halfViewport;
+        float dLen = length (d);
+        axisX = (dLen > 1.0e-6) ? (d / dLen) : vec2 (1.0, 0.0);
+        axisY = vec2 (-axisX.y, axisX.x);
+    }
+
+    vec2 offsetPx = (corner.x * axisX + corner.y * axisY) * halfPx;
+    clip.xy += offsetPx / halfViewport * clip.w;
+
+    gl_Position = clip;
+    vColor = particle.color;
+    vUV = corner;
+}
@@ -0,0 +1,28 @@
+#version 430 core
+
+// HDR resolve: scene + bloom, exposure, then the ACES filmic fit (Narkowicz 2015) down to [0, 1].
+// Particle colours are authored as display values (HSV in boids_step.comp), so no extra sRGB encode is applied.
+in vec2 vUV;
+out vec4 FragColor;
+
+uniform sampler2D u_scene;
+uniform sampler2D u_bloom;          // bloom chain level 0 (lower resolution, bilinear upscaled here)
+uniform float u_bloomStrength;
+uniform float u_exposure;
+uniform int u_toneMap;              // 0: plain clamp (scene target used only for motion blur, same look as without it)
+
+vec3 acesFilm (vec3 x)
+{
+    const float a = 2.51;
+    const float b = 0.03;
+    const float c = 2.43;
+    const float d = 0.59;
+    const float e = 0.14;
+    return clamp ((x * (a * x + b)) / (x * (c * x + d) + e), 0.0, 1.0);
+}
+
+void main()
+{
+    vec3 hdr = texture (u_scene, vUV).rgb + texture (u_bloom, vUV).rgb * u_bloomStrength;
+    FragColor = vec4 (u_toneMap != 0 ? acesFilm (hdr * u_exposure) : clamp (hdr, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,58 @@
+#version 430 core
+
+// Motion trails: one instance per particle, drawn as GL_LINES with two vertices per segment and no vertex buffers.
+// Trail point 0 is the live position, so the trail always reaches the boid; point k >= 1 is the k-th newest
+// sample in the history ring written by trails_record.comp.
+
+struct Particle
+{
+    vec4 pos;
+    vec4 vel;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer Particles
+{
+    Particle p[];
+};
+
+layout (std430, binding = 11) readonly buffer TrailHistory
+{
+    vec4 history[];
+};
+
+uniform mat4  u_viewProj;
+uniform int   u_capacity;
+uniform int   u_head;        // newest slot
+uniform int   u_trailLength; // slots in the ring (= segments per trail)
+uniform float u_alphaMul;
+uniform float u_maxSegment;  // longer segments are jumps (wrapped bounds), not motion, and are collapsed
+
+out vec4 vColor;
+
+vec3 trailPoint (int particle, int k)
+{
+    if (k == 0)
+        return p[particle].pos.xyz;
+
+    int slot = (u_head - (k - 1) + u_trailLength) % u_trailLength;
+    return history[slot * u_capacity + particle].xyz;
+}
+
+void main()
+{
+    int particle = gl_InstanceID;
+    int segment = gl_VertexID >> 1;
+    int k = segment + (gl_VertexID & 1);
+
+    vec3 a = trailPoint (particle, segment);
+    vec3 b = trailPoint (particle, segment + 1);
+    vec3 pos = (k == segment || distance (a, b) > u_maxSegment) ? a : b;
+
+    gl_Position = u_viewProj * vec4 (pos, 1.0);
+
+    // Fades linearly with age, from the particle's own alpha at the head to zero at the oldest sample.
+    vec4 color = p[particle].color;
+    float fade = 1.0 - float (k) / float (u_trailLength);
+    vColor = vec4 (color.rgb, color.a * u_alphaMul * fade);
+}
@@ -0,0 +1,63 @@
+#version 430 core
+
+// Volume render mode, step 2: emission-absorption raymarch through the density texture written by
+// volume_density.comp. Each boid blocks roughly its sprite's area, so extinction = count / cellVolume * crossSection.
+// Output is premultiplied (blend ONE, ONE_MINUS_SRC_ALPHA).
+in vec2 vUV;
+out vec4 FragColor;
+
+uniform sampler3D u_volume;
+uniform mat4  u_invViewProj;
+uniform vec3  u_boxMin;          // grid bounds, origin-relative like the particle positions
+uniform vec3  u_boxMax;
+uniform float u_extinctionScale; // crossSection / cellVolume * alpha multiplier: count -> extinction per world unit
+uniform float u_stepSize;        // world units
+uniform int   u_maxSteps;
+
+vec3 unproject (vec2 ndc, float z)
+{
+    vec4 p = u_invViewProj * vec4 (ndc, z, 1.0);
+    return p.xyz / p.w;
+}
+
+void main()
+{
+    vec2 ndc = vUV * 2.0 - 1.0;
+    vec3 rayStart = unproject (ndc, -1.0);
+    vec3 rayDir = normalize (unproject (ndc, 1.0) - rayStart);
+
+    // Slab test against the grid box.
+    vec3 invDir = 1.0 / rayDir;
+    vec3 t0 = (u_boxMin - rayStart) * invDir;
+    vec3 t1 = (u_boxMax - rayStart) * invDir;
+    float tEnter = max (max (min (t0.x, t1.x), min (t0.y, t1.y)), max (min (t0.z, t1.z), 0.0));
+    float tExit  = min (min (max (t0.x, t1.x), max (t0.y, t1.y)), max (t0.z, t1.z));
+
+    if (tExit <= tEnter)
+    {
+        FragColor = vec4 (0.0);
+        return;
+    }
+
+    vec3 boxScale = 1.0 / (u_boxMax - u_boxMin);
+    vec3 color = vec3 (0.0);
+    float transmittance = 1.0;
+
+    // Jitter the first sample per pixel so the step size shows up as fine noise rather than banding.
+    float jitter = fract (52.9829189 * fract (dot (gl_FragCoord.xy, vec2 (0.06711056, 0.00583715))));
+    float t = tEnter + jitter * u_stepSize;
+
+    for (int step = 0; step < u_maxSteps && t < tExit; ++step, t += u_stepSize)
+    {
+        vec4 voxel = texture (u_volume, (rayStart + rayDir * t - u_boxMin) * boxScale);
+        float alpha = 1.0 - exp (-voxel.a * u_extinctionScale * u_stepSize);
+
+        color += transmittance * alpha * (voxel.rgb / max (voxel.a, 1.0e-3));
+        transmittance *= 1.0 - alpha;
+
+        if (transmittance < 0.01)
+            break;
+    }
+
+    FragColor = vec4 (color, 1.0 - transmittance);
+}
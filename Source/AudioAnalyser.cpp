@@ -0,0 +1,328 @@
+#include "AudioAnalyser.h"
+
+namespace
+{
+    constexpr float kBandEdgesHz[AudioAnalyser::numBands + 1] = { 20.0f, 150.0f, 800.0f, 4000.0f, 12000.0f };
+
+    // Each band reads 0..1 over this range below its peak; the peak falls slowly and never below the floor + range,
+    // so silence reads 0 rather than being stretched to full scale.
+    constexpr float kRangeDb = 40.0f;
+    constexpr float kFloorDb = -90.0f;
+    constexpr float kPeakFallDbPerSecond = 3.0f;
+
+    constexpr float kOnsetThreshold = 1.5f;         // flux above this times its running mean
+    constexpr double kOnsetMeanSeconds = 0.25;      // time constant of that mean
+    constexpr double kMinOnsetGapSeconds = 0.06;
+
+    constexpr int kFileBlockSize = 512;
+
+    float toDecibels (float power)
+    {
+        return 10.0f * std::log10 (power + 1.0e-20f);
+    }
+}
+
+//==============================================================================
+AudioAnalyser::AudioAnalyser()
+    : juce::Thread ("Audio file analysis")
+{
+    formatManager.registerBasicFormats();
+}
+
+AudioAnalyser::~AudioAnalyser()
+{
+    stop();
+}
+
+bool AudioAnalyser::startInput (juce::String& error)
+{
+    stop();
+
+    if (const auto result = deviceManager.initialiseWithDefaultDevices (2, 0); result.isNotEmpty())
+    {
+        error = "Can't open the audio input: " + result;
+        return false;
+    }
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+
+    if (device == nullptr || device->getActiveInputChannels().isZero())
+    {
+        deviceManager.closeAudioDevice();
+        error = "No audio input device is available";
+        return false;
+    }
+
+    sourceName = device->getName();
+    deviceOpen = true;
+    running.store (true);
+    deviceManager.addAudioCallback (this); // calls audioDeviceAboutToStart(), which prepares the analysis
+    return true;
+}
+
+bool AudioAnalyser::startFile (const juce::File& file, juce::String& error)
+{
+    stop();
+
+    fileReader = std::unique_ptr<juce::AudioFormatReader> (formatManager.createReaderFor (file));
+
+    if (fileReader == nullptr || fileReader->lengthInSamples <= 0 || fileReader->sampleRate <= 0.0)
+    {
+        fileReader = nullptr;
+        error = file.getFileName() + " isn't an audio file this build can read";
+        return false;
+    }
+
+    fileBlock.setSize (juce::jlimit (1, 2, (int) fileReader->numChannels), kFileBlockSize);
+    prepare (fileReader->sampleRate);
+
+    sourceName = file.getFileName();
+    running.store (true);
+    startThread();
+    return true;
+}
+
+void AudioAnalyser::stop()
+{
+    if (deviceOpen)
+    {
+        deviceManager.removeAudioCallback (this);
+        deviceManager.closeAudioDevice();
+        deviceOpen = false;
+    }
+
+    stopThread (2000);
+    fileReader = nullptr;
+
+    running.store (false);
+    sourceName.clear();
+}
+
+std::vector<AudioAnalyser::Frame> AudioAnalyser::analyse (const juce::AudioBuffer<float>& buffer, double sampleRate)
+{
+    jassert (! isRunning() && sampleRate > 0.0);
+
+    std::vector<Frame> frames;
+    frames.reserve ((size_t) (buffer.getNumSamples() / hopSize));
+
+    prepare (sampleRate);
+    process (buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getNumSamples(), &frames);
+    return frames;
+}
+
+//==============================================================================
+void AudioAnalyser::audioDeviceIOCallbackWithContext (const float* const* inputChannelData, int numInputChannels,
+                                                      float* const* outputChannelData, int numOutputChannels,
+                                                      int numSamples, const juce::AudioIODeviceCallbackContext&)
+{
+    process (inputChannelData, numInputChannels, numSamples);
+
+    for (int channel = 0; channel < numOutputChannels; ++channel)
+        if (outputChannelData[channel] != nullptr)
+            juce::FloatVectorOperations::clear (outputChannelData[channel], numSamples);
+}
+
+void AudioAnalyser::audioDeviceAboutToStart (juce::AudioIODevice* device)
+{
+    prepare (device->getCurrentSampleRate());
+}
+
+void AudioAnalyser::audioDeviceStopped()
+{
+}
+
+// Plays the file into the analysis at the rate a device would, so modulation responds as it would live.
+void AudioAnalyser::run()
+{
+    const auto sampleRate = fileReader->sampleRate;
+    const auto length = fileReader->lengthInSamples;
+    juce::int64 position = 0;
+    auto nextBlockMs = juce::Time::getMillisecondCounterHiRes();
+
+    while (! threadShouldExit())
+    {
+        const auto numSamples = (int) juce::jmin ((juce::int64) kFileBlockSize, length - position);
+
+        fileReader->read (&fileBlock, 0, numSamples, position, true, true);
+        process (fileBlock.getArrayOfReadPointers(), fileBlock.getNumChannels(), numSamples);
+
+        position += numSamples;
+        if (position >= length)
+            position = 0;
+
+        nextBlockMs += 1000.0 * numSamples / sampleRate;
+        const auto aheadMs = nextBlockMs - juce::Time::getMillisecondCounterHiRes();
+
+        if (aheadMs > 1.0)
+            wait ((int) aheadMs);
+        else if (aheadMs < -250.0)
+            nextBlockMs = juce::Time::getMillisecondCounterHiRes(); // fell far behind (debugger, sleep): don't race
+    }
+}
+
+//==============================================================================
+void AudioAnalyser::prepare (double sampleRate)
+{
+    const auto binHz = (float) sampleRate / (float) fftSize;
+
+    for (int i = 0; i <= numBands; ++i)
+        bandFirstBin[i] = juce::jlimit (1, fftSize / 2, juce::roundToInt (kBandEdgesHz[i] / binHz));
+
+    history.fill (0.0f);
+    previousMagnitudes.fill (0.0f);
+    historyPos = 0;
+    samplesSinceHop = 0;
+    hopSeconds = hopSize / sampleRate;
+
+    for (auto& peak : bandPeaksDb)
+        peak = kFloorDb + kRangeDb;
+
+    fluxMean = 0.0f;
+    previousFlux = 0.0f;
+    secondsSinceOnset = kMinOnsetGapSeconds;
+}
+
+// Frames go to the consumer's queue, or to offlineFrames when analyse() passes one.
+void AudioAnalyser::process (const float* const* channels, int numChannels, int numSamples, std::vector<Frame>* offlineFrames)
+{
+    const auto gain = numChannels > 0 ? 1.0f / (float) numChannels : 0.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float mono = 0.0f;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            if (channels[channel] != nullptr)
+                mono += channels[channel][i];
+
+        history[(size_t) historyPos] = mono * gain;
+        historyPos = (historyPos + 1) % fftSize;
+
+        if (++samplesSinceHop == hopSize)
+        {
+            samplesSinceHop = 0;
+            const auto frame = analyseHop();
+
+            if (offlineFrames != nullptr)
+                offlineFrames->push_back (frame);
+            else
+                push (frame);
+        }
+    }
+}
+
+AudioAnalyser::Frame AudioAnalyser::analyseHop()
+{
+    // Oldest sample first.
+    float hopPower = 0.0f;
+
+    for (int i = 0; i < fftSize; ++i)
+    {
+        const auto sample = history[(size_t) ((historyPos + i) % fftSize)];
+        fftData[(size_t) i] = sample;
+
+        if (i >= fftSize - hopSize)
+            hopPower += sample * sample;
+    }
+
+    std::fill (fftData.begin() + fftSize, fftData.end(), 0.0f);
+    window.multiplyWithWindowingTable (fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform (fftData.data());
+
+    // Scaled so that a full-scale sine reads about 1 (the Hann window halves the amplitude).
+    const auto scale = 4.0f / (float) fftSize;
+    float flux = 0.0f;
+
+    for (int bin = 1; bin < fftSize / 2; ++bin)
+    {
+        const auto magnitude = fftData[(size_t) bin] * scale;
+        flux += juce::jmax (0.0f, magnitude - previousMagnitudes[(size_t) bin]);
+        previousMagnitudes[(size_t) bin] = magnitude;
+    }
+
+    float levelsDb[numBands + 1];
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        float power = 0.0f;
+
+        for (int bin = bandFirstBin[band]; bin < bandFirstBin[band + 1]; ++bin)
+            power += juce::square (fftData[(size_t) bin] * scale);
+
+        levelsDb[band] = toDecibels (power / (float) juce::jmax (1, bandFirstBin[band + 1] - bandFirstBin[band]));
+    }
+
+    levelsDb[numBands] = toDecibels (hopPower / (float) hopSize);
+
+    Frame frame;
+
+    for (int i = 0; i <= numBands; ++i)
+    {
+        auto& peak = bandPeaksDb[i];
+        peak = juce::jmax (levelsDb[i], peak - kPeakFallDbPerSecond * (float) hopSeconds, kFloorDb + kRangeDb);
+
+        const auto value = juce::jlimit (0.0f, 1.0f, (levelsDb[i] - (peak - kRangeDb)) / kRangeDb);
+
+        if (i < numBands)
+            frame.bands[i] = value;
+        else
+            frame.level = value;
+    }
+
+    // Onset: a rising flux well above its recent mean, and not right after the last one.
+    secondsSinceOnset += hopSeconds;
+
+    if (flux > fluxMean * kOnsetThreshold && flux > previousFlux && flux > 1.0e-4f
+        && secondsSinceOnset >= kMinOnsetGapSeconds)
+    {
+        frame.onset = 1.0f;
+        secondsSinceOnset = 0.0;
+    }
+
+    fluxMean += (flux - fluxMean) * (float) (1.0 - std::exp (-hopSeconds / kOnsetMeanSeconds));
+    previousFlux = flux;
+
+    return frame;
+}
+
+void AudioAnalyser::push (const Frame& frame)
+{
+    if (fifo.getFreeSpace() == 0)
+        return;
+
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+    queue[(size_t) start1] = frame;
+    fifo.finishedWrite (1);
+}
+
+//==============================================================================
+int AudioAnalyser::popFrames (Frame& latest)
+{
+    const auto numReady = fifo.getNumReady();
+
+    if (numReady == 0)
+        return 0;
+
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+    float onset = 0.0f;
+
+    const auto take = [this, &latest, &onset] (int index)
+    {
+        latest = queue[(size_t) index];
+        onset = juce::jmax (onset, latest.onset);
+    };
+
+    for (int i = 0; i < size1; ++i)
+        take (start1 + i);
+
+    for (int i = 0; i < size2; ++i)
+        take (start2 + i);
+
+    fifo.finishedRead (size1 + size2);
+
+    latest.onset = onset;
+    return size1 + size2;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Live audio analysis for audio-reactive modulation: band energies, overall level and onsets.
+
+    Audio comes from the default input device (analysed on its audio callback) or from an audio file such as a WAV,
+    which a feeder thread plays through the same analysis at real-time pace, looping - so the look can be tuned and
+    tested with a known track and no device. Nothing is played back.
+
+    Every hop of hopSize samples, the last fftSize samples are windowed (Hann) and transformed. Each Frame holds:
+
+    - bands: energy in four bands (bass 20-150 Hz, low mid 150-800 Hz, high mid 800-4000 Hz, treble 4-12 kHz) and
+      the overall level, each mapped to 0..1 over the 40 dB below its own slowly falling peak, so the response
+      doesn't depend on the input gain;
+    - onset: 1 for a hop where the spectral flux (summed rise of the magnitudes) jumps above its running mean,
+      at most one every 60 ms, else 0.
+
+    The analysis allocates nothing and takes no locks. Frames go to the consumer through a lock-free single-producer
+    ring; a full ring drops the new frame (the consumer is expected to drain it every rendered frame).
+
+    start...() and stop() must be called on the message thread, popFrames() on one consumer thread (the GL thread).
+    analyse() runs the same analysis synchronously over a whole buffer, for tests and offline use.
+*/
+class AudioAnalyser final : private juce::AudioIODeviceCallback,
+                            private juce::Thread
+{
+public:
+    //==============================================================================
+    static constexpr int numBands = 4;
+    static constexpr int fftOrder = 10;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 2;     // frame k covers the fftSize samples up to (k + 1) * hopSize
+
+    struct Frame
+    {
+        float bands[numBands] {};   // bass, low mid, high mid, treble; 0..1
+        float level = 0.0f;         // 0..1
+        float onset = 0.0f;         // 1 at a detected onset
+    };
+
+    AudioAnalyser();
+    ~AudioAnalyser() override;
+
+    /** Opens the default audio input device. On failure, error says why. */
+    bool startInput (juce::String& error);
+
+    /** Analyses an audio file (any format JUCE reads) at real-time pace, looping. On failure, error says why. */
+    bool startFile (const juce::File& file, juce::String& error);
+
+    void stop();
+
+    /** Analyses a whole buffer at once from a fresh state and returns one Frame per hop, as the live analysis would
+        have queued them. Must not be called while a live source is running.
+    */
+    std::vector<Frame> analyse (const juce::AudioBuffer<float>& buffer, double sampleRate);
+
+    bool isRunning() const noexcept                 { return running.load(); }
+    juce::String getSourceName() const              { return sourceName; } // message thread
+
+    /** Takes every frame queued since the last call: latest gets the newest bands and level and the largest onset
+        among them. Returns the number of frames taken (0 leaves latest untouched).
+    */
+    int popFrames (Frame& latest);
+
+private:
+    //==============================================================================
+    void audioDeviceIOCallbackWithContext (const float* const* inputChannelData, int numInputChannels,
+                                           float* const* outputChannelData, int numOutputChannels,
+                                           int numSamples, const juce::AudioIODeviceCallbackContext& context) override;
+    void audioDeviceAboutToStart (juce::AudioIODevice* device) override;
+    void audioDeviceStopped() override;
+
+    void run() override; // file feeder
+
+    void prepare (double sampleRate);
+    void process (const float* const* channels, int numChannels, int numSamples, std::vector<Frame>* offlineFrames = nullptr);
+    Frame analyseHop();
+    void push (const Frame& frame);
+
+    static constexpr int queueSize = 64;
+
+    // Sources (message thread)
+    juce::AudioDeviceManager deviceManager;
+    bool deviceOpen = false;
+    juce::AudioFormatManager formatManager;
+    std::unique_ptr<juce::AudioFormatReader> fileReader;
+    juce::String sourceName;
+    std::atomic<bool> running { false };
+
+    // Analysis (audio callback or feeder thread, one at a time)
+    juce::dsp::FFT fft { fftOrder };
+    juce::dsp::WindowingFunction<float> window { (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann, false };
+    juce::AudioBuffer<float> fileBlock;
+    std::array<float, (size_t) fftSize> history {};         // mono ring of the last fftSize samples
+    std::array<float, (size_t) fftSize * 2> fftData {};
+    std::array<float, (size_t) fftSize / 2> previousMagnitudes {};
+    int historyPos = 0;
+    int samplesSinceHop = 0;
+    double hopSeconds = 0.0;
+    int bandFirstBin[numBands + 1] {};
+    float bandPeaksDb[numBands + 1] {};     // bands, then the level
+    float fluxMean = 0.0f;
+    float previousFlux = 0.0f;
+    double secondsSinceOnset = 0.0;
+
+    // Analysis -> consumer
+    juce::AbstractFifo fifo { queueSize };
+    std::array<Frame, (size_t) queueSize> queue;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioAnalyser)
+};
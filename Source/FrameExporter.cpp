@@ -0,0 +1,355 @@
+#include "FrameExporter.h"
+
+using namespace juce::gl;
+
+//==============================================================================
+FrameExporter::FrameExporter()
+    : juce::Thread ("Frame encoder")
+{
+}
+
+FrameExporter::~FrameExporter()
+{
+    // The PBOs must be released on the GL thread (stop()) before destruction.
+    jassert (! isExporting());
+    stopThread (10000);
+}
+
+bool FrameExporter::start (const Settings& newSettings, juce::String& errorOut)
+{
+    jassert (! isExporting());
+
+    settings = newSettings;
+    settings.width = juce::jmax (1, settings.width);
+    settings.height = juce::jmax (1, settings.height);
+    settings.framesPerSecond = juce::jlimit (1.0, 1000.0, settings.framesPerSecond);
+    frameBytes = (size_t) settings.width * (size_t) settings.height * 4;
+
+    if (const auto result = settings.directory.createDirectory(); result.failed())
+    {
+        errorOut = "Can't create " + settings.directory.getFullPathName() + ": " + result.getErrorMessage();
+        return false;
+    }
+
+    error.clear();
+    writeFailed = false;
+
+    if (! writeSidecar())
+    {
+        errorOut = error;
+        return false;
+    }
+
+    if (settings.format == Format::rawVideo)
+    {
+        const auto file = settings.directory.getChildFile ("frames.bgra");
+        file.deleteFile();
+        rawStream = std::make_unique<juce::FileOutputStream> (file);
+
+        if (rawStream->failedToOpen())
+        {
+            errorOut = "Can't write " + file.getFullPathName() + ": " + rawStream->getStatus().getErrorMessage();
+            rawStream.reset();
+            return false;
+        }
+
+        rawFrame.allocate (frameBytes, false);
+    }
+
+    for (auto& pending : queue)
+        pending.pixels.allocate (frameBytes, false);
+
+    for (auto& pixelBuffer : pixelBuffers)
+    {
+        glGenBuffers (1, &pixelBuffer.buffer);
+        glBindBuffer (GL_PIXEL_PACK_BUFFER, pixelBuffer.buffer);
+        glBufferData (GL_PIXEL_PACK_BUFFER, (GLsizeiptr) frameBytes, nullptr, GL_STREAM_READ);
+    }
+
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+
+    nextPixelBuffer = 0;
+    oldestPixelBuffer = 0;
+    pixelBuffersInFlight = 0;
+    nextFrameNumber = 0;
+
+    framesCaptured = 0;
+    framesWritten = 0;
+    droppedFrames = 0;
+    encodeMilliseconds = 0.0f;
+
+    exporting = true;
+    startThread();
+    return true;
+}
+
+bool FrameExporter::stop()
+{
+    if (! exporting.exchange (false))
+        return error.isEmpty();
+
+    // Everything captured so far goes to disk: wait out the readbacks in flight, then let the encoder drain.
+    while (pixelBuffersInFlight > 0 && handOverOldest (true))
+    {
+    }
+
+    // A readback that hasn't finished within the timeout never reaches the encoder: those frames are lost.
+    if (pixelBuffersInFlight > 0)
+    {
+        droppedFrames += pixelBuffersInFlight;
+
+        if (error.isEmpty())
+            error = juce::String (pixelBuffersInFlight) + " captured frame(s) dropped: their readback didn't finish within 1 s";
+    }
+
+    releasePixelBuffers();
+
+    signalThreadShouldExit();
+    notify();
+    stopThread (30000);
+
+    if (rawStream != nullptr)
+    {
+        rawStream->flush();
+
+        if (rawStream->getStatus().failed() && error.isEmpty())
+            error = "Can't write " + rawStream->getFile().getFullPathName() + ": " + rawStream->getStatus().getErrorMessage();
+
+        rawStream.reset();
+    }
+
+    rawFrame.free();
+
+    for (auto& pending : queue)
+        pending.pixels.free();
+
+    return ! writeFailed && error.isEmpty();
+}
+
+bool FrameExporter::captureFrame (unsigned int sourceFrameBuffer)
+{
+    jassert (isExporting());
+
+    pollReadbacks();
+
+    if (pixelBuffersInFlight == numPixelBuffers && ! (settings.waitInsteadOfDropping && handOverOldest (true)))
+    {
+        ++droppedFrames;
+        return false;
+    }
+
+    auto& pixelBuffer = pixelBuffers[nextPixelBuffer];
+
+    GLint previousReadFrameBuffer = 0;
+    glGetIntegerv (GL_READ_FRAMEBUFFER_BINDING, &previousReadFrameBuffer);
+
+    glBindFramebuffer (GL_READ_FRAMEBUFFER, sourceFrameBuffer);
+    glReadBuffer (sourceFrameBuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, pixelBuffer.buffer);
+    glPixelStorei (GL_PACK_ALIGNMENT, 4);
+
+    // BGRA is both the fast path for most drivers and juce::Image's in-memory order, so nothing gets swizzled.
+    glReadPixels (0, 0, settings.width, settings.height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer (GL_READ_FRAMEBUFFER, (GLuint) previousReadFrameBuffer);
+
+    pixelBuffer.fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pixelBuffer.frameNumber = nextFrameNumber++;
+
+    nextPixelBuffer = (nextPixelBuffer + 1) % numPixelBuffers;
+    ++pixelBuffersInFlight;
+    ++framesCaptured;
+    return true;
+}
+
+void FrameExporter::pollReadbacks()
+{
+    while (pixelBuffersInFlight > 0 && handOverOldest (false))
+    {
+    }
+}
+
+// Copies the oldest readback into a free queue slot. Without wait, gives up (returning false) if its fence hasn't
+// signalled or the queue is full; with wait, blocks for both (the queue only stays full while the encoder runs).
+bool FrameExporter::handOverOldest (bool wait)
+{
+    auto& pixelBuffer = pixelBuffers[oldestPixelBuffer];
+
+    const auto status = glClientWaitSync (pixelBuffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                          wait ? (GLuint64) 1000000000 : 0); // 1 s safety timeout
+
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+
+    while (fifo.getFreeSpace() == 0)
+    {
+        if (! wait || ! isThreadRunning())
+            return false;
+
+        juce::Thread::sleep (1);
+    }
+
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+    auto& pending = queue[(size_t) start1];
+
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, pixelBuffer.buffer);
+
+    if (const auto* mapped = glMapBufferRange (GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) frameBytes, GL_MAP_READ_BIT))
+    {
+        std::memcpy (pending.pixels.getData(), mapped, frameBytes);
+        glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+
+        pending.frameNumber = pixelBuffer.frameNumber;
+        fifo.finishedWrite (1);
+        notify();
+    }
+    else
+    {
+        ++droppedFrames;
+    }
+
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+
+    glDeleteSync (pixelBuffer.fence);
+    pixelBuffer.fence = nullptr;
+    oldestPixelBuffer = (oldestPixelBuffer + 1) % numPixelBuffers;
+    --pixelBuffersInFlight;
+    return true;
+}
+
+void FrameExporter::releasePixelBuffers()
+{
+    for (auto& pixelBuffer : pixelBuffers)
+    {
+        if (pixelBuffer.fence != nullptr)
+            glDeleteSync (pixelBuffer.fence);
+
+        if (pixelBuffer.buffer != 0)
+            glDeleteBuffers (1, &pixelBuffer.buffer);
+
+        pixelBuffer = {};
+    }
+
+    pixelBuffersInFlight = 0;
+}
+
+// A note next to the frames with the ffmpeg command that turns them into a video.
+bool FrameExporter::writeSidecar()
+{
+    const auto size = juce::String (settings.width) + "x" + juce::String (settings.height);
+    const auto fps = juce::String (settings.framesPerSecond, 3).trimCharactersAtEnd ("0").trimCharactersAtEnd (".");
+
+    juce::String text;
+    text << "JuicyFlock frame export: " << size << " at " << fps << " fps\n\n";
+
+    if (settings.format == Format::rawVideo)
+        text << "ffmpeg -f rawvideo -pix_fmt bgra -s " << size << " -r " << fps
+             << " -i frames.bgra -c:v libx264 -pix_fmt yuv420p -crf 16 flock.mp4\n";
+    else
+        text << "ffmpeg -framerate " << fps << " -i frame_%06d.png -c:v libx264 -pix_fmt yuv420p -crf 16 flock.mp4\n";
+
+    const auto file = settings.directory.getChildFile ("export.txt");
+
+    if (! file.replaceWithText (text))
+    {
+        error = "Can't write " + file.getFullPathName();
+        return false;
+    }
+
+    return true;
+}
+
+//==============================================================================
+// Same shape as TrajectoryRecorder::run(): a frame leaves the queue once it's written, so stop() can drain it.
+void FrameExporter::run()
+{
+    for (;;)
+    {
+        if (fifo.getNumReady() == 0)
+        {
+            if (threadShouldExit())
+                return;
+
+            wait (50);
+            continue;
+        }
+
+        int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+        fifo.prepareToRead (1, start1, size1, start2, size2);
+        auto& pending = queue[(size_t) start1];
+
+        if (! writeFailed)
+        {
+            const auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+            if (writeFrame (pending))
+            {
+                ++framesWritten;
+                encodeMilliseconds = (float) (0.9 * encodeMilliseconds.load() + 0.1 * (juce::Time::getMillisecondCounterHiRes() - startMs));
+            }
+            else
+            {
+                writeFailed = true;
+            }
+        }
+
+        fifo.finishedRead (1);
+    }
+}
+
+bool FrameExporter::writeFrame (PendingFrame& pending)
+{
+    if (settings.format == Format::rawVideo)
+    {
+        flipToOpaque (pending.pixels.getData(), rawFrame.getData(), settings.width * 4);
+
+        if (! rawStream->write (rawFrame.getData(), frameBytes))
+        {
+            error = "Can't write " + rawStream->getFile().getFullPathName() + " (disk full?)";
+            return false;
+        }
+
+        return true;
+    }
+
+    juce::Image image (juce::Image::ARGB, settings.width, settings.height, false);
+
+    {
+        const juce::Image::BitmapData bitmap (image, juce::Image::BitmapData::writeOnly);
+        jassert (bitmap.pixelStride == 4);
+        flipToOpaque (pending.pixels.getData(), bitmap.data, bitmap.lineStride);
+    }
+
+    const auto file = settings.directory.getChildFile ("frame_" + juce::String (pending.frameNumber).paddedLeft ('0', 6) + ".png");
+    file.deleteFile();
+
+    juce::FileOutputStream out (file);
+
+    if (out.failedToOpen() || ! pngFormat.writeImageToStream (image, out))
+    {
+        error = "Can't write " + file.getFullPathName() + ": " + out.getStatus().getErrorMessage();
+        return false;
+    }
+
+    return true;
+}
+
+// Rows are reversed (glReadPixels starts at the bottom) and alpha set to 255: blending leaves the framebuffer's
+// alpha meaningless, and an image viewer or encoder would otherwise show the frame see-through.
+void FrameExporter::flipToOpaque (const juce::uint8* bottomUp, juce::uint8* topDown, int destLineStride) const
+{
+    const auto rowBytes = (size_t) settings.width * 4;
+
+    for (int y = 0; y < settings.height; ++y)
+    {
+        const auto* src = bottomUp + (size_t) (settings.height - 1 - y) * rowBytes;
+        auto* dest = topDown + (size_t) y * (size_t) destLineStride;
+
+        std::memcpy (dest, src, rowBytes);
+
+        for (size_t x = 3; x < rowBytes; x += 4)
+            dest[x] = 0xff;
+    }
+}
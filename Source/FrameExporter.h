@@ -0,0 +1,126 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Captures rendered frames and writes them to disk as a PNG sequence or as raw video, without stalling the GL thread.
+
+    captureFrame() starts an asynchronous glReadPixels of a framebuffer into the next pixel buffer object of a small
+    ring and fences it. Later calls hand every PBO whose fence has signalled to the encoder thread - one copy, from the
+    mapped PBO into a queue slot - so the GPU->CPU transfer overlaps the next frames' rendering. The encoder thread
+    flips the rows (GL's origin is bottom-left), forces alpha opaque and writes the frame.
+
+    When the encoder falls behind, frames back up in the queue and then in the PBO ring. In real-time mode a capture
+    that finds the ring full is dropped (counted); with waitInsteadOfDropping it waits for the oldest readback and a
+    free queue slot instead, which is what fixed-dt captures want: every simulated step ends up on disk, however
+    long the frame takes.
+
+    start(), stop(), captureFrame() and pollReadbacks() must be called on the GL thread; the getters on any thread.
+*/
+class FrameExporter : private juce::Thread
+{
+public:
+    //==============================================================================
+    enum class Format
+    {
+        pngSequence = 0,    // frame_000000.png, frame_000001.png, ...
+        rawVideo = 1        // one file of packed BGRA frames (see the ffmpeg line written next to it)
+    };
+
+    struct Settings
+    {
+        juce::File directory;
+        Format format = Format::pngSequence;
+        int width = 1920;
+        int height = 1080;
+        double framesPerSecond = 60.0;  // frame rate of the output; export steps the simulation by 1 / fps per frame
+        int numFrames = 0;              // frames to capture (0 = until stopped)
+        bool waitInsteadOfDropping = true;
+    };
+
+    FrameExporter();
+    ~FrameExporter() override;
+
+    /** Creates the directory and the PBO ring, and starts the encoder thread. */
+    bool start (const Settings& settings, juce::String& error);
+
+    /** Waits for the frames in flight, lets the encoder finish writing them and releases the PBOs.
+        Returns false if anything failed to write, or if a readback timed out and its frame was dropped (see getError()).
+    */
+    bool stop();
+
+    bool isExporting() const noexcept               { return exporting.load(); }
+    const Settings& getSettings() const noexcept    { return settings; }
+    bool hasCapturedAllFrames() const noexcept      { return settings.numFrames > 0 && framesCaptured.load() >= settings.numFrames; }
+
+    /** Reads the colour attachment 0 (or the back buffer, for framebuffer 0) of sourceFrameBuffer, which must be
+        at least getSettings().width x height. Returns false if the frame was dropped.
+    */
+    bool captureFrame (unsigned int sourceFrameBuffer);
+
+    /** Hands completed readbacks to the encoder, oldest first. Never blocks (captureFrame() calls this). */
+    void pollReadbacks();
+
+    //==============================================================================
+    juce::int64 getFramesCaptured() const noexcept  { return framesCaptured.load(); }
+    juce::int64 getFramesWritten() const noexcept   { return framesWritten.load(); }
+    juce::int64 getDroppedFrames() const noexcept   { return droppedFrames.load(); }
+    float getEncodeMilliseconds() const noexcept    { return encodeMilliseconds.load(); } // smoothed, per frame
+    juce::String getError() const                   { return error; }
+
+private:
+    //==============================================================================
+    struct PixelBuffer
+    {
+        unsigned int buffer = 0;
+        juce::gl::GLsync fence = nullptr;
+        juce::int64 frameNumber = 0;
+    };
+
+    struct PendingFrame
+    {
+        juce::HeapBlock<juce::uint8> pixels; // BGRA, bottom row first
+        juce::int64 frameNumber = 0;
+    };
+
+    bool handOverOldest (bool wait);
+    void releasePixelBuffers();
+    bool writeSidecar();
+
+    void run() override;
+    bool writeFrame (PendingFrame& frame);
+    void flipToOpaque (const juce::uint8* bottomUp, juce::uint8* topDown, int destLineStride) const;
+
+    static constexpr int numPixelBuffers = 4;
+    static constexpr int queueSize = 4;
+
+    Settings settings;
+    size_t frameBytes = 0;
+    std::atomic<bool> exporting { false };
+
+    // GL thread
+    PixelBuffer pixelBuffers[numPixelBuffers];
+    int nextPixelBuffer = 0;
+    int oldestPixelBuffer = 0;
+    int pixelBuffersInFlight = 0;
+    juce::int64 nextFrameNumber = 0;
+
+    // GL thread -> encoder thread. Slots own their pixel memory for the whole export.
+    juce::AbstractFifo fifo { queueSize };
+    std::array<PendingFrame, (size_t) queueSize> queue;
+
+    // Encoder thread
+    std::unique_ptr<juce::FileOutputStream> rawStream;
+    juce::HeapBlock<juce::uint8> rawFrame;  // top-down, opaque copy of a frame (raw video)
+    juce::PNGImageFormat pngFormat;
+    std::atomic<bool> writeFailed { false };
+    juce::String error;
+
+    std::atomic<juce::int64> framesCaptured { 0 };
+    std::atomic<juce::int64> framesWritten { 0 };
+    std::atomic<juce::int64> droppedFrames { 0 };
+    std::atomic<float> encodeMilliseconds { 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FrameExporter)
+};
@@ -0,0 +1,164 @@
+#include "GLRenderTarget.h"
+
+using namespace juce::gl;
+
+//==============================================================================
+GLRenderTarget::~GLRenderTarget()
+{
+    // GL objects must be released on the GL thread (MainComponent::shutdown()) before destruction.
+    jassert (frameBuffer == 0);
+}
+
+// Textures are sampled 1:1 by fullscreen passes unless setLinearFiltering() was called; clamp, no mipmaps.
+bool GLRenderTarget::create (int newWidth, int newHeight, const juce::Array<GLenum>& colourFormats, bool withDepth)
+{
+    release();
+
+    if (newWidth <= 0 || newHeight <= 0 || colourFormats.isEmpty())
+        return false;
+
+    width = newWidth;
+    height = newHeight;
+    formats = colourFormats;
+    hasDepth = withDepth;
+
+    auto makeTexture = [this] (GLenum internalFormat, GLint filter)
+    {
+        GLuint texture = 0;
+        glGenTextures (1, &texture);
+        glBindTexture (GL_TEXTURE_2D, texture);
+        glTexStorage2D (GL_TEXTURE_2D, 1, internalFormat, width, height);
+        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    };
+
+    const auto previousFrameBuffer = getCurrentFrameBuffer();
+
+    glGenFramebuffers (1, &frameBuffer);
+    glBindFramebuffer (GL_FRAMEBUFFER, frameBuffer);
+
+    for (int i = 0; i < formats.size(); ++i)
+    {
+        const auto texture = makeTexture (formats[i], linearFiltering ? GL_LINEAR : GL_NEAREST);
+        colourTextures.add (texture);
+        glFramebufferTexture2D (GL_FRAMEBUFFER, (GLenum) (GL_COLOR_ATTACHMENT0 + i), GL_TEXTURE_2D, texture, 0);
+    }
+
+    if (hasDepth)
+    {
+        depthTexture = makeTexture (GL_DEPTH_COMPONENT24, GL_NEAREST);
+        glFramebufferTexture2D (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    }
+
+    glBindTexture (GL_TEXTURE_2D, 0);
+
+    const auto status = glCheckFramebufferStatus (GL_FRAMEBUFFER);
+    glBindFramebuffer (GL_FRAMEBUFFER, previousFrameBuffer);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        DBG ("GLRenderTarget: framebuffer incomplete (0x" + juce::String::toHexString ((int) status) + ")");
+        release();
+        return false;
+    }
+
+    return true;
+}
+
+void GLRenderTarget::release()
+{
+    for (auto texture : colourTextures)
+    {
+        GLuint id = texture;
+        glDeleteTextures (1, &id);
+    }
+
+    colourTextures.clear();
+
+    if (depthTexture != 0)
+    {
+        glDeleteTextures (1, &depthTexture);
+        depthTexture = 0;
+    }
+
+    if (frameBuffer != 0)
+    {
+        glDeleteFramebuffers (1, &frameBuffer);
+        frameBuffer = 0;
+    }
+
+    width = height = 0;
+}
+
+bool GLRenderTarget::ensureSize (int newWidth, int newHeight)
+{
+    if (isValid() && newWidth == width && newHeight == height)
+        return true;
+
+    // Copy: create() releases (and so clears) the current description first.
+    const auto previousFormats = formats;
+    return create (newWidth, newHeight, previousFormats, hasDepth);
+}
+
+void GLRenderTarget::setLinearFiltering (bool shouldBeLinear)
+{
+    linearFiltering = shouldBeLinear;
+
+    const GLint filter = linearFiltering ? GL_LINEAR : GL_NEAREST;
+
+    for (auto texture : colourTextures)
+    {
+        glBindTexture (GL_TEXTURE_2D, texture);
+        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    }
+
+    glBindTexture (GL_TEXTURE_2D, 0);
+}
+
+void GLRenderTarget::setOutputLocations (const juce::Array<int>& locationsForAttachments)
+{
+    outputLocations = locationsForAttachments;
+}
+
+//==============================================================================
+void GLRenderTarget::bind() const
+{
+    jassert (isValid());
+
+    // Draw buffer n receives fragment output location n; locations no attachment takes stay GL_NONE.
+    GLenum drawBuffers[8] {};
+    int numBuffers = 0;
+
+    for (int i = 0; i < colourTextures.size(); ++i)
+    {
+        const int location = i < outputLocations.size() ? outputLocations[i] : i;
+
+        if (! juce::isPositiveAndBelow (location, (int) juce::numElementsInArray (drawBuffers)))
+            continue;
+
+        drawBuffers[location] = (GLenum) (GL_COLOR_ATTACHMENT0 + i);
+        numBuffers = juce::jmax (numBuffers, location + 1);
+    }
+
+    glBindFramebuffer (GL_FRAMEBUFFER, frameBuffer);
+    glDrawBuffers (numBuffers, drawBuffers);
+    glViewport (0, 0, width, height);
+}
+
+void GLRenderTarget::bindColourTexture (int index, int textureUnit) const
+{
+    glActiveTexture ((GLenum) (GL_TEXTURE0 + textureUnit));
+    glBindTexture (GL_TEXTURE_2D, getColourTexture (index));
+    glActiveTexture (GL_TEXTURE0);
+}
+
+unsigned int GLRenderTarget::getCurrentFrameBuffer()
+{
+    GLint current = 0;
+    glGetIntegerv (GL_DRAW_FRAMEBUFFER_BINDING, &current);
+    return (unsigned int) current;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    An offscreen framebuffer with any number of texture colour attachments (each with its own internal
+    format, e.g. GL_RGBA16F or GL_R8) and an optional depth texture.
+
+    juce::OpenGLFrameBuffer only offers a single RGBA8 attachment, which isn't enough for floating-point
+    or multiple-render-target passes.
+
+    All methods must be called on the GL thread.
+*/
+class GLRenderTarget
+{
+public:
+    //==============================================================================
+    GLRenderTarget() = default;
+    ~GLRenderTarget();
+
+    /** (Re)allocates the target. colourFormats are sized internal formats, one texture per attachment, in draw-buffer order. */
+    bool create (int width, int height, const juce::Array<juce::gl::GLenum>& colourFormats, bool withDepth);
+    void release();
+
+    /** Recreates the target only if the size differs (keeps the current formats). */
+    bool ensureSize (int width, int height);
+
+    /** Colour textures default to GL_NEAREST (1:1 fullscreen passes); resampling passes like bloom need GL_LINEAR. Persists across create(). */
+    void setLinearFiltering (bool shouldBeLinear);
+
+    /** Fragment output location written to each colour attachment, in attachment order (default: attachment i <- location i).
+        Lets a target skip locations, e.g. { 0, 2 } takes colour and velocity but not the OIT revealage at location 1.
+        Persists across create(). */
+    void setOutputLocations (const juce::Array<int>& locationsForAttachments);
+
+    bool isValid() const noexcept                           { return frameBuffer != 0; }
+    int getWidth() const noexcept                           { return width; }
+    int getHeight() const noexcept                          { return height; }
+    int getNumColourAttachments() const noexcept            { return colourTextures.size(); }
+    unsigned int getColourTexture (int index) const noexcept { return colourTextures[index]; }
+    unsigned int getDepthTexture() const noexcept           { return depthTexture; }
+    unsigned int getFrameBufferID() const noexcept          { return frameBuffer; }
+
+    //==============================================================================
+    /** Binds the framebuffer with all colour attachments enabled as draw buffers (at their output locations), and sets the viewport to its size. */
+    void bind() const;
+
+    /** Binds a colour attachment to a texture unit (the active unit is left at GL_TEXTURE0). */
+    void bindColourTexture (int index, int textureUnit) const;
+
+    /** The draw framebuffer bound right now; render() may not be drawing into framebuffer 0. */
+    static unsigned int getCurrentFrameBuffer();
+
+private:
+    //==============================================================================
+    unsigned int frameBuffer = 0;
+    juce::Array<unsigned int> colourTextures;
+    juce::Array<juce::gl::GLenum> formats;
+    juce::Array<int> outputLocations;
+    unsigned int depthTexture = 0;
+    bool hasDepth = false;
+    bool linearFiltering = false;
+    int width = 0, height = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GLRenderTarget)
+};
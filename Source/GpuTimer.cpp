@@ -0,0 +1,142 @@
+#include "GpuTimer.h"
+
+using namespace juce::gl;
+
+//==============================================================================
+GpuTimer::~GpuTimer()
+{
+    // GL objects must be released on the GL thread (MainComponent::shutdown()) before destruction.
+    jassert (frames.empty());
+}
+
+// Some drivers report 0 timestamp bits (no timer support); the timer then stays uncreated and all calls are no-ops.
+bool GpuTimer::create (int sections, int numFramesInFlight)
+{
+    release();
+
+    if (sections <= 0 || numFramesInFlight < 2)
+        return false;
+
+    GLint counterBits = 0;
+    glGetQueryiv (GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+
+    if (counterBits == 0)
+        return false;
+
+    numSections = sections;
+    frames.resize ((size_t) numFramesInFlight);
+
+    for (auto& frame : frames)
+    {
+        frame.queries.resize ((size_t) numSections * 2);
+        frame.issued.assign ((size_t) numSections, false);
+        glGenQueries ((GLsizei) frame.queries.size(), frame.queries.data());
+    }
+
+    smoothedMs.assign ((size_t) numSections, 0.0);
+    hasResult.assign ((size_t) numSections, false);
+    currentFrame = 0;
+    return true;
+}
+
+void GpuTimer::release()
+{
+    for (auto& frame : frames)
+        glDeleteQueries ((GLsizei) frame.queries.size(), frame.queries.data());
+
+    frames.clear();
+    smoothedMs.clear();
+    hasResult.clear();
+    numSections = 0;
+    currentFrame = 0;
+}
+
+//==============================================================================
+void GpuTimer::beginSection (int section)
+{
+    if (! juce::isPositiveAndBelow (section, numSections))
+        return;
+
+    auto& frame = frames[(size_t) currentFrame];
+    glQueryCounter (frame.queries[(size_t) section * 2], GL_TIMESTAMP);
+}
+
+void GpuTimer::endSection (int section)
+{
+    if (! juce::isPositiveAndBelow (section, numSections))
+        return;
+
+    auto& frame = frames[(size_t) currentFrame];
+    glQueryCounter (frame.queries[(size_t) section * 2 + 1], GL_TIMESTAMP);
+    frame.issued[(size_t) section] = true;
+}
+
+// Frames complete in order, so polling stops at the first one that isn't done yet.
+void GpuTimer::endFrame()
+{
+    if (! isCreated())
+        return;
+
+    frames[(size_t) currentFrame].pending = true;
+
+    const int numFrames = (int) frames.size();
+
+    for (int n = 1; n <= numFrames; ++n)
+    {
+        auto& frame = frames[(size_t) ((currentFrame + n) % numFrames)];
+
+        if (! frame.pending)
+            continue;
+
+        bool available = true;
+
+        for (int s = 0; s < numSections && available; ++s)
+        {
+            if (! frame.issued[(size_t) s])
+                continue;
+
+            GLint ready = 0;
+            glGetQueryObjectiv (frame.queries[(size_t) s * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &ready);
+            available = ready != 0;
+        }
+
+        if (! available)
+            break;
+
+        collect (frame);
+    }
+
+    currentFrame = (currentFrame + 1) % numFrames;
+
+    // The GPU is a whole ring behind: drop that frame's results rather than wait for them.
+    auto& next = frames[(size_t) currentFrame];
+    next.pending = false;
+    std::fill (next.issued.begin(), next.issued.end(), false);
+}
+
+void GpuTimer::collect (FrameQueries& frame)
+{
+    for (int s = 0; s < numSections; ++s)
+    {
+        if (! frame.issued[(size_t) s])
+            continue;
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v (frame.queries[(size_t) s * 2], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v (frame.queries[(size_t) s * 2 + 1], GL_QUERY_RESULT, &end);
+
+        const double ms = (double) (end - begin) * 1.0e-6;
+        auto& smoothed = smoothedMs[(size_t) s];
+
+        smoothed = hasResult[(size_t) s] ? smoothed + 0.1 * (ms - smoothed) : ms;
+        hasResult[(size_t) s] = true;
+    }
+
+    frame.pending = false;
+    std::fill (frame.issued.begin(), frame.issued.end(), false);
+}
+
+double GpuTimer::getMilliseconds (int section) const noexcept
+{
+    return juce::isPositiveAndBelow (section, numSections) ? smoothedMs[(size_t) section] : 0.0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Measures GPU time of named sections of a frame with GL_TIMESTAMP queries, without ever waiting for them.
+
+    Each frame uses its own set of queries from a small ring; endFrame() collects the results of older frames
+    whose queries have completed and smooths them. Results therefore lag a few frames behind, which is fine for
+    benchmarks and for feedback loops like dynamic resolution.
+
+    Timestamp pairs (rather than GL_TIME_ELAPSED) are used so sections may nest or overlap.
+    All methods must be called on the GL thread.
+*/
+class GpuTimer
+{
+public:
+    //==============================================================================
+    GpuTimer() = default;
+    ~GpuTimer();
+
+    /** Allocates queries for numSections sections over numFramesInFlight frames. Returns false if timestamps aren't supported. */
+    bool create (int numSections, int numFramesInFlight = 4);
+    void release();
+
+    bool isCreated() const noexcept                 { return numSections > 0; }
+
+    //==============================================================================
+    void beginSection (int section);
+    void endSection (int section);
+
+    /** Call once per frame after the last section: polls completed frames (never blocks) and moves to the next query set. */
+    void endFrame();
+
+    /** Smoothed GPU time of a section in milliseconds (0 until the first result arrives). */
+    double getMilliseconds (int section) const noexcept;
+
+private:
+    //==============================================================================
+    struct FrameQueries
+    {
+        std::vector<unsigned int> queries;  // begin/end timestamp per section
+        std::vector<bool> issued;           // both timestamps recorded this frame
+        bool pending = false;               // submitted, results not collected yet
+    };
+
+    void collect (FrameQueries& frame);
+
+    std::vector<FrameQueries> frames;
+    std::vector<double> smoothedMs;
+    std::vector<bool> hasResult;
+    int numSections = 0;
+    int currentFrame = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GpuTimer)
+};
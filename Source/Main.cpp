@@ -16,6 +16,63 @@ public:
     void initialise(const juce::String& commandLine) override
     {
         mainWindow.reset(new MainWindow(getApplicationName()));
+
+        const auto args = juce::StringArray::fromTokens (commandLine, true);
+
+        // --seed <n> runs in deterministic mode from that seed (reproducible runs and renders; combine with --export).
+        const auto seedIndex = args.indexOf ("--seed");
+
+        if (seedIndex >= 0 && seedIndex + 1 < args.size())
+            if (auto* content = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+                content->runDeterministicOnLaunch (args[seedIndex + 1].unquoted().getIntValue());
+
+        // --osc <port> listens for OSC control messages from the start.
+        const auto oscIndex = args.indexOf ("--osc");
+
+        if (oscIndex >= 0 && oscIndex + 1 < args.size())
+            if (auto* content = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+                content->listenForOscOnLaunch (args[oscIndex + 1].unquoted().getIntValue());
+
+        // --audio <file> modulates the flock from an audio file (WAV, AIFF, FLAC, Ogg), as from a live input.
+        const auto audioIndex = args.indexOf ("--audio");
+
+        if (audioIndex >= 0 && audioIndex + 1 < args.size())
+            if (auto* content = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+                content->analyseAudioFileOnLaunch (juce::File::getCurrentWorkingDirectory().getChildFile (args[audioIndex + 1].unquoted()));
+
+        // --timeline <file> drives the settings from a parameter timeline, starting with the first frame.
+        const auto timelineIndex = args.indexOf ("--timeline");
+
+        if (timelineIndex >= 0 && timelineIndex + 1 < args.size())
+            if (auto* content = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+                content->runTimelineOnLaunch (juce::File::getCurrentWorkingDirectory().getChildFile (args[timelineIndex + 1].unquoted()));
+
+        // --export <directory> [--frames 600] [--fps 60] [--size 1920x1080] [--format png|raw]
+        // renders the frames offscreen at a fixed time step, as fast as the GPU and disk allow, then quits.
+        const auto exportIndex = args.indexOf ("--export");
+
+        if (exportIndex >= 0 && exportIndex + 1 < args.size())
+        {
+            auto valueOf = [&args] (const juce::String& option, const juce::String& fallback)
+            {
+                const auto i = args.indexOf (option);
+                return (i >= 0 && i + 1 < args.size()) ? args[i + 1].unquoted() : fallback;
+            };
+
+            FrameExporter::Settings settings;
+            settings.directory = juce::File::getCurrentWorkingDirectory().getChildFile (args[exportIndex + 1].unquoted());
+            settings.numFrames = juce::jmax (1, valueOf ("--frames", "600").getIntValue());
+            settings.framesPerSecond = valueOf ("--fps", "60").getDoubleValue();
+            settings.format = valueOf ("--format", "png") == "raw" ? FrameExporter::Format::rawVideo
+                                                                    : FrameExporter::Format::pngSequence;
+
+            const auto size = valueOf ("--size", "1920x1080");
+            settings.width = size.upToFirstOccurrenceOf ("x", false, true).getIntValue();
+            settings.height = size.fromFirstOccurrenceOf ("x", false, true).getIntValue();
+
+            if (auto* content = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+                content->exportOnLaunch (settings);
+        }
     }
 
     void shutdown() override
@@ -1,15 +1,77 @@
 #include "MainComponent.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <random>
-#include <vector>
 
 // Use the JUCE OpenGL namespace
 using namespace juce::gl;
 
 namespace
 {
+    // Most particles the app runs: the panel's slider range, and the limit for snapshots and recordings it loads.
+    constexpr int kMaxParticles = 100000;
+
+    // Instanced mesh sizes (non-indexed triangle lists); must match kBird/kTetra in particles_mesh.vert.
+    constexpr GLuint kBirdVertexCount  = 18;
+    constexpr GLuint kTetraVertexCount = 12;
+    constexpr int kNumLodBins = 3; // bird, tetrahedron, point
+
+    // Depth sort (particles_sort.comp): 16-bit keys, 4 bits per pass. The workgroup size is fixed rather than tuned
+    // because the scatter kernel's shared memory grows with it (32 bytes per thread) and it sizes the histogram.
+    constexpr int kSortWorkgroupSize = 256;
+    constexpr int kSortPasses = 4;
+    constexpr int kSortRadix = 16;
+    constexpr int kSortBenchmarkKeys = 1 << 20;
+    constexpr int kSortBenchmarkFrames = 64;
+
+    // Cell sort for the subgroup step (boids_cellsort.comp): the scan is one workgroup, so its size is fixed too.
+    constexpr int kCellScanWorkgroupSize = 256;
+
+    constexpr float kNearPlane = 0.1f;
+    constexpr float kFarPlane  = 500.0f;
+
+    // Camera distance limits (mouse wheel and OSC).
+    constexpr float kMinCameraDistance = 2.0f;
+    constexpr float kMaxCameraDistance = 200.0f;
+
+    // Bloom chain: the first level is at most this tall (so the post chain costs the same at 1080p and 4K),
+    // and halves per level down to a few pixels.
+    constexpr int kBloomMaxBaseHeight = 540;
+    constexpr int kBloomMaxLevels = 6;
+    constexpr int kBloomMinLevelSize = 8;
+
+    // Volume render mode: cells count at most kVolumeMaxCount particles (already opaque at any sensible extinction),
+    // and the raymarch takes at most kVolumeMaxSteps samples across the grid box, whatever the particle count.
+    constexpr float kVolumeMaxCount = 1024.0f;
+    constexpr int kVolumeMaxSteps = 256;
+
+    // Motion trails: longest history ring the UI offers (memory is kMaxTrailLength x particle capacity x 16 bytes).
+    constexpr int kMaxTrailLength = 64;
+    constexpr int kMaxTrailStride = 8;
+
+    // Motion blur: velocity tiles are this many pixels square; blurs are capped at two tiles long (see motion_blur.frag).
+    constexpr int kMotionBlurTileSize = 16;
+
+    // Dynamic resolution: the scene target never drops below kMinRenderScale of the window per axis, moves in
+    // kRenderScaleStep increments (each change reallocates the targets), and waits kRenderScaleSettleFrames after a
+    // change so GpuTimer's lagged, smoothed reading reflects the new size before the next decision.
+    constexpr float kMinRenderScale = 0.25f;
+    constexpr float kRenderScaleStep = 0.05f;
+    constexpr int kRenderScaleSettleFrames = 30;
+    constexpr float kMaxDrawBudgetMs = 33.0f;
+
+    // ParticleStream readback tags: 0 is the per-frame "Stream to CPU" copy.
+    constexpr int kSnapshotReadbackTag = 1;
+
+    // Deterministic mode: simulated time per frame, and the largest seed the panel offers.
+    constexpr float kDeterministicStepSeconds = 1.0f / 60.0f;
+    constexpr int kMaxSeed = 99999;
+
+    // GpuTimer sections shown in the FPS readout.
+    enum GpuTimerSection { gpuTimerSort, gpuTimerDraw, gpuTimerSortBenchmark, numGpuTimerSections };
+
     struct ParticleCPU
     {
         float pos[4];
@@ -17,6 +79,156 @@ namespace
         float color[4];
     };
 
+    // Seeds particles with random positions inside the world box, placed according to distribution (see PresetFile),
+    // and random headings/speeds. Used for the initial flock, restarts and any particles added when the count grows.
+    static void fillRandomParticles (ParticleCPU* particles, size_t numParticles,
+                                     juce::Vector3D<float> worldMin, juce::Vector3D<float> worldMax,
+                                     float minSpeed, float maxSpeed, uint32_t rngSeed,
+                                     PresetFile::Distribution distribution = PresetFile::Distribution::uniform)
+    {
+        std::mt19937 rng (rngSeed);
+        std::uniform_real_distribution<float> rx (worldMin.x, worldMax.x);
+        std::uniform_real_distribution<float> ry (worldMin.y, worldMax.y);
+        std::uniform_real_distribution<float> rz (worldMin.z, worldMax.z);
+        std::uniform_real_distribution<float> ru (-1.0f, 1.0f);
+        std::uniform_real_distribution<float> rs (minSpeed, juce::jmax(minSpeed, maxSpeed/2.0f));
+
+        const auto centre = (worldMin + worldMax) * 0.5f;
+        const auto size = worldMax - worldMin;
+        const float radius = 0.5f * juce::jmin (size.x, size.y, size.z);
+
+        // Clusters: a handful of centres in the middle 60% of the box, drawn before any particle so that the same
+        // seed gives the same clumps; particles scatter around them with a spread of a tenth of the ball radius.
+        constexpr int numClusters = 6;
+        std::array<juce::Vector3D<float>, numClusters> clusterCentres;
+        std::normal_distribution<float> rn (0.0f, 0.1f * radius);
+
+        if (distribution == PresetFile::Distribution::clusters)
+            for (auto& c : clusterCentres)
+                c = centre + juce::Vector3D<float> (size.x * 0.3f * ru (rng), size.y * 0.3f * ru (rng), size.z * 0.3f * ru (rng));
+
+        auto randomPosition = [&]
+        {
+            switch (distribution)
+            {
+                case PresetFile::Distribution::sphere:
+                    for (;;) // rejection sampling: about half the draws land inside
+                    {
+                        const juce::Vector3D<float> d { ru (rng), ru (rng), ru (rng) };
+                        if (d.lengthSquared() <= 1.0f)
+                            return centre + d * radius;
+                    }
+
+                case PresetFile::Distribution::clusters:
+                {
+                    const auto& c = clusterCentres[rng() % (uint32_t) numClusters];
+                    return juce::Vector3D<float> (juce::jlimit (worldMin.x, worldMax.x, c.x + rn (rng)),
+                                                  juce::jlimit (worldMin.y, worldMax.y, c.y + rn (rng)),
+                                                  juce::jlimit (worldMin.z, worldMax.z, c.z + rn (rng)));
+                }
+
+                case PresetFile::Distribution::uniform:
+                default:
+                {
+                    const auto x = rx (rng);
+                    const auto y = ry (rng);
+                    return juce::Vector3D<float> (x, y, rz (rng));
+                }
+            }
+        };
+
+        for (size_t i = 0; i < numParticles; ++i)
+        {
+            auto& p = particles[i];
+            const auto pos = randomPosition();
+            p.pos[0] = pos.x;
+            p.pos[1] = pos.y;
+            p.pos[2] = pos.z;
+            p.pos[3] = 1.0f;
+
+            juce::Vector3D<float> dir { ru (rng), ru (rng), ru (rng) };
+            if (dir.length() < 1.0e-3f)
+                dir = juce::Vector3D<float> (1.0f, 0.0f, 0.0f);
+            dir = dir.normalised();
+
+            const float speed = rs (rng);
+            const auto vel = dir * speed;
+
+            p.vel[0] = vel.x;
+            p.vel[1] = vel.y;
+            p.vel[2] = vel.z;
+            p.vel[3] = 0.0f;
+
+            const auto heading = vel.normalised();
+            const float t = juce::jlimit (0.0f, 1.0f, (speed - minSpeed) / (maxSpeed - minSpeed));
+            p.color[0] = 0.2f + 0.8f * std::abs (heading.x);
+            p.color[1] = 0.2f + 0.8f * std::abs (heading.y);
+            p.color[2] = 0.2f + 0.8f * std::abs (heading.z);
+            p.color[3] = 0.35f + 0.65f * t;
+        }
+    }
+
+    // RNG seed for particles [firstIndex, ...): from the panel seed in deterministic mode, so a flock grown in the same
+    // steps comes out the same, otherwise from the clock.
+    static uint32_t getRangeSeed (bool deterministic, int seed, int firstIndex)
+    {
+        if (! deterministic)
+            return (uint32_t) juce::Time::getMillisecondCounter();
+
+        return (uint32_t) seed * 0x9e3779b9u + (uint32_t) firstIndex;
+    }
+
+    // Matrix3D precision conversions (the view matrix is composed in double, see getViewProjectionMatrix()).
+    static juce::Matrix3D<double> toDoubleMatrix (const juce::Matrix3D<float>& m)
+    {
+        double values[16];
+        for (int i = 0; i < 16; ++i)
+            values[i] = (double) m.mat[i];
+        return juce::Matrix3D<double> (values);
+    }
+
+    static juce::Matrix3D<float> toFloatMatrix (const juce::Matrix3D<double>& m)
+    {
+        float values[16];
+        for (int i = 0; i < 16; ++i)
+            values[i] = (float) m.mat[i];
+        return juce::Matrix3D<float> (values);
+    }
+
+    // General 4x4 inverse (cofactor expansion, in double); used to unproject screen rays. Returns identity if singular.
+    static juce::Matrix3D<float> invertMatrix (const juce::Matrix3D<float>& matrix)
+    {
+        const auto source = toDoubleMatrix (matrix);
+        const double* m = source.mat;
+        double inv[16];
+
+        inv[0]  =  m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+        inv[4]  = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+        inv[8]  =  m[4] * m[9]  * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+        inv[12] = -m[4] * m[9]  * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+        inv[1]  = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+        inv[5]  =  m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+        inv[9]  = -m[0] * m[9]  * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+        inv[13] =  m[0] * m[9]  * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+        inv[2]  =  m[1] * m[6]  * m[15] - m[1] * m[7]  * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7]  - m[13] * m[3] * m[6];
+        inv[6]  = -m[0] * m[6]  * m[15] + m[0] * m[7]  * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7]  + m[12] * m[3] * m[6];
+        inv[10] =  m[0] * m[5]  * m[15] - m[0] * m[7]  * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7]  - m[12] * m[3] * m[5];
+        inv[14] = -m[0] * m[5]  * m[14] + m[0] * m[6]  * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6]  + m[12] * m[2] * m[5];
+        inv[3]  = -m[1] * m[6]  * m[11] + m[1] * m[7]  * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9]  * m[2] * m[7]  + m[9]  * m[3] * m[6];
+        inv[7]  =  m[0] * m[6]  * m[11] - m[0] * m[7]  * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8]  * m[2] * m[7]  - m[8]  * m[3] * m[6];
+        inv[11] = -m[0] * m[5]  * m[11] + m[0] * m[7]  * m[9]  + m[4] * m[1] * m[11] - m[4] * m[3] * m[9]  - m[8]  * m[1] * m[7]  + m[8]  * m[3] * m[5];
+        inv[15] =  m[0] * m[5]  * m[10] - m[0] * m[6]  * m[9]  - m[4] * m[1] * m[10] + m[4] * m[2] * m[9]  + m[8]  * m[1] * m[6]  - m[8]  * m[2] * m[5];
+
+        const double det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+        if (std::abs (det) < 1.0e-300)
+            return {};
+
+        float values[16];
+        for (int i = 0; i < 16; ++i)
+            values[i] = (float) (inv[i] / det);
+        return juce::Matrix3D<float> (values);
+    }
+
     // Returns the OpenGL compiler info log for a shader object (used for compile errors/warnings).
     static juce::String getInfoLogForShader (GLuint shader)
     {
@@ -78,6 +290,33 @@ namespace
         return true;
     }
 
+    // The define that sizes a compute shader's workgroup (JF_LOCAL_SIZE, see boids_clear.comp).
+    static juce::StringArray localSizeDefine (int size)
+    {
+        return { "JF_LOCAL_SIZE " + juce::String (size) };
+    }
+
+    // Inserts `#define NAME [VALUE]` lines right after the `#version` line so one shader file can be compiled in several variants.
+    static juce::String injectDefines (const juce::String& source, const juce::StringArray& defines)
+    {
+        if (defines.isEmpty())
+            return source;
+
+        juce::String defineBlock;
+        for (const auto& d : defines)
+            defineBlock << "#define " << d << "\n";
+
+        const int versionPos = source.indexOf ("#version");
+        if (versionPos < 0)
+            return defineBlock + source;
+
+        const int lineEnd = source.indexOfChar (versionPos, '\n');
+        if (lineEnd < 0)
+            return source + "\n" + defineBlock;
+
+        return source.substring (0, lineEnd + 1) + defineBlock + source.substring (lineEnd + 1);
+    }
+
     // Links a GLSL program and returns a readable error log on failure.
     static bool linkProgram (GLuint program, juce::String& outError)
     {
@@ -97,6 +336,26 @@ namespace
         return true;
     }
 
+    // Opens the per-user settings file (persists things like tuned workgroup sizes across runs).
+    static std::unique_ptr<juce::PropertiesFile> openSettingsFile()
+    {
+        juce::PropertiesFile::Options options;
+        options.applicationName = "JuicyFlock";
+        options.filenameSuffix = ".settings";
+        options.folderName = "JuicyFlock";
+        options.osxLibrarySubFolder = "Application Support";
+        return std::make_unique<juce::PropertiesFile> (options);
+    }
+
+    // Reads a GL string (vendor/renderer/version) as a juce::String; empty if the query fails.
+    static juce::String getGLString (GLenum name)
+    {
+        if (auto* str = glGetString (name))
+            return juce::String::fromUTF8 ((const char*) str);
+
+        return {};
+    }
+
     // Sets an int uniform only if it exists in the linked program (allows optional uniforms).
     static void setUniform1iIfPresent (GLuint program, const char* name, int v)
     {
@@ -113,6 +372,14 @@ namespace
             glUniform1f (loc, v);
     }
 
+    // Sets a vec2 uniform only if it exists in the linked program (allows optional uniforms).
+    static void setUniform2fIfPresent (GLuint program, const char* name, float x, float y)
+    {
+        auto loc = glGetUniformLocation (program, name);
+        if (loc >= 0)
+            glUniform2f (loc, x, y);
+    }
+
     // Sets a vec3 uniform only if it exists in the linked program (allows optional uniforms).
     static void setUniform3fIfPresent (GLuint program, const char* name, juce::Vector3D<float> v)
     {
@@ -148,104 +415,104 @@ MainComponent::MainComponent()
 
     controlPanel = std::make_unique<BoidsControlPanel>();
 
-    // Single source of truth for initial simulation settings: BoidsControlPanel::Params defaults.
-    // We clamp/normalize once here so both the simulation and the UI start from the same values.
-    {
-        BoidsControlPanel::Params p;
-
-        const int newCount = juce::jlimit (1, 100000, p.particleCount);
-
-        currentParticleCount = newCount;
-        requestedParticleCount.store (newCount);
-
-        neighborRadius = juce::jlimit (0.05f, 50.0f, p.neighborRadius);
-        separationRadius = juce::jlimit (0.01f, neighborRadius, p.separationRadius);
-        weightSeparation = juce::jlimit (0.0f, 50.0f, p.weightSeparation);
-        weightAlignment  = juce::jlimit (0.0f, 50.0f, p.weightAlignment);
-        weightCohesion   = juce::jlimit (0.0f, 50.0f, p.weightCohesion);
-        minSpeed = juce::jlimit (0.0f, 1000.0f, p.minSpeed);
-        maxSpeed = juce::jlimit (juce::jmax (minSpeed + 1.0e-3f, 0.01f), 1000.0f, p.maxSpeed);
-        maxAccel = juce::jlimit (0.0f, 10000.0f, p.maxAccel);
-        simSpeed = juce::jlimit (0.1f, 2.0f, p.simSpeed);
-        centerAttraction = juce::jlimit (0.0f, 1000.0f, p.centerAttraction);
-        boundaryMargin = juce::jlimit (0.01f, 1000.0f, p.boundaryMargin);
-        boundaryStrength = juce::jlimit (0.0f, 10000.0f, p.boundaryStrength);
-        wrapBounds = p.wrapBounds;
-        pointSize = juce::jlimit (1.0f, 64.0f, p.pointSize);
-        alphaMul = juce::jlimit (0.0f, 1.0f, p.alphaMul);
-        particleShape = juce::jlimit (0, 3, p.particleShape);
-
-        colorMode = juce::jlimit (0, 3, p.colorMode);
-        hueOffset = juce::jlimit (0.0f, 1.0f, p.hueOffset);
-        hueRange = juce::jlimit (0.0f, 1.0f, p.hueRange);
-        saturation = juce::jlimit (0.0f, 1.0f, p.saturation);
-        value = juce::jlimit (0.0f, 1.0f, p.value);
-        densityCurve = juce::jlimit (0.1f, 8.0f, p.densityCurve);
-
-        // Ensure the UI matches the clamped/normalized values.
-        p.particleCount = currentParticleCount;
-        p.neighborRadius = neighborRadius;
-        p.separationRadius = separationRadius;
-        p.weightSeparation = weightSeparation;
-        p.weightAlignment = weightAlignment;
-        p.weightCohesion = weightCohesion;
-        p.minSpeed = minSpeed;
-        p.maxSpeed = maxSpeed;
-        p.maxAccel = maxAccel;
-        p.simSpeed = simSpeed;
-        p.centerAttraction = centerAttraction;
-        p.boundaryMargin = boundaryMargin;
-        p.boundaryStrength = boundaryStrength;
-        p.wrapBounds = wrapBounds;
-        p.pointSize = pointSize;
-        p.alphaMul = alphaMul;
-        p.particleShape = particleShape;
-        p.colorMode = colorMode;
-        p.hueOffset = hueOffset;
-        p.hueRange = hueRange;
-        p.saturation = saturation;
-        p.value = value;
-        p.densityCurve = densityCurve;
+    // Single source of truth for initial simulation settings: BoidsControlPanel::Params defaults, clamped the same
+    // way as every later change so both the simulation and the UI start from the same values. No GL context exists
+    // yet, so only the members are set here; the buffers are built by the first applyParamsOnGLThread().
+    {
+        const auto p = clampParams (BoidsControlPanel::Params());
+
+        currentParticleCount = p.particleCount;
+        requestedParticleCount.store (p.particleCount);
+        setSimulationParams (p);
 
         controlPanel->setParams (p);
     }
 
     controlPanel->setOnParamsChanged ([this] (BoidsControlPanel::Params p)
     {
-        openGLContext.executeOnGLThread ([this, p] (juce::OpenGLContext&)
-        {
-            // Update CPU-side sim params on the GL thread (render also runs on the GL thread)
-            const int newCount = juce::jlimit (1, 100000, p.particleCount);
-
-            const bool neighborRadiusChanged = std::abs (p.neighborRadius - neighborRadius) > 1.0e-4f;
-
-            neighborRadius = juce::jlimit (0.05f, 50.0f, p.neighborRadius);
-            separationRadius = juce::jlimit (0.01f, neighborRadius, p.separationRadius);
-            weightSeparation = juce::jlimit (0.0f, 50.0f, p.weightSeparation);
-            weightAlignment  = juce::jlimit (0.0f, 50.0f, p.weightAlignment);
-            weightCohesion   = juce::jlimit (0.0f, 50.0f, p.weightCohesion);
-            minSpeed = juce::jlimit (0.0f, 1000.0f, p.minSpeed);
-            maxSpeed = juce::jlimit (juce::jmax (minSpeed + 1.0e-3f, 0.01f), 1000.0f, p.maxSpeed);
-            maxAccel = juce::jlimit (0.0f, 10000.0f, p.maxAccel);
-            simSpeed = juce::jlimit (0.1f, 2.0f, p.simSpeed);
-            centerAttraction = juce::jlimit (0.0f, 1000.0f, p.centerAttraction);
-            boundaryMargin = juce::jlimit (0.01f, 1000.0f, p.boundaryMargin);
-            boundaryStrength = juce::jlimit (0.0f, 10000.0f, p.boundaryStrength);
-            wrapBounds = p.wrapBounds;
-            pointSize = juce::jlimit (1.0f, 64.0f, p.pointSize);
-            alphaMul = juce::jlimit (0.0f, 1.0f, p.alphaMul);
-            particleShape = juce::jlimit (0, 3, p.particleShape);
-
-            colorMode = juce::jlimit (0, 3, p.colorMode);
-            hueOffset = juce::jlimit (0.0f, 1.0f, p.hueOffset);
-            hueRange = juce::jlimit (0.0f, 1.0f, p.hueRange);
-            saturation = juce::jlimit (0.0f, 1.0f, p.saturation);
-            value = juce::jlimit (0.0f, 1.0f, p.value);
-            densityCurve = juce::jlimit (0.1f, 8.0f, p.densityCurve);
-
-            if (newCount != currentParticleCount || neighborRadiusChanged)
-                rebuildBuffersOnGLThread (newCount);
-        }, true);
+        openGLContext.executeOnGLThread ([this, p] (juce::OpenGLContext&) { applyParamsOnGLThread (p); }, true);
+    });
+
+    controlPanel->setOnSaveSnapshotRequested ([this] (SnapshotFile::Encoding encoding) { saveSnapshotAsync (encoding); });
+    controlPanel->setOnLoadSnapshotRequested ([this] { loadSnapshotAsync(); });
+
+    controlPanel->setOnPresetSelected ([this] (int index) { applyPreset (index); });
+    controlPanel->setOnSavePresetRequested ([this] { savePresetAsync(); });
+
+    controlPanel->setOnOpenTimelineRequested ([this] { openTimelineAsync(); });
+    controlPanel->setOnStopTimelineRequested ([this]
+    {
+        openGLContext.executeOnGLThread ([this] (juce::OpenGLContext&) { stopTimelineOnGLThread(); }, false);
+    });
+
+    controlPanel->setOnOscToggled ([this] (bool shouldListen)
+    {
+        if (shouldListen)
+            startOsc (oscPort);
+        else
+            stopOsc();
+    });
+
+    controlPanel->setOnAudioInputToggled ([this] (bool shouldListen)
+    {
+        if (shouldListen)
+            startAudioInput();
+        else
+            stopAudio();
+    });
+
+    controlPanel->setOnOpenAudioFileRequested ([this] { openAudioFileAsync(); });
+    controlPanel->setOnStopAudioRequested ([this] { stopAudio(); });
+
+    controlPanel->setOnRecordingToggled ([this] (bool shouldRecord, TrajectoryFile::Encoding encoding)
+    {
+        if (shouldRecord)
+            startRecordingAsync (encoding);
+        else
+            openGLContext.executeOnGLThread ([this] (juce::OpenGLContext&) { stopRecordingOnGLThread(); }, false);
+    });
+
+    controlPanel->setOnOpenRecordingRequested ([this] { openRecordingAsync(); });
+
+    controlPanel->setOnStopPlaybackRequested ([this]
+    {
+        controlPanel->setPlaybackLength (0);
+        openGLContext.executeOnGLThread ([this] (juce::OpenGLContext&) { stopPlaybackOnGLThread(); }, false);
+    });
+
+    // Read by the GL thread at the next frame; no need to go through executeOnGLThread.
+    controlPanel->setOnPlaybackChanged ([this] (bool paused, float speed)
+    {
+        playbackPaused.store (paused);
+        playbackSpeed.store (speed);
+    });
+
+    controlPanel->setOnPlaybackSeek ([this] (int frame) { playbackSeekFrame.store (frame); });
+    controlPanel->setPlaybackFrameSource ([this] { return playbackFrameForUi.load(); });
+
+    controlPanel->setOnExportToggled ([this] (bool shouldExport, FrameExporter::Format format, juce::Point<int> size)
+    {
+        if (shouldExport)
+            startExportAsync (format, size);
+        else
+            openGLContext.executeOnGLThread ([this] (juce::OpenGLContext&) { stopExportOnGLThread(); }, false);
+    });
+
+    controlPanel->setOnRestartFlockRequested ([this]
+    {
+        openGLContext.executeOnGLThread ([this] (juce::OpenGLContext&) { restartFlockOnGLThread(); }, false);
+    });
+
+    controlPanel->setOnTuneWorkgroupsRequested ([this]
+    {
+        // Picked up at the start of the next render() on the GL thread.
+        workgroupTuneRequested.store (true);
+    });
+
+    controlPanel->setOnBenchmarkSortRequested ([this]
+    {
+        // Picked up at the start of the next render() on the GL thread.
+        sortBenchmarkRequested.store (true);
     });
 
     controlPanel->setOnFullscreenChanged ([this] (bool shouldBeFullscreen)
@@ -261,6 +528,15 @@ MainComponent::MainComponent()
         }
     });
     addAndMakeVisible (*controlPanel);
+    rescanPresets();
+
+    oscControl.onCommand = [this] (const OscControl::Command& command) { handleOscCommand (command); };
+    oscControl.onDrained = [this] { applyOscParamChanges(); };
+    oscParamChanges = new juce::DynamicObject();
+    controlPanel->setOscListening (false, oscPort);
+
+    // Number keys switch presets.
+    setWantsKeyboardFocus (true);
 
     // Ensure the panel is laid out immediately (some hosts won't call resized() until later)
     resized();
@@ -270,7 +546,7 @@ MainComponent::MainComponent()
     lastFrameTimeSeconds = juce::Time::getMillisecondCounterHiRes() * 0.001;
     fpsUpdateStartSeconds = lastFrameTimeSeconds;
 
-    // Start timer for checking shader file changes (check every 500ms)
+    // Start timer for checking shader and preset file changes (check every 500ms)
     startTimer (500);
 }
 
@@ -278,23 +554,25 @@ MainComponent::MainComponent()
 MainComponent::~MainComponent()
 {
     stopTimer();
+    oscControl.stop();
+    audioAnalyser.stop();
     shutdownOpenGL();
 }
 
 //==============================================================================
-// Finds the runtime `Shaders/` directory (next to the executable, or in a few parent directories, or CWD as fallback).
-juce::File MainComponent::getShadersDirectory() const
+// Finds a runtime directory such as `Shaders/` (next to the executable, or in a few parent directories, or CWD as fallback).
+juce::File MainComponent::findRuntimeDirectory (const juce::String& name)
 {
-    // Look for Shaders folder relative to the executable
+    // Look for the folder relative to the executable
     auto executableFile = juce::File::getSpecialLocation(juce::File::currentExecutableFile);
     
     // Try multiple possible locations
     juce::Array<juce::File> possiblePaths = {
-        executableFile.getParentDirectory().getChildFile("Shaders"),
-        executableFile.getParentDirectory().getParentDirectory().getChildFile("Shaders"),
-        executableFile.getParentDirectory().getParentDirectory().getParentDirectory().getChildFile("Shaders"),
-        executableFile.getParentDirectory().getParentDirectory().getParentDirectory().getParentDirectory().getChildFile("Shaders"),
-        juce::File::getCurrentWorkingDirectory().getChildFile("Shaders")
+        executableFile.getParentDirectory().getChildFile(name),
+        executableFile.getParentDirectory().getParentDirectory().getChildFile(name),
+        executableFile.getParentDirectory().getParentDirectory().getParentDirectory().getChildFile(name),
+        executableFile.getParentDirectory().getParentDirectory().getParentDirectory().getParentDirectory().getChildFile(name),
+        juce::File::getCurrentWorkingDirectory().getChildFile(name)
     };
     
     for (const auto& path : possiblePaths)
@@ -307,6 +585,21 @@ juce::File MainComponent::getShadersDirectory() const
     return possiblePaths[0];
 }
 
+juce::File MainComponent::getShadersDirectory() const
+{
+    return findRuntimeDirectory ("Shaders");
+}
+
+juce::File MainComponent::getPresetsDirectory() const
+{
+    return findRuntimeDirectory ("Presets");
+}
+
+juce::File MainComponent::getTimelinesDirectory() const
+{
+    return findRuntimeDirectory ("Timelines");
+}
+
 // Configures JUCE's OpenGL context to request an OpenGL 4.3 core context (compute shaders) and attaches it to this component.
 void MainComponent::ensureGL43CoreContext()
 {
@@ -340,11 +633,33 @@ bool MainComponent::checkGLCapabilitiesOnGLThread()
         return false;
     }
 
+    // Tuned settings are only valid for the exact GPU + driver they were measured on.
+    gpuIdentity = getGLString (GL_VENDOR) + " | " + getGLString (GL_RENDERER) + " | " + getGLString (GL_VERSION);
+
+    // Optional: KHR subgroup ops in compute, used by the shared neighbour scan variant of boids_step.comp.
+    // Values from GL_KHR_shader_subgroup (spelled out so we don't depend on the loader exposing the enums).
+    constexpr GLenum kSubgroupSupportedStages   = 0x9533; // GL_SUBGROUP_SUPPORTED_STAGES_KHR
+    constexpr GLenum kSubgroupSupportedFeatures = 0x9534; // GL_SUBGROUP_SUPPORTED_FEATURES_KHR
+    constexpr GLint  kRequiredSubgroupFeatures  = 0x1 | 0x2 | 0x4 | 0x8 | 0x10; // basic | vote | arithmetic | ballot | shuffle
+
+    subgroupsAvailable = false;
+
+    if (juce::OpenGLHelpers::isExtensionSupported ("GL_KHR_shader_subgroup"))
+    {
+        GLint stages = 0, features = 0;
+        glGetIntegerv (kSubgroupSupportedStages, &stages);
+        glGetIntegerv (kSubgroupSupportedFeatures, &features);
+
+        subgroupsAvailable = (stages & GL_COMPUTE_SHADER_BIT) != 0
+                          && (features & kRequiredSubgroupFeatures) == kRequiredSubgroupFeatures;
+    }
+
     return true;
 }
 
 // Loads, compiles, and links a compute shader program from a file path; used by reloadAllShadersOnGLThread().
-bool MainComponent::compileComputeProgramFromFile (juce::File file, unsigned int& outProgram, juce::String& outError)
+bool MainComponent::compileComputeProgramFromFile (juce::File file, unsigned int& outProgram, juce::String& outError,
+                                                   const juce::StringArray& defines)
 {
     if (! file.existsAsFile())
     {
@@ -366,7 +681,7 @@ bool MainComponent::compileComputeProgramFromFile (juce::File file, unsigned int
         return false;
     }
 
-    if (! compileAndAttachShader (program, GL_COMPUTE_SHADER, src, outError))
+    if (! compileAndAttachShader (program, GL_COMPUTE_SHADER, injectDefines (src, defines), outError))
     {
         glDeleteProgram (program);
         return false;
@@ -443,36 +758,73 @@ bool MainComponent::compileRenderProgramFromFiles (juce::File vertexFile, juce::
 
 // Deletes all compiled/linked GL programs owned by MainComponent.
 void MainComponent::deletePrograms()
+{
+    deleteSimulationPrograms();
+
+    if (computeRebaseProgram != 0) { glDeleteProgram (computeRebaseProgram); computeRebaseProgram = 0; }
+    if (computeCullProgram  != 0) { glDeleteProgram (computeCullProgram);  computeCullProgram  = 0; }
+    if (renderProgram       != 0) { glDeleteProgram (renderProgram);       renderProgram       = 0; }
+    if (quadRenderProgram   != 0) { glDeleteProgram (quadRenderProgram);   quadRenderProgram   = 0; }
+    if (meshRenderProgram   != 0) { glDeleteProgram (meshRenderProgram);   meshRenderProgram   = 0; }
+    if (computeLodCullProgram != 0) { glDeleteProgram (computeLodCullProgram); computeLodCullProgram = 0; }
+    if (computePackProgram  != 0) { glDeleteProgram (computePackProgram);  computePackProgram  = 0; }
+    if (computeUnpackProgram != 0) { glDeleteProgram (computeUnpackProgram); computeUnpackProgram = 0; }
+    if (oitCompositeProgram != 0) { glDeleteProgram (oitCompositeProgram); oitCompositeProgram = 0; }
+    if (bloomDownProgram    != 0) { glDeleteProgram (bloomDownProgram);    bloomDownProgram    = 0; }
+    if (bloomUpProgram      != 0) { glDeleteProgram (bloomUpProgram);      bloomUpProgram      = 0; }
+    if (tonemapProgram      != 0) { glDeleteProgram (tonemapProgram);      tonemapProgram      = 0; }
+    if (computeVolumeSplatProgram != 0) { glDeleteProgram (computeVolumeSplatProgram); computeVolumeSplatProgram = 0; }
+    if (computeVolumeResolveProgram != 0) { glDeleteProgram (computeVolumeResolveProgram); computeVolumeResolveProgram = 0; }
+    if (volumeRaymarchProgram != 0) { glDeleteProgram (volumeRaymarchProgram); volumeRaymarchProgram = 0; }
+    if (computeTrailRecordProgram != 0) { glDeleteProgram (computeTrailRecordProgram); computeTrailRecordProgram = 0; }
+    if (trailRenderProgram  != 0) { glDeleteProgram (trailRenderProgram);  trailRenderProgram  = 0; }
+    if (motionTileMaxProgram != 0) { glDeleteProgram (motionTileMaxProgram); motionTileMaxProgram = 0; }
+    if (motionNeighbourMaxProgram != 0) { glDeleteProgram (motionNeighbourMaxProgram); motionNeighbourMaxProgram = 0; }
+    if (motionBlurProgram   != 0) { glDeleteProgram (motionBlurProgram);   motionBlurProgram   = 0; }
+
+    for (auto& program : computeSortPrograms)
+        if (program != 0) { glDeleteProgram (program); program = 0; }
+}
+
+// Deletes the programs reloadSimulationProgramsOnGLThread() compiles.
+void MainComponent::deleteSimulationPrograms()
 {
     if (computeClearProgram != 0) { glDeleteProgram (computeClearProgram); computeClearProgram = 0; }
     if (computeBuildProgram != 0) { glDeleteProgram (computeBuildProgram); computeBuildProgram = 0; }
     if (computeStepProgram  != 0) { glDeleteProgram (computeStepProgram);  computeStepProgram  = 0; }
-    if (renderProgram       != 0) { glDeleteProgram (renderProgram);       renderProgram       = 0; }
+    if (computeStepDeterministicProgram != 0) { glDeleteProgram (computeStepDeterministicProgram); computeStepDeterministicProgram = 0; }
+    if (computeCellScanProgram != 0) { glDeleteProgram (computeCellScanProgram); computeCellScanProgram = 0; }
+    if (computeCellScatterProgram != 0) { glDeleteProgram (computeCellScatterProgram); computeCellScatterProgram = 0; }
+}
+
+// Every shader file the app loads; watched for hot reload.
+juce::Array<juce::File> MainComponent::getShaderFiles() const
+{
+    return { computeClearFile, computeBuildFile, computeStepFile, computeCellSortFile, computeRebaseFile, computeCullFile,
+             computeSortFile, computePackFile, computeVolumeDensityFile, computeTrailRecordFile, renderVertexFile, renderFragmentFile, quadVertexFile,
+             quadFragmentFile, meshVertexFile, meshFragmentFile, trailVertexFile, trailFragmentFile, fullscreenVertexFile,
+             oitCompositeFragmentFile, bloomDownsampleFragmentFile, bloomUpsampleFragmentFile, tonemapFragmentFile,
+             volumeRaymarchFragmentFile, motionTileMaxFragmentFile, motionNeighbourMaxFragmentFile, motionBlurFragmentFile };
 }
 
 //==============================================================================
-// Periodic file watcher: checks shader file modification times and triggers a full shader reload if any changed.
+// Periodic file watcher: rereads the presets if the folder changed, and checks shader file modification times and
+// triggers a full shader reload if any changed.
 void MainComponent::timerCallback()
 {
-    if (! computeClearFile.existsAsFile()
-        || ! computeBuildFile.existsAsFile()
-        || ! computeStepFile.existsAsFile()
-        || ! renderVertexFile.existsAsFile()
-        || ! renderFragmentFile.existsAsFile())
-        return;
+    rescanPresets();
+
+    bool changed = false;
 
-    const auto clearMod = computeClearFile.getLastModificationTime();
-    const auto buildMod = computeBuildFile.getLastModificationTime();
-    const auto stepMod  = computeStepFile.getLastModificationTime();
-    const auto rvMod    = renderVertexFile.getLastModificationTime();
-    const auto rfMod    = renderFragmentFile.getLastModificationTime();
+    for (auto& file : getShaderFiles())
+    {
+        if (! file.existsAsFile())
+            return;
 
-    const bool changed =
-        (clearMod > lastClearMod)
-        || (buildMod > lastBuildMod)
-        || (stepMod > lastStepMod)
-        || (rvMod > lastRenderVertMod)
-        || (rfMod > lastRenderFragMod);
+        auto known = shaderModTimes.find (file.getFullPathName());
+        if (known == shaderModTimes.end() || file.getLastModificationTime() > known->second)
+            changed = true;
+    }
 
     if (! changed)
         return;
@@ -497,8 +849,30 @@ void MainComponent::initialise()
     computeClearFile   = shadersDir.getChildFile ("boids_clear.comp");
     computeBuildFile   = shadersDir.getChildFile ("boids_build.comp");
     computeStepFile    = shadersDir.getChildFile ("boids_step.comp");
+    computeCellSortFile = shadersDir.getChildFile ("boids_cellsort.comp");
+    computeRebaseFile  = shadersDir.getChildFile ("boids_rebase.comp");
+    computeCullFile    = shadersDir.getChildFile ("particles_cull.comp");
+    computeSortFile    = shadersDir.getChildFile ("particles_sort.comp");
+    computePackFile    = shadersDir.getChildFile ("particles_pack.comp");
+    computeVolumeDensityFile = shadersDir.getChildFile ("volume_density.comp");
+    computeTrailRecordFile = shadersDir.getChildFile ("trails_record.comp");
     renderVertexFile   = shadersDir.getChildFile ("particles.vert");
     renderFragmentFile = shadersDir.getChildFile ("particles.frag");
+    quadVertexFile     = shadersDir.getChildFile ("particles_quad.vert");
+    quadFragmentFile   = shadersDir.getChildFile ("particles_quad.frag");
+    meshVertexFile     = shadersDir.getChildFile ("particles_mesh.vert");
+    meshFragmentFile   = shadersDir.getChildFile ("particles_mesh.frag");
+    trailVertexFile    = shadersDir.getChildFile ("trails.vert");
+    trailFragmentFile  = shadersDir.getChildFile ("trails.frag");
+    fullscreenVertexFile        = shadersDir.getChildFile ("fullscreen.vert");
+    oitCompositeFragmentFile    = shadersDir.getChildFile ("oit_composite.frag");
+    bloomDownsampleFragmentFile = shadersDir.getChildFile ("bloom_downsample.frag");
+    bloomUpsampleFragmentFile   = shadersDir.getChildFile ("bloom_upsample.frag");
+    tonemapFragmentFile         = shadersDir.getChildFile ("tonemap.frag");
+    volumeRaymarchFragmentFile  = shadersDir.getChildFile ("volume_raymarch.frag");
+    motionTileMaxFragmentFile   = shadersDir.getChildFile ("motion_tilemax.frag");
+    motionNeighbourMaxFragmentFile = shadersDir.getChildFile ("motion_neighbourmax.frag");
+    motionBlurFragmentFile      = shadersDir.getChildFile ("motion_blur.frag");
 
     // Create a VAO (required in core profile even if we don't use vertex attribs)
     glGenVertexArrays (1, &vao);
@@ -509,17 +883,31 @@ void MainComponent::initialise()
     glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable (GL_PROGRAM_POINT_SIZE);
 
+    // Use the workgroup sizes tuned for this GPU/driver if we have them; otherwise tune on the first frame.
+    if (computeAvailable && ! loadWorkgroupConfig())
+        workgroupTuneRequested.store (true);
+
     reloadAllShadersOnGLThread();
 
     if (computeAvailable)
         rebuildBuffersOnGLThread (currentParticleCount);
+
+    gpuTimer.create (numGpuTimerSections);
 }
 
 // OpenGLAppComponent shutdown: releases GL programs, buffers, and VAO; resets state flags used by render()/paint().
 void MainComponent::shutdown()
 {
+    stopRecordingOnGLThread(); // finishes the file while its frames are still in the ring
+    stopPlaybackOnGLThread();
+    stopExportOnGLThread();
+    releaseSortBenchmarkOnGLThread();
     deletePrograms();
     deleteBuffers();
+    oitTarget.release();
+    exportTarget.release();
+    releaseHdrTargetsOnGLThread();
+    gpuTimer.release();
 
     if (vao != 0)
     {
@@ -532,6 +920,99 @@ void MainComponent::shutdown()
     lastShaderError.clear();
 }
 
+// Compiles the programs the workgroup tuner sizes: clear, build and step, with the step's deterministic variant and
+// the subgroup variant's cell sort kernels. Swaps them in on success; on failure they are all left deleted.
+// reloadAllShadersOnGLThread() starts with this; the tuner calls it alone for each candidate size.
+bool MainComponent::reloadSimulationProgramsOnGLThread()
+{
+    deleteSimulationPrograms();
+
+    juce::String error;
+    unsigned int newClear = 0, newBuild = 0, newStep = 0, newStepDeterministic = 0, newCellScan = 0, newCellScatter = 0;
+
+    auto fail = [&] (const juce::String& what)
+    {
+        for (auto program : { newClear, newBuild, newStep, newStepDeterministic, newCellScan, newCellScatter })
+            if (program != 0)
+                glDeleteProgram (program);
+
+        lastShaderError = what + ":\n" + error;
+        shadersLoaded = false;
+        return false;
+    };
+
+    // Prefer the subgroup step when the driver supports it. It needs the cell-sorted index list, so the two
+    // boids_cellsort.comp kernels come with it; any compile/link failure there (driver quirks) silently falls back
+    // to the portable step.
+    stepUsesSubgroups = false;
+
+    if (subgroupsAvailable)
+    {
+        juce::String subgroupError;
+        auto stepDefines = localSizeDefine (workgroupConfig.step);
+        auto scanDefines = localSizeDefine (kCellScanWorkgroupSize);
+        auto scatterDefines = localSizeDefine (workgroupConfig.build);
+        stepDefines.add ("JF_SUBGROUP 1");
+        scanDefines.add ("JF_CELLSORT_SCAN 1");
+        scatterDefines.add ("JF_CELLSORT_SCATTER 1");
+
+        stepUsesSubgroups = compileComputeProgramFromFile (computeStepFile, newStep, subgroupError, stepDefines)
+                         && compileComputeProgramFromFile (computeCellSortFile, newCellScan, subgroupError, scanDefines)
+                         && compileComputeProgramFromFile (computeCellSortFile, newCellScatter, subgroupError, scatterDefines);
+
+        if (! stepUsesSubgroups)
+        {
+            for (auto* program : { &newStep, &newCellScan, &newCellScatter })
+            {
+                if (*program != 0)
+                    glDeleteProgram (*program);
+
+                *program = 0;
+            }
+
+            DBG ("boids_step.comp subgroup variant unavailable, using fallback:\n" + subgroupError);
+            juce::ignoreUnused (subgroupError);
+        }
+    }
+
+    // The grid passes also fill the cell counts and slots the cell sort needs while the subgroup step is in use.
+    auto gridDefines = [this] (int size)
+    {
+        auto defines = localSizeDefine (size);
+
+        if (stepUsesSubgroups)
+            defines.add ("JF_CELL_SORT 1");
+
+        return defines;
+    };
+
+    if (! compileComputeProgramFromFile (computeClearFile, newClear, error, gridDefines (workgroupConfig.clear)))
+        return fail ("boids_clear.comp");
+
+    if (! compileComputeProgramFromFile (computeBuildFile, newBuild, error, gridDefines (workgroupConfig.build)))
+        return fail ("boids_build.comp");
+
+    if (! stepUsesSubgroups && ! compileComputeProgramFromFile (computeStepFile, newStep, error, localSizeDefine (workgroupConfig.step)))
+        return fail ("boids_step.comp");
+
+    // Deterministic mode always uses the portable scan, with order-independent neighbour sums.
+    {
+        auto defines = localSizeDefine (workgroupConfig.step);
+        defines.add ("JF_DETERMINISTIC 1");
+
+        if (! compileComputeProgramFromFile (computeStepFile, newStepDeterministic, error, defines))
+            return fail ("boids_step.comp (JF_DETERMINISTIC)");
+    }
+
+    computeClearProgram = newClear;
+    computeBuildProgram = newBuild;
+    computeStepProgram  = newStep;
+    computeStepDeterministicProgram = newStepDeterministic;
+    computeCellScanProgram = newCellScan;
+    computeCellScatterProgram = newCellScatter;
+    return true;
+}
+
 // Compiles all compute + render shader programs and swaps them in atomically (delete old, install new); updates file modification timestamps.
 bool MainComponent::reloadAllShadersOnGLThread()
 {
@@ -543,54 +1024,158 @@ bool MainComponent::reloadAllShadersOnGLThread()
         return false;
     }
 
+    if (! reloadSimulationProgramsOnGLThread())
+        return false;
+
     juce::String error;
 
-    unsigned int newClear = 0, newBuild = 0, newStep = 0, newRender = 0;
+    unsigned int newRebase = 0, newCull = 0, newLodCull = 0;
+    unsigned int newRender = 0, newQuadRender = 0, newMeshRender = 0, newOitComposite = 0;
+    unsigned int newBloomDown = 0, newBloomUp = 0, newTonemap = 0, newVolumeSplat = 0, newVolumeResolve = 0;
+    unsigned int newVolumeRaymarch = 0;
+    unsigned int newTrailRecord = 0, newTrailRender = 0, newMotionTileMax = 0, newMotionNeighbourMax = 0, newMotionBlur = 0;
+    unsigned int newPack = 0, newUnpack = 0;
+    unsigned int newSort[numSortKernels] {};
 
-    if (! compileComputeProgramFromFile (computeClearFile, newClear, error))
+    // On any failure, the programs compiled so far are discarded and the previous error path is kept.
+    auto fail = [&] (const juce::String& what)
     {
-        lastShaderError = "boids_clear.comp:\n" + error;
+        for (auto program : { newRebase, newCull, newLodCull, newRender, newQuadRender, newMeshRender, newOitComposite,
+                              newBloomDown, newBloomUp, newTonemap, newVolumeSplat, newVolumeResolve, newVolumeRaymarch, newTrailRecord, newTrailRender,
+                              newMotionTileMax, newMotionNeighbourMax, newMotionBlur, newPack, newUnpack })
+            if (program != 0)
+                glDeleteProgram (program);
+
+        for (auto program : newSort)
+            if (program != 0)
+                glDeleteProgram (program);
+
+        deleteSimulationPrograms();
+        lastShaderError = what + ":\n" + error;
         shadersLoaded = false;
         return false;
+    };
+
+    if (! compileComputeProgramFromFile (computeRebaseFile, newRebase, error, localSizeDefine (workgroupConfig.build)))
+        return fail ("boids_rebase.comp");
+
+    if (! compileComputeProgramFromFile (computeCullFile, newCull, error, localSizeDefine (workgroupConfig.build)))
+        return fail ("particles_cull.comp");
+
+    {
+        auto defines = localSizeDefine (workgroupConfig.build);
+        defines.add ("JF_LOD 1");
+
+        if (! compileComputeProgramFromFile (computeCullFile, newLodCull, error, defines))
+            return fail ("particles_cull.comp (JF_LOD)");
     }
 
-    if (! compileComputeProgramFromFile (computeBuildFile, newBuild, error))
     {
-        glDeleteProgram (newClear);
-        lastShaderError = "boids_build.comp:\n" + error;
-        shadersLoaded = false;
-        return false;
+        const char* kernelDefines[numSortKernels] { "JF_SORT_KEYS 1", "JF_SORT_HISTOGRAM 1", "JF_SORT_SCAN 1", "JF_SORT_SCATTER 1" };
+
+        for (int kernel = 0; kernel < numSortKernels; ++kernel)
+        {
+            auto defines = localSizeDefine (kSortWorkgroupSize);
+            defines.add (kernelDefines[kernel]);
+
+            if (! compileComputeProgramFromFile (computeSortFile, newSort[kernel], error, defines))
+                return fail ("particles_sort.comp (" + juce::String (kernelDefines[kernel]).upToFirstOccurrenceOf (" ", false, false) + ")");
+        }
     }
 
-    if (! compileComputeProgramFromFile (computeStepFile, newStep, error))
     {
-        glDeleteProgram (newClear);
-        glDeleteProgram (newBuild);
-        lastShaderError = "boids_step.comp:\n" + error;
-        shadersLoaded = false;
-        return false;
+        auto packDefines = localSizeDefine (workgroupConfig.build);
+        auto unpackDefines = packDefines;
+        packDefines.add ("JF_PACK 1");
+        unpackDefines.add ("JF_UNPACK 1");
+
+        if (! compileComputeProgramFromFile (computePackFile, newPack, error, packDefines))
+            return fail ("particles_pack.comp (JF_PACK)");
+
+        if (! compileComputeProgramFromFile (computePackFile, newUnpack, error, unpackDefines))
+            return fail ("particles_pack.comp (JF_UNPACK)");
     }
 
-    if (! compileRenderProgramFromFiles (renderVertexFile, renderFragmentFile, newRender, error))
+    // The splat runs per particle like the build pass, the resolve per grid cell like the clear pass.
     {
-        glDeleteProgram (newClear);
-        glDeleteProgram (newBuild);
-        glDeleteProgram (newStep);
-        lastShaderError = "particles.vert/particles.frag:\n" + error;
-        shadersLoaded = false;
-        return false;
+        auto splatDefines = localSizeDefine (workgroupConfig.build);
+        auto resolveDefines = localSizeDefine (workgroupConfig.clear);
+        splatDefines.add ("JF_VOLUME_SPLAT 1");
+        resolveDefines.add ("JF_VOLUME_RESOLVE 1");
+
+        if (! compileComputeProgramFromFile (computeVolumeDensityFile, newVolumeSplat, error, splatDefines))
+            return fail ("volume_density.comp (JF_VOLUME_SPLAT)");
+
+        if (! compileComputeProgramFromFile (computeVolumeDensityFile, newVolumeResolve, error, resolveDefines))
+            return fail ("volume_density.comp (JF_VOLUME_RESOLVE)");
     }
 
-    computeClearProgram = newClear;
-    computeBuildProgram = newBuild;
-    computeStepProgram  = newStep;
-    renderProgram       = newRender;
+    if (! compileComputeProgramFromFile (computeTrailRecordFile, newTrailRecord, error, localSizeDefine (workgroupConfig.build)))
+        return fail ("trails_record.comp");
+
+    if (! compileRenderProgramFromFiles (renderVertexFile, renderFragmentFile, newRender, error))
+        return fail ("particles.vert/particles.frag");
+
+    if (! compileRenderProgramFromFiles (quadVertexFile, quadFragmentFile, newQuadRender, error))
+        return fail ("particles_quad.vert/particles_quad.frag");
+
+    if (! compileRenderProgramFromFiles (meshVertexFile, meshFragmentFile, newMeshRender, error))
+        return fail ("particles_mesh.vert/particles_mesh.frag");
+
+    if (! compileRenderProgramFromFiles (trailVertexFile, trailFragmentFile, newTrailRender, error))
+        return fail ("trails.vert/trails.frag");
+
+    if (! compileRenderProgramFromFiles (fullscreenVertexFile, oitCompositeFragmentFile, newOitComposite, error))
+        return fail ("fullscreen.vert/oit_composite.frag");
+
+    if (! compileRenderProgramFromFiles (fullscreenVertexFile, bloomDownsampleFragmentFile, newBloomDown, error))
+        return fail ("fullscreen.vert/bloom_downsample.frag");
+
+    if (! compileRenderProgramFromFiles (fullscreenVertexFile, bloomUpsampleFragmentFile, newBloomUp, error))
+        return fail ("fullscreen.vert/bloom_upsample.frag");
 
-    lastClearMod      = computeClearFile.getLastModificationTime();
-    lastBuildMod      = computeBuildFile.getLastModificationTime();
-    lastStepMod       = computeStepFile.getLastModificationTime();
-    lastRenderVertMod = renderVertexFile.getLastModificationTime();
-    lastRenderFragMod = renderFragmentFile.getLastModificationTime();
+    if (! compileRenderProgramFromFiles (fullscreenVertexFile, tonemapFragmentFile, newTonemap, error))
+        return fail ("fullscreen.vert/tonemap.frag");
+
+    if (! compileRenderProgramFromFiles (fullscreenVertexFile, volumeRaymarchFragmentFile, newVolumeRaymarch, error))
+        return fail ("fullscreen.vert/volume_raymarch.frag");
+
+    if (! compileRenderProgramFromFiles (fullscreenVertexFile, motionTileMaxFragmentFile, newMotionTileMax, error))
+        return fail ("fullscreen.vert/motion_tilemax.frag");
+
+    if (! compileRenderProgramFromFiles (fullscreenVertexFile, motionNeighbourMaxFragmentFile, newMotionNeighbourMax, error))
+        return fail ("fullscreen.vert/motion_neighbourmax.frag");
+
+    if (! compileRenderProgramFromFiles (fullscreenVertexFile, motionBlurFragmentFile, newMotionBlur, error))
+        return fail ("fullscreen.vert/motion_blur.frag");
+
+    computeRebaseProgram = newRebase;
+    computeCullProgram  = newCull;
+    computeLodCullProgram = newLodCull;
+    computePackProgram  = newPack;
+    computeUnpackProgram = newUnpack;
+    renderProgram       = newRender;
+    quadRenderProgram   = newQuadRender;
+    meshRenderProgram   = newMeshRender;
+    oitCompositeProgram = newOitComposite;
+    bloomDownProgram    = newBloomDown;
+    bloomUpProgram      = newBloomUp;
+    tonemapProgram      = newTonemap;
+    computeVolumeSplatProgram = newVolumeSplat;
+    computeVolumeResolveProgram = newVolumeResolve;
+    volumeRaymarchProgram = newVolumeRaymarch;
+    computeTrailRecordProgram = newTrailRecord;
+    trailRenderProgram  = newTrailRender;
+    motionTileMaxProgram = newMotionTileMax;
+    motionNeighbourMaxProgram = newMotionNeighbourMax;
+    motionBlurProgram   = newMotionBlur;
+
+    for (int kernel = 0; kernel < numSortKernels; ++kernel)
+        computeSortPrograms[kernel] = newSort[kernel];
+
+    shaderModTimes.clear();
+    for (auto& file : getShaderFiles())
+        shaderModTimes[file.getFullPathName()] = file.getLastModificationTime();
 
     shadersLoaded = true;
     lastShaderError.clear();
@@ -604,156 +1189,2092 @@ void MainComponent::deleteBuffers()
     if (particlesSSBO[1] != 0) { glDeleteBuffers (1, &particlesSSBO[1]); particlesSSBO[1] = 0; }
     if (cellHeadsSSBO != 0)    { glDeleteBuffers (1, &cellHeadsSSBO);    cellHeadsSSBO = 0; }
     if (nextIndexSSBO != 0)    { glDeleteBuffers (1, &nextIndexSSBO);    nextIndexSSBO = 0; }
+    if (cellStartSSBO != 0)    { glDeleteBuffers (1, &cellStartSSBO);    cellStartSSBO = 0; }
+    if (cellSlotSSBO != 0)     { glDeleteBuffers (1, &cellSlotSSBO);     cellSlotSSBO = 0; }
+    if (sortedIndexSSBO != 0)  { glDeleteBuffers (1, &sortedIndexSSBO);  sortedIndexSSBO = 0; }
+    if (visibleIndicesSSBO != 0) { glDeleteBuffers (1, &visibleIndicesSSBO); visibleIndicesSSBO = 0; }
+    if (drawIndirectBuffer != 0) { glDeleteBuffers (1, &drawIndirectBuffer); drawIndirectBuffer = 0; }
+    if (sortKeysSSBO[0] != 0)  { glDeleteBuffers (2, sortKeysSSBO);       sortKeysSSBO[0] = sortKeysSSBO[1] = 0; }
+    if (sortValuesSSBO != 0)   { glDeleteBuffers (1, &sortValuesSSBO);    sortValuesSSBO = 0; }
+    if (sortHistogramSSBO != 0) { glDeleteBuffers (1, &sortHistogramSSBO); sortHistogramSSBO = 0; }
+    if (packedParticlesSSBO != 0) { glDeleteBuffers (1, &packedParticlesSSBO); packedParticlesSSBO = 0; }
+    if (volumeTexture != 0)    { glDeleteTextures (1, &volumeTexture);    volumeTexture = 0; }
+    if (volumeAccumulatorSSBO != 0) { glDeleteBuffers (1, &volumeAccumulatorSSBO); volumeAccumulatorSSBO = 0; }
+    releaseTrailHistoryOnGLThread();
+    trajectoryRecorder.waitUntilIdle(); // it may still be reading retained ring slots
+    particleStream.release();
+    streamFrameInfo.clear();
+    particleCapacity = 0;
+    cellHeadsCapacity = 0;
     buffersReady.store (false);
 }
 
-// Allocates/reallocates SSBOs for the requested particle count and current grid parameters; initializes particle data and grid buffers.
+// Allocates all simulation SSBOs from scratch (startup / after a context loss): fresh random particles plus grid buffers.
 void MainComponent::rebuildBuffersOnGLThread (int newParticleCount)
 {
     jassert (juce::OpenGLHelpers::isContextActive());
 
     deleteBuffers();
 
-    currentParticleCount = juce::jlimit (1, 100000, newParticleCount);
+    resizeParticleBuffersOnGLThread (newParticleCount);
+    rebuildGridOnGLThread();
+}
 
-    // Grid derives from world size and cell size.
-    //
-    // Performance note:
-    // If cellSize becomes very small (e.g. tiny neighborRadius), cellCount can explode and the per-frame clear/build
-    // passes become the dominant cost. Clamp total cells to a reasonable upper bound by increasing cellSize as needed.
-    cellSize = juce::jmax (0.5f, neighborRadius);
-    const auto worldSize = worldMax - worldMin;
+// Changes the live particle count without resetting the flock.
+// Existing particles are kept; only the newly added range [oldCount, newCount) is seeded randomly.
+// Buffers are over-allocated (particleCapacity) so that small count increases are just a glBufferSubData of the new tail.
+void MainComponent::resizeParticleBuffersOnGLThread (int newParticleCount)
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
 
-    auto computeGridFromCellSize = [this, worldSize]
+    newParticleCount = juce::jlimit (1, kMaxParticles, newParticleCount);
+    const int oldCount = (particlesSSBO[0] != 0) ? currentParticleCount : 0;
+
+    if (newParticleCount > particleCapacity)
     {
-        gridDims =
-        {
-            juce::jmax (1, (int) std::ceil (worldSize.x / cellSize)),
-            juce::jmax (1, (int) std::ceil (worldSize.y / cellSize)),
-            juce::jmax (1, (int) std::ceil (worldSize.z / cellSize))
-        };
+        // Grow with headroom so dragging the particle slider doesn't reallocate every debounce tick.
+        const int newCapacity = juce::jlimit (newParticleCount, kMaxParticles, newParticleCount + newParticleCount / 4);
+        const auto newBytes = (GLsizeiptr) ((size_t) newCapacity * sizeof (ParticleCPU));
 
-        cellCount = gridDims.x * gridDims.y * gridDims.z;
-    };
+        GLuint newParticles[2] { 0, 0 };
+        glGenBuffers (2, newParticles);
 
-    computeGridFromCellSize();
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, newParticles[0]);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, newBytes, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, newParticles[1]);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, newBytes, nullptr, GL_DYNAMIC_DRAW);
 
-    if (maxCellCount > 0 && cellCount > maxCellCount)
-    {
-        // Increase cellSize until we're under budget. Usually 1 iteration, but ceil() can overshoot slightly.
-        for (int iter = 0; iter < 4 && cellCount > maxCellCount; ++iter)
+        // Carry the live flock over GPU-side; buffer 1 is fully rewritten by the next step, so only buffer 0 needs copying.
+        if (oldCount > 0)
         {
-            const float scale = std::cbrt ((float) cellCount / (float) maxCellCount);
-            cellSize *= (scale * 1.001f);
-            computeGridFromCellSize();
+            glBindBuffer (GL_COPY_READ_BUFFER, particlesSSBO[0]);
+            glBindBuffer (GL_COPY_WRITE_BUFFER, newParticles[0]);
+            glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                                 (GLsizeiptr) ((size_t) oldCount * sizeof (ParticleCPU)));
+            glBindBuffer (GL_COPY_READ_BUFFER, 0);
+            glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
         }
-    }
 
-    // Create SSBOs
-    glGenBuffers (2, particlesSSBO);
-    glGenBuffers (1, &cellHeadsSSBO);
-    glGenBuffers (1, &nextIndexSSBO);
+        if (particlesSSBO[0] != 0) glDeleteBuffers (1, &particlesSSBO[0]);
+        if (particlesSSBO[1] != 0) glDeleteBuffers (1, &particlesSSBO[1]);
+        if (nextIndexSSBO != 0)    glDeleteBuffers (1, &nextIndexSSBO);
+        if (cellSlotSSBO != 0)     glDeleteBuffers (1, &cellSlotSSBO);
+        if (sortedIndexSSBO != 0)  glDeleteBuffers (1, &sortedIndexSSBO);
+        if (visibleIndicesSSBO != 0) glDeleteBuffers (1, &visibleIndicesSSBO);
+        if (sortKeysSSBO[0] != 0)  glDeleteBuffers (2, sortKeysSSBO);
+        if (sortValuesSSBO != 0)   glDeleteBuffers (1, &sortValuesSSBO);
+        if (sortHistogramSSBO != 0) glDeleteBuffers (1, &sortHistogramSSBO);
+        if (packedParticlesSSBO != 0) glDeleteBuffers (1, &packedParticlesSSBO);
+
+        particlesSSBO[0] = newParticles[0];
+        particlesSSBO[1] = newParticles[1];
+
+        // NextIndex is rewritten every frame by the build pass, so it never needs its contents preserved.
+        glGenBuffers (1, &nextIndexSSBO);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, nextIndexSSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) ((size_t) newCapacity * sizeof (GLint)), nullptr, GL_DYNAMIC_DRAW);
+
+        // The cell sort's slots and sorted index list too (only used while the subgroup step is).
+        glGenBuffers (1, &cellSlotSSBO);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, cellSlotSSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) ((size_t) newCapacity * sizeof (GLint)), nullptr, GL_DYNAMIC_DRAW);
+
+        glGenBuffers (1, &sortedIndexSSBO);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, sortedIndexSSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) ((size_t) newCapacity * sizeof (GLint)), nullptr, GL_DYNAMIC_DRAW);
+
+        // Same for the visible index list: the cull pass rewrites it every frame.
+        // One capacity-sized slice per LOD bin (the plain cull only uses the first).
+        glGenBuffers (1, &visibleIndicesSSBO);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, visibleIndicesSSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) ((size_t) newCapacity * kNumLodBins * sizeof (GLuint)), nullptr, GL_DYNAMIC_DRAW);
+
+        if (drawIndirectBuffer == 0)
+        {
+            glGenBuffers (1, &drawIndirectBuffer);
+            glBindBuffer (GL_SHADER_STORAGE_BUFFER, drawIndirectBuffer);
+            glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) (kNumLodBins * 4 * sizeof (GLuint)), nullptr, GL_DYNAMIC_DRAW);
+        }
 
-    // Init particle data
-    std::vector<ParticleCPU> particles;
-    particles.resize ((size_t) currentParticleCount);
+        // Depth sort scratch: ping-pong keys, one values buffer (the other half of the ping-pong is the visible list
+        // itself), and the per-workgroup digit histogram. All rewritten every sorted frame.
+        const auto sortTiles = (size_t) ((newCapacity + kSortWorkgroupSize - 1) / kSortWorkgroupSize);
 
-    std::mt19937 rng ((uint32_t) juce::Time::getMillisecondCounter());
-    std::uniform_real_distribution<float> rx (worldMin.x, worldMax.x);
-    std::uniform_real_distribution<float> ry (worldMin.y, worldMax.y);
-    std::uniform_real_distribution<float> rz (worldMin.z, worldMax.z);
-    std::uniform_real_distribution<float> ru (-1.0f, 1.0f);
-    std::uniform_real_distribution<float> rs (minSpeed, juce::jmax(minSpeed, maxSpeed/2.0f));
+        glGenBuffers (2, sortKeysSSBO);
+        for (auto buffer : sortKeysSSBO)
+        {
+            glBindBuffer (GL_SHADER_STORAGE_BUFFER, buffer);
+            glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) ((size_t) newCapacity * sizeof (GLuint)), nullptr, GL_DYNAMIC_DRAW);
+        }
 
-    for (auto& p : particles)
-    {
-        p.pos[0] = rx (rng);
-        p.pos[1] = ry (rng);
-        p.pos[2] = rz (rng);
-        p.pos[3] = 1.0f;
+        glGenBuffers (1, &sortValuesSSBO);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, sortValuesSSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) ((size_t) newCapacity * sizeof (GLuint)), nullptr, GL_DYNAMIC_DRAW);
+
+        glGenBuffers (1, &sortHistogramSSBO);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, sortHistogramSSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) (sortTiles * kSortRadix * sizeof (GLuint)), nullptr, GL_DYNAMIC_DRAW);
+
+        // Compact snapshots are packed into / unpacked from here; only touched on the frames that save or load one.
+        glGenBuffers (1, &packedParticlesSSBO);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, packedParticlesSSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) ((size_t) newCapacity * SnapshotFile::bytesPerCompactParticle), nullptr, GL_DYNAMIC_DRAW);
+
+        particleCapacity = newCapacity;
+
+        // Transfer rings hold one full frame, so they follow the capacity (in-flight readbacks are simply dropped).
+        // One slot more than the default, so the recorder's writer can hold a frame while two more are in flight.
+        trajectoryRecorder.waitUntilIdle();
+        particleStream.release();
+        streamFrameInfo.clear();
+        pendingSnapshotQueued = false; // its readback went with the old ring; queue it again from the new one
+        if (ParticleStream::isSupported())
+            particleStream.create ((size_t) particleCapacity * sizeof (ParticleCPU), 4);
+    }
 
-        juce::Vector3D<float> dir { ru (rng), ru (rng), ru (rng) };
-        if (dir.length() < 1.0e-3f)
-            dir = juce::Vector3D<float> (1.0f, 0.0f, 0.0f);
-        dir = dir.normalised();
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
 
-        const float speed = rs (rng);
-        const auto vel = dir * speed;
+    if (newParticleCount > oldCount)
+    {
+        const auto numNew = (size_t) (newParticleCount - oldCount);
+
+        uploadToBufferOnGLThread (particlesSSBO[0], (size_t) oldCount * sizeof (ParticleCPU), numNew * sizeof (ParticleCPU),
+                                  [this, numNew, rngSeed = getRangeSeed (deterministic, seed, oldCount)] (void* dest)
+                                  {
+                                      fillRandomParticles (static_cast<ParticleCPU*> (dest), numNew,
+                                                           toOriginRelative (worldMin), toOriginRelative (worldMax),
+                                                           minSpeed, maxSpeed, rngSeed, flockDistribution);
+                                  });
+    }
 
-        p.vel[0] = vel.x;
-        p.vel[1] = vel.y;
-        p.vel[2] = vel.z;
-        p.vel[3] = 0.0f;
+    // Added particles have no history yet.
+    if (newParticleCount != currentParticleCount)
+        trailsNeedReset = true;
 
-        const auto heading = vel.normalised();
-        const float t = juce::jlimit (0.0f, 1.0f, (speed - minSpeed) / (maxSpeed - minSpeed));
-        p.color[0] = 0.2f + 0.8f * std::abs (heading.x);
-        p.color[1] = 0.2f + 0.8f * std::abs (heading.y);
-        p.color[2] = 0.2f + 0.8f * std::abs (heading.z);
-        p.color[3] = 0.35f + 0.65f * t;
-    }
+    currentParticleCount = newParticleCount;
+    buffersReady.store (particlesSSBO[0] != 0 && cellHeadsSSBO != 0);
+}
 
-    glBindBuffer (GL_SHADER_STORAGE_BUFFER, particlesSSBO[0]);
-    glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) (particles.size() * sizeof (ParticleCPU)), particles.data(), GL_DYNAMIC_DRAW);
+// Reseeds every particle in place (Restart flock, and deterministic mode turning on or changing seed). The floating
+// origin goes back to zero first: seeded positions are origin-relative, so the same seed only gives the same flock
+// from the same origin.
+void MainComponent::restartFlockOnGLThread()
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
 
-    glBindBuffer (GL_SHADER_STORAGE_BUFFER, particlesSSBO[1]);
-    glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) (particles.size() * sizeof (ParticleCPU)), nullptr, GL_DYNAMIC_DRAW);
+    // During playback the recording owns the particles.
+    if (particlesSSBO[0] == 0 || trajectoryPlayer != nullptr)
+        return;
 
-    std::vector<GLint> heads;
-    heads.resize ((size_t) cellCount, -1);
-    glBindBuffer (GL_SHADER_STORAGE_BUFFER, cellHeadsSSBO);
-    glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) (heads.size() * sizeof (GLint)), heads.data(), GL_DYNAMIC_DRAW);
+    worldOrigin = {};
 
-    glBindBuffer (GL_SHADER_STORAGE_BUFFER, nextIndexSSBO);
-    glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) (currentParticleCount * (int) sizeof (GLint)), nullptr, GL_DYNAMIC_DRAW);
+    const auto numParticles = (size_t) currentParticleCount;
 
-    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+    uploadToBufferOnGLThread (particlesSSBO[0], 0, numParticles * sizeof (ParticleCPU),
+                              [this, numParticles, rngSeed = getRangeSeed (deterministic, seed, 0)] (void* dest)
+                              {
+                                  fillRandomParticles (static_cast<ParticleCPU*> (dest), numParticles,
+                                                       toOriginRelative (worldMin), toOriginRelative (worldMax),
+                                                       minSpeed, maxSpeed, rngSeed, flockDistribution);
+                              });
 
-    buffersReady.store (true);
+    trailsNeedReset = true;
+    previousViewProjValid = false;
 }
 
-// Builds the combined view-projection matrix from orbit/pan/cameraDistance, used by the render shader.
-juce::Matrix3D<float> MainComponent::getViewProjectionMatrix() const
+// Writes numBytes into buffer at offset. Goes through the persistently mapped upload ring when available
+// (writeData fills mapped memory directly, no staging copy); otherwise stages in a heap block for glBufferSubData.
+void MainComponent::uploadToBufferOnGLThread (unsigned int buffer, size_t offset, size_t numBytes,
+                                              const std::function<void (void*)>& writeData)
 {
-    const float w = (float) juce::jmax (1, getWidth());
-    const float h = (float) juce::jmax (1, getHeight());
-    const float aspect = w / h;
-
-    const float nearZ = 0.1f;
-    const float farZ  = 500.0f;
-    const float fovY  = juce::MathConstants<float>::pi / 3.0f; // 60 degrees
-    const float top   = nearZ * std::tan (fovY * 0.5f);
-    const float right = top * aspect;
+    jassert (juce::OpenGLHelpers::isContextActive());
 
-    const auto proj = juce::Matrix3D<float>::fromFrustum (-right, right, -top, top, nearZ, farZ);
+    if (auto* mapped = particleStream.beginUpload (numBytes))
+    {
+        writeData (mapped);
+        particleStream.commitUpload (buffer, offset, numBytes);
+        return;
+    }
 
-    // Treat orbit as rotating the world (simpler than building the true inverse camera rotation)
-    const auto rot = orbit.getRotationMatrix();
-    const auto trans = juce::Matrix3D<float>::fromTranslation ({ pan.x, pan.y, -cameraDistance });
-    const auto view = trans * rot;
+    juce::HeapBlock<char> staging (numBytes);
+    writeData (staging.getData());
 
-    return proj * view;
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferSubData (GL_SHADER_STORAGE_BUFFER, (GLintptr) offset, (GLsizeiptr) numBytes, staging.getData());
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
 }
 
-// Runs the per-frame compute pipeline: clear grid, build grid, step boids; then swaps particle ping-pong buffers.
-void MainComponent::dispatchComputePasses (float dtSeconds)
+// Collects finished readbacks (never waits) and queues a copy of this frame's particle state.
+// Each per-frame copy feeds both the trajectory recorder and the built-in analytics, so recording and
+// "Stream to CPU" together still cost one readback per frame.
+// A pending snapshot save rides on the same ring (tagged kSnapshotReadbackTag), with or without "Stream to CPU".
+void MainComponent::streamParticlesOnGLThread()
 {
-    if (! buffersReady.load())
-        return;
+    if (! particleStream.isCreated())
+    {
+        if (pendingSnapshot != nullptr)
+            readSnapshotSynchronouslyOnGLThread();
+
+        return;
+    }
+
+    particleStream.pollReadbacks ([this] (const ParticleStream::Frame& frame)
+    {
+        if (frame.tag == kSnapshotReadbackTag)
+        {
+            // Copied out rather than retained: the ring is reallocated whenever the particle capacity grows.
+            if (pendingSnapshot != nullptr && pendingSnapshotQueued)
+            {
+                pendingSnapshot->particles.replaceAll (frame.data, frame.numBytes);
+                writeSnapshotInBackground();
+            }
+            return;
+        }
+
+        jassert (! streamFrameInfo.empty());
+        if (streamFrameInfo.empty())
+            return;
+
+        const auto info = streamFrameInfo.front();
+        streamFrameInfo.pop_front();
+
+        if (frame.particleCount <= 0)
+            return;
+
+        if (trajectoryRecorder.isRecording())
+        {
+            // The writer encodes straight out of the ring slot and hands it back when the frame is in the file.
+            particleStream.retainFrame (frame.slot);
+
+            if (! trajectoryRecorder.pushFrame (frame.data, frame.particleCount, info.timeSeconds - recordingStartSeconds,
+                                                info.worldOrigin, [this, slot = frame.slot] { particleStream.releaseFrame (slot); }))
+                particleStream.releaseFrame (frame.slot);
+        }
+
+        if (! streamParticles)
+            return;
+
+        const auto* particles = static_cast<const ParticleCPU*> (frame.data);
+
+        double speedSum = 0.0, cx = 0.0, cy = 0.0, cz = 0.0;
+
+        for (int i = 0; i < frame.particleCount; ++i)
+        {
+            const auto& p = particles[i];
+            cx += p.pos[0];
+            cy += p.pos[1];
+            cz += p.pos[2];
+            speedSum += std::sqrt (p.vel[0] * p.vel[0] + p.vel[1] * p.vel[1] + p.vel[2] * p.vel[2]);
+        }
+
+        const double inv = 1.0 / (double) frame.particleCount;
+        streamMeanSpeed = (float) (speedSum * inv);
+        streamCentroid = { (float) (cx * inv + info.worldOrigin.x), (float) (cy * inv + info.worldOrigin.y), (float) (cz * inv + info.worldOrigin.z) };
+    });
+
+    if (pendingSnapshot != nullptr && ! pendingSnapshotQueued)
+    {
+        fillSnapshotHeaderOnGLThread (*pendingSnapshot);
+        const auto source = packSnapshotOnGLThread (*pendingSnapshot);
+        pendingSnapshotQueued = particleStream.enqueueReadback (source, (size_t) currentParticleCount * (size_t) pendingSnapshot->bytesPerParticle,
+                                                                currentParticleCount, kSnapshotReadbackTag);
+    }
+
+    if (streamParticles || trajectoryRecorder.isRecording())
+    {
+        if (particleStream.enqueueReadback (particlesSSBO[0], (size_t) currentParticleCount * sizeof (ParticleCPU), currentParticleCount))
+            streamFrameInfo.push_back ({ simulationTimeSeconds, worldOrigin });
+        else if (trajectoryRecorder.isRecording())
+            trajectoryRecorder.addDroppedFrame();
+    }
+}
+
+//==============================================================================
+// Snapshots (see SnapshotFile). Save: the settings are taken from the panel here, the particles are read back
+// asynchronously on a later frame through particleStream, and the file is written on a background thread.
+void MainComponent::saveSnapshotAsync (SnapshotFile::Encoding encoding)
+{
+    snapshotChooser = std::make_unique<juce::FileChooser> ("Save flock snapshot", getSnapshotDirectory(), "*.jfsnap");
+
+    const auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                     | juce::FileBrowserComponent::warnAboutOverwriting;
+
+    snapshotChooser->launchAsync (flags, [this, encoding] (const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+
+        auto snapshot = std::make_shared<SnapshotFile>();
+        snapshot->encoding = encoding;
+        snapshot->params = controlPanel->getParams().toVar();
+
+        openGLContext.executeOnGLThread ([this, snapshot, file = file.withFileExtension ("jfsnap")] (juce::OpenGLContext&)
+        {
+            pendingSnapshot = snapshot;
+            pendingSnapshotFile = file;
+            pendingSnapshotQueued = false;
+        }, false);
+    });
+}
+
+// Load: the file is read and validated here, the panel updated, then the flock is replaced on the GL thread.
+void MainComponent::loadSnapshotAsync()
+{
+    snapshotChooser = std::make_unique<juce::FileChooser> ("Load flock snapshot", getSnapshotDirectory(), "*.jfsnap");
+
+    const auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+
+    snapshotChooser->launchAsync (flags, [this] (const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+
+        auto snapshot = std::make_shared<SnapshotFile>();
+        juce::String error;
+
+        if (! snapshot->readFromFile (file, error))
+        {
+            showError ("Snapshot not loaded", error);
+            return;
+        }
+
+        const auto expectedBytes = snapshot->encoding == SnapshotFile::Encoding::compact ? SnapshotFile::bytesPerCompactParticle
+                                                                                         : (int) sizeof (ParticleCPU);
+
+        if (snapshot->bytesPerParticle != expectedBytes || snapshot->particleCount > kMaxParticles)
+        {
+            showError ("Snapshot not loaded",
+                       file.getFileName() + " holds " + juce::String (snapshot->particleCount) + " particles of "
+                         + juce::String (snapshot->bytesPerParticle) + " bytes; this build runs up to "
+                         + juce::String (kMaxParticles) + " of " + juce::String (expectedBytes) + " bytes");
+            return;
+        }
+
+        auto p = BoidsControlPanel::Params::fromVar (snapshot->params);
+        p.particleCount = snapshot->particleCount;
+        controlPanel->setParams (p);
+
+        openGLContext.executeOnGLThread ([this, snapshot, p] (juce::OpenGLContext&)
+        {
+            loadSnapshotOnGLThread (*snapshot, p);
+        }, false);
+    });
+}
+
+juce::File MainComponent::getSnapshotDirectory() const
+{
+    return juce::File::getSpecialLocation (juce::File::userDocumentsDirectory);
+}
+
+// Reports a failed load, save, recording, export or audio/OSC start: a non-blocking warning box (message thread).
+void MainComponent::showError (const juce::String& title, const juce::String& message)
+{
+    juce::AlertWindow::showMessageBoxAsync (juce::MessageBoxIconType::WarningIcon, title, message);
+}
+
+// Everything but the particle data, taken on the frame whose particles are read back so the two always match.
+// Compact snapshots quantise over the world box plus a quarter on each side (the recorder's margin), so boids that
+// stray outside it with wrap off keep their place; anything further out is clamped to the edge.
+void MainComponent::fillSnapshotHeaderOnGLThread (SnapshotFile& snapshot) const
+{
+    if (computePackProgram == 0)
+        snapshot.encoding = SnapshotFile::Encoding::raw;
+
+    const auto compact = snapshot.encoding == SnapshotFile::Encoding::compact;
+    const auto pad = (worldMax - worldMin) * 0.25f;
+
+    snapshot.particleCount = currentParticleCount;
+    snapshot.bytesPerParticle = compact ? SnapshotFile::bytesPerCompactParticle : (int) sizeof (ParticleCPU);
+    snapshot.worldMin = worldMin;
+    snapshot.worldMax = worldMax;
+    snapshot.cellSize = cellSize;
+    snapshot.gridDims = gridDims;
+    snapshot.worldOrigin = worldOrigin;
+    snapshot.quantMin = compact ? toOriginRelative (worldMin - pad) : juce::Vector3D<float>();
+    snapshot.quantMax = compact ? toOriginRelative (worldMax + pad) : juce::Vector3D<float>();
+    snapshot.speedRange = compact ? maxSpeed * 1.5f : 0.0f;
+}
+
+// Returns the buffer a snapshot's particle bytes are read back from: the particles themselves for a raw snapshot,
+// or packedParticlesSSBO after a pack pass for a compact one (4x less to read back and to write).
+unsigned int MainComponent::packSnapshotOnGLThread (const SnapshotFile& snapshot)
+{
+    if (snapshot.encoding != SnapshotFile::Encoding::compact)
+        return particlesSSBO[0];
+
+    glUseProgram (computePackProgram);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, particlesSSBO[0]);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 12, packedParticlesSSBO);
+
+    setUniform1iIfPresent (computePackProgram, "u_particleCount", snapshot.particleCount);
+    setUniform3fIfPresent (computePackProgram, "u_quantMin", snapshot.quantMin);
+    setUniform3fIfPresent (computePackProgram, "u_quantSize", snapshot.quantMax - snapshot.quantMin);
+    setUniform1fIfPresent (computePackProgram, "u_speedRange", snapshot.speedRange);
+
+    glDispatchCompute ((GLuint) ((snapshot.particleCount + workgroupConfig.build - 1) / workgroupConfig.build), 1, 1);
+    glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 12, 0);
+    glUseProgram (0);
+    return packedParticlesSSBO;
+}
+
+// Without persistent mapping there is no readback ring: read the buffer back directly (stalls this one frame).
+void MainComponent::readSnapshotSynchronouslyOnGLThread()
+{
+    fillSnapshotHeaderOnGLThread (*pendingSnapshot);
+    const auto source = packSnapshotOnGLThread (*pendingSnapshot);
+
+    const auto numBytes = (size_t) currentParticleCount * (size_t) pendingSnapshot->bytesPerParticle;
+    pendingSnapshot->particles.setSize (numBytes);
+
+    glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, source);
+    glGetBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr) numBytes, pendingSnapshot->particles.getData());
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+    writeSnapshotInBackground();
+}
+
+// Hands the completed snapshot to a one-off thread so disk speed never shows up in the frame time.
+void MainComponent::writeSnapshotInBackground()
+{
+    auto snapshot = std::move (pendingSnapshot);
+    pendingSnapshotQueued = false;
+
+    juce::Thread::launch ([snapshot, file = pendingSnapshotFile]
+    {
+        juce::String error;
+
+        if (! snapshot->writeToFile (file, error))
+            juce::MessageManager::callAsync ([error] { showError ("Snapshot not saved", error); });
+    });
+}
+
+// Replaces the running flock. The world box and origin come first: the grid is derived from the box, and the
+// stored positions are relative to the origin. The grid itself is rebuilt from the restored settings.
+void MainComponent::loadSnapshotOnGLThread (const SnapshotFile& snapshot, const BoidsControlPanel::Params& p)
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
+
+    pendingSnapshot = nullptr; // a save still waiting for its readback would capture a mix of both flocks
+    pendingSnapshotQueued = false;
+
+    worldMin = snapshot.worldMin;
+    worldMax = snapshot.worldMax;
+    worldOrigin = snapshot.worldOrigin;
+
+    // A deterministic snapshot resumes where it was saved, rather than applyParamsOnGLThread() restarting it from its seed.
+    deterministic = p.deterministic;
+    seed = juce::jlimit (0, kMaxSeed, p.seed);
+
+    applyParamsOnGLThread (p);
+    rebuildGridOnGLThread();
+
+    if (particlesSSBO[0] == 0 || currentParticleCount != snapshot.particleCount)
+        return;
+
+    const auto compact = snapshot.encoding == SnapshotFile::Encoding::compact;
+
+    uploadToBufferOnGLThread (compact ? packedParticlesSSBO : particlesSSBO[0], 0, snapshot.particles.getSize(), [&snapshot] (void* dest)
+    {
+        std::memcpy (dest, snapshot.particles.getData(), snapshot.particles.getSize());
+    });
+
+    if (compact)
+    {
+        // Quantised back into the origin-relative space restored above; colour is left for the next step to fill in.
+        glUseProgram (computeUnpackProgram);
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, particlesSSBO[0]);
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 12, packedParticlesSSBO);
+
+        setUniform1iIfPresent (computeUnpackProgram, "u_particleCount", snapshot.particleCount);
+        setUniform3fIfPresent (computeUnpackProgram, "u_quantMin", snapshot.quantMin);
+        setUniform3fIfPresent (computeUnpackProgram, "u_quantSize", snapshot.quantMax - snapshot.quantMin);
+        setUniform1fIfPresent (computeUnpackProgram, "u_speedRange", snapshot.speedRange);
+
+        glDispatchCompute ((GLuint) ((snapshot.particleCount + workgroupConfig.build - 1) / workgroupConfig.build), 1, 1);
+        glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 12, 0);
+        glUseProgram (0);
+    }
+
+    trailsNeedReset = true;
+    previousViewProjValid = false;
+}
+
+//==============================================================================
+// Presets (see PresetFile). The folder is read whenever a file in it is added, removed or saved, and every preset
+// is parsed then, so applying one is a lookup plus the GL-thread work its changes need.
+void MainComponent::rescanPresets()
+{
+    const auto files = PresetFile::findPresetFiles (getPresetsDirectory());
+
+    juce::StringArray stamps;
+    for (const auto& file : files)
+        stamps.add (file.getFullPathName() + "@" + juce::String (file.getLastModificationTime().toMilliseconds()));
+
+    if (stamps == presetFileStamps)
+        return;
+
+    presetFileStamps = stamps;
+    presets.clear();
+
+    juce::StringArray names, errors;
+
+    for (const auto& file : files)
+    {
+        PresetFile preset;
+        juce::String error;
+
+        if (preset.readFromFile (file, error))
+        {
+            names.add (preset.name);
+            presets.push_back (std::move (preset));
+        }
+        else
+        {
+            errors.add (error);
+        }
+    }
+
+    controlPanel->setPresetNames (names);
+
+    if (! errors.isEmpty())
+        showError ("Presets skipped", errors.joinIntoString ("\n"));
+}
+
+// The preset's settings go over the current ones, so fields it leaves out keep their values.
+void MainComponent::applyPreset (int index)
+{
+    if (! juce::isPositiveAndBelow (index, (int) presets.size()))
+        return;
+
+    const auto& preset = presets[(size_t) index];
+    const auto p = BoidsControlPanel::Params::fromVar (preset.params, controlPanel->getParams());
+
+    controlPanel->setParams (p);
+    controlPanel->setSelectedPreset (index);
+
+    openGLContext.executeOnGLThread ([this, preset, p] (juce::OpenGLContext&) { applyPresetOnGLThread (preset, p); }, false);
+}
+
+// Only what the preset changes is touched: most settings are uniforms, a new world box or neighbour radius rebuilds
+// the grid (not the particles), and only a new count resizes the particle buffers. The flock flies on into the new
+// look unless the preset asks for a restart, which reseeds it with the preset's distribution.
+void MainComponent::applyPresetOnGLThread (const PresetFile& preset, const BoidsControlPanel::Params& p)
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
+
+    const auto differs = [] (juce::Vector3D<float> a, juce::Vector3D<float> b) { return a.x != b.x || a.y != b.y || a.z != b.z; };
+    const bool worldBoxChanged = preset.hasWorldBox && (differs (preset.worldMin, worldMin) || differs (preset.worldMax, worldMax));
+
+    if (worldBoxChanged)
+    {
+        worldMin = preset.worldMin;
+        worldMax = preset.worldMax;
+    }
+
+    if (preset.hasDistribution)
+        flockDistribution = preset.distribution;
+
+    applyParamsOnGLThread (p, preset.restart);
+
+    if (worldBoxChanged)
+        rebuildGridOnGLThread();
+}
+
+// Saves the current look: panel settings, world box and distribution. A restart flag has to be added by hand.
+void MainComponent::savePresetAsync()
+{
+    presetChooser = std::make_unique<juce::FileChooser> ("Save preset", getPresetsDirectory(), "*.json");
+
+    const auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                     | juce::FileBrowserComponent::warnAboutOverwriting;
+
+    presetChooser->launchAsync (flags, [this] (const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+
+        auto preset = std::make_shared<PresetFile>();
+        preset->name = file.getFileNameWithoutExtension();
+        preset->params = controlPanel->getParams().toVar();
+
+        // The world box and distribution are GL-thread state; the file is written back on the message thread.
+        openGLContext.executeOnGLThread ([this, preset, file = file.withFileExtension ("json")] (juce::OpenGLContext&)
+        {
+            preset->hasWorldBox = true;
+            preset->worldMin = worldMin;
+            preset->worldMax = worldMax;
+            preset->hasDistribution = true;
+            preset->distribution = flockDistribution;
+
+            juce::MessageManager::callAsync ([safeThis = juce::Component::SafePointer<MainComponent> (this), preset, file]
+            {
+                juce::String error;
+
+                if (! preset->writeToFile (file, error))
+                    showError ("Preset not saved", error);
+                else if (safeThis != nullptr)
+                    safeThis->rescanPresets();
+            });
+        }, false);
+    });
+}
+
+//==============================================================================
+// Parameter timelines (see ParamTimeline). Read and checked here; run on the GL thread, which steps the simulation
+// they drive.
+std::shared_ptr<ParamTimeline> MainComponent::readTimeline (const juce::File& file, juce::String& error) const
+{
+    auto newTimeline = std::make_shared<ParamTimeline>();
+
+    if (! newTimeline->loadFromFile (file, error))
+        return nullptr;
+
+    // A misspelt track would otherwise do nothing, silently.
+    const auto fields = BoidsControlPanel::Params().toVar();
+
+    for (const auto& name : newTimeline->getTrackNames())
+    {
+        if (! fields.hasProperty (name))
+        {
+            error = file.getFileName() + ": \"" + name + "\" isn't a setting";
+            return nullptr;
+        }
+    }
+
+    return newTimeline;
+}
+
+void MainComponent::openTimelineAsync()
+{
+    timelineChooser = std::make_unique<juce::FileChooser> ("Run parameter timeline", getTimelinesDirectory(), "*.json");
+
+    const auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+
+    timelineChooser->launchAsync (flags, [this] (const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+
+        juce::String error;
+        auto newTimeline = readTimeline (file, error);
+
+        if (newTimeline == nullptr)
+        {
+            showError ("Timeline not started", error);
+            return;
+        }
+
+        openGLContext.executeOnGLThread ([this, newTimeline] (juce::OpenGLContext&)
+        {
+            startTimelineOnGLThread (newTimeline);
+        }, false);
+    });
+}
+
+// Time 0 is the next simulation step. A timeline started while another runs replaces it from where that one left
+// the settings.
+void MainComponent::startTimelineOnGLThread (std::shared_ptr<ParamTimeline> newTimeline)
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
+
+    timeline = std::move (newTimeline);
+    timelineStartSeconds = simulationTimeSeconds;
+}
+
+void MainComponent::stopTimelineOnGLThread()
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
+
+    if (timeline == nullptr)
+        return;
+
+    timeline = nullptr;
+
+    // The panel still shows the settings from before the timeline; leave the automated ones where it took them.
+    juce::MessageManager::callAsync ([panel = juce::Component::SafePointer<BoidsControlPanel> (controlPanel.get()), p = appliedParams]
+    {
+        if (panel != nullptr)
+            panel->setParams (p);
+    });
+}
+
+// Sets the automated settings for the step about to run, from the simulated time since the timeline started, so
+// they follow simulated time whatever the frame rate. They go over the settings applied last, through the same
+// applyParamsOnGLThread() as the panel: most tracks change uniforms only, a count or radius track resizes the
+// particles or recomputes the grid as it moves, and nothing rebuilds the buffers.
+void MainComponent::advanceTimelineOnGLThread()
+{
+    const auto t = simulationTimeSeconds - timelineStartSeconds;
+    const bool finished = ! timeline->isLooping() && t >= timeline->getDuration();
+
+    applyParamsOnGLThread (BoidsControlPanel::Params::fromVar (timeline->evaluate (t), appliedParams));
+
+    if (finished)
+        stopTimelineOnGLThread();
+}
+
+//==============================================================================
+// OSC input (see OscControl). Everything here runs on the message thread, from the receiver's drain.
+bool MainComponent::startOsc (int port)
+{
+    juce::String error;
+    const bool listening = oscControl.start (port, error);
+
+    if (listening)
+        oscPort = port;
+    else
+        showError ("OSC input not started", error);
+
+    controlPanel->setOscListening (listening, oscPort);
+    return listening;
+}
+
+void MainComponent::stopOsc()
+{
+    oscControl.stop();
+    controlPanel->setOscListening (false, oscPort);
+}
+
+void MainComponent::handleOscCommand (const OscControl::Command& command)
+{
+    using Type = OscControl::Command::Type;
+
+    switch (command.type)
+    {
+        case Type::param:
+        {
+            // Typed like the field it sets, so 1.0 from a fader turns a toggle on and 2.7 picks mode 3.
+            static const auto fields = BoidsControlPanel::Params().toVar();
+            const juce::Identifier name (juce::String::fromUTF8 (command.name));
+
+            if (! fields.hasProperty (name))
+                return;
+
+            const auto current = fields[name];
+            const auto value = command.values[0];
+
+            if (current.isBool())
+                oscParamChanges.getDynamicObject()->setProperty (name, value >= 0.5f);
+            else if (current.isInt())
+                oscParamChanges.getDynamicObject()->setProperty (name, juce::roundToInt (value));
+            else
+                oscParamChanges.getDynamicObject()->setProperty (name, (double) value);
+            return;
+        }
+
+        case Type::preset:
+        {
+            // Settings queued before the preset land first, so the preset wins over them as it would from a key.
+            applyOscParamChanges();
+
+            auto index = command.index;
+
+            if (index < 0)
+            {
+                const auto name = juce::String::fromUTF8 (command.name);
+                for (int i = 0; i < (int) presets.size() && index < 0; ++i)
+                    if (presets[(size_t) i].name.equalsIgnoreCase (name))
+                        index = i;
+            }
+
+            applyPreset (index);
+            return;
+        }
+
+        case Type::restart:
+            openGLContext.executeOnGLThread ([this] (juce::OpenGLContext&) { restartFlockOnGLThread(); }, false);
+            return;
+
+        // The camera is read by render(), so it's changed on the GL thread between frames.
+        case Type::cameraOrbit:
+        {
+            // Absolute, from the startup view: yaw about the vertical axis, then pitch about the horizontal one.
+            const auto yaw = juce::Quaternion<float>::fromAngle (juce::degreesToRadians (command.values[0]), { 0.0f, 1.0f, 0.0f });
+            const auto pitch = juce::Quaternion<float>::fromAngle (juce::degreesToRadians (command.values[1]), { 1.0f, 0.0f, 0.0f });
+            const auto orientation = pitch * yaw * juce::Draggable3DOrientation().getQuaternion();
+
+            openGLContext.executeOnGLThread ([this, orientation] (juce::OpenGLContext&) { orbit.getQuaternion() = orientation; }, false);
+            return;
+        }
+
+        case Type::cameraDistance:
+        {
+            const auto distance = juce::jlimit (kMinCameraDistance, kMaxCameraDistance, command.values[0]);
+            openGLContext.executeOnGLThread ([this, distance] (juce::OpenGLContext&) { cameraDistance = distance; }, false);
+            return;
+        }
+
+        case Type::cameraPan:
+        {
+            const juce::Vector3D<float> newPan { command.values[0], command.values[1], 0.0f };
+            openGLContext.executeOnGLThread ([this, newPan] (juce::OpenGLContext&) { pan = newPan; }, false);
+            return;
+        }
+
+        case Type::cameraReset:
+        {
+            const auto bounds = getLocalBounds();
+            openGLContext.executeOnGLThread ([this, bounds] (juce::OpenGLContext&)
+            {
+                orbit = juce::Draggable3DOrientation();
+                orbit.setViewport (bounds);
+                pan = {};
+                cameraDistance = defaultCameraDistance;
+            }, false);
+            return;
+        }
+    }
+}
+
+// Every setting that arrived in one drain goes over the panel's values as one change: the panel shows it, and the GL
+// thread applies it with the next frame, as from a preset. Never waits for the GL thread.
+void MainComponent::applyOscParamChanges()
+{
+    auto* changes = oscParamChanges.getDynamicObject();
+
+    if (changes->getProperties().isEmpty())
+        return;
+
+    const auto p = BoidsControlPanel::Params::fromVar (oscParamChanges, controlPanel->getParams());
+    changes->clear();
+
+    controlPanel->setParams (p);
+
+    openGLContext.executeOnGLThread ([this, p] (juce::OpenGLContext&) { applyParamsOnGLThread (p); }, false);
+}
+
+bool MainComponent::listenForOscOnLaunch (int port)
+{
+    juce::String error;
+
+    if (! oscControl.start (port, error))
+    {
+        juce::Logger::writeToLog ("OSC input not started: " + error);
+        return false;
+    }
+
+    oscPort = port;
+    controlPanel->setOscListening (true, oscPort);
+    return true;
+}
+
+//==============================================================================
+// Audio-reactive modulation (see AudioAnalyser). Sources are opened and closed here, on the message thread.
+void MainComponent::startAudioInput()
+{
+    juce::String error;
+    const bool listening = audioAnalyser.startInput (error);
+
+    if (! listening)
+        showError ("Audio input not started", error);
+
+    controlPanel->setAudioInput (listening);
+}
+
+void MainComponent::openAudioFileAsync()
+{
+    audioChooser = std::make_unique<juce::FileChooser> ("Analyse audio file", juce::File(), "*.wav;*.aif;*.aiff;*.flac;*.ogg");
+
+    const auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+
+    audioChooser->launchAsync (flags, [this] (const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+
+        juce::String error;
+
+        if (! audioAnalyser.startFile (file, error))
+            showError ("Audio file not analysed", error);
+
+        controlPanel->setAudioInput (false);
+    });
+}
+
+bool MainComponent::analyseAudioFileOnLaunch (const juce::File& file)
+{
+    juce::String error;
+
+    if (! audioAnalyser.startFile (file, error))
+    {
+        juce::Logger::writeToLog ("Audio file not analysed: " + error);
+        return false;
+    }
+
+    return true;
+}
+
+void MainComponent::stopAudio()
+{
+    audioAnalyser.stop();
+    controlPanel->setAudioInput (false);
+}
+
+// Takes the analysis frames queued since the last step and modulates the settings applied last, so the flock reacts
+// in the first frame rendered after the audio arrives, and the panel, presets, OSC and timelines keep setting the
+// base values. Only uniforms are touched: nothing here resizes or rebuilds a buffer. The envelopes hold each peak
+// and release it over a fraction of a second, so a hop between two frames isn't missed and nothing flickers; once
+// the audio has stopped and they have released, the settings are back at their base and this stops running.
+void MainComponent::modulateFromAudioOnGLThread (float dtSeconds)
+{
+    AudioAnalyser::Frame frame;
+    const bool hasFrames = audioAnalyser.popFrames (frame) > 0;
+
+    const auto bandRelease = std::exp (-dtSeconds / 0.15f);
+    const auto onsetRelease = std::exp (-dtSeconds / 0.2f);
+
+    for (int i = 0; i <= AudioAnalyser::numBands; ++i)
+    {
+        const auto target = hasFrames ? (i < AudioAnalyser::numBands ? frame.bands[i] : frame.level) : 0.0f;
+        audioBandEnvelopes[i] = juce::jmax (target, audioBandEnvelopes[i] * bandRelease);
+    }
+
+    audioOnsetEnvelope = juce::jmax (hasFrames ? frame.onset : 0.0f, audioOnsetEnvelope * onsetRelease);
+
+    audioModulating = audioAnalyser.isRunning() || audioOnsetEnvelope > 1.0e-3f
+                        || *std::max_element (std::begin (audioBandEnvelopes), std::end (audioBandEnvelopes)) > 1.0e-3f;
+
+    if (! audioModulating)
+    {
+        // Released: this last pass puts the settings back exactly.
+        std::fill (std::begin (audioBandEnvelopes), std::end (audioBandEnvelopes), 0.0f);
+        audioOnsetEnvelope = 0.0f;
+    }
+
+    const auto depth = audioReactivity;
+    const auto bass = depth * audioBandEnvelopes[0];
+    const auto lowMid = depth * audioBandEnvelopes[1];
+    const auto highMid = depth * audioBandEnvelopes[2];
+    const auto treble = depth * audioBandEnvelopes[3];
+    const auto level = depth * audioBandEnvelopes[AudioAnalyser::numBands];
+    const auto onset = depth * audioOnsetEnvelope;
+
+    // The modulated settings go through the same clamping as any other settings change.
+    auto modulated = appliedParams;
+    modulated.weightCohesion   *= 1.0f + 1.5f * bass;
+    modulated.weightAlignment  *= 1.0f + lowMid;
+    modulated.weightSeparation *= 1.0f + highMid;
+    modulated.maxSpeed *= 1.0f + 0.75f * level;
+    modulated.maxAccel *= 1.0f + 2.0f * onset;
+    modulated.saturation += (1.0f - modulated.saturation) * treble;
+
+    const auto hue = modulated.hueOffset + 0.15f * onset;
+    modulated.hueOffset = hue - std::floor (hue);
+
+    const auto clamped = clampParams (modulated);
+    weightCohesion   = clamped.weightCohesion;
+    weightAlignment  = clamped.weightAlignment;
+    weightSeparation = clamped.weightSeparation;
+    maxSpeed = clamped.maxSpeed;
+    maxAccel = clamped.maxAccel;
+    saturation = clamped.saturation;
+    hueOffset = clamped.hueOffset;
+}
+
+//==============================================================================
+// Trajectory recording (see TrajectoryRecorder). The file is picked here; the recorder is started and stopped on
+// the GL thread, between frames, so its frames are exactly the per-frame readbacks queued while it runs.
+void MainComponent::startRecordingAsync (TrajectoryFile::Encoding encoding)
+{
+    recordingChooser = std::make_unique<juce::FileChooser> ("Record particle trajectories", getSnapshotDirectory(), "*.jftraj");
+
+    const auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                     | juce::FileBrowserComponent::warnAboutOverwriting;
+
+    recordingChooser->launchAsync (flags, [this, encoding] (const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file == juce::File())
+        {
+            controlPanel->setRecording (false);
+            return;
+        }
+
+        openGLContext.executeOnGLThread ([this, encoding, file = file.withFileExtension ("jftraj")] (juce::OpenGLContext&)
+        {
+            startRecordingOnGLThread (file, encoding);
+        }, false);
+    });
+}
+
+// The quantisation box is the world box, plus a quarter of its size on every side unless boids wrap around it (see
+// TrajectoryFile::getQuantisationBox()), and velocities are quantised up to 1.5x the current max speed. Both are
+// taken when the recording starts and stay fixed until it stops, whatever the settings do in between.
+void MainComponent::startRecordingOnGLThread (const juce::File& file, TrajectoryFile::Encoding encoding)
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
+
+    stopRecordingOnGLThread();
+
+    juce::String error;
+
+    if (particleStream.isCreated())
+    {
+        TrajectoryRecorder::Settings settings;
+        settings.encoding = encoding;
+        TrajectoryFile::getQuantisationBox (worldMin, worldMax, wrapBounds, settings.quantMin, settings.quantMax);
+        settings.velocityRange = maxSpeed * 1.5f;
+
+        if (trajectoryRecorder.start (file, settings, error))
+        {
+            recordingStartSeconds = simulationTimeSeconds;
+            return;
+        }
+    }
+    else
+    {
+        error = "Recording needs OpenGL 4.4 or GL_ARB_buffer_storage (asynchronous readback)";
+    }
+
+    juce::MessageManager::callAsync ([panel = juce::Component::SafePointer<BoidsControlPanel> (controlPanel.get()), error]
+    {
+        if (panel != nullptr)
+            panel->setRecording (false);
+
+        showError ("Recording not started", error);
+    });
+}
+
+// Blocks this one frame until the writer has drained its queue (a few frames at most) and written the index.
+void MainComponent::stopRecordingOnGLThread()
+{
+    if (! trajectoryRecorder.isRecording())
+        return;
+
+    if (! trajectoryRecorder.stop())
+    {
+        juce::MessageManager::callAsync ([error = trajectoryRecorder.getError()]
+        {
+            showError ("Recording incomplete", error);
+        });
+        return;
+    }
+
+    DBG ("Trajectory: " + juce::String (trajectoryRecorder.getFramesWritten()) + " frames, "
+         + juce::String (trajectoryRecorder.getBytesWritten()) + " bytes, "
+         + juce::String (trajectoryRecorder.getDroppedFrames()) + " dropped");
+}
+
+// Playback (see TrajectoryPlayer). The file is mapped and its index checked here, on the message thread;
+// the GL thread then only decodes frames.
+void MainComponent::openRecordingAsync()
+{
+    playbackChooser = std::make_unique<juce::FileChooser> ("Play particle trajectories", getSnapshotDirectory(), "*.jftraj");
+
+    const auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+
+    playbackChooser->launchAsync (flags, [this] (const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+
+        auto player = std::make_shared<TrajectoryPlayer>();
+        juce::String error;
+
+        if (! player->open (file, error))
+        {
+            showError ("Recording not played", error);
+            return;
+        }
+
+        if (player->getMaxParticleCount() > kMaxParticles)
+        {
+            showError ("Recording not played",
+                       file.getFileName() + " has up to " + juce::String (player->getMaxParticleCount())
+                         + " particles per frame; this build runs up to " + juce::String (kMaxParticles));
+            return;
+        }
+
+        controlPanel->setPlaybackLength (player->getNumFrames());
+
+        openGLContext.executeOnGLThread ([this, player] (juce::OpenGLContext&)
+        {
+            startPlaybackOnGLThread (player);
+        }, false);
+    });
+}
+
+void MainComponent::startPlaybackOnGLThread (std::shared_ptr<TrajectoryPlayer> player)
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
+
+    trajectoryPlayer = std::move (player);
+    playbackFrame = -1;
+    playheadSeconds = trajectoryPlayer->getFrameTime (0);
+    playbackSeekFrame.store (0);
+}
+
+// The simulation carries on from whatever frame was showing.
+void MainComponent::stopPlaybackOnGLThread()
+{
+    trajectoryPlayer = nullptr;
+    playbackFrame = -1;
+    playbackFrameForUi.store (-1);
+}
+
+// Follows the recorded timestamps at playbackSpeed (frames are skipped or held as needed) and loops at the end.
+// A frame is only decoded and uploaded when it changes: straight from the file mapping into the upload ring.
+void MainComponent::advancePlaybackOnGLThread (float dtSeconds)
+{
+    auto& player = *trajectoryPlayer;
+    const auto numFrames = player.getNumFrames();
+    const auto seek = playbackSeekFrame.exchange (-1);
+    auto frame = juce::jmax (0, playbackFrame);
+    bool jumped = seek >= 0;
+
+    if (jumped)
+    {
+        frame = juce::jlimit (0, numFrames - 1, seek);
+        playheadSeconds = player.getFrameTime (frame);
+    }
+    else if (! playbackPaused.load())
+    {
+        playheadSeconds += (double) (dtSeconds * playbackSpeed.load());
+
+        if (playheadSeconds > player.getDuration())
+        {
+            frame = 0;
+            playheadSeconds = player.getFrameTime (0);
+            jumped = true;
+        }
+
+        while (frame + 1 < numFrames && player.getFrameTime (frame + 1) <= playheadSeconds)
+            ++frame;
+    }
+
+    const auto count = player.getParticleCount (frame);
+
+    if (frame == playbackFrame && count == currentParticleCount)
+        return;
+
+    if (count != currentParticleCount)
+        resizeParticleBuffersOnGLThread (count);
+
+    if (particlesSSBO[0] == 0)
+        return;
+
+    bool decoded = false;
+    uploadToBufferOnGLThread (particlesSSBO[0], 0, (size_t) count * sizeof (ParticleCPU), [&] (void* dest)
+    {
+        decoded = player.decodeFrame (frame, worldOrigin, dest);
+    });
+
+    if (! decoded)
+    {
+        juce::MessageManager::callAsync ([panel = juce::Component::SafePointer<BoidsControlPanel> (controlPanel.get()),
+                                          name = player.getFile().getFileName(), frame]
+        {
+            if (panel != nullptr)
+                panel->setPlaybackLength (0);
+
+            showError ("Playback stopped", name + ": frame " + juce::String (frame) + " is corrupt");
+        });
+
+        stopPlaybackOnGLThread();
+        return;
+    }
+
+    // Compact recordings carry no colour: the colour pass of the step fills it in from the current colour settings.
+    if (! TrajectoryFile::storesColour (player.getEncoding()))
+        dispatchComputePasses (0.0f, nullptr, true);
+
+    // Seeks and the loop back to the start have no history for the trails to draw.
+    if (jumped)
+        trailsNeedReset = true;
+
+    playbackFrame = frame;
+    playbackFrameForUi.store (frame);
+    player.prefetchFrom (frame + 1);
+}
+
+//==============================================================================
+// Frame export (see FrameExporter). The directory is picked here; the exporter and its render target are created
+// and released on the GL thread, between frames.
+void MainComponent::startExportAsync (FrameExporter::Format format, juce::Point<int> size)
+{
+    exportChooser = std::make_unique<juce::FileChooser> ("Export frames to", getSnapshotDirectory());
+
+    const auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectDirectories;
+
+    exportChooser->launchAsync (flags, [this, format, size] (const juce::FileChooser& chooser)
+    {
+        const auto directory = chooser.getResult();
+        if (directory == juce::File())
+        {
+            controlPanel->setExporting (false);
+            return;
+        }
+
+        FrameExporter::Settings settings;
+        settings.directory = directory;
+        settings.format = format;
+        settings.width = size.x;
+        settings.height = size.y;
+
+        openGLContext.executeOnGLThread ([this, settings] (juce::OpenGLContext&) { startExportOnGLThread (settings); }, false);
+    });
+}
+
+void MainComponent::exportOnLaunch (const FrameExporter::Settings& settings)
+{
+    quitWhenExportFinished = true;
+    launchExportSettings = settings;
+    launchExportRequested.store (true); // picked up by the next render()
+}
+
+void MainComponent::runDeterministicOnLaunch (int newSeed)
+{
+    auto p = controlPanel->getParams();
+    p.deterministic = true;
+    p.seed = juce::jlimit (0, kMaxSeed, newSeed);
+    controlPanel->setParams (p);
+
+    launchParams = p;
+    launchParamsRequested.store (true); // picked up by the next render(), before a launch export starts
+}
+
+bool MainComponent::runTimelineOnLaunch (const juce::File& file)
+{
+    juce::String error;
+    auto newTimeline = readTimeline (file, error);
+
+    if (newTimeline == nullptr)
+    {
+        juce::Logger::writeToLog ("Timeline not started: " + error);
+        return false;
+    }
+
+    launchTimeline = std::move (newTimeline);
+    launchTimelineRequested.store (true); // picked up by the next render(), with the launch settings and export
+    return true;
+}
+
+// A size of 0 means the window's. Sizes are made even, which yuv420p video (what most encoders want) needs.
+// Vsync is off while exporting so frames render as fast as the GPU and the encoder allow.
+void MainComponent::startExportOnGLThread (FrameExporter::Settings settings)
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
+
+    stopExportOnGLThread();
+
+    if (settings.width <= 0 || settings.height <= 0)
+    {
+        const auto desktopScale = (float) openGLContext.getRenderingScale();
+        settings.width = juce::roundToInt (desktopScale * (float) getWidth());
+        settings.height = juce::roundToInt (desktopScale * (float) getHeight());
+    }
+
+    settings.width = juce::jmax (2, settings.width & ~1);
+    settings.height = juce::jmax (2, settings.height & ~1);
+
+    GLint maxSize = 0;
+    glGetIntegerv (GL_MAX_TEXTURE_SIZE, &maxSize);
+
+    juce::String error;
+
+    if (settings.width > maxSize || settings.height > maxSize)
+        error = juce::String (settings.width) + "x" + juce::String (settings.height) + " is larger than this GPU's "
+              + juce::String (maxSize) + " pixel limit";
+    else if (! exportTarget.create (settings.width, settings.height, { GL_RGBA8 }, true))
+        error = "Can't allocate a " + juce::String (settings.width) + "x" + juce::String (settings.height) + " render target";
+    else if (frameExporter.start (settings, error))
+    {
+        openGLContext.setSwapInterval (0);
+        previousViewProjValid = false; // the last frame's matrix was for the window's aspect ratio
+
+        // Command-line exports don't come from the panel.
+        juce::MessageManager::callAsync ([panel = juce::Component::SafePointer<BoidsControlPanel> (controlPanel.get())]
+        {
+            if (panel != nullptr)
+                panel->setExporting (true);
+        });
+        return;
+    }
+
+    exportTarget.release();
+
+    juce::MessageManager::callAsync ([panel = juce::Component::SafePointer<BoidsControlPanel> (controlPanel.get()), error,
+                                      quit = quitWhenExportFinished]
+    {
+        if (panel != nullptr)
+            panel->setExporting (false);
+
+        if (quit)
+        {
+            juce::Logger::writeToLog ("Export not started: " + error);
+            juce::JUCEApplication::quit();
+            return;
+        }
+
+        showError ("Export not started", error);
+    });
+}
+
+// Blocks this one frame until the frames in flight are read back and the encoder has written them.
+void MainComponent::stopExportOnGLThread()
+{
+    if (! frameExporter.isExporting())
+        return;
+
+    const bool ok = frameExporter.stop();
+    exportTarget.release();
+    openGLContext.setSwapInterval (1);
+    previousViewProjValid = false;
+
+    DBG ("Export: " + juce::String (frameExporter.getFramesWritten()) + " frames, "
+         + juce::String (frameExporter.getDroppedFrames()) + " dropped");
+
+    juce::MessageManager::callAsync ([panel = juce::Component::SafePointer<BoidsControlPanel> (controlPanel.get()), ok,
+                                      error = frameExporter.getError(), quit = quitWhenExportFinished]
+    {
+        if (panel != nullptr)
+            panel->setExporting (false);
+
+        if (quit)
+        {
+            juce::Logger::writeToLog (ok ? juce::String ("Export finished") : "Export incomplete: " + error);
+            juce::JUCEApplication::quit();
+            return;
+        }
+
+        if (! ok)
+            showError ("Export incomplete", error);
+    });
+}
+
+// Queues the finished frame's readback, then shows it in the window letterboxed to the export's aspect ratio.
+void MainComponent::presentExportFrameOnGLThread (unsigned int windowFrameBuffer, int windowWidth, int windowHeight)
+{
+    frameExporter.captureFrame (exportTarget.getFrameBufferID());
+
+    const int exportWidth = exportTarget.getWidth();
+    const int exportHeight = exportTarget.getHeight();
+    const float scale = juce::jmin ((float) windowWidth / (float) exportWidth, (float) windowHeight / (float) exportHeight);
+    const int w = juce::roundToInt ((float) exportWidth * scale);
+    const int h = juce::roundToInt ((float) exportHeight * scale);
+    const int x = (windowWidth - w) / 2;
+    const int y = (windowHeight - h) / 2;
+
+    glBindFramebuffer (GL_FRAMEBUFFER, windowFrameBuffer);
+    glViewport (0, 0, windowWidth, windowHeight);
+    juce::OpenGLHelpers::clear (juce::Colours::black);
+
+    glBindFramebuffer (GL_READ_FRAMEBUFFER, exportTarget.getFrameBufferID());
+    glBlitFramebuffer (0, 0, exportWidth, exportHeight, x, y, x + w, y + h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer (GL_FRAMEBUFFER, windowFrameBuffer);
+
+    if (frameExporter.hasCapturedAllFrames())
+        stopExportOnGLThread();
+}
+
+//==============================================================================
+// Limits every setting to the range the simulation and renderer support. Pure, so it serves the constructor (before
+// there is a GL context) as well as applyParamsOnGLThread().
+MainComponent::BoidsControlPanel::Params MainComponent::clampParams (BoidsControlPanel::Params p)
+{
+    p.particleCount = juce::jlimit (1, kMaxParticles, p.particleCount);
+    p.neighborRadius = juce::jlimit (0.05f, 50.0f, p.neighborRadius);
+    p.separationRadius = juce::jlimit (0.01f, p.neighborRadius, p.separationRadius);
+    p.weightSeparation = juce::jlimit (0.0f, 50.0f, p.weightSeparation);
+    p.weightAlignment  = juce::jlimit (0.0f, 50.0f, p.weightAlignment);
+    p.weightCohesion   = juce::jlimit (0.0f, 50.0f, p.weightCohesion);
+    p.minSpeed = juce::jlimit (0.0f, 1000.0f, p.minSpeed);
+    p.maxSpeed = juce::jlimit (juce::jmax (p.minSpeed + 1.0e-3f, 0.01f), 1000.0f, p.maxSpeed);
+    p.maxAccel = juce::jlimit (0.0f, 10000.0f, p.maxAccel);
+    p.simSpeed = juce::jlimit (0.1f, 2.0f, p.simSpeed);
+    p.centerAttraction = juce::jlimit (0.0f, 1000.0f, p.centerAttraction);
+    p.boundaryMargin = juce::jlimit (0.01f, 1000.0f, p.boundaryMargin);
+    p.boundaryStrength = juce::jlimit (0.0f, 10000.0f, p.boundaryStrength);
+    p.pointSize = juce::jlimit (1.0f, 64.0f, p.pointSize);
+    p.alphaMul = juce::jlimit (0.0f, 1.0f, p.alphaMul);
+    p.particleShape = juce::jlimit (0, 4, p.particleShape);
+    p.particleRenderer = juce::jlimit (0, 3, p.particleRenderer);
+    p.transparencyMode = juce::jlimit (0, 3, p.transparencyMode);
+    p.bloomStrength = juce::jlimit (0.0f, 2.0f, p.bloomStrength);
+    p.exposure = juce::jlimit (0.1f, 4.0f, p.exposure);
+    p.trailLength = juce::jlimit (0, kMaxTrailLength, p.trailLength);
+    p.trailStride = juce::jlimit (1, kMaxTrailStride, p.trailStride);
+    p.motionBlur = juce::jlimit (0.0f, 1.0f, p.motionBlur);
+    p.drawBudgetMs = juce::jlimit (0.0f, kMaxDrawBudgetMs, p.drawBudgetMs);
+    p.seed = juce::jlimit (0, kMaxSeed, p.seed);
+
+    p.colorMode = juce::jlimit (0, 3, p.colorMode);
+    p.hueOffset = juce::jlimit (0.0f, 1.0f, p.hueOffset);
+    p.hueRange = juce::jlimit (0.0f, 1.0f, p.hueRange);
+    p.saturation = juce::jlimit (0.0f, 1.0f, p.saturation);
+    p.value = juce::jlimit (0.0f, 1.0f, p.value);
+    p.densityCurve = juce::jlimit (0.1f, 8.0f, p.densityCurve);
+    p.audioReactivity = juce::jlimit (0.0f, 1.0f, p.audioReactivity);
+    return p;
+}
+
+// Copies already clamped settings into the members the passes read. Touches no GL state; the particle count is
+// left to the caller, which has to resize the buffers to match.
+void MainComponent::setSimulationParams (const BoidsControlPanel::Params& clamped)
+{
+    neighborRadius = clamped.neighborRadius;
+    separationRadius = clamped.separationRadius;
+    weightSeparation = clamped.weightSeparation;
+    weightAlignment  = clamped.weightAlignment;
+    weightCohesion   = clamped.weightCohesion;
+    minSpeed = clamped.minSpeed;
+    maxSpeed = clamped.maxSpeed;
+    maxAccel = clamped.maxAccel;
+    simSpeed = clamped.simSpeed;
+    centerAttraction = clamped.centerAttraction;
+    boundaryMargin = clamped.boundaryMargin;
+    boundaryStrength = clamped.boundaryStrength;
+    wrapBounds = clamped.wrapBounds;
+    frustumCull = clamped.frustumCull;
+    streamParticles = clamped.streamParticles;
+    pointSize = clamped.pointSize;
+    alphaMul = clamped.alphaMul;
+    particleShape = clamped.particleShape;
+    particleRenderer = clamped.particleRenderer;
+    transparencyMode = clamped.transparencyMode;
+    hdrBloom = clamped.hdrBloom;
+    bloomStrength = clamped.bloomStrength;
+    exposure = clamped.exposure;
+    trailLength = clamped.trailLength;
+    trailStride = clamped.trailStride;
+    motionBlurShutter = clamped.motionBlur;
+    drawBudgetMs = clamped.drawBudgetMs;
+    deterministic = clamped.deterministic;
+    seed = clamped.seed;
+
+    colorMode = clamped.colorMode;
+    hueOffset = clamped.hueOffset;
+    hueRange = clamped.hueRange;
+    saturation = clamped.saturation;
+    value = clamped.value;
+    densityCurve = clamped.densityCurve;
+    audioReactivity = clamped.audioReactivity;
+}
+
+// Takes new settings from the panel (or a snapshot or preset): clamps them into the simulation state on the GL thread
+// (render also runs on the GL thread), and resizes the particle buffers / rebuilds the grid when needed.
+// restartFlock reseeds the flock afterwards, which deterministic mode also does by itself on a new seed.
+void MainComponent::applyParamsOnGLThread (const BoidsControlPanel::Params& p, bool restartFlock)
+{
+    const auto clamped = clampParams (p);
+    const int newCount = clamped.particleCount;
+    restartFlock = restartFlock || (clamped.deterministic && (! deterministic || clamped.seed != seed));
+
+    const bool neighborRadiusChanged = std::abs (clamped.neighborRadius - neighborRadius) > 1.0e-4f;
+
+    setSimulationParams (clamped);
+
+    // Neither path resets the flock: count changes keep existing particles, radius changes only touch the grid.
+    if (particlesSSBO[0] == 0)
+        rebuildBuffersOnGLThread (newCount);
+    else
+    {
+        // During playback the recording decides the count.
+        if (newCount != currentParticleCount && trajectoryPlayer == nullptr)
+            resizeParticleBuffersOnGLThread (newCount);
+
+        if (neighborRadiusChanged)
+            rebuildGridOnGLThread();
+    }
+
+    if (restartFlock)
+        restartFlockOnGLThread();
+
+    appliedParams = clamped;
+}
+
+// Recomputes cellSize/gridDims/cellCount from neighborRadius and (re)allocates CellHeads only if it no longer fits.
+// Particle buffers are untouched, so tuning the radius never resets the flock.
+void MainComponent::rebuildGridOnGLThread()
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
+
+    // Grid derives from world size and cell size.
+    //
+    // Performance note:
+    // If cellSize becomes very small (e.g. tiny neighborRadius), cellCount can explode and the per-frame clear/build
+    // passes become the dominant cost. Clamp total cells to a reasonable upper bound by increasing cellSize as needed.
+    cellSize = juce::jmax (0.5f, neighborRadius);
+    const auto worldSize = worldMax - worldMin;
+
+    auto computeGridFromCellSize = [this, worldSize]
+    {
+        gridDims =
+        {
+            juce::jmax (1, (int) std::ceil (worldSize.x / cellSize)),
+            juce::jmax (1, (int) std::ceil (worldSize.y / cellSize)),
+            juce::jmax (1, (int) std::ceil (worldSize.z / cellSize))
+        };
+
+        cellCount = gridDims.x * gridDims.y * gridDims.z;
+    };
+
+    computeGridFromCellSize();
+
+    if (maxCellCount > 0 && cellCount > maxCellCount)
+    {
+        // Increase cellSize until we're under budget. Usually 1 iteration, but ceil() can overshoot slightly.
+        for (int iter = 0; iter < 4 && cellCount > maxCellCount; ++iter)
+        {
+            const float scale = std::cbrt ((float) cellCount / (float) maxCellCount);
+            cellSize *= (scale * 1.001f);
+            computeGridFromCellSize();
+        }
+    }
+
+    // Reuse the existing allocation while it fits; shrink only when it is grossly oversized.
+    // The clear pass resets head[0..cellCount) every frame, so the contents never need initialising here.
+    if (cellHeadsSSBO == 0 || cellCount > cellHeadsCapacity || cellCount < cellHeadsCapacity / 4)
+    {
+        const int newCapacity = juce::jmax (cellCount, juce::jmin (maxCellCount, cellCount + cellCount / 2));
+
+        if (cellHeadsSSBO == 0)
+            glGenBuffers (1, &cellHeadsSSBO);
+
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, cellHeadsSSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) ((size_t) newCapacity * sizeof (GLint)), nullptr, GL_DYNAMIC_DRAW);
+
+        // The cell sort's counts/start offsets follow the same capacity, plus one entry for the total.
+        if (cellStartSSBO == 0)
+            glGenBuffers (1, &cellStartSSBO);
+
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, cellStartSSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) ((size_t) (newCapacity + 1) * sizeof (GLint)), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+        cellHeadsCapacity = newCapacity;
+    }
+
+    buffersReady.store (particlesSSBO[0] != 0 && cellHeadsSSBO != 0);
+}
+
+// Perspective projection (60 degree vertical FOV) for the current component aspect ratio, or the export size's.
+juce::Matrix3D<float> MainComponent::getProjectionMatrix() const
+{
+    float w = (float) juce::jmax (1, getWidth());
+    float h = (float) juce::jmax (1, getHeight());
+
+    if (frameExporter.isExporting())
+    {
+        w = (float) frameExporter.getSettings().width;
+        h = (float) frameExporter.getSettings().height;
+    }
+
+    const float aspect = w / h;
+
+    const float nearZ = kNearPlane;
+    const float farZ  = kFarPlane;
+    const float fovY  = juce::MathConstants<float>::pi / 3.0f; // 60 degrees
+    const float top   = nearZ * std::tan (fovY * 0.5f);
+    const float right = top * aspect;
+
+    return juce::Matrix3D<float>::fromFrustum (-right, right, -top, top, nearZ, farZ);
+}
+
+// Builds the combined view-projection matrix from orbit/pan/cameraDistance, used by culling and the render shaders.
+juce::Matrix3D<float> MainComponent::getViewProjectionMatrix() const
+{
+    const auto proj = toDoubleMatrix (getProjectionMatrix());
+
+    // Treat orbit as rotating the world (simpler than building the true inverse camera rotation)
+    const auto rot = toDoubleMatrix (orbit.getRotationMatrix());
+    const auto trans = juce::Matrix3D<double>::fromTranslation ({ (double) pan.x, (double) pan.y, (double) -cameraDistance });
+
+    // Particles are origin-relative, so the model matrix moves them back by worldOrigin. Composing in double lets the
+    // large origin and pan translations cancel exactly before the result is rounded to float.
+    const auto model = juce::Matrix3D<double>::fromTranslation (worldOrigin);
+    const auto view = trans * rot * model;
+
+    return toFloatMatrix (proj * view);
+}
+
+// Quad half-size in world units. The point-size slider drives both paths; 1 maps to a few pixels at the default zoom.
+float MainComponent::getQuadWorldSize() const
+{
+    return pointSize * 0.05f;
+}
+
+// Mesh half-length in world units (nose to tail is twice this); meshes read a little larger than a quad of the same setting.
+float MainComponent::getMeshWorldSize() const
+{
+    return pointSize * 0.1f;
+}
+
+// Absolute world point the camera orbits around: the view maps it to (0, 0, -cameraDistance), i.e. R^T * -pan.
+juce::Vector3D<double> MainComponent::getCameraFocus() const
+{
+    const auto rot = orbit.getRotationMatrix(); // column-major: R[row][col] = mat[col * 4 + row]
+    const double px = -pan.x, py = -pan.y;
+
+    return { rot.mat[0] * px + rot.mat[1] * py,
+             rot.mat[4] * px + rot.mat[5] * py,
+             rot.mat[8] * px + rot.mat[9] * py };
+}
+
+// Converts an absolute world point to the origin-relative space the particle buffers live in (subtracted in double).
+juce::Vector3D<float> MainComponent::toOriginRelative (juce::Vector3D<float> worldPoint) const
+{
+    return { (float) ((double) worldPoint.x - worldOrigin.x),
+             (float) ((double) worldPoint.y - worldOrigin.y),
+             (float) ((double) worldPoint.z - worldOrigin.z) };
+}
+
+// Dynamic resolution: steers renderScale so the GPU draw section (gpuTimerDraw, dominated by particle overdraw)
+// stays within drawBudgetMs. Draw cost is taken as proportional to the scene's pixel count, i.e. to renderScale².
+void MainComponent::updateRenderScaleOnGLThread()
+{
+    // Exported frames always render at full size: they're not shown in real time.
+    if (drawBudgetMs <= 0.0f || ! gpuTimer.isCreated() || frameExporter.isExporting())
+    {
+        renderScale = 1.0f;
+        renderScaleFramesSinceChange = 0;
+        return;
+    }
+
+    if (++renderScaleFramesSinceChange < kRenderScaleSettleFrames)
+        return;
+
+    const double drawMs = gpuTimer.getMilliseconds (gpuTimerDraw);
+
+    // Dead band (5% over to 20% under the budget) so the scale doesn't hunt, reallocating targets every change.
+    if (drawMs <= 0.0 || (drawMs <= drawBudgetMs * 1.05 && drawMs >= drawBudgetMs * 0.8))
+        return;
+
+    const float ideal = renderScale * (float) std::sqrt (drawBudgetMs / drawMs);
+
+    // Drop straight to the estimate, but climb back one step at a time: overshooting up costs a slow frame.
+    auto next = juce::jmin (ideal, renderScale + kRenderScaleStep);
+    next = juce::jlimit (kMinRenderScale, 1.0f, std::round (next / kRenderScaleStep) * kRenderScaleStep);
+
+    if (next != renderScale)
+    {
+        renderScale = next;
+        renderScaleFramesSinceChange = 0;
+    }
+}
+
+// Re-centres the floating origin on the camera focus once it is more than originRebaseDistance away.
+// The shift is snapped to whole units (exact in float for any realistic world size) and applied to the latest
+// particle buffer in one pass; the other ping-pong buffer is rewritten by the next step anyway.
+void MainComponent::updateFloatingOriginOnGLThread()
+{
+    if (! buffersReady.load() || computeRebaseProgram == 0)
+        return;
+
+    // Rebasing rounds every position, so in deterministic mode moving the camera would change the run.
+    if (deterministic)
+        return;
+
+    const auto focus = getCameraFocus();
+    const auto offset = focus - worldOrigin;
+
+    if (offset.length() <= originRebaseDistance)
+        return;
+
+    const juce::Vector3D<double> shift { std::round (offset.x), std::round (offset.y), std::round (offset.z) };
+
+    glUseProgram (computeRebaseProgram);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, particlesSSBO[0]);
+    setUniform1iIfPresent (computeRebaseProgram, "u_particleCount", currentParticleCount);
+    setUniform3fIfPresent (computeRebaseProgram, "u_originShift", { (float) shift.x, (float) shift.y, (float) shift.z });
+
+    glDispatchCompute ((GLuint) ((currentParticleCount + workgroupConfig.build - 1) / workgroupConfig.build), 1, 1);
+    glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Trail history isn't rebased; restarting the trails is cheaper and only visible for a moment.
+    trailsNeedReset = true;
+    previousViewProjValid = false; // last frame's matrix is in the old origin's coordinates
+    worldOrigin += shift;
+}
+
+// GPU frustum culling: tests every particle against viewProj and compacts the survivors into visibleIndicesSSBO,
+// writing their count straight into the indirect draw command. Nothing is read back; render() draws with
+// glDrawArraysIndirect. Returns false if culling can't run (the caller then draws all particles).
+bool MainComponent::cullParticlesOnGLThread (const juce::Matrix3D<float>& viewProj, int viewportWidth, int viewportHeight,
+                                             bool lodBins)
+{
+    const auto program = lodBins ? computeLodCullProgram : computeCullProgram;
+
+    if (! buffersReady.load() || program == 0 || visibleIndicesSSBO == 0 || drawIndirectBuffer == 0)
+        return false;
+
+    // SSBO bindings (must match shaders)
+    constexpr GLuint kVisibleIndicesBinding = 4;
+    constexpr GLuint kDrawCommandBinding    = 5;
+
+    // { count, instanceCount, first, baseInstance }: points draw one instance and count vertices,
+    // quads and meshes draw a fixed vertex count per visible instance.
+    // LOD bins: 0 = bird mesh, 1 = tetrahedron, 2 = points. The point bin's `first` skips to its slice of the
+    // visible list, so particles.vert can keep indexing visible[gl_VertexID].
+    const bool quads = ! lodBins && particleRenderer != 0;
+    const auto binStride = (GLuint) particleCapacity;
+
+    const GLuint pointsCommand[4] { 0, 1, 0, 0 };
+    const GLuint quadsCommand[4]  { 4, 0, 0, 0 };
+    const GLuint lodCommands[kNumLodBins * 4] { kBirdVertexCount,  0, 0, 0,
+                                                kTetraVertexCount, 0, 0, 0,
+                                                0, 1, 2 * binStride, 0 };
+
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, drawIndirectBuffer);
+    if (lodBins)
+        glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr) sizeof (lodCommands), lodCommands);
+    else
+        glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr) (4 * sizeof (GLuint)), quads ? quadsCommand : pointsCommand);
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram (program);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, particlesSSBO[0]);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kVisibleIndicesBinding, visibleIndicesSSBO);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kDrawCommandBinding, drawIndirectBuffer);
+
+    setUniform1iIfPresent (program, "u_particleCount", currentParticleCount);
+    setUniformMatrix4IfPresent (program, "u_viewProj", viewProj);
+    setUniform1iIfPresent (program, "u_counterField", quads ? 1 : 0);
+
+    // Widen the side planes by half a sprite: points are pointSize window pixels wide, quads and meshes have a
+    // world-space radius (plus the 1 px minimum quad size) so big close-up boids straddling the edge aren't popped.
+    const float marginPx = (quads || lodBins) ? 1.0f : 0.5f * pointSize * renderScale * outputPixelScale;
+    setUniform2fIfPresent (program, "u_cullMarginNdc",
+                           2.0f * marginPx / (float) juce::jmax (1, viewportWidth),
+                           2.0f * marginPx / (float) juce::jmax (1, viewportHeight));
+
+    const auto proj = getProjectionMatrix();
+    const float radius = lodBins ? getMeshWorldSize() * juce::MathConstants<float>::sqrt2
+                                 : (quads ? getQuadWorldSize() * juce::MathConstants<float>::sqrt2 : 0.0f);
+    setUniform2fIfPresent (program, "u_cullRadiusClip", radius * proj.mat[0], radius * proj.mat[5]);
+
+    if (lodBins)
+    {
+        // Bin by projected half-length in pixels: full bird from 8 px, tetrahedron from 2 px, point below that.
+        setUniform1fIfPresent (program, "u_lodPixelScale", getMeshWorldSize() * proj.mat[5] * 0.5f * (float) viewportHeight);
+        setUniform2fIfPresent (program, "u_lodPixelThresholds", 8.0f, 2.0f);
+        setUniform1iIfPresent (program, "u_binStride", (int) binStride);
+
+        const auto loc = glGetUniformLocation (program, "u_binCounterField");
+        if (loc >= 0)
+            glUniform3i (loc, 1, 1, 0);
+    }
+
+    glDispatchCompute ((GLuint) ((currentParticleCount + workgroupConfig.build - 1) / workgroupConfig.build), 1, 1);
+
+    // Visible indices are read by the vertex shader, the count by the indirect draw.
+    glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    return true;
+}
+
+// Sorts the visible list written by cullParticlesOnGLThread() back to front by view depth (GPU radix sort, see
+// particles_sort.comp). Sorts the points bin for LOD meshes. The count never leaves the GPU.
+bool MainComponent::sortVisibleOnGLThread (const juce::Matrix3D<float>& viewProj, bool lodBins)
+{
+    for (auto program : computeSortPrograms)
+        if (program == 0)
+            return false;
+
+    if (! buffersReady.load() || sortKeysSSBO[0] == 0 || sortHistogramSSBO == 0)
+        return false;
+
+    // SSBO bindings (must match particles_sort.comp)
+    constexpr GLuint kDrawCommandBinding    = 5;
+    constexpr GLuint kKeysOutBinding        = 7;
+    constexpr GLuint kValuesInBinding       = 8;
+    constexpr GLuint kHistogramBinding      = 10;
+
+    // Where the list and its count live: points count vertices (field 0), quads instances (field 1),
+    // and the LOD point bin is the third slice/command.
+    const bool quads = ! lodBins && particleRenderer != 0;
+    const int listOffset = lodBins ? 2 * particleCapacity : 0;
+    const int countIndex = lodBins ? 2 * 4 : (quads ? 1 : 0);
+
+    const int numTiles = (currentParticleCount + kSortWorkgroupSize - 1) / kSortWorkgroupSize;
+
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, particlesSSBO[0]);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kDrawCommandBinding, drawIndirectBuffer);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kHistogramBinding, sortHistogramSSBO);
+
+    // Keys, aligned with the visible list.
+    const auto keysProgram = computeSortPrograms[sortKernelKeys];
+    glUseProgram (keysProgram);
+    setUniform1iIfPresent (keysProgram, "u_countIndex", countIndex);
+    setUniform1iIfPresent (keysProgram, "u_valuesInOffset", listOffset);
+    setUniformMatrix4IfPresent (keysProgram, "u_viewProj", viewProj);
+    setUniform2fIfPresent (keysProgram, "u_depthRange", kNearPlane, kFarPlane);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kValuesInBinding, visibleIndicesSSBO);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kKeysOutBinding, sortKeysSSBO[0]);
+    glDispatchCompute ((GLuint) numTiles, 1, 1);
+    glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+
+    dispatchSortPassesOnGLThread (sortKeysSSBO, visibleIndicesSSBO, listOffset, sortValuesSSBO, countIndex, numTiles);
+    return true;
+}
+
+// The histogram/scan/scatter passes of the depth sort, shared by sortVisibleOnGLThread() and the sort benchmark.
+// Sorts keys[0] with values[valuesOffset...] (ping-ponging through keys[1] and scratchValues, from offset 0), using the
+// count in cmd[countIndex]. The caller binds the draw command (5) and histogram (10) buffers.
+void MainComponent::dispatchSortPassesOnGLThread (const unsigned int keys[2], unsigned int values, int valuesOffset,
+                                                  unsigned int scratchValues, int countIndex, int numTiles)
+{
+    // SSBO bindings (must match particles_sort.comp)
+    constexpr GLuint kKeysInBinding         = 6;
+    constexpr GLuint kKeysOutBinding        = 7;
+    constexpr GLuint kValuesInBinding       = 8;
+    constexpr GLuint kValuesOutBinding      = 9;
+
+    // Even passes go values -> scratch, odd passes back; an even number of passes ends in the original buffers.
+    static_assert (kSortPasses % 2 == 0, "the sorted result must end up back in keys[0] and values");
+
+    for (int pass = 0; pass < kSortPasses; ++pass)
+    {
+        const bool even = (pass % 2) == 0;
+
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kKeysInBinding,    keys[even ? 0 : 1]);
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kKeysOutBinding,   keys[even ? 1 : 0]);
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kValuesInBinding,  even ? values : scratchValues);
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kValuesOutBinding, even ? scratchValues : values);
+
+        for (auto kernel : { sortKernelHistogram, sortKernelScan, sortKernelScatter })
+        {
+            const auto program = computeSortPrograms[kernel];
+            glUseProgram (program);
+            setUniform1iIfPresent (program, "u_countIndex", countIndex);
+            setUniform1iIfPresent (program, "u_numTiles", numTiles);
+            setUniform1iIfPresent (program, "u_valuesInOffset", even ? valuesOffset : 0);
+            setUniform1iIfPresent (program, "u_valuesOutOffset", even ? 0 : valuesOffset);
+            setUniform1iIfPresent (program, "u_shift", pass * 4);
+            glDispatchCompute (kernel == sortKernelScan ? 1u : (GLuint) numTiles, 1, 1);
+            glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+    }
+}
+
+// Sort benchmark: the depth sort's passes over kSortBenchmarkKeys random 16-bit keys, independent of the scene, so
+// the sort's cost at full scale can be measured on any GPU. Timed per frame by GpuTimer (gpuTimerSortBenchmark) for
+// kSortBenchmarkFrames frames; the first sort is read back and checked for order and stability.
+void MainComponent::startSortBenchmarkOnGLThread()
+{
+    for (auto program : computeSortPrograms)
+        if (program == 0)
+            return;
+
+    releaseSortBenchmarkOnGLThread();
+
+    std::vector<GLuint> keys ((size_t) kSortBenchmarkKeys), values ((size_t) kSortBenchmarkKeys);
+    juce::Random random (0x5047);
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        keys[i] = (GLuint) random.nextInt (0x10000);
+        values[i] = (GLuint) i;
+    }
+
+    const auto bytes = (GLsizeiptr) (keys.size() * sizeof (GLuint));
+    const auto numTiles = (size_t) ((kSortBenchmarkKeys + kSortWorkgroupSize - 1) / kSortWorkgroupSize);
+    const GLuint command[4] { (GLuint) kSortBenchmarkKeys, 0, 0, 0 };
+
+    auto& bench = sortBenchmark;
+    glGenBuffers (3, bench.keysSSBO);
+    glGenBuffers (2, bench.valuesSSBO);
+    glGenBuffers (1, &bench.histogramSSBO);
+    glGenBuffers (1, &bench.commandBuffer);
+
+    auto allocate = [] (GLuint buffer, GLsizeiptr size, const void* data)
+    {
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_COPY);
+    };
+
+    allocate (bench.keysSSBO[0], bytes, nullptr);
+    allocate (bench.keysSSBO[1], bytes, nullptr);
+    allocate (bench.keysSSBO[2], bytes, keys.data());
+    allocate (bench.valuesSSBO[0], bytes, values.data());
+    allocate (bench.valuesSSBO[1], bytes, nullptr);
+    allocate (bench.histogramSSBO, (GLsizeiptr) (numTiles * kSortRadix * sizeof (GLuint)), nullptr);
+    allocate (bench.commandBuffer, (GLsizeiptr) sizeof (command), command);
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+    bench.originalKeys = std::move (keys);
+    bench.framesLeft = kSortBenchmarkFrames;
+    bench.result = "sort bench " + juce::String (kSortBenchmarkKeys) + " keys: running";
+}
+
+// One timed sort of the benchmark keys; called from render() while the benchmark runs.
+void MainComponent::runSortBenchmarkFrameOnGLThread()
+{
+    auto& bench = sortBenchmark;
+
+    for (auto program : computeSortPrograms)
+    {
+        if (program == 0)
+        {
+            bench.result = "sort bench: shaders not loaded";
+            releaseSortBenchmarkOnGLThread();
+            return;
+        }
+    }
+
+    const bool firstFrame = bench.framesLeft == kSortBenchmarkFrames;
+    const int numTiles = (kSortBenchmarkKeys + kSortWorkgroupSize - 1) / kSortWorkgroupSize;
+
+    // Every run sorts the same shuffled keys (sorted input would scatter more coherently and flatter the result).
+    // Values are only checked after the first run, so they're left as the previous run permuted them.
+    glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer (GL_COPY_READ_BUFFER, bench.keysSSBO[2]);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, bench.keysSSBO[0]);
+    glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr) (kSortBenchmarkKeys * sizeof (GLuint)));
+    glBindBuffer (GL_COPY_READ_BUFFER, 0);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 5, bench.commandBuffer);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 10, bench.histogramSSBO);
+
+    gpuTimer.beginSection (gpuTimerSortBenchmark);
+    dispatchSortPassesOnGLThread (bench.keysSSBO, bench.valuesSSBO[0], 0, bench.valuesSSBO[1], 0, numTiles);
+    gpuTimer.endSection (gpuTimerSortBenchmark);
+
+    if (firstFrame)
+    {
+        // Stalls this one frame; the timings come from the later ones.
+        glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+        std::vector<GLuint> keys ((size_t) kSortBenchmarkKeys), values ((size_t) kSortBenchmarkKeys);
+        const auto bytes = (GLsizeiptr) (keys.size() * sizeof (GLuint));
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, bench.keysSSBO[0]);
+        glGetBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, bytes, keys.data());
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, bench.valuesSSBO[0]);
+        glGetBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, bytes, values.data());
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+        // Ascending keys, equal keys in their original order, and every key still with its value.
+        int errors = 0;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (values[i] >= (GLuint) kSortBenchmarkKeys || bench.originalKeys[values[i]] != keys[i])
+                ++errors;
+            else if (i > 0 && (keys[i - 1] > keys[i] || (keys[i - 1] == keys[i] && values[i - 1] > values[i])))
+                ++errors;
+        }
+
+        bench.orderErrors = errors;
+        bench.originalKeys = {};
+    }
+
+    if (--bench.framesLeft > 0)
+        return;
+
+    // GpuTimer's reading lags a few frames and is smoothed, so by now it covers the last few dozen runs.
+    bench.result = "sort bench " + juce::String (kSortBenchmarkKeys) + " keys: "
+                 + juce::String (gpuTimer.getMilliseconds (gpuTimerSortBenchmark), 2) + " ms, "
+                 + (bench.orderErrors == 0 ? juce::String ("sorted") : juce::String (bench.orderErrors) + " order errors");
+    DBG (bench.result);
+
+    releaseSortBenchmarkOnGLThread();
+}
+
+void MainComponent::releaseSortBenchmarkOnGLThread()
+{
+    auto& bench = sortBenchmark;
+
+    if (bench.keysSSBO[0] != 0)      { glDeleteBuffers (3, bench.keysSSBO);          bench.keysSSBO[0] = bench.keysSSBO[1] = bench.keysSSBO[2] = 0; }
+    if (bench.valuesSSBO[0] != 0)    { glDeleteBuffers (2, bench.valuesSSBO);        bench.valuesSSBO[0] = bench.valuesSSBO[1] = 0; }
+    if (bench.histogramSSBO != 0)    { glDeleteBuffers (1, &bench.histogramSSBO);    bench.histogramSSBO = 0; }
+    if (bench.commandBuffer != 0)    { glDeleteBuffers (1, &bench.commandBuffer);    bench.commandBuffer = 0; }
+
+    bench.originalKeys = {};
+    bench.framesLeft = 0;
+}
+
+// Draws LOD bins 0 (bird) and 1 (tetrahedron) as opaque instanced meshes; bin 2 is drawn by the point path.
+void MainComponent::drawLodMeshesOnGLThread (const juce::Matrix3D<float>& viewProj, float timeSeconds)
+{
+    glUseProgram (meshRenderProgram);
+    glBindVertexArray (vao);
+
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, particlesSSBO[0]);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 4, visibleIndicesSSBO);
+
+    glEnable (GL_DEPTH_TEST);
+    glDepthFunc (GL_LEQUAL);
+    glDepthMask (GL_TRUE);
+    glDisable (GL_BLEND);
+
+    setUniformMatrix4IfPresent (meshRenderProgram, "u_viewProj", viewProj);
+    setUniform1fIfPresent (meshRenderProgram, "u_meshSize", getMeshWorldSize());
+    setUniform1fIfPresent (meshRenderProgram, "u_time", timeSeconds);
+    setVelocityUniforms (meshRenderProgram);
+
+    glBindBuffer (GL_DRAW_INDIRECT_BUFFER, drawIndirectBuffer);
+
+    for (int bin = 0; bin < 2; ++bin)
+    {
+        setUniform1iIfPresent (meshRenderProgram, "u_mesh", bin);
+        setUniform1iIfPresent (meshRenderProgram, "u_visibleOffset", bin * particleCapacity);
+        glDrawArraysIndirect (GL_TRIANGLES, reinterpret_cast<const void*> ((size_t) bin * 4 * sizeof (GLuint)));
+    }
+
+    glBindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+    glEnable (GL_BLEND);
+}
+
+// Runs the per-frame compute pipeline: clear grid, build grid (and sort particle indices by cell for the subgroup step),
+// step boids; then swaps particle ping-pong buffers.
+// If passTimerQueries is given (3 GL_TIME_ELAPSED query objects), each pass is wrapped in its own query; the cell sort
+// counts towards the build pass.
+// With recolourOnly, the step leaves positions and velocities as they are and only recomputes colours.
+void MainComponent::dispatchComputePasses (float dtSeconds, const unsigned int* passTimerQueries, bool recolourOnly)
+{
+    if (! buffersReady.load())
+        return;
+
+    auto beginPass = [passTimerQueries] (int index)
+    {
+        if (passTimerQueries != nullptr)
+            glBeginQuery (GL_TIME_ELAPSED, passTimerQueries[index]);
+    };
+
+    auto endPass = [passTimerQueries]
+    {
+        if (passTimerQueries != nullptr)
+            glEndQuery (GL_TIME_ELAPSED);
+    };
+
+    auto groupsFor = [] (int count, int localSize) { return (GLuint) ((count + localSize - 1) / localSize); };
 
     // SSBO bindings (must match shaders)
     constexpr GLuint kParticlesInBinding  = 0;
     constexpr GLuint kParticlesOutBinding = 1;
     constexpr GLuint kCellHeadsBinding    = 2;
     constexpr GLuint kNextIndexBinding    = 3;
+    constexpr GLuint kCellStartBinding    = 14;
+    constexpr GLuint kCellSlotBinding     = 15;
+    constexpr GLuint kSortedIndexBinding  = 16;
+
+    // The grid programs write these when compiled with JF_CELL_SORT, i.e. whenever the subgroup step is loaded.
+    const bool sortByCell = stepUsesSubgroups && ! deterministic;
+
+    if (stepUsesSubgroups)
+    {
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kCellStartBinding, cellStartSSBO);
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kCellSlotBinding, cellSlotSSBO);
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kSortedIndexBinding, sortedIndexSSBO);
+    }
 
     // Clear grid
     glUseProgram (computeClearProgram);
     glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kCellHeadsBinding, cellHeadsSSBO);
     setUniform1iIfPresent (computeClearProgram, "u_cellCount", cellCount);
 
-    const GLuint clearGroups = (GLuint) ((cellCount + 255) / 256);
-    glDispatchCompute (clearGroups, 1, 1);
+    beginPass (0);
+    glDispatchCompute (groupsFor (cellCount, workgroupConfig.clear), 1, 1);
+    endPass();
     glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
 
     // Build grid
@@ -764,55 +3285,209 @@ void MainComponent::dispatchComputePasses (float dtSeconds)
 
     setUniform1iIfPresent (computeBuildProgram, "u_particleCount", currentParticleCount);
     setUniform3iIfPresent (computeBuildProgram, "u_gridDims", gridDims);
-    setUniform3fIfPresent (computeBuildProgram, "u_worldMin", worldMin);
+    setUniform3fIfPresent (computeBuildProgram, "u_worldMin", toOriginRelative (worldMin));
     setUniform1fIfPresent (computeBuildProgram, "u_cellSize", cellSize);
 
-    const GLuint buildGroups = (GLuint) ((currentParticleCount + 255) / 256);
-    glDispatchCompute (buildGroups, 1, 1);
+    beginPass (1);
+    glDispatchCompute (groupsFor (currentParticleCount, workgroupConfig.build), 1, 1);
+
+    // Cell sort: counts -> start offsets, then each particle's index into its cell's group.
+    if (sortByCell)
+    {
+        glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram (computeCellScanProgram);
+        setUniform1iIfPresent (computeCellScanProgram, "u_cellCount", cellCount);
+        glDispatchCompute (1, 1, 1);
+        glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram (computeCellScatterProgram);
+        setUniform1iIfPresent (computeCellScatterProgram, "u_particleCount", currentParticleCount);
+        setUniform3iIfPresent (computeCellScatterProgram, "u_gridDims", gridDims);
+        setUniform3fIfPresent (computeCellScatterProgram, "u_worldMin", toOriginRelative (worldMin));
+        setUniform1fIfPresent (computeCellScatterProgram, "u_cellSize", cellSize);
+        glDispatchCompute (groupsFor (currentParticleCount, workgroupConfig.build), 1, 1);
+    }
+
+    endPass();
     glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
 
     // Boids step
-    glUseProgram (computeStepProgram);
+    const auto stepProgram = deterministic ? computeStepDeterministicProgram : computeStepProgram;
+    glUseProgram (stepProgram);
     glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kParticlesInBinding,  particlesSSBO[0]);
     glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kParticlesOutBinding, particlesSSBO[1]);
     glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kCellHeadsBinding,    cellHeadsSSBO);
     glBindBufferBase (GL_SHADER_STORAGE_BUFFER, kNextIndexBinding,    nextIndexSSBO);
 
-    setUniform1iIfPresent (computeStepProgram, "u_particleCount", currentParticleCount);
-    setUniform3iIfPresent (computeStepProgram, "u_gridDims", gridDims);
-    setUniform3fIfPresent (computeStepProgram, "u_worldMin", worldMin);
-    setUniform3fIfPresent (computeStepProgram, "u_worldMax", worldMax);
-    setUniform1fIfPresent (computeStepProgram, "u_cellSize", cellSize);
-    // Simulation speed: scales time without extra compute work (same number of dispatches).
-    // Note: very large values would change behaviour due to integration stability, so the UI range is kept conservative.
-    setUniform1fIfPresent (computeStepProgram, "u_dt", dtSeconds * simSpeed);
-
-    setUniform1fIfPresent (computeStepProgram, "u_neighborRadius", neighborRadius);
-    setUniform1fIfPresent (computeStepProgram, "u_separationRadius", separationRadius);
-    setUniform1fIfPresent (computeStepProgram, "u_weightSeparation", weightSeparation);
-    setUniform1fIfPresent (computeStepProgram, "u_weightAlignment", weightAlignment);
-    setUniform1fIfPresent (computeStepProgram, "u_weightCohesion", weightCohesion);
-    setUniform1fIfPresent (computeStepProgram, "u_minSpeed", minSpeed);
-    setUniform1fIfPresent (computeStepProgram, "u_maxSpeed", maxSpeed);
-    setUniform1fIfPresent (computeStepProgram, "u_maxAccel", maxAccel);
-    setUniform1fIfPresent (computeStepProgram, "u_centerAttraction", centerAttraction);
-    setUniform1fIfPresent (computeStepProgram, "u_boundaryMargin", boundaryMargin);
-    setUniform1fIfPresent (computeStepProgram, "u_boundaryStrength", boundaryStrength);
-    setUniform1iIfPresent (computeStepProgram, "u_wrapBounds", wrapBounds ? 1 : 0);
+    setUniform1iIfPresent (stepProgram, "u_particleCount", currentParticleCount);
+    setUniform3iIfPresent (stepProgram, "u_gridDims", gridDims);
+    setUniform3fIfPresent (stepProgram, "u_worldMin", toOriginRelative (worldMin));
+    setUniform3fIfPresent (stepProgram, "u_worldMax", toOriginRelative (worldMax));
+    setUniform1fIfPresent (stepProgram, "u_cellSize", cellSize);
+    // Simulation speed: scales time without extra compute work (same number of dispatches).
+    // Note: very large values would change behaviour due to integration stability, so the UI range is kept conservative.
+    setUniform1fIfPresent (stepProgram, "u_dt", dtSeconds * simSpeed);
+
+    setUniform1fIfPresent (stepProgram, "u_neighborRadius", neighborRadius);
+    setUniform1fIfPresent (stepProgram, "u_separationRadius", separationRadius);
+    setUniform1fIfPresent (stepProgram, "u_weightSeparation", weightSeparation);
+    setUniform1fIfPresent (stepProgram, "u_weightAlignment", weightAlignment);
+    setUniform1fIfPresent (stepProgram, "u_weightCohesion", weightCohesion);
+    setUniform1fIfPresent (stepProgram, "u_minSpeed", minSpeed);
+    setUniform1fIfPresent (stepProgram, "u_maxSpeed", maxSpeed);
+    setUniform1fIfPresent (stepProgram, "u_maxAccel", maxAccel);
+    setUniform1fIfPresent (stepProgram, "u_centerAttraction", centerAttraction);
+    setUniform1fIfPresent (stepProgram, "u_boundaryMargin", boundaryMargin);
+    setUniform1fIfPresent (stepProgram, "u_boundaryStrength", boundaryStrength);
+    setUniform1iIfPresent (stepProgram, "u_wrapBounds", wrapBounds ? 1 : 0);
+    setUniform1iIfPresent (stepProgram, "u_recolourOnly", recolourOnly ? 1 : 0);
+
+    // Coloring uniforms
+    setUniform1iIfPresent (stepProgram, "u_colorMode", colorMode);
+    setUniform1fIfPresent (stepProgram, "u_hueOffset", hueOffset);
+    setUniform1fIfPresent (stepProgram, "u_hueRange", hueRange);
+    setUniform1fIfPresent (stepProgram, "u_saturation", saturation);
+    setUniform1fIfPresent (stepProgram, "u_value", value);
+    setUniform1fIfPresent (stepProgram, "u_densityCurve", densityCurve);
+
+    beginPass (2);
+    glDispatchCompute (groupsFor (currentParticleCount, workgroupConfig.step), 1, 1);
+    endPass();
+    glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Ping-pong swap
+    std::swap (particlesSSBO[0], particlesSSBO[1]);
+}
+
+// Loads the tuned workgroup sizes for the current GPU/driver from the settings file. Returns false if none are stored.
+bool MainComponent::loadWorkgroupConfig()
+{
+    auto settings = openSettingsFile();
+    const auto stored = settings->getValue ("workgroupSizes " + gpuIdentity);
+
+    juce::StringArray tokens;
+    tokens.addTokens (stored, ",", "");
+
+    if (tokens.size() != 3)
+        return false;
+
+    auto parseSize = [] (const juce::String& t) { return juce::jlimit (1, 1024, t.getIntValue()); };
+    workgroupConfig = { parseSize (tokens[0]), parseSize (tokens[1]), parseSize (tokens[2]) };
+    return true;
+}
+
+// Stores the current workgroup sizes under the current GPU/driver identity.
+void MainComponent::saveWorkgroupConfig()
+{
+    auto settings = openSettingsFile();
+    settings->setValue ("workgroupSizes " + gpuIdentity,
+                        juce::String (workgroupConfig.clear) + "," + juce::String (workgroupConfig.build) + "," + juce::String (workgroupConfig.step));
+    settings->saveIfNeeded();
+}
+
+// Workgroup auto-tuner: recompiles only the clear/build/step programs (reloadSimulationProgramsOnGLThread()) at each
+// candidate local size, times every kernel separately on the current scene (GL_TIME_ELAPSED queries), keeps the fastest
+// size per kernel, then reloads every shader with the winners and persists them for this GPU/driver. Blocks the GL thread for a moment; run rarely.
+// The timed steps really run on the particle buffers, so the flock and the ping-pong order are saved first and put
+// back afterwards: tuning never advances the flock, which would break deterministic runs and recordings.
+bool MainComponent::runWorkgroupTunerOnGLThread()
+{
+    jassert (juce::OpenGLHelpers::isContextActive());
+
+    if (! computeAvailable || ! shadersLoaded || ! buffersReady.load())
+        return false;
+
+    GLint maxInvocations = 0, maxSizeX = 0;
+    glGetIntegerv (GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+    glGetIntegeri_v (GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxSizeX);
+    const int sizeLimit = juce::jmin (maxInvocations, maxSizeX);
+
+    constexpr int kCandidates[] = { 32, 64, 128, 256, 512, 1024 };
+    constexpr int kTimedRuns = 8;
+
+    const auto previousConfig = workgroupConfig;
+    int bestSize[3] = { previousConfig.clear, previousConfig.build, previousConfig.step };
+    double bestTime[3] = { -1.0, -1.0, -1.0 };
+
+    const GLuint liveParticles[2] = { particlesSSBO[0], particlesSSBO[1] };
+    const auto flockBytes = (GLsizeiptr) ((size_t) currentParticleCount * sizeof (ParticleCPU));
+
+    // The last step's storage writes have to land before the copy reads them.
+    glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    GLuint savedFlock = 0;
+    glGenBuffers (1, &savedFlock);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, savedFlock);
+    glBufferData (GL_COPY_WRITE_BUFFER, flockBytes, nullptr, GL_STREAM_COPY);
+    glBindBuffer (GL_COPY_READ_BUFFER, liveParticles[0]);
+    glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, flockBytes);
+
+    GLuint queries[3] { 0, 0, 0 };
+    glGenQueries (3, queries);
+
+    for (int size : kCandidates)
+    {
+        if (size > sizeLimit)
+            continue;
+
+        workgroupConfig = { size, size, size };
+        if (! reloadSimulationProgramsOnGLThread())
+            continue;
+
+        dispatchComputePasses (0.0f); // warm-up: first dispatch after a link can include driver-side compilation
+
+        double total[3] = { 0.0, 0.0, 0.0 };
+        for (int run = 0; run < kTimedRuns; ++run)
+        {
+            dispatchComputePasses (0.0f, queries);
+
+            for (int k = 0; k < 3; ++k)
+            {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v (queries[k], GL_QUERY_RESULT, &ns);
+                total[k] += (double) ns;
+            }
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            if (bestTime[k] < 0.0 || total[k] < bestTime[k])
+            {
+                bestTime[k] = total[k];
+                bestSize[k] = size;
+            }
+        }
+    }
+
+    glDeleteQueries (3, queries);
+
+    glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+    particlesSSBO[0] = liveParticles[0];
+    particlesSSBO[1] = liveParticles[1];
+
+    glBindBuffer (GL_COPY_READ_BUFFER, savedFlock);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, particlesSSBO[0]);
+    glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, flockBytes);
+    glBindBuffer (GL_COPY_READ_BUFFER, 0);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers (1, &savedFlock);
+
+    workgroupConfig = { bestSize[0], bestSize[1], bestSize[2] };
+
+    if (! reloadAllShadersOnGLThread())
+    {
+        workgroupConfig = previousConfig;
+        reloadAllShadersOnGLThread();
+        return false;
+    }
 
-    // Coloring uniforms
-    setUniform1iIfPresent (computeStepProgram, "u_colorMode", colorMode);
-    setUniform1fIfPresent (computeStepProgram, "u_hueOffset", hueOffset);
-    setUniform1fIfPresent (computeStepProgram, "u_hueRange", hueRange);
-    setUniform1fIfPresent (computeStepProgram, "u_saturation", saturation);
-    setUniform1fIfPresent (computeStepProgram, "u_value", value);
-    setUniform1fIfPresent (computeStepProgram, "u_densityCurve", densityCurve);
-
-    glDispatchCompute (buildGroups, 1, 1);
-    glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+    saveWorkgroupConfig();
 
-    // Ping-pong swap
-    std::swap (particlesSSBO[0], particlesSSBO[1]);
+    DBG ("Workgroup tuner: clear " + juce::String (workgroupConfig.clear)
+         + ", build " + juce::String (workgroupConfig.build)
+         + ", step " + juce::String (workgroupConfig.step));
+    return true;
 }
 
 // OpenGLAppComponent per-frame callback: computes dt, updates simulation via compute, then draws particles as points.
@@ -820,11 +3495,28 @@ void MainComponent::render()
 {
     jassert (juce::OpenGLHelpers::isContextActive());
 
+    if (launchParamsRequested.exchange (false))
+        applyParamsOnGLThread (launchParams);
+
+    if (launchTimelineRequested.exchange (false))
+        startTimelineOnGLThread (std::move (launchTimeline));
+
+    if (launchExportRequested.exchange (false))
+        startExportOnGLThread (launchExportSettings);
+
     const auto nowSeconds = juce::Time::getMillisecondCounterHiRes() * 0.001;
     float dt = (float) (nowSeconds - lastFrameTimeSeconds);
     lastFrameTimeSeconds = nowSeconds;
     dt = juce::jlimit (0.0f, 0.05f, dt);
 
+    // Deterministic mode takes the same step every frame, so the run doesn't depend on the frame rate.
+    if (deterministic)
+        dt = kDeterministicStepSeconds;
+
+    // Exported frames are a fixed 1 / fps of simulated time apart, however long each takes to render and save.
+    if (frameExporter.isExporting())
+        dt = (float) (1.0 / frameExporter.getSettings().framesPerSecond);
+
     // FPS readout (update ~2x/sec on the message thread)
     framesSinceFpsUpdate++;
     const double elapsedForFps = nowSeconds - fpsUpdateStartSeconds;
@@ -836,7 +3528,71 @@ void MainComponent::render()
 
         if (controlPanel != nullptr)
         {
-            const auto text = "FPS: " + juce::String (fps, 1) + " | Particles: " + juce::String (currentParticleCount);
+            auto text = "FPS: " + juce::String (fps, 1) + " | Particles: " + juce::String (currentParticleCount);
+            text << " | WG " << juce::String (workgroupConfig.clear) << "/" << juce::String (workgroupConfig.build)
+                 << "/" << juce::String (workgroupConfig.step);
+            if (deterministic)
+                text << " | deterministic (seed " << juce::String (seed) << ")";
+            else if (stepUsesSubgroups)
+                text << " | subgroups";
+
+            if (gpuTimer.isCreated())
+            {
+                text << " | draw " << juce::String (gpuTimer.getMilliseconds (gpuTimerDraw), 2) << " ms";
+                if (transparencyMode == 2)
+                    text << ", sort " << juce::String (gpuTimer.getMilliseconds (gpuTimerSort), 2) << " ms";
+
+                if (sortBenchmark.result.isNotEmpty())
+                    text << " | " << sortBenchmark.result;
+
+                if (drawBudgetMs > 0.0f)
+                    text << " | res " << juce::String (juce::roundToInt (renderScale * 100.0f)) << "% ("
+                         << juce::String (drawBudgetMs, 1) << " ms budget)";
+            }
+
+            if (trailHistorySSBO != 0)
+            {
+                // History size, and the bytes the trail draw reads each frame (every slot of every live particle).
+                const double mb = 1.0 / (1024.0 * 1024.0);
+                text << " | trails " << juce::String (trailHistoryLength) << "x" << juce::String (currentParticleCount) << ": "
+                     << juce::String ((double) trailHistoryLength * trailHistoryCapacity * 16.0 * mb, 1) << " MB, "
+                     << juce::String ((double) trailHistoryLength * currentParticleCount * 16.0 * mb, 1) << " MB/frame";
+            }
+
+            const auto streamedBytes = particleStream.getTotalBytesReadBack() + particleStream.getTotalBytesUploaded();
+            if (streamParticles)
+            {
+                const double mbPerSecond = (double) (streamedBytes - streamBytesAtLastFpsUpdate) / (elapsedForFps * 1024.0 * 1024.0);
+                text << " | Stream " << juce::String (mbPerSecond, 1) << " MB/s, "
+                     << juce::String (particleStream.getDroppedFrames()) << " dropped"
+                     << " | mean speed " << juce::String (streamMeanSpeed, 2);
+            }
+            streamBytesAtLastFpsUpdate = streamedBytes;
+
+            if (trajectoryPlayer != nullptr)
+                text << " | PLAY " << juce::String (playbackFrame + 1) << "/" << juce::String (trajectoryPlayer->getNumFrames())
+                     << " (" << juce::String (playheadSeconds, 2) << " s, " << juce::String (playbackSpeed.load(), 2) << "x)";
+
+            if (trajectoryRecorder.isRecording())
+                text << " | REC " << juce::String (trajectoryRecorder.getFramesWritten()) << " frames, "
+                     << juce::String ((double) trajectoryRecorder.getBytesWritten() / (1024.0 * 1024.0), 1) << " MB, "
+                     << juce::String (trajectoryRecorder.getDroppedFrames()) << " dropped, "
+                     << juce::String (trajectoryRecorder.getWriteMilliseconds(), 2) << " ms/frame";
+
+            if (timeline != nullptr)
+                text << " | TIMELINE " << juce::String (simulationTimeSeconds - timelineStartSeconds, 1) << " / "
+                     << juce::String (timeline->getDuration(), 1) << " s" << (timeline->isLooping() ? " (loop)" : "");
+
+            if (oscControl.isListening())
+                text << " | OSC :" << juce::String (oscControl.getPort()) << " " << juce::String (oscControl.getReceivedMessages())
+                     << " msgs, " << juce::String (oscControl.getDroppedMessages()) << " dropped";
+
+            if (frameExporter.isExporting())
+                text << " | EXPORT " << juce::String (frameExporter.getFramesWritten()) << " frames at "
+                     << juce::String (frameExporter.getSettings().width) << "x" << juce::String (frameExporter.getSettings().height) << ", "
+                     << juce::String (frameExporter.getDroppedFrames()) << " dropped, "
+                     << juce::String (frameExporter.getEncodeMilliseconds(), 1) << " ms/frame";
+
             juce::MessageManager::callAsync ([panel = controlPanel.get(), text]
             {
                 if (panel != nullptr)
@@ -852,37 +3608,726 @@ void MainComponent::render()
         return;
     }
 
-    dispatchComputePasses (dt);
+    if (workgroupTuneRequested.exchange (false))
+        runWorkgroupTunerOnGLThread();
+
+    if (sortBenchmarkRequested.exchange (false))
+        startSortBenchmarkOnGLThread();
+
+    if (sortBenchmark.framesLeft > 0)
+        runSortBenchmarkFrameOnGLThread();
+
+    updateFloatingOriginOnGLThread();
+
+    if (trajectoryPlayer != nullptr)
+    {
+        advancePlaybackOnGLThread (dt);
+    }
+    else
+    {
+        if (timeline != nullptr)
+            advanceTimelineOnGLThread();
+
+        if (audioModulating || audioAnalyser.isRunning())
+            modulateFromAudioOnGLThread (dt);
+
+        dispatchComputePasses (dt);
+        simulationTimeSeconds += (double) (dt * simSpeed);
+    }
+
+    if (streamParticles || pendingSnapshot != nullptr || trajectoryRecorder.isRecording())
+        streamParticlesOnGLThread();
+
+    recordTrailsOnGLThread();
 
     auto desktopScale = (float) openGLContext.getRenderingScale();
-    glViewport (0, 0,
-                juce::roundToInt (desktopScale * (float) getWidth()),
-                juce::roundToInt (desktopScale * (float) getHeight()));
+    const int windowWidth  = juce::roundToInt (desktopScale * (float) getWidth());
+    const int windowHeight = juce::roundToInt (desktopScale * (float) getHeight());
+
+    // Exporting: the frame renders into exportTarget at the export size (everything below draws into whichever
+    // framebuffer is bound here), then presentExportFrameOnGLThread() captures it and shows it in the window.
+    const bool exportFrame = frameExporter.isExporting() && exportTarget.isValid();
+    const auto windowFrameBuffer = GLRenderTarget::getCurrentFrameBuffer();
+    const int viewportWidth  = exportFrame ? exportTarget.getWidth()  : windowWidth;
+    const int viewportHeight = exportFrame ? exportTarget.getHeight() : windowHeight;
+    outputPixelScale = (float) viewportHeight / (float) juce::jmax (1, windowHeight);
+
+    const auto viewProj = getViewProjectionMatrix();
+
+    // Dynamic resolution: below full scale, the scene (meshes, trails, particles) renders into the offscreen scene
+    // target at sceneWidth x sceneHeight, and the final resolve pass upscales it to the window.
+    updateRenderScaleOnGLThread();
+    int sceneWidth  = juce::jmax (1, juce::roundToInt ((float) viewportWidth * renderScale));
+    int sceneHeight = juce::jmax (1, juce::roundToInt ((float) viewportHeight * renderScale));
+
+    // Inputs for the per-vertex screen velocities (see setVelocityUniforms()).
+    frameStepSeconds = dt * simSpeed;
+    frameViewportWidth = sceneWidth;
+    frameViewportHeight = sceneHeight;
+
+    if (! previousViewProjValid)
+        previousViewProj = viewProj;
+
+    // Volume mode replaces all per-particle drawing, so it needs none of the cull/sort/mesh work below.
+    const bool useVolume = particleShape == 4 && computeVolumeSplatProgram != 0 && computeVolumeResolveProgram != 0
+                        && volumeRaymarchProgram != 0;
+
+    // Meshes always go through the LOD binning pass (which also frustum culls); if it can't run, draw points.
+    // Sorting needs the compacted list too, so it culls even when "Frustum cull" is off.
+    bool useMeshes = ! useVolume && particleRenderer == 3 && meshRenderProgram != 0;
+    bool culled = false;
+
+    if (useMeshes)
+        useMeshes = culled = cullParticlesOnGLThread (viewProj, sceneWidth, sceneHeight, true);
+    else if (! useVolume && (frustumCull || transparencyMode == 2))
+        culled = cullParticlesOnGLThread (viewProj, sceneWidth, sceneHeight, false);
+
+    gpuTimer.beginSection (gpuTimerSort);
+    const bool sorted = transparencyMode == 2 && culled && sortVisibleOnGLThread (viewProj, useMeshes);
+    gpuTimer.endSection (gpuTimerSort);
+
+    if (exportFrame)
+        exportTarget.bind();
+
+    glViewport (0, 0, viewportWidth, viewportHeight);
 
     juce::OpenGLHelpers::clear (juce::Colours::black);
 
-    glUseProgram (renderProgram);
+    // HDR: everything below draws into the RGBA16F scene target, resolved by bloom + tone mapping at the end.
+    // Motion blur and dynamic resolution need the same offscreen scene, so they use this path even without HDR.
+    const bool useMotionBlur = motionBlurShutter > 0.0f && motionTileMaxProgram != 0 && motionNeighbourMaxProgram != 0
+                            && motionBlurProgram != 0;
+    const bool useHdr = (hdrBloom || useMotionBlur || renderScale < 1.0f) && tonemapProgram != 0
+                     && beginHdrSceneOnGLThread (sceneWidth, sceneHeight, useMotionBlur);
+
+    if (! useHdr && renderScale < 1.0f)
+    {
+        // No float target after all: draw at full size this frame (the cull margins above were a few pixels off).
+        renderScale = 1.0f;
+        sceneWidth = frameViewportWidth = viewportWidth;
+        sceneHeight = frameViewportHeight = viewportHeight;
+    }
+
+    const float meshTime = (float) (nowSeconds - (double) startTime);
+
+    // The draw section covers everything rasterised into the scene, meshes included: dynamic resolution steers by it.
+    gpuTimer.beginSection (gpuTimerDraw);
+
+    if (useMeshes)
+        drawLodMeshesOnGLThread (viewProj, meshTime);
+
+    if (trailHistorySSBO != 0)
+        drawTrailsOnGLThread (viewProj);
+
+    // Translucent particles go into the OIT targets instead (the opaque meshes above stay in the scene framebuffer).
+    const bool useOit = ! useVolume && transparencyMode == 1 && oitCompositeProgram != 0
+                     && beginOitPassOnGLThread (sceneWidth, sceneHeight, useMeshes ? &viewProj : nullptr, meshTime,
+                                                useHdr && useMotionBlur);
+
+    if (useVolume)
+        drawDensityVolumeOnGLThread (viewProj);
+    else
+        drawParticlesOnGLThread (viewProj, sceneWidth, sceneHeight, culled, useMeshes, useOit, sorted);
+
+    if (useOit)
+        compositeOitOnGLThread();
+
+    if (useHdr)
+        resolveHdrSceneOnGLThread (viewportWidth, viewportHeight);
+
+    gpuTimer.endSection (gpuTimerDraw);
+    gpuTimer.endFrame();
+
+    previousViewProj = viewProj;
+    previousViewProjValid = true;
+
+    if (exportFrame)
+        presentExportFrameOnGLThread (windowFrameBuffer, windowWidth, windowHeight);
+
+    glDepthMask (GL_TRUE);
+    glBindVertexArray (0);
+}
+
+// Inputs for the particle/mesh vertex shaders' screen-space velocity output (fragment location 2, motion blur).
+void MainComponent::setVelocityUniforms (unsigned int program) const
+{
+    setUniformMatrix4IfPresent (program, "u_prevViewProj", previousViewProj);
+    setUniform1fIfPresent (program, "u_stepSeconds", frameStepSeconds);
+    setUniform2fIfPresent (program, "u_viewportSize", (float) frameViewportWidth, (float) frameViewportHeight);
+}
+
+// Points/quads from the particle buffer (or the visible list when culled); with meshes this draws the far LOD bin
+// as points. Blend/depth state follows the transparency mode; useOit means the OIT targets are bound.
+void MainComponent::drawParticlesOnGLThread (const juce::Matrix3D<float>& viewProj, int viewportWidth, int viewportHeight,
+                                             bool culled, bool useMeshes, bool useOit, bool sorted)
+{
+    const bool useQuads = ! useMeshes && (particleRenderer == 1 || particleRenderer == 2) && quadRenderProgram != 0;
+    const auto program = useQuads ? quadRenderProgram : renderProgram;
+
+    glUseProgram (program);
     glBindVertexArray (vao);
 
     glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, particlesSSBO[0]);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 4, visibleIndicesSSBO);
 
     // JUCE's component painting can change GL state after our render callback.
     // Ensure blending is enabled at draw time so alpha actually has an effect.
+    // Quads are fully translucent at their edges (no discard), so they test depth but don't write it;
+    // with OIT nothing translucent writes depth (order doesn't matter, occlusion by opaque meshes still does),
+    // and sorted particles arrive back to front, so later (nearer) ones are never hidden by earlier ones.
+    // Additive blending is order-independent by construction (and is what HDR + bloom is made for).
+    const bool additive = transparencyMode == 3;
+
+    glEnable (GL_DEPTH_TEST);
+    glDepthFunc (GL_LEQUAL);
+    glDepthMask ((useQuads || useOit || sorted || additive) ? GL_FALSE : GL_TRUE);
+    glEnable (GL_BLEND);
+
+    if (useOit)
+    {
+        glBlendFunci (0, GL_ONE, GL_ONE);                  // accumulation: weighted sum
+        glBlendFunci (1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR); // revealage: product of (1 - alpha)
+    }
+    else if (additive)
+    {
+        glBlendFunc (GL_SRC_ALPHA, GL_ONE);
+    }
+    else
+    {
+        glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    // Velocity (location 2, only bound with motion blur) is always coverage-weighted over what's behind it.
+    glBlendFunci (2, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    setUniformMatrix4IfPresent (program, "u_viewProj", viewProj);
+    setUniform1iIfPresent (program, "u_shape", particleShape); // 0 square, 1 circle, 2 line, 3 cube
+    setUniform1fIfPresent (program, "u_alphaMul", alphaMul);
+    setUniform1iIfPresent (program, "u_useVisibleList", culled ? 1 : 0);
+    setUniform1iIfPresent (program, "u_oit", useOit ? 1 : 0);
+    setVelocityUniforms (program);
+
+    if (useQuads)
+    {
+        const auto proj = getProjectionMatrix();
+        setUniform2fIfPresent (program, "u_projScale", proj.mat[0], proj.mat[5]);
+        setUniform2fIfPresent (program, "u_viewportSize", (float) viewportWidth, (float) viewportHeight);
+        setUniform1fIfPresent (program, "u_quadSize", getQuadWorldSize());
+        setUniform1fIfPresent (program, "u_minPixelSize", 1.0f);
+        setUniform1iIfPresent (program, "u_velocityAligned", particleRenderer == 2 ? 1 : 0);
+    }
+    else
+    {
+        setUniform1fIfPresent (program, "u_pointSize", pointSize * renderScale * outputPixelScale); // window pixels, at scene resolution
+    }
+
+    if (culled)
+    {
+        // Visible count comes from the cull pass (vertex count for points, instance count for quads);
+        // the CPU never learns how many particles are visible.
+        glBindBuffer (GL_DRAW_INDIRECT_BUFFER, drawIndirectBuffer);
+        const size_t commandOffset = useMeshes ? (size_t) 2 * 4 * sizeof (GLuint) : 0;
+        glDrawArraysIndirect (useQuads ? GL_TRIANGLE_STRIP : GL_POINTS, reinterpret_cast<const void*> (commandOffset));
+        glBindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else if (useQuads)
+    {
+        glDrawArraysInstanced (GL_TRIANGLE_STRIP, 0, 4, currentParticleCount);
+    }
+    else
+    {
+        glDrawArrays (GL_POINTS, 0, currentParticleCount);
+    }
+}
+
+// Volume render mode: turns this frame's grid lists into a density texture (volume_density.comp), then raymarches it
+// with one fullscreen pass. Each boid is treated as blocking its quad's area, so the look tracks the sprite modes.
+void MainComponent::drawDensityVolumeOnGLThread (const juce::Matrix3D<float>& viewProj)
+{
+    if (! buffersReady.load() || cellCount <= 0)
+        return;
+
+    if (volumeTexture == 0 || volumeTextureDims.x != gridDims.x || volumeTextureDims.y != gridDims.y || volumeTextureDims.z != gridDims.z)
+    {
+        // Immutable storage, so a new grid size needs a new texture.
+        if (volumeTexture != 0)
+            glDeleteTextures (1, &volumeTexture);
+
+        glGenTextures (1, &volumeTexture);
+        glBindTexture (GL_TEXTURE_3D, volumeTexture);
+        glTexStorage3D (GL_TEXTURE_3D, 1, GL_RGBA16F, gridDims.x, gridDims.y, gridDims.z);
+        glTexParameteri (GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri (GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri (GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri (GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri (GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture (GL_TEXTURE_3D, 0);
+
+        // The accumulator starts zeroed; after that, every resolve leaves it zeroed for the next splat.
+        const std::vector<GLuint> zeros ((size_t) cellCount * 4, 0u);
+
+        if (volumeAccumulatorSSBO == 0)
+            glGenBuffers (1, &volumeAccumulatorSSBO);
+
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, volumeAccumulatorSSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) (zeros.size() * sizeof (GLuint)), zeros.data(), GL_DYNAMIC_COPY);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+        volumeTextureDims = gridDims;
+    }
+
+    // SSBO bindings (must match volume_density.comp). The splat reads the particles themselves rather than this
+    // frame's grid lists, so played-back frames (which build no grid) get a current volume too.
+    glUseProgram (computeVolumeSplatProgram);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, particlesSSBO[0]);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 13, volumeAccumulatorSSBO);
+
+    setUniform1iIfPresent (computeVolumeSplatProgram, "u_particleCount", currentParticleCount);
+    setUniform3iIfPresent (computeVolumeSplatProgram, "u_gridDims", gridDims);
+    setUniform3fIfPresent (computeVolumeSplatProgram, "u_worldMin", toOriginRelative (worldMin));
+    setUniform1fIfPresent (computeVolumeSplatProgram, "u_cellSize", cellSize);
+
+    glDispatchCompute ((GLuint) ((currentParticleCount + workgroupConfig.build - 1) / workgroupConfig.build), 1, 1);
+    glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram (computeVolumeResolveProgram);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 13, volumeAccumulatorSSBO);
+    glBindImageTexture (0, volumeTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    setUniform3iIfPresent (computeVolumeResolveProgram, "u_gridDims", gridDims);
+    setUniform1fIfPresent (computeVolumeResolveProgram, "u_maxCount", kVolumeMaxCount);
+
+    glDispatchCompute ((GLuint) ((cellCount + workgroupConfig.clear - 1) / workgroupConfig.clear), 1, 1);
+    glMemoryBarrier (GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    glBindImageTexture (0, 0, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    // The grid box can overhang worldMax by up to a cell (dims are rounded up).
+    const auto boxMin = toOriginRelative (worldMin);
+    const auto boxSize = juce::Vector3D<float> ((float) gridDims.x, (float) gridDims.y, (float) gridDims.z) * cellSize;
+    const float crossSection = juce::square (2.0f * getQuadWorldSize());
+
+    glUseProgram (volumeRaymarchProgram);
+    glBindVertexArray (vao);
+    glActiveTexture (GL_TEXTURE0);
+    glBindTexture (GL_TEXTURE_3D, volumeTexture);
+
+    setUniform1iIfPresent (volumeRaymarchProgram, "u_volume", 0);
+    setUniformMatrix4IfPresent (volumeRaymarchProgram, "u_invViewProj", invertMatrix (viewProj));
+    setUniform3fIfPresent (volumeRaymarchProgram, "u_boxMin", boxMin);
+    setUniform3fIfPresent (volumeRaymarchProgram, "u_boxMax", boxMin + boxSize);
+    setUniform1fIfPresent (volumeRaymarchProgram, "u_extinctionScale", crossSection / (cellSize * cellSize * cellSize) * alphaMul);
+    setUniform1fIfPresent (volumeRaymarchProgram, "u_stepSize", juce::jmax (cellSize * 0.5f, boxSize.length() / (float) kVolumeMaxSteps));
+    setUniform1iIfPresent (volumeRaymarchProgram, "u_maxSteps", kVolumeMaxSteps);
+
+    // Premultiplied output over whatever is already in the scene.
+    glDisable (GL_DEPTH_TEST);
+    glDepthMask (GL_FALSE);
+    glEnable (GL_BLEND);
+    glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    // No per-pixel velocity for a density field; leave the motion blur velocity target (draw buffer 2) alone.
+    glColorMaski (2, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDrawArrays (GL_TRIANGLES, 0, 3);
+    glColorMaski (2, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    glBindTexture (GL_TEXTURE_3D, 0);
+    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable (GL_DEPTH_TEST);
+}
+
+// Samples the current positions into the trail history ring every trailStride frames. Allocates the ring when the
+// length or particle capacity changes, and frees it when trails are off.
+void MainComponent::recordTrailsOnGLThread()
+{
+    if (trailLength < 1 || computeTrailRecordProgram == 0 || trailRenderProgram == 0 || ! buffersReady.load())
+    {
+        releaseTrailHistoryOnGLThread();
+        return;
+    }
+
+    if (trailHistorySSBO == 0 || trailHistoryLength != trailLength || trailHistoryCapacity != particleCapacity)
+    {
+        releaseTrailHistoryOnGLThread();
+
+        glGenBuffers (1, &trailHistorySSBO);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, trailHistorySSBO);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) ((size_t) trailLength * (size_t) particleCapacity * 4 * sizeof (float)),
+                      nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+        trailHistoryLength = trailLength;
+        trailHistoryCapacity = particleCapacity;
+    }
+
+    const bool fill = trailsNeedReset;
+
+    if (! fill && ++trailFramesSinceSample < trailStride)
+        return;
+
+    trailFramesSinceSample = 0;
+    trailsNeedReset = false;
+    trailHead = fill ? 0 : (trailHead + 1) % trailHistoryLength;
+
+    // SSBO bindings (must match trails_record.comp)
+    glUseProgram (computeTrailRecordProgram);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, particlesSSBO[0]);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 11, trailHistorySSBO);
+
+    setUniform1iIfPresent (computeTrailRecordProgram, "u_particleCount", currentParticleCount);
+    setUniform1iIfPresent (computeTrailRecordProgram, "u_capacity", trailHistoryCapacity);
+    setUniform1iIfPresent (computeTrailRecordProgram, "u_head", trailHead);
+    setUniform1iIfPresent (computeTrailRecordProgram, "u_trailLength", trailHistoryLength);
+    setUniform1iIfPresent (computeTrailRecordProgram, "u_fill", fill ? 1 : 0);
+
+    glDispatchCompute ((GLuint) ((currentParticleCount + workgroupConfig.build - 1) / workgroupConfig.build), 1, 1);
+    glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// Draws every trail in one instanced GL_LINES call, with trailHistoryLength segments per boid. Trails blend like the
+// particles but never write depth.
+void MainComponent::drawTrailsOnGLThread (const juce::Matrix3D<float>& viewProj)
+{
+    glUseProgram (trailRenderProgram);
+    glBindVertexArray (vao);
+
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, particlesSSBO[0]);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 11, trailHistorySSBO);
+
+    const auto worldSize = worldMax - worldMin;
+
+    setUniformMatrix4IfPresent (trailRenderProgram, "u_viewProj", viewProj);
+    setUniform1iIfPresent (trailRenderProgram, "u_capacity", trailHistoryCapacity);
+    setUniform1iIfPresent (trailRenderProgram, "u_head", trailHead);
+    setUniform1iIfPresent (trailRenderProgram, "u_trailLength", trailHistoryLength);
+    setUniform1fIfPresent (trailRenderProgram, "u_alphaMul", alphaMul);
+    setUniform1fIfPresent (trailRenderProgram, "u_maxSegment", 0.5f * juce::jmin (worldSize.x, worldSize.y, worldSize.z));
+
     glEnable (GL_DEPTH_TEST);
     glDepthFunc (GL_LEQUAL);
+    glDepthMask (GL_FALSE);
+    glEnable (GL_BLEND);
+    glBlendFunc (GL_SRC_ALPHA, transparencyMode == 3 ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+
+    // Trails write no velocity; keep them out of the motion blur velocity target (draw buffer 2) if it's bound.
+    glColorMaski (2, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDrawArraysInstanced (GL_LINES, 0, 2 * trailHistoryLength, currentParticleCount);
+    glColorMaski (2, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void MainComponent::releaseTrailHistoryOnGLThread()
+{
+    if (trailHistorySSBO != 0)
+    {
+        glDeleteBuffers (1, &trailHistorySSBO);
+        trailHistorySSBO = 0;
+    }
+
+    trailHistoryLength = 0;
+    trailHistoryCapacity = 0;
+    trailsNeedReset = true;
+}
+
+// Binds and clears the OIT targets (accumulation 0, revealage 1, optionally velocity 2). Opaque meshes are re-drawn depth-only so the
+// translucent pass is still occluded by them. Returns false (caller falls back to straight alpha) if the
+// floating-point targets can't be created. Leaves the OIT framebuffer bound; compositeOitOnGLThread() restores.
+bool MainComponent::beginOitPassOnGLThread (int viewportWidth, int viewportHeight,
+                                            const juce::Matrix3D<float>* meshViewProj, float meshTimeSeconds,
+                                            bool withVelocity)
+{
+    // With motion blur the particle velocities are gathered here too (attachment 2), and composited with the colour.
+    if (! oitTarget.isValid() || oitTarget.getNumColourAttachments() != (withVelocity ? 3 : 2))
+    {
+        if (withVelocity)
+            oitTarget.create (viewportWidth, viewportHeight, { GL_RGBA16F, GL_R8, GL_RG16F }, true);
+        else
+            oitTarget.create (viewportWidth, viewportHeight, { GL_RGBA16F, GL_R8 }, true);
+    }
+
+    if (! oitTarget.ensureSize (viewportWidth, viewportHeight))
+        return false;
+
+    oitSceneFrameBuffer = GLRenderTarget::getCurrentFrameBuffer();
+    oitTarget.bind();
+
+    const GLfloat zero[4] { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat one[4]  { 1.0f, 1.0f, 1.0f, 1.0f };
+    const GLfloat farDepth = 1.0f;
+
+    glDepthMask (GL_TRUE);
+    glClearBufferfv (GL_COLOR, 0, zero);
+    glClearBufferfv (GL_COLOR, 1, one);
+    glClearBufferfv (GL_DEPTH, 0, &farDepth);
+
+    if (withVelocity)
+        glClearBufferfv (GL_COLOR, 2, zero);
+
+    if (meshViewProj != nullptr)
+    {
+        glColorMask (GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        drawLodMeshesOnGLThread (*meshViewProj, meshTimeSeconds);
+        glColorMask (GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    return true;
+}
+
+// Makes sure the HDR scene target and the bloom chain match the viewport, then binds and clears the scene target.
+// withVelocity adds the motion blur velocity attachment (fed by fragment output location 2) and its tile targets.
+// Returns false (caller renders straight into the current framebuffer) if float targets aren't available.
+bool MainComponent::beginHdrSceneOnGLThread (int viewportWidth, int viewportHeight, bool withVelocity)
+{
+    if (bloomDownProgram == 0 || bloomUpProgram == 0)
+        return false;
+
+    if (! hdrTarget.isValid() || hdrTarget.getWidth() != viewportWidth || hdrTarget.getHeight() != viewportHeight
+        || hdrTarget.getNumColourAttachments() != (withVelocity ? 2 : 1))
+    {
+        releaseHdrTargetsOnGLThread();
+
+        hdrTarget.setLinearFiltering (true); // sampled at a different size by the first bloom step
+
+        if (withVelocity)
+        {
+            hdrTarget.setOutputLocations ({ 0, 2 }); // colour and velocity; location 1 is the OIT revealage
+            if (! hdrTarget.create (viewportWidth, viewportHeight, { GL_RGBA16F, GL_RG16F }, true))
+                return false;
+
+            const int tilesX = (viewportWidth + kMotionBlurTileSize - 1) / kMotionBlurTileSize;
+            const int tilesY = (viewportHeight + kMotionBlurTileSize - 1) / kMotionBlurTileSize;
+
+            motionBlurTarget.setLinearFiltering (true); // feeds the bloom chain like hdrTarget does
+
+            if (! motionTileMax.create (tilesX, tilesY, { GL_RG16F }, false)
+                || ! motionNeighbourMax.create (tilesX, tilesY, { GL_RG16F }, false)
+                || ! motionBlurTarget.create (viewportWidth, viewportHeight, { GL_RGBA16F }, false))
+            {
+                releaseHdrTargetsOnGLThread();
+                return false;
+            }
+        }
+        else
+        {
+            hdrTarget.setOutputLocations ({ 0 });
+            if (! hdrTarget.create (viewportWidth, viewportHeight, { GL_RGBA16F }, true))
+                return false;
+        }
+
+        // First level: half resolution, or less on big viewports so it never exceeds kBloomMaxBaseHeight rows.
+        int divisor = 2;
+        while (viewportHeight / divisor > kBloomMaxBaseHeight)
+            divisor *= 2;
+
+        int w = juce::jmax (1, viewportWidth / divisor);
+        int h = juce::jmax (1, viewportHeight / divisor);
+
+        for (int level = 0; level < kBloomMaxLevels && juce::jmin (w, h) >= kBloomMinLevelSize; ++level)
+        {
+            auto* target = bloomLevels.add (new GLRenderTarget());
+            target->setLinearFiltering (true);
+
+            // 11/11/10 float: half the bandwidth of RGBA16F and bloom has no alpha.
+            if (! target->create (w, h, { GL_R11F_G11F_B10F }, false))
+            {
+                releaseHdrTargetsOnGLThread();
+                return false;
+            }
+
+            w /= 2;
+            h /= 2;
+        }
+    }
+
+    hdrSceneFrameBuffer = GLRenderTarget::getCurrentFrameBuffer();
+    hdrTarget.bind();
+
+    const GLfloat black[4] { 0.0f, 0.0f, 0.0f, 1.0f };
+    const GLfloat farDepth = 1.0f;
+
     glDepthMask (GL_TRUE);
+    glClearBufferfv (GL_COLOR, 0, black);
+    glClearBufferfv (GL_DEPTH, 0, &farDepth);
+
+    if (withVelocity)
+    {
+        const GLfloat still[4] { 0.0f, 0.0f, 0.0f, 0.0f };
+        glClearBufferfv (GL_COLOR, 2, still);
+    }
+
+    return true;
+}
+
+// Motion blur (velocity tiles, then the gather into motionBlurTarget), bloom (downsample the scene through the chain,
+// then tent-upsample back up, accumulating) and the tone-map composite into the framebuffer that was bound before
+// beginHdrSceneOnGLThread(), at the output size (the scene may be smaller with dynamic resolution: the tone-map pass
+// then upscales it bilinearly). Without bloom the scene target only exists for motion blur or dynamic resolution,
+// and is copied out unmapped.
+void MainComponent::resolveHdrSceneOnGLThread (int outputWidth, int outputHeight)
+{
+    glBindVertexArray (vao);
+    glDisable (GL_DEPTH_TEST);
+    glDepthMask (GL_FALSE);
+    glDisable (GL_BLEND);
+
+    const GLRenderTarget* scene = &hdrTarget;
+
+    if (hdrTarget.getNumColourAttachments() > 1 && motionBlurTarget.isValid())
+    {
+        // 1. Largest velocity per tile.
+        motionTileMax.bind();
+        glUseProgram (motionTileMaxProgram);
+        hdrTarget.bindColourTexture (1, 0);
+        setUniform1iIfPresent (motionTileMaxProgram, "u_velocity", 0);
+        setUniform1iIfPresent (motionTileMaxProgram, "u_tileSize", kMotionBlurTileSize);
+        glDrawArrays (GL_TRIANGLES, 0, 3);
+
+        // 2. Largest of each tile's 3x3 neighbourhood, so blur can spill into the next tile.
+        motionNeighbourMax.bind();
+        glUseProgram (motionNeighbourMaxProgram);
+        motionTileMax.bindColourTexture (0, 0);
+        setUniform1iIfPresent (motionNeighbourMaxProgram, "u_tileMax", 0);
+        glDrawArrays (GL_TRIANGLES, 0, 3);
+
+        // 3. Gather.
+        motionBlurTarget.bind();
+        glUseProgram (motionBlurProgram);
+        hdrTarget.bindColourTexture (0, 0);
+        hdrTarget.bindColourTexture (1, 1);
+        motionNeighbourMax.bindColourTexture (0, 2);
+        setUniform1iIfPresent (motionBlurProgram, "u_scene", 0);
+        setUniform1iIfPresent (motionBlurProgram, "u_velocity", 1);
+        setUniform1iIfPresent (motionBlurProgram, "u_neighbourMax", 2);
+        setUniform1iIfPresent (motionBlurProgram, "u_tileSize", kMotionBlurTileSize);
+        setUniform1fIfPresent (motionBlurProgram, "u_shutter", motionBlurShutter);
+        setUniform1fIfPresent (motionBlurProgram, "u_maxBlur", (float) (2 * kMotionBlurTileSize));
+        glDrawArrays (GL_TRIANGLES, 0, 3);
+
+        glActiveTexture (GL_TEXTURE2);
+        glBindTexture (GL_TEXTURE_2D, 0);
+        glActiveTexture (GL_TEXTURE0);
+
+        scene = &motionBlurTarget;
+    }
+
+    const int numLevels = hdrBloom ? bloomLevels.size() : 0;
+
+    if (numLevels > 0 && bloomStrength > 0.0f)
+    {
+        glDisable (GL_BLEND);
+        glUseProgram (bloomDownProgram);
+        setUniform1iIfPresent (bloomDownProgram, "u_source", 0);
+        setUniform1fIfPresent (bloomDownProgram, "u_threshold", 1.0f);
+        setUniform1fIfPresent (bloomDownProgram, "u_knee", 0.5f);
+
+        const GLRenderTarget* source = scene;
+
+        for (int level = 0; level < numLevels; ++level)
+        {
+            auto* target = bloomLevels.getUnchecked (level);
+            target->bind();
+            source->bindColourTexture (0, 0);
+
+            setUniform1iIfPresent (bloomDownProgram, "u_prefilter", level == 0 ? 1 : 0);
+            setUniform2fIfPresent (bloomDownProgram, "u_sourceTexelSize", 1.0f / (float) source->getWidth(), 1.0f / (float) source->getHeight());
+            glDrawArrays (GL_TRIANGLES, 0, 3);
+
+            source = target;
+        }
+
+        glEnable (GL_BLEND);
+        glBlendFunc (GL_ONE, GL_ONE);
+        glUseProgram (bloomUpProgram);
+        setUniform1iIfPresent (bloomUpProgram, "u_source", 0);
+
+        for (int level = numLevels - 1; level > 0; --level)
+        {
+            auto* smaller = bloomLevels.getUnchecked (level);
+            bloomLevels.getUnchecked (level - 1)->bind();
+            smaller->bindColourTexture (0, 0);
+
+            setUniform2fIfPresent (bloomUpProgram, "u_sourceTexelSize", 1.0f / (float) smaller->getWidth(), 1.0f / (float) smaller->getHeight());
+            glDrawArrays (GL_TRIANGLES, 0, 3);
+        }
+    }
+
+    glBindFramebuffer (GL_FRAMEBUFFER, hdrSceneFrameBuffer);
+    glViewport (0, 0, outputWidth, outputHeight);
+    glDisable (GL_BLEND);
+
+    glUseProgram (tonemapProgram);
+    scene->bindColourTexture (0, 0);
+    setUniform1iIfPresent (tonemapProgram, "u_scene", 0);
+
+    if (numLevels > 0)
+        bloomLevels.getUnchecked (0)->bindColourTexture (0, 1);
+
+    setUniform1iIfPresent (tonemapProgram, "u_bloom", 1);
+    setUniform1fIfPresent (tonemapProgram, "u_bloomStrength", numLevels > 0 ? bloomStrength : 0.0f);
+    setUniform1fIfPresent (tonemapProgram, "u_exposure", exposure);
+    setUniform1iIfPresent (tonemapProgram, "u_toneMap", hdrBloom ? 1 : 0);
+
+    glDrawArrays (GL_TRIANGLES, 0, 3);
+
+    glActiveTexture (GL_TEXTURE1);
+    glBindTexture (GL_TEXTURE_2D, 0);
+    glActiveTexture (GL_TEXTURE0);
+    glBindTexture (GL_TEXTURE_2D, 0);
+
+    glEnable (GL_BLEND);
+    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable (GL_DEPTH_TEST);
+}
+
+void MainComponent::releaseHdrTargetsOnGLThread()
+{
+    hdrTarget.release();
+    motionTileMax.release();
+    motionNeighbourMax.release();
+    motionBlurTarget.release();
+
+    for (auto* level : bloomLevels)
+        level->release();
+
+    bloomLevels.clear();
+}
+
+// Resolves the OIT targets over the scene framebuffer with a single fullscreen pass.
+void MainComponent::compositeOitOnGLThread()
+{
+    glBindFramebuffer (GL_FRAMEBUFFER, oitSceneFrameBuffer);
+    glViewport (0, 0, oitTarget.getWidth(), oitTarget.getHeight());
+
+    glUseProgram (oitCompositeProgram);
+    glBindVertexArray (vao);
+
+    oitTarget.bindColourTexture (0, 0);
+    oitTarget.bindColourTexture (1, 1);
+    setUniform1iIfPresent (oitCompositeProgram, "u_accum", 0);
+    setUniform1iIfPresent (oitCompositeProgram, "u_reveal", 1);
+
+    const bool hasVelocity = oitTarget.getNumColourAttachments() > 2;
+
+    if (hasVelocity)
+        oitTarget.bindColourTexture (2, 2);
+
+    setUniform1iIfPresent (oitCompositeProgram, "u_velocity", 2);
+    setUniform1iIfPresent (oitCompositeProgram, "u_hasVelocity", hasVelocity ? 1 : 0);
+
+    glDisable (GL_DEPTH_TEST);
+    glDepthMask (GL_FALSE);
     glEnable (GL_BLEND);
     glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    const auto viewProj = getViewProjectionMatrix();
-    setUniformMatrix4IfPresent (renderProgram, "u_viewProj", viewProj);
-    setUniform1fIfPresent (renderProgram, "u_pointSize", pointSize);
-    setUniform1iIfPresent (renderProgram, "u_shape", particleShape); // 0 square, 1 circle, 2 line, 3 cube
-    setUniform1fIfPresent (renderProgram, "u_alphaMul", alphaMul);
-
-    glDrawArrays (GL_POINTS, 0, currentParticleCount);
+    glDrawArrays (GL_TRIANGLES, 0, 3);
 
-    glBindVertexArray (0);
+    glActiveTexture (GL_TEXTURE2);
+    glBindTexture (GL_TEXTURE_2D, 0);
+    glActiveTexture (GL_TEXTURE1);
+    glBindTexture (GL_TEXTURE_2D, 0);
+    glActiveTexture (GL_TEXTURE0);
+    glBindTexture (GL_TEXTURE_2D, 0);
+    glEnable (GL_DEPTH_TEST);
 }
 
 //==============================================================================
@@ -946,7 +4391,21 @@ void MainComponent::mouseDrag (const juce::MouseEvent& e)
 void MainComponent::mouseWheelMove (const juce::MouseEvent&, const juce::MouseWheelDetails& wheel)
 {
     const float zoomFactor = 1.0f - (wheel.deltaY * 0.15f);
-    cameraDistance = juce::jlimit (2.0f, 200.0f, cameraDistance * zoomFactor);
+    cameraDistance = juce::jlimit (kMinCameraDistance, kMaxCameraDistance, cameraDistance * zoomFactor);
+}
+
+// Keys 1-9 switch to the first nine presets (in the panel's order), so a show can cut between looks without the mouse.
+bool MainComponent::keyPressed (const juce::KeyPress& key)
+{
+    const auto c = key.getTextCharacter();
+
+    if (c >= '1' && c <= '9' && ! key.getModifiers().isAnyModifierKeyDown())
+    {
+        applyPreset ((int) (c - '1'));
+        return true;
+    }
+
+    return false;
 }
 
 //==============================================================================
@@ -961,10 +4420,111 @@ MainComponent::BoidsControlPanel::BoidsControlPanel()
     wrapBoundsToggle.addListener (this);
     addAndMakeVisible (wrapBoundsToggle);
 
+    streamParticlesToggle.setToggleState (false, juce::dontSendNotification);
+    streamParticlesToggle.addListener (this);
+    addAndMakeVisible (streamParticlesToggle);
+
+    frustumCullToggle.setToggleState (true, juce::dontSendNotification);
+    frustumCullToggle.addListener (this);
+    addAndMakeVisible (frustumCullToggle);
+
     fullscreenToggle.setToggleState (false, juce::dontSendNotification);
     fullscreenToggle.addListener (this);
     addAndMakeVisible (fullscreenToggle);
 
+    hdrBloomToggle.setToggleState (false, juce::dontSendNotification);
+    hdrBloomToggle.addListener (this);
+    addAndMakeVisible (hdrBloomToggle);
+
+    tuneWorkgroupsButton.addListener (this);
+    addAndMakeVisible (tuneWorkgroupsButton);
+
+    deterministicToggle.setToggleState (false, juce::dontSendNotification);
+    deterministicToggle.addListener (this);
+    addAndMakeVisible (deterministicToggle);
+    restartFlockButton.addListener (this);
+    addAndMakeVisible (restartFlockButton);
+    benchmarkSortButton.addListener (this);
+    addAndMakeVisible (benchmarkSortButton);
+
+    saveSnapshotButton.addListener (this);
+    addAndMakeVisible (saveSnapshotButton);
+    loadSnapshotButton.addListener (this);
+    addAndMakeVisible (loadSnapshotButton);
+
+    // Item ids are SnapshotFile::Encoding + 1.
+    snapshotFormatBox.addItem ("Raw (exact, 48 B/boid)", 1);
+    snapshotFormatBox.addItem ("Compact (12 B/boid)", 2);
+    snapshotFormatBox.setSelectedId (1, juce::dontSendNotification);
+    addAndMakeVisible (snapshotFormatBox);
+
+    // Item ids are preset indices + 1 (see setPresetNames()).
+    presetBox.setTextWhenNothingSelected ("Preset");
+    presetBox.setTextWhenNoChoicesAvailable ("No presets");
+    presetBox.onChange = [this]
+    {
+        if (onPresetSelected != nullptr && presetBox.getSelectedId() > 0)
+            onPresetSelected (presetBox.getSelectedId() - 1);
+    };
+    addAndMakeVisible (presetBox);
+    savePresetButton.addListener (this);
+    addAndMakeVisible (savePresetButton);
+
+    openTimelineButton.addListener (this);
+    addAndMakeVisible (openTimelineButton);
+    stopTimelineButton.addListener (this);
+    addAndMakeVisible (stopTimelineButton);
+
+    oscToggle.setToggleState (false, juce::dontSendNotification);
+    oscToggle.addListener (this);
+    addAndMakeVisible (oscToggle);
+
+    audioInputToggle.setToggleState (false, juce::dontSendNotification);
+    audioInputToggle.addListener (this);
+    addAndMakeVisible (audioInputToggle);
+    openAudioFileButton.addListener (this);
+    addAndMakeVisible (openAudioFileButton);
+    stopAudioButton.addListener (this);
+    addAndMakeVisible (stopAudioButton);
+
+    recordToggle.setToggleState (false, juce::dontSendNotification);
+    recordToggle.addListener (this);
+    addAndMakeVisible (recordToggle);
+
+    // Item ids are TrajectoryFile::Encoding + 1.
+    recordFormatBox.addItem ("Raw (48 B/boid)", 1);
+    recordFormatBox.addItem ("Quantised + delta", 2);
+    recordFormatBox.addItem ("Compact + delta (no colour)", 3);
+    recordFormatBox.setSelectedId (2, juce::dontSendNotification);
+    addAndMakeVisible (recordFormatBox);
+
+    openRecordingButton.addListener (this);
+    addAndMakeVisible (openRecordingButton);
+    pausePlaybackToggle.setToggleState (false, juce::dontSendNotification);
+    pausePlaybackToggle.addListener (this);
+    addAndMakeVisible (pausePlaybackToggle);
+    stopPlaybackButton.addListener (this);
+    addAndMakeVisible (stopPlaybackButton);
+
+    exportToggle.setToggleState (false, juce::dontSendNotification);
+    exportToggle.addListener (this);
+    addAndMakeVisible (exportToggle);
+
+    // Item ids are FrameExporter::Format + 1.
+    exportFormatBox.addItem ("PNG sequence", 1);
+    exportFormatBox.addItem ("Raw video", 2);
+    exportFormatBox.setSelectedId (1, juce::dontSendNotification);
+    addAndMakeVisible (exportFormatBox);
+
+    // Item ids index the sizes in buttonClicked() (1 = the window's).
+    exportSizeBox.addItem ("Window size", 1);
+    exportSizeBox.addItem ("1280 x 720", 2);
+    exportSizeBox.addItem ("1920 x 1080", 3);
+    exportSizeBox.addItem ("2560 x 1440", 4);
+    exportSizeBox.addItem ("3840 x 2160", 5);
+    exportSizeBox.setSelectedId (3, juce::dontSendNotification);
+    addAndMakeVisible (exportSizeBox);
+
     auto initSlider = [this] (juce::Slider& s, double minV, double maxV, double step, const juce::String& suffix)
     {
         s.setRange (minV, maxV, step);
@@ -977,7 +4537,7 @@ MainComponent::BoidsControlPanel::BoidsControlPanel()
 
     particleCountLabel.setText ("Particles", juce::dontSendNotification);
     addAndMakeVisible (particleCountLabel);
-    initSlider (particleCountSlider, 1.0, 100000.0, 1.0, "");
+    initSlider (particleCountSlider, 1.0, (double) kMaxParticles, 1.0, "");
 
     neighborRadiusLabel.setText ("Neighbor r", juce::dontSendNotification);
     addAndMakeVisible (neighborRadiusLabel);
@@ -1035,15 +4595,74 @@ MainComponent::BoidsControlPanel::BoidsControlPanel()
     addAndMakeVisible (alphaLabel);
     initSlider (alphaSlider, 0.0, 1.0, 0.01, "");
 
+    bloomStrengthLabel.setText ("Bloom", juce::dontSendNotification);
+    addAndMakeVisible (bloomStrengthLabel);
+    initSlider (bloomStrengthSlider, 0.0, 2.0, 0.01, "");
+
+    exposureLabel.setText ("Exposure", juce::dontSendNotification);
+    addAndMakeVisible (exposureLabel);
+    initSlider (exposureSlider, 0.1, 4.0, 0.01, "");
+
+    trailLengthLabel.setText ("Trail length", juce::dontSendNotification);
+    addAndMakeVisible (trailLengthLabel);
+    initSlider (trailLengthSlider, 0.0, (double) kMaxTrailLength, 1.0, "");
+
+    trailStrideLabel.setText ("Trail stride", juce::dontSendNotification);
+    addAndMakeVisible (trailStrideLabel);
+    initSlider (trailStrideSlider, 1.0, (double) kMaxTrailStride, 1.0, " fr");
+
+    motionBlurLabel.setText ("Motion blur", juce::dontSendNotification);
+    addAndMakeVisible (motionBlurLabel);
+    initSlider (motionBlurSlider, 0.0, 1.0, 0.05, "");
+
+    drawBudgetLabel.setText ("Draw budget", juce::dontSendNotification);
+    addAndMakeVisible (drawBudgetLabel);
+    initSlider (drawBudgetSlider, 0.0, (double) kMaxDrawBudgetMs, 0.5, " ms");
+
+    seedLabel.setText ("Seed", juce::dontSendNotification);
+    addAndMakeVisible (seedLabel);
+    initSlider (seedSlider, 0.0, (double) kMaxSeed, 1.0, "");
+
+    playbackPositionLabel.setText ("Playback frame", juce::dontSendNotification);
+    addAndMakeVisible (playbackPositionLabel);
+    initSlider (playbackPositionSlider, 0.0, 1.0, 1.0, "");
+
+    playbackSpeedLabel.setText ("Playback speed", juce::dontSendNotification);
+    addAndMakeVisible (playbackSpeedLabel);
+    initSlider (playbackSpeedSlider, 0.1, 4.0, 0.05, "x");
+    playbackSpeedSlider.setSkewFactorFromMidPoint (1.0);
+    playbackSpeedSlider.setValue (1.0, juce::dontSendNotification);
+
+    setPlaybackLength (0);
+
     particleShapeLabel.setText ("Shape", juce::dontSendNotification);
     addAndMakeVisible (particleShapeLabel);
     particleShapeBox.addItem ("Square", 1);
     particleShapeBox.addItem ("Circle", 2);
     particleShapeBox.addItem ("Line", 3);
     particleShapeBox.addItem ("Cube", 4);
+    particleShapeBox.addItem ("Volume", 5);
     particleShapeBox.onChange = [this] { pendingAnyChange.store (true); };
     addAndMakeVisible (particleShapeBox);
 
+    rendererLabel.setText ("Renderer", juce::dontSendNotification);
+    addAndMakeVisible (rendererLabel);
+    rendererBox.addItem ("Points", 1);
+    rendererBox.addItem ("Quads (screen)", 2);
+    rendererBox.addItem ("Quads (velocity)", 3);
+    rendererBox.addItem ("Meshes (LOD)", 4);
+    rendererBox.onChange = [this] { pendingAnyChange.store (true); };
+    addAndMakeVisible (rendererBox);
+
+    transparencyLabel.setText ("Transparency", juce::dontSendNotification);
+    addAndMakeVisible (transparencyLabel);
+    transparencyBox.addItem ("Alpha (unsorted)", 1);
+    transparencyBox.addItem ("Weighted OIT", 2);
+    transparencyBox.addItem ("Sorted (back to front)", 3);
+    transparencyBox.addItem ("Additive", 4);
+    transparencyBox.onChange = [this] { pendingAnyChange.store (true); };
+    addAndMakeVisible (transparencyBox);
+
     colorModeLabel.setText ("Color mode", juce::dontSendNotification);
     addAndMakeVisible (colorModeLabel);
     colorModeBox.addItem ("Solid", 1);
@@ -1073,6 +4692,10 @@ MainComponent::BoidsControlPanel::BoidsControlPanel()
     addAndMakeVisible (densityCurveLabel);
     initSlider (densityCurveSlider, 0.1, 8.0, 0.01, "");
 
+    audioReactivityLabel.setText ("Audio reactivity", juce::dontSendNotification);
+    addAndMakeVisible (audioReactivityLabel);
+    initSlider (audioReactivitySlider, 0.0, 1.0, 0.01, "");
+
     fpsLabel.setText ("", juce::dontSendNotification);
     addAndMakeVisible (fpsLabel);
 
@@ -1085,7 +4708,28 @@ MainComponent::BoidsControlPanel::~BoidsControlPanel()
     particleCountSlider.removeListener (this);
     collapseButton.removeListener (this);
     wrapBoundsToggle.removeListener (this);
+    streamParticlesToggle.removeListener (this);
+    frustumCullToggle.removeListener (this);
     fullscreenToggle.removeListener (this);
+    hdrBloomToggle.removeListener (this);
+    tuneWorkgroupsButton.removeListener (this);
+    deterministicToggle.removeListener (this);
+    restartFlockButton.removeListener (this);
+    benchmarkSortButton.removeListener (this);
+    saveSnapshotButton.removeListener (this);
+    loadSnapshotButton.removeListener (this);
+    savePresetButton.removeListener (this);
+    openTimelineButton.removeListener (this);
+    stopTimelineButton.removeListener (this);
+    oscToggle.removeListener (this);
+    audioInputToggle.removeListener (this);
+    openAudioFileButton.removeListener (this);
+    stopAudioButton.removeListener (this);
+    recordToggle.removeListener (this);
+    openRecordingButton.removeListener (this);
+    pausePlaybackToggle.removeListener (this);
+    stopPlaybackButton.removeListener (this);
+    exportToggle.removeListener (this);
 
     neighborRadiusSlider.removeListener (this);
     separationRadiusSlider.removeListener (this);
@@ -1101,12 +4745,22 @@ MainComponent::BoidsControlPanel::~BoidsControlPanel()
     boundaryStrengthSlider.removeListener (this);
     pointSizeSlider.removeListener (this);
     alphaSlider.removeListener (this);
+    bloomStrengthSlider.removeListener (this);
+    exposureSlider.removeListener (this);
+    trailLengthSlider.removeListener (this);
+    trailStrideSlider.removeListener (this);
+    motionBlurSlider.removeListener (this);
+    drawBudgetSlider.removeListener (this);
+    seedSlider.removeListener (this);
+    playbackPositionSlider.removeListener (this);
+    playbackSpeedSlider.removeListener (this);
 
     hueOffsetSlider.removeListener (this);
     hueRangeSlider.removeListener (this);
     saturationSlider.removeListener (this);
     valueSlider.removeListener (this);
     densityCurveSlider.removeListener (this);
+    audioReactivitySlider.removeListener (this);
 }
 
 // Sets the callback that receives updated Params when the UI changes (called by MainComponent).
@@ -1120,6 +4774,262 @@ void MainComponent::BoidsControlPanel::setOnFullscreenChanged (std::function<voi
     onFullscreenChanged = std::move (cb);
 }
 
+void MainComponent::BoidsControlPanel::setOnTuneWorkgroupsRequested (std::function<void()> cb)
+{
+    onTuneWorkgroupsRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnBenchmarkSortRequested (std::function<void()> cb)
+{
+    onBenchmarkSortRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnRestartFlockRequested (std::function<void()> cb)
+{
+    onRestartFlockRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnSaveSnapshotRequested (std::function<void(SnapshotFile::Encoding)> cb)
+{
+    onSaveSnapshotRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnLoadSnapshotRequested (std::function<void()> cb)
+{
+    onLoadSnapshotRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setPresetNames (const juce::StringArray& names)
+{
+    presetBox.clear (juce::dontSendNotification);
+
+    for (int i = 0; i < names.size(); ++i)
+        presetBox.addItem (i < 9 ? juce::String (i + 1) + "  " + names[i] : names[i], i + 1);
+}
+
+void MainComponent::BoidsControlPanel::setSelectedPreset (int index)
+{
+    presetBox.setSelectedId (index + 1, juce::dontSendNotification);
+}
+
+void MainComponent::BoidsControlPanel::setOnPresetSelected (std::function<void(int)> cb)
+{
+    onPresetSelected = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnSavePresetRequested (std::function<void()> cb)
+{
+    onSavePresetRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnOpenTimelineRequested (std::function<void()> cb)
+{
+    onOpenTimelineRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnStopTimelineRequested (std::function<void()> cb)
+{
+    onStopTimelineRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnOscToggled (std::function<void(bool)> cb)
+{
+    onOscToggled = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOscListening (bool isListening, int port)
+{
+    oscToggle.setToggleState (isListening, juce::dontSendNotification);
+    oscToggle.setButtonText ("OSC input (UDP " + juce::String (port) + ")");
+}
+
+void MainComponent::BoidsControlPanel::setOnAudioInputToggled (std::function<void(bool)> cb)
+{
+    onAudioInputToggled = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnOpenAudioFileRequested (std::function<void()> cb)
+{
+    onOpenAudioFileRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnStopAudioRequested (std::function<void()> cb)
+{
+    onStopAudioRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setAudioInput (bool isListening)
+{
+    audioInputToggle.setToggleState (isListening, juce::dontSendNotification);
+}
+
+void MainComponent::BoidsControlPanel::setOnRecordingToggled (std::function<void(bool, TrajectoryFile::Encoding)> cb)
+{
+    onRecordingToggled = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setRecording (bool isRecording)
+{
+    recordToggle.setToggleState (isRecording, juce::dontSendNotification);
+    recordFormatBox.setEnabled (! isRecording);
+}
+
+void MainComponent::BoidsControlPanel::setOnOpenRecordingRequested (std::function<void()> cb)
+{
+    onOpenRecordingRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnStopPlaybackRequested (std::function<void()> cb)
+{
+    onStopPlaybackRequested = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnPlaybackChanged (std::function<void(bool, float)> cb)
+{
+    onPlaybackChanged = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setOnPlaybackSeek (std::function<void(int)> cb)
+{
+    onPlaybackSeek = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setPlaybackFrameSource (std::function<int()> source)
+{
+    playbackFrameSource = std::move (source);
+}
+
+// The transport controls are only live while a recording is playing.
+void MainComponent::BoidsControlPanel::setPlaybackLength (int numFrames)
+{
+    const bool playing = numFrames > 0;
+
+    playbackPositionSlider.setRange (0.0, (double) juce::jmax (1, numFrames - 1), 1.0);
+    playbackPositionSlider.setValue (0.0, juce::dontSendNotification);
+    playbackPositionSlider.setEnabled (playing);
+    pausePlaybackToggle.setEnabled (playing);
+    stopPlaybackButton.setEnabled (playing);
+}
+
+void MainComponent::BoidsControlPanel::setOnExportToggled (std::function<void(bool, FrameExporter::Format, juce::Point<int>)> cb)
+{
+    onExportToggled = std::move (cb);
+}
+
+void MainComponent::BoidsControlPanel::setExporting (bool isExporting)
+{
+    exportToggle.setToggleState (isExporting, juce::dontSendNotification);
+    exportFormatBox.setEnabled (! isExporting);
+    exportSizeBox.setEnabled (! isExporting);
+}
+
+// Every field by name, for snapshots and presets. Stored as plain JSON-compatible values so files stay readable across versions.
+juce::var MainComponent::BoidsControlPanel::Params::toVar() const
+{
+    auto* object = new juce::DynamicObject(); // floats go in as double: var has no float constructor
+
+    object->setProperty ("particleCount", particleCount);
+    object->setProperty ("neighborRadius", (double) neighborRadius);
+    object->setProperty ("separationRadius", (double) separationRadius);
+    object->setProperty ("weightSeparation", (double) weightSeparation);
+    object->setProperty ("weightAlignment", (double) weightAlignment);
+    object->setProperty ("weightCohesion", (double) weightCohesion);
+    object->setProperty ("minSpeed", (double) minSpeed);
+    object->setProperty ("maxSpeed", (double) maxSpeed);
+    object->setProperty ("maxAccel", (double) maxAccel);
+    object->setProperty ("simSpeed", (double) simSpeed);
+    object->setProperty ("centerAttraction", (double) centerAttraction);
+    object->setProperty ("boundaryMargin", (double) boundaryMargin);
+    object->setProperty ("boundaryStrength", (double) boundaryStrength);
+    object->setProperty ("wrapBounds", wrapBounds);
+    object->setProperty ("streamParticles", streamParticles);
+    object->setProperty ("frustumCull", frustumCull);
+    object->setProperty ("pointSize", (double) pointSize);
+    object->setProperty ("alphaMul", (double) alphaMul);
+    object->setProperty ("particleShape", particleShape);
+    object->setProperty ("particleRenderer", particleRenderer);
+    object->setProperty ("transparencyMode", transparencyMode);
+    object->setProperty ("hdrBloom", hdrBloom);
+    object->setProperty ("bloomStrength", (double) bloomStrength);
+    object->setProperty ("exposure", (double) exposure);
+    object->setProperty ("trailLength", trailLength);
+    object->setProperty ("trailStride", trailStride);
+    object->setProperty ("motionBlur", (double) motionBlur);
+    object->setProperty ("drawBudgetMs", (double) drawBudgetMs);
+    object->setProperty ("deterministic", deterministic);
+    object->setProperty ("seed", seed);
+    object->setProperty ("colorMode", colorMode);
+    object->setProperty ("hueOffset", (double) hueOffset);
+    object->setProperty ("hueRange", (double) hueRange);
+    object->setProperty ("saturation", (double) saturation);
+    object->setProperty ("value", (double) value);
+    object->setProperty ("densityCurve", (double) densityCurve);
+    object->setProperty ("audioReactivity", (double) audioReactivity);
+
+    return juce::var (object);
+}
+
+MainComponent::BoidsControlPanel::Params MainComponent::BoidsControlPanel::Params::fromVar (const juce::var& v)
+{
+    return fromVar (v, Params());
+}
+
+// Fields missing from v (older files, partial presets) keep their value in base; the caller clamps as usual.
+MainComponent::BoidsControlPanel::Params MainComponent::BoidsControlPanel::Params::fromVar (const juce::var& v, Params base)
+{
+    auto p = base;
+
+    auto* object = v.getDynamicObject();
+    if (object == nullptr)
+        return p;
+
+    auto read = [object] (const char* name, auto& field)
+    {
+        if (object->hasProperty (name))
+            field = static_cast<std::decay_t<decltype (field)>> (object->getProperty (name));
+    };
+
+    read ("particleCount", p.particleCount);
+    read ("neighborRadius", p.neighborRadius);
+    read ("separationRadius", p.separationRadius);
+    read ("weightSeparation", p.weightSeparation);
+    read ("weightAlignment", p.weightAlignment);
+    read ("weightCohesion", p.weightCohesion);
+    read ("minSpeed", p.minSpeed);
+    read ("maxSpeed", p.maxSpeed);
+    read ("maxAccel", p.maxAccel);
+    read ("simSpeed", p.simSpeed);
+    read ("centerAttraction", p.centerAttraction);
+    read ("boundaryMargin", p.boundaryMargin);
+    read ("boundaryStrength", p.boundaryStrength);
+    read ("wrapBounds", p.wrapBounds);
+    read ("streamParticles", p.streamParticles);
+    read ("frustumCull", p.frustumCull);
+    read ("pointSize", p.pointSize);
+    read ("alphaMul", p.alphaMul);
+    read ("particleShape", p.particleShape);
+    read ("particleRenderer", p.particleRenderer);
+    read ("transparencyMode", p.transparencyMode);
+    read ("hdrBloom", p.hdrBloom);
+    read ("bloomStrength", p.bloomStrength);
+    read ("exposure", p.exposure);
+    read ("trailLength", p.trailLength);
+    read ("trailStride", p.trailStride);
+    read ("motionBlur", p.motionBlur);
+    read ("drawBudgetMs", p.drawBudgetMs);
+    read ("deterministic", p.deterministic);
+    read ("seed", p.seed);
+    read ("colorMode", p.colorMode);
+    read ("hueOffset", p.hueOffset);
+    read ("hueRange", p.hueRange);
+    read ("saturation", p.saturation);
+    read ("value", p.value);
+    read ("densityCurve", p.densityCurve);
+    read ("audioReactivity", p.audioReactivity);
+
+    return p;
+}
+
 // Updates the UI controls to match the provided Params without triggering notifications (sync UI from simulation state).
 void MainComponent::BoidsControlPanel::setParams (Params p)
 {
@@ -1137,11 +5047,24 @@ void MainComponent::BoidsControlPanel::setParams (Params p)
     boundaryMarginSlider.setValue ((double) p.boundaryMargin, juce::dontSendNotification);
     boundaryStrengthSlider.setValue ((double) p.boundaryStrength, juce::dontSendNotification);
     wrapBoundsToggle.setToggleState (p.wrapBounds, juce::dontSendNotification);
+    streamParticlesToggle.setToggleState (p.streamParticles, juce::dontSendNotification);
+    frustumCullToggle.setToggleState (p.frustumCull, juce::dontSendNotification);
     pointSizeSlider.setValue ((double) p.pointSize, juce::dontSendNotification);
     alphaSlider.setValue ((double) p.alphaMul, juce::dontSendNotification);
+    hdrBloomToggle.setToggleState (p.hdrBloom, juce::dontSendNotification);
+    bloomStrengthSlider.setValue ((double) p.bloomStrength, juce::dontSendNotification);
+    exposureSlider.setValue ((double) p.exposure, juce::dontSendNotification);
+    trailLengthSlider.setValue ((double) p.trailLength, juce::dontSendNotification);
+    trailStrideSlider.setValue ((double) p.trailStride, juce::dontSendNotification);
+    motionBlurSlider.setValue ((double) p.motionBlur, juce::dontSendNotification);
+    drawBudgetSlider.setValue ((double) p.drawBudgetMs, juce::dontSendNotification);
+    deterministicToggle.setToggleState (p.deterministic, juce::dontSendNotification);
+    seedSlider.setValue ((double) p.seed, juce::dontSendNotification);
 
     // ComboBox item ids start at 1, map shape 0..3 => 1..4
-    particleShapeBox.setSelectedId (juce::jlimit (1, 4, p.particleShape + 1), juce::dontSendNotification);
+    particleShapeBox.setSelectedId (juce::jlimit (1, 5, p.particleShape + 1), juce::dontSendNotification);
+    rendererBox.setSelectedId (juce::jlimit (1, 4, p.particleRenderer + 1), juce::dontSendNotification);
+    transparencyBox.setSelectedId (juce::jlimit (1, 4, p.transparencyMode + 1), juce::dontSendNotification);
 
     // ComboBox item ids start at 1, map mode 0..3 => 1..4
     colorModeBox.setSelectedId (juce::jlimit (1, 4, p.colorMode + 1), juce::dontSendNotification);
@@ -1150,6 +5073,7 @@ void MainComponent::BoidsControlPanel::setParams (Params p)
     saturationSlider.setValue ((double) p.saturation, juce::dontSendNotification);
     valueSlider.setValue ((double) p.value, juce::dontSendNotification);
     densityCurveSlider.setValue ((double) p.densityCurve, juce::dontSendNotification);
+    audioReactivitySlider.setValue ((double) p.audioReactivity, juce::dontSendNotification);
 }
 
 // Updates the FPS label text (called from MainComponent via MessageManager::callAsync()).
@@ -1177,11 +5101,25 @@ void MainComponent::BoidsControlPanel::paint (juce::Graphics& g)
 // Marks that some slider changed; actual Params emission is debounced in this panel's timerCallback().
 void MainComponent::BoidsControlPanel::sliderValueChanged (juce::Slider* s)
 {
-    juce::ignoreUnused (s);
+    // The transport isn't part of Params: it goes straight to the player, undebounced.
+    if (s == &playbackPositionSlider)
+    {
+        if (onPlaybackSeek != nullptr)
+            onPlaybackSeek ((int) playbackPositionSlider.getValue());
+        return;
+    }
+
+    if (s == &playbackSpeedSlider)
+    {
+        if (onPlaybackChanged != nullptr)
+            onPlaybackChanged (pausePlaybackToggle.getToggleState(), (float) playbackSpeedSlider.getValue());
+        return;
+    }
+
     pendingAnyChange.store (true);
 }
 
-// Handles toggle/button actions (collapse and wrap bounds) and marks pending changes for debounce.
+// Handles toggle/button actions (collapse, wrap bounds, streaming, culling) and marks pending changes for debounce.
 void MainComponent::BoidsControlPanel::buttonClicked (juce::Button* b)
 {
     if (b == &collapseButton)
@@ -1191,7 +5129,8 @@ void MainComponent::BoidsControlPanel::buttonClicked (juce::Button* b)
         return;
     }
 
-    if (b == &wrapBoundsToggle)
+    if (b == &wrapBoundsToggle || b == &streamParticlesToggle || b == &frustumCullToggle || b == &hdrBloomToggle
+        || b == &deterministicToggle)
     {
         pendingAnyChange.store (true);
         return;
@@ -1203,17 +5142,143 @@ void MainComponent::BoidsControlPanel::buttonClicked (juce::Button* b)
             onFullscreenChanged (fullscreenToggle.getToggleState());
         return;
     }
+
+    if (b == &restartFlockButton)
+    {
+        if (onRestartFlockRequested != nullptr)
+            onRestartFlockRequested();
+        return;
+    }
+
+    if (b == &tuneWorkgroupsButton)
+    {
+        if (onTuneWorkgroupsRequested != nullptr)
+            onTuneWorkgroupsRequested();
+        return;
+    }
+
+    if (b == &benchmarkSortButton)
+    {
+        if (onBenchmarkSortRequested != nullptr)
+            onBenchmarkSortRequested();
+        return;
+    }
+
+    if (b == &saveSnapshotButton)
+    {
+        if (onSaveSnapshotRequested != nullptr)
+            onSaveSnapshotRequested ((SnapshotFile::Encoding) juce::jlimit (0, 1, snapshotFormatBox.getSelectedId() - 1));
+        return;
+    }
+
+    if (b == &loadSnapshotButton)
+    {
+        if (onLoadSnapshotRequested != nullptr)
+            onLoadSnapshotRequested();
+        return;
+    }
+
+    if (b == &savePresetButton)
+    {
+        if (onSavePresetRequested != nullptr)
+            onSavePresetRequested();
+        return;
+    }
+
+    if (b == &openTimelineButton || b == &stopTimelineButton)
+    {
+        auto& callback = (b == &openTimelineButton) ? onOpenTimelineRequested : onStopTimelineRequested;
+        if (callback != nullptr)
+            callback();
+        return;
+    }
+
+    if (b == &oscToggle)
+    {
+        if (onOscToggled != nullptr)
+            onOscToggled (oscToggle.getToggleState());
+        return;
+    }
+
+    if (b == &audioInputToggle)
+    {
+        if (onAudioInputToggled != nullptr)
+            onAudioInputToggled (audioInputToggle.getToggleState());
+        return;
+    }
+
+    if (b == &openAudioFileButton || b == &stopAudioButton)
+    {
+        auto& callback = (b == &openAudioFileButton) ? onOpenAudioFileRequested : onStopAudioRequested;
+        if (callback != nullptr)
+            callback();
+        return;
+    }
+
+    if (b == &openRecordingButton || b == &stopPlaybackButton)
+    {
+        auto& callback = (b == &openRecordingButton) ? onOpenRecordingRequested : onStopPlaybackRequested;
+        if (callback != nullptr)
+            callback();
+        return;
+    }
+
+    if (b == &pausePlaybackToggle)
+    {
+        if (onPlaybackChanged != nullptr)
+            onPlaybackChanged (pausePlaybackToggle.getToggleState(), (float) playbackSpeedSlider.getValue());
+        return;
+    }
+
+    if (b == &recordToggle)
+    {
+        const bool shouldRecord = recordToggle.getToggleState();
+        recordFormatBox.setEnabled (! shouldRecord);
+
+        if (onRecordingToggled != nullptr)
+            onRecordingToggled (shouldRecord, (TrajectoryFile::Encoding) juce::jlimit (0, 2, recordFormatBox.getSelectedId() - 1));
+        return;
+    }
+
+    if (b == &exportToggle)
+    {
+        const bool shouldExport = exportToggle.getToggleState();
+        exportFormatBox.setEnabled (! shouldExport);
+        exportSizeBox.setEnabled (! shouldExport);
+
+        // Window size is passed as 0 x 0 and resolved on the GL thread.
+        static const juce::Point<int> sizes[] = { { 0, 0 }, { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+        const auto size = sizes[juce::jlimit (0, 4, exportSizeBox.getSelectedId() - 1)];
+
+        if (onExportToggled != nullptr)
+            onExportToggled (shouldExport, (FrameExporter::Format) juce::jlimit (0, 1, exportFormatBox.getSelectedId() - 1), size);
+        return;
+    }
 }
 
 // Debounce tick (~10Hz): if any control changed, gathers Params and calls onParamsChanged.
 void MainComponent::BoidsControlPanel::timerCallback()
 {
+    // Follow the playhead, unless the user is dragging it.
+    if (playbackFrameSource != nullptr && ! playbackPositionSlider.isMouseButtonDown())
+    {
+        const auto frame = playbackFrameSource();
+        if (frame >= 0)
+            playbackPositionSlider.setValue ((double) frame, juce::dontSendNotification);
+    }
+
     if (! pendingAnyChange.exchange (false))
         return;
 
     if (onParamsChanged == nullptr)
         return;
 
+    onParamsChanged (getParams());
+}
+
+// Gathers Params from the current state of every control.
+MainComponent::BoidsControlPanel::Params MainComponent::BoidsControlPanel::getParams() const
+{
     Params p;
     p.particleCount = (int) particleCountSlider.getValue();
     p.neighborRadius = (float) neighborRadiusSlider.getValue();
@@ -1229,10 +5294,23 @@ void MainComponent::BoidsControlPanel::timerCallback()
     p.boundaryMargin = (float) boundaryMarginSlider.getValue();
     p.boundaryStrength = (float) boundaryStrengthSlider.getValue();
     p.wrapBounds = wrapBoundsToggle.getToggleState();
+    p.streamParticles = streamParticlesToggle.getToggleState();
+    p.frustumCull = frustumCullToggle.getToggleState();
     p.pointSize = (float) pointSizeSlider.getValue();
     p.alphaMul = (float) alphaSlider.getValue();
-
-    p.particleShape = juce::jlimit (0, 3, particleShapeBox.getSelectedId() - 1);
+    p.hdrBloom = hdrBloomToggle.getToggleState();
+    p.bloomStrength = (float) bloomStrengthSlider.getValue();
+    p.exposure = (float) exposureSlider.getValue();
+    p.trailLength = juce::roundToInt (trailLengthSlider.getValue());
+    p.trailStride = juce::roundToInt (trailStrideSlider.getValue());
+    p.motionBlur = (float) motionBlurSlider.getValue();
+    p.drawBudgetMs = (float) drawBudgetSlider.getValue();
+    p.deterministic = deterministicToggle.getToggleState();
+    p.seed = juce::roundToInt (seedSlider.getValue());
+
+    p.particleShape = juce::jlimit (0, 4, particleShapeBox.getSelectedId() - 1);
+    p.particleRenderer = juce::jlimit (0, 3, rendererBox.getSelectedId() - 1);
+    p.transparencyMode = juce::jlimit (0, 3, transparencyBox.getSelectedId() - 1);
 
     p.colorMode = juce::jlimit (0, 3, colorModeBox.getSelectedId() - 1);
     p.hueOffset = (float) hueOffsetSlider.getValue();
@@ -1240,8 +5318,9 @@ void MainComponent::BoidsControlPanel::timerCallback()
     p.saturation = (float) saturationSlider.getValue();
     p.value = (float) valueSlider.getValue();
     p.densityCurve = (float) densityCurveSlider.getValue();
+    p.audioReactivity = (float) audioReactivitySlider.getValue();
 
-    onParamsChanged (p);
+    return p;
 }
 
 // Lays out the controls and manages collapsed state; also resizes the panel height to fit visible content.
@@ -1254,9 +5333,18 @@ void MainComponent::BoidsControlPanel::updateLayout()
     const int headerH = rowH;
     const int wrapH = rowH;
     const int fullscreenH = rowH;
+    const int deterministicH = rowH;
+    const int snapshotH = rowH;
+    const int presetH = rowH;
+    const int timelineH = rowH;
+    const int oscH = rowH;
+    const int audioH = rowH;
+    const int recordH = rowH;
+    const int playbackH = rowH;
+    const int exportH = rowH;
     const int fpsH = 20;
 
-    const int sliderRows = 22; // includes combo rows (shape + color) and color sliders
+    const int sliderRows = 34; // includes combo rows (shape + renderer + transparency + color), bloom/exposure, trails, motion blur, draw budget, seed, playback, color and audio sliders
 
     const int expandedContentH =
         headerH
@@ -1265,6 +5353,24 @@ void MainComponent::BoidsControlPanel::updateLayout()
         + rowGap
         + fullscreenH
         + rowGap
+        + deterministicH
+        + rowGap
+        + snapshotH
+        + rowGap
+        + presetH
+        + rowGap
+        + timelineH
+        + rowGap
+        + oscH
+        + rowGap
+        + audioH
+        + rowGap
+        + recordH
+        + rowGap
+        + playbackH
+        + rowGap
+        + exportH
+        + rowGap
         + sliderRows * (rowH + rowGap)
         + fpsH;
 
@@ -1293,10 +5399,101 @@ void MainComponent::BoidsControlPanel::updateLayout()
     for (auto* c : getChildren())
         c->setVisible (true);
 
-    wrapBoundsToggle.setBounds (r.removeFromTop (22));
+    {
+        // Wrap bounds, CPU streaming and culling share a row.
+        auto area = r.removeFromTop (22);
+        const int third = area.getWidth() / 3;
+        wrapBoundsToggle.setBounds (area.removeFromLeft (third));
+        streamParticlesToggle.setBounds (area.removeFromLeft (third));
+        frustumCullToggle.setBounds (area);
+    }
+    r.removeFromTop (6);
+
+    {
+        // Fullscreen, HDR and the on-demand workgroup tuner share a row.
+        auto area = r.removeFromTop (22);
+        const int third = area.getWidth() / 3;
+        fullscreenToggle.setBounds (area.removeFromLeft (third));
+        hdrBloomToggle.setBounds (area.removeFromLeft (third));
+        tuneWorkgroupsButton.setBounds (area);
+    }
+    r.removeFromTop (6);
+
+    {
+        // Deterministic mode, the flock restart and the sort benchmark share a row (the seed is a slider row below).
+        auto area = r.removeFromTop (22);
+        const int third = area.getWidth() / 3;
+        deterministicToggle.setBounds (area.removeFromLeft (third));
+        restartFlockButton.setBounds (area.removeFromLeft (third).reduced (2, 0));
+        benchmarkSortButton.setBounds (area.reduced (2, 0));
+    }
+    r.removeFromTop (6);
+
+    {
+        // Snapshot save/load and the save format share a row.
+        auto area = r.removeFromTop (22);
+        const int third = area.getWidth() / 3;
+        saveSnapshotButton.setBounds (area.removeFromLeft (third).reduced (2, 0));
+        loadSnapshotButton.setBounds (area.removeFromLeft (third).reduced (2, 0));
+        snapshotFormatBox.setBounds (area.reduced (2, 0));
+    }
+    r.removeFromTop (6);
+
+    {
+        // Preset picker and preset save share a row.
+        auto area = r.removeFromTop (22);
+        presetBox.setBounds (area.removeFromLeft (area.getWidth() * 2 / 3).reduced (2, 0));
+        savePresetButton.setBounds (area.reduced (2, 0));
+    }
+    r.removeFromTop (6);
+
+    {
+        // Parameter timeline start/stop share a row.
+        auto area = r.removeFromTop (22);
+        openTimelineButton.setBounds (area.removeFromLeft (area.getWidth() / 2).reduced (2, 0));
+        stopTimelineButton.setBounds (area.reduced (2, 0));
+    }
+    r.removeFromTop (6);
+
+    oscToggle.setBounds (r.removeFromTop (22));
+    r.removeFromTop (6);
+
+    {
+        // Audio input, audio file analysis and stop share a row (the depth is a slider row below).
+        auto area = r.removeFromTop (22);
+        const int third = area.getWidth() / 3;
+        audioInputToggle.setBounds (area.removeFromLeft (third));
+        openAudioFileButton.setBounds (area.removeFromLeft (third).reduced (2, 0));
+        stopAudioButton.setBounds (area.reduced (2, 0));
+    }
+    r.removeFromTop (6);
+
+    {
+        // Trajectory recording and its format share a row.
+        auto area = r.removeFromTop (22);
+        recordToggle.setBounds (area.removeFromLeft (area.getWidth() / 2));
+        recordFormatBox.setBounds (area.reduced (2, 0));
+    }
+    r.removeFromTop (6);
+
+    {
+        // Playback transport shares a row.
+        auto area = r.removeFromTop (22);
+        const int third = area.getWidth() / 3;
+        openRecordingButton.setBounds (area.removeFromLeft (third).reduced (2, 0));
+        pausePlaybackToggle.setBounds (area.removeFromLeft (third).reduced (2, 0));
+        stopPlaybackButton.setBounds (area.reduced (2, 0));
+    }
     r.removeFromTop (6);
 
-    fullscreenToggle.setBounds (r.removeFromTop (22));
+    {
+        // Frame export, its format and size share a row.
+        auto area = r.removeFromTop (22);
+        const int third = area.getWidth() / 3;
+        exportToggle.setBounds (area.removeFromLeft (third));
+        exportFormatBox.setBounds (area.removeFromLeft (third).reduced (2, 0));
+        exportSizeBox.setBounds (area.reduced (2, 0));
+    }
     r.removeFromTop (6);
 
     auto row = [&r] { auto x = r.removeFromTop (22); r.removeFromTop (4); return x; };
@@ -1322,6 +5519,15 @@ void MainComponent::BoidsControlPanel::updateLayout()
     place (boundaryStrengthLabel, boundaryStrengthSlider, row());
     place (pointSizeLabel, pointSizeSlider, row());
     place (alphaLabel, alphaSlider, row());
+    place (bloomStrengthLabel, bloomStrengthSlider, row());
+    place (exposureLabel, exposureSlider, row());
+    place (trailLengthLabel, trailLengthSlider, row());
+    place (trailStrideLabel, trailStrideSlider, row());
+    place (motionBlurLabel, motionBlurSlider, row());
+    place (drawBudgetLabel, drawBudgetSlider, row());
+    place (seedLabel, seedSlider, row());
+    place (playbackPositionLabel, playbackPositionSlider, row());
+    place (playbackSpeedLabel, playbackSpeedSlider, row());
 
     // Combo row for particle shape
     {
@@ -1330,6 +5536,20 @@ void MainComponent::BoidsControlPanel::updateLayout()
         particleShapeBox.setBounds (area);
     }
 
+    // Combo row for the render path
+    {
+        auto area = row();
+        rendererLabel.setBounds (area.removeFromLeft (110));
+        rendererBox.setBounds (area);
+    }
+
+    // Combo row for translucency handling
+    {
+        auto area = row();
+        transparencyLabel.setBounds (area.removeFromLeft (110));
+        transparencyBox.setBounds (area);
+    }
+
     // Combo row for color mode
     {
         auto area = row();
@@ -1342,6 +5562,7 @@ void MainComponent::BoidsControlPanel::updateLayout()
     place (saturationLabel, saturationSlider, row());
     place (valueLabel, valueSlider, row());
     place (densityCurveLabel, densityCurveSlider, row());
+    place (audioReactivityLabel, audioReactivitySlider, row());
 
     fpsLabel.setBounds (r.removeFromTop (20));
 }
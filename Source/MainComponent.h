@@ -2,6 +2,21 @@
 
 #include <JuceHeader.h>
 
+#include <deque>
+#include <map>
+
+#include "AudioAnalyser.h"
+#include "FrameExporter.h"
+#include "GLRenderTarget.h"
+#include "GpuTimer.h"
+#include "OscControl.h"
+#include "ParamTimeline.h"
+#include "ParticleStream.h"
+#include "PresetFile.h"
+#include "SnapshotFile.h"
+#include "TrajectoryPlayer.h"
+#include "TrajectoryRecorder.h"
+
 //==============================================================================
 class MainComponent : public juce::OpenGLAppComponent,
                       private juce::Timer
@@ -24,26 +39,113 @@ public:
     void mouseDown (const juce::MouseEvent& e) override;
     void mouseDrag (const juce::MouseEvent& e) override;
     void mouseWheelMove (const juce::MouseEvent& e, const juce::MouseWheelDetails& wheel) override;
+    bool keyPressed (const juce::KeyPress& key) override;
+
+    /** Starts a frame export with the first rendered frame and quits the app once it has finished (command line). */
+    void exportOnLaunch (const FrameExporter::Settings& settings);
+
+    /** Switches to deterministic mode with the given seed before the first frame (command line). */
+    void runDeterministicOnLaunch (int seed);
+
+    /** Starts the parameter timeline in file with the first frame (command line). Returns false if it can't be read. */
+    bool runTimelineOnLaunch (const juce::File& file);
+
+    /** Starts OSC input on a UDP port (command line). Returns false if the port can't be opened. */
+    bool listenForOscOnLaunch (int port);
+
+    /** Starts audio-reactive modulation from an audio file, analysed at real-time pace and looped (command line). */
+    bool analyseAudioFileOnLaunch (const juce::File& file);
 
 private:
     //==============================================================================
     void timerCallback() override;
 
+    static juce::File findRuntimeDirectory (const juce::String& name);
     juce::File getShadersDirectory() const;
+    juce::File getPresetsDirectory() const;
+    juce::File getTimelinesDirectory() const;
+    juce::Array<juce::File> getShaderFiles() const;
 
     // Shader management (compute + render)
     bool reloadAllShadersOnGLThread();
-    bool compileComputeProgramFromFile (juce::File file, unsigned int& outProgram, juce::String& outError);
+    bool reloadSimulationProgramsOnGLThread();
+    bool compileComputeProgramFromFile (juce::File file, unsigned int& outProgram, juce::String& outError,
+                                        const juce::StringArray& defines = {});
     bool compileRenderProgramFromFiles (juce::File vertexFile, juce::File fragmentFile, unsigned int& outProgram, juce::String& outError);
     void deletePrograms();
+    void deleteSimulationPrograms();
 
     // GL + simulation
     void ensureGL43CoreContext();
     bool checkGLCapabilitiesOnGLThread();
     void rebuildBuffersOnGLThread (int newParticleCount);
+    void resizeParticleBuffersOnGLThread (int newParticleCount);
+    void restartFlockOnGLThread();
+    void rebuildGridOnGLThread();
     void deleteBuffers();
-    void dispatchComputePasses (float dtSeconds);
+    void uploadToBufferOnGLThread (unsigned int buffer, size_t offset, size_t numBytes,
+                                   const std::function<void (void*)>& writeData);
+    void streamParticlesOnGLThread();
+    void saveSnapshotAsync (SnapshotFile::Encoding encoding);
+    void loadSnapshotAsync();
+    juce::File getSnapshotDirectory() const;
+    static void showError (const juce::String& title, const juce::String& message);
+    void fillSnapshotHeaderOnGLThread (SnapshotFile& snapshot) const;
+    unsigned int packSnapshotOnGLThread (const SnapshotFile& snapshot);
+    void readSnapshotSynchronouslyOnGLThread();
+    void writeSnapshotInBackground();
+    void rescanPresets();
+    void applyPreset (int index);
+    void savePresetAsync();
+    std::shared_ptr<ParamTimeline> readTimeline (const juce::File& file, juce::String& error) const;
+    void openTimelineAsync();
+    void startTimelineOnGLThread (std::shared_ptr<ParamTimeline> newTimeline);
+    void stopTimelineOnGLThread();
+    void advanceTimelineOnGLThread();
+    void startRecordingAsync (TrajectoryFile::Encoding encoding);
+    void startRecordingOnGLThread (const juce::File& file, TrajectoryFile::Encoding encoding);
+    void stopRecordingOnGLThread();
+    void openRecordingAsync();
+    void startPlaybackOnGLThread (std::shared_ptr<TrajectoryPlayer> player);
+    void stopPlaybackOnGLThread();
+    void advancePlaybackOnGLThread (float dtSeconds);
+    void startExportAsync (FrameExporter::Format format, juce::Point<int> size);
+    void startExportOnGLThread (FrameExporter::Settings settings);
+    void stopExportOnGLThread();
+    void presentExportFrameOnGLThread (unsigned int windowFrameBuffer, int windowWidth, int windowHeight);
+    void updateFloatingOriginOnGLThread();
+    void updateRenderScaleOnGLThread();
+    bool cullParticlesOnGLThread (const juce::Matrix3D<float>& viewProj, int viewportWidth, int viewportHeight, bool lodBins);
+    bool sortVisibleOnGLThread (const juce::Matrix3D<float>& viewProj, bool lodBins);
+    void dispatchSortPassesOnGLThread (const unsigned int keys[2], unsigned int values, int valuesOffset,
+                                       unsigned int scratchValues, int countIndex, int numTiles);
+    void startSortBenchmarkOnGLThread();
+    void runSortBenchmarkFrameOnGLThread();
+    void releaseSortBenchmarkOnGLThread();
+    void drawLodMeshesOnGLThread (const juce::Matrix3D<float>& viewProj, float timeSeconds);
+    bool beginOitPassOnGLThread (int viewportWidth, int viewportHeight,
+                                 const juce::Matrix3D<float>* meshViewProj, float meshTimeSeconds, bool withVelocity);
+    void compositeOitOnGLThread();
+    bool beginHdrSceneOnGLThread (int viewportWidth, int viewportHeight, bool withVelocity);
+    void resolveHdrSceneOnGLThread (int outputWidth, int outputHeight);
+    void releaseHdrTargetsOnGLThread();
+    void setVelocityUniforms (unsigned int program) const;
+    void drawParticlesOnGLThread (const juce::Matrix3D<float>& viewProj, int viewportWidth, int viewportHeight,
+                                  bool culled, bool useMeshes, bool useOit, bool sorted);
+    void drawDensityVolumeOnGLThread (const juce::Matrix3D<float>& viewProj);
+    void recordTrailsOnGLThread();
+    void drawTrailsOnGLThread (const juce::Matrix3D<float>& viewProj);
+    void releaseTrailHistoryOnGLThread();
+    juce::Vector3D<float> toOriginRelative (juce::Vector3D<float> worldPoint) const;
+    juce::Vector3D<double> getCameraFocus() const;
+    void dispatchComputePasses (float dtSeconds, const unsigned int* passTimerQueries = nullptr, bool recolourOnly = false);
+    bool runWorkgroupTunerOnGLThread();
+    bool loadWorkgroupConfig();
+    void saveWorkgroupConfig();
+    juce::Matrix3D<float> getProjectionMatrix() const;
     juce::Matrix3D<float> getViewProjectionMatrix() const;
+    float getQuadWorldSize() const;
+    float getMeshWorldSize() const;
 
     // UI
     class BoidsControlPanel final : public juce::Component,
@@ -68,12 +170,42 @@ private:
             float boundaryMargin = 5.0f;
             float boundaryStrength = 10.0f;
             bool wrapBounds = false;
+            bool streamParticles = false; // read the flock back to the CPU every frame (analytics / recorders)
+            bool frustumCull = true;      // GPU culling + indirect draw of only the visible particles
             float pointSize = 1.0f;
             float alphaMul = 0.65f;
 
             // Rendering
-            // 0 square, 1 circle, 2 line (screen-facing, aligned to velocity), 3 cube (fake shaded sprite)
+            // 0 square, 1 circle, 2 line (screen-facing, aligned to velocity), 3 cube (fake shaded sprite),
+            // 4 volume (grid density raymarch instead of per-particle sprites; ignores renderer/transparency)
             int particleShape = 1;
+            // 0 point sprites, 1 instanced quads (screen-aligned), 2 instanced quads (velocity-aligned),
+            // 3 instanced meshes with distance LOD (bird / tetrahedron / point)
+            int particleRenderer = 0;
+            // 0 straight alpha blending in buffer order, 1 weighted blended order-independent transparency,
+            // 2 straight alpha over a GPU depth sort (back to front), 3 additive
+            int transparencyMode = 0;
+
+            // HDR scene target + bloom + tone mapping
+            bool hdrBloom = false;
+            float bloomStrength = 0.6f;
+            float exposure = 1.0f;
+
+            // Motion trails: trailLength segments per boid (0 = off), from its live position back through the last
+            // trailLength sampled positions, one sample every trailStride frames
+            int trailLength = 0;
+            int trailStride = 2;
+
+            // Motion blur: fraction of the frame the virtual shutter is open (0 = off, 0.5 = 180 degrees)
+            float motionBlur = 0.0f;
+
+            // Dynamic resolution: GPU draw time to hold by scaling the scene resolution (0 = off, always full size)
+            float drawBudgetMs = 0.0f;
+
+            // Deterministic mode: fixed time step, a flock seeded from `seed`, order-independent neighbour sums.
+            // Turning it on, or changing the seed while it's on, restarts the flock, so the run replays bit for bit.
+            bool deterministic = false;
+            int seed = 1;
 
             // Coloring
             int colorMode = 1;          // 0 solid, 1 heading, 2 speed, 3 density
@@ -82,6 +214,13 @@ private:
             float saturation = 0.4f;    // 0..1
             float value = 1.0f;         // 0..1
             float densityCurve = 1.0f;  // >0, applied as pow(t, densityCurve)
+
+            // Audio-reactive modulation depth (0 = none), while an audio input or file is being analysed
+            float audioReactivity = 0.5f;
+
+            juce::var toVar() const;                    // every field by name (snapshots, presets)
+            static Params fromVar (const juce::var& v);              // missing fields keep their defaults
+            static Params fromVar (const juce::var& v, Params base); // missing fields keep their value in base
         };
 
         BoidsControlPanel();
@@ -91,9 +230,37 @@ private:
         void paint (juce::Graphics& g) override;
 
         void setParams (Params p);
+        Params getParams() const;
         void setFpsText (juce::String text);
         void setOnParamsChanged (std::function<void(Params)> cb);
         void setOnFullscreenChanged (std::function<void(bool)> cb);
+        void setOnTuneWorkgroupsRequested (std::function<void()> cb);
+        void setOnBenchmarkSortRequested (std::function<void()> cb);
+        void setOnRestartFlockRequested (std::function<void()> cb);
+        void setOnSaveSnapshotRequested (std::function<void(SnapshotFile::Encoding)> cb);
+        void setOnLoadSnapshotRequested (std::function<void()> cb);
+        void setPresetNames (const juce::StringArray& names);
+        void setSelectedPreset (int index); // -1 = none; doesn't call back
+        void setOnPresetSelected (std::function<void(int index)> cb);
+        void setOnSavePresetRequested (std::function<void()> cb);
+        void setOnOpenTimelineRequested (std::function<void()> cb);
+        void setOnStopTimelineRequested (std::function<void()> cb);
+        void setOnOscToggled (std::function<void(bool)> cb);
+        void setOscListening (bool isListening, int port); // reflects the receiver's state without calling back
+        void setOnAudioInputToggled (std::function<void(bool)> cb);
+        void setOnOpenAudioFileRequested (std::function<void()> cb);
+        void setOnStopAudioRequested (std::function<void()> cb);
+        void setAudioInput (bool isListening); // reflects the input's state without calling back
+        void setOnRecordingToggled (std::function<void(bool, TrajectoryFile::Encoding)> cb);
+        void setRecording (bool isRecording); // reflects the recorder's state without calling back
+        void setOnOpenRecordingRequested (std::function<void()> cb);
+        void setOnStopPlaybackRequested (std::function<void()> cb);
+        void setOnPlaybackChanged (std::function<void(bool paused, float speed)> cb);
+        void setOnPlaybackSeek (std::function<void(int frame)> cb);
+        void setPlaybackFrameSource (std::function<int()> source); // polled to move the position slider
+        void setPlaybackLength (int numFrames); // 0 = not playing back
+        void setOnExportToggled (std::function<void(bool, FrameExporter::Format, juce::Point<int> size)> cb); // size 0 = window
+        void setExporting (bool isExporting); // reflects the exporter's state without calling back
 
     private:
         void sliderValueChanged (juce::Slider* s) override;
@@ -105,7 +272,33 @@ private:
 
         juce::ToggleButton collapseButton { "Controls" };
         juce::ToggleButton wrapBoundsToggle { "Wrap bounds" };
+        juce::ToggleButton streamParticlesToggle { "Stream to CPU" };
+        juce::ToggleButton frustumCullToggle { "Frustum cull" };
         juce::ToggleButton fullscreenToggle { "Fullscreen" };
+        juce::ToggleButton hdrBloomToggle { "HDR + bloom" };
+        juce::TextButton tuneWorkgroupsButton { "Tune workgroups" };
+        juce::ToggleButton deterministicToggle { "Deterministic" };
+        juce::TextButton restartFlockButton { "Restart flock" };
+        juce::TextButton benchmarkSortButton { "Benchmark sort" };
+        juce::TextButton saveSnapshotButton { "Save snapshot..." };
+        juce::TextButton loadSnapshotButton { "Load snapshot..." };
+        juce::ComboBox snapshotFormatBox;
+        juce::ComboBox presetBox;
+        juce::TextButton savePresetButton { "Save preset..." };
+        juce::TextButton openTimelineButton { "Run timeline..." };
+        juce::TextButton stopTimelineButton { "Stop timeline" };
+        juce::ToggleButton oscToggle { "OSC input" };
+        juce::ToggleButton audioInputToggle { "Audio input" };
+        juce::TextButton openAudioFileButton { "Audio file..." };
+        juce::TextButton stopAudioButton { "Stop audio" };
+        juce::ToggleButton recordToggle { "Record trajectories" };
+        juce::ComboBox recordFormatBox;
+        juce::TextButton openRecordingButton { "Play recording..." };
+        juce::ToggleButton pausePlaybackToggle { "Pause" };
+        juce::TextButton stopPlaybackButton { "Stop playback" };
+        juce::ToggleButton exportToggle { "Export frames" };
+        juce::ComboBox exportFormatBox;
+        juce::ComboBox exportSizeBox;
 
         juce::Label particleCountLabel;
         juce::Slider particleCountSlider;
@@ -148,9 +341,39 @@ private:
         juce::Label alphaLabel;
         juce::Slider alphaSlider;
 
+        juce::Label bloomStrengthLabel;
+        juce::Slider bloomStrengthSlider;
+        juce::Label exposureLabel;
+        juce::Slider exposureSlider;
+
+        juce::Label trailLengthLabel;
+        juce::Slider trailLengthSlider;
+        juce::Label trailStrideLabel;
+        juce::Slider trailStrideSlider;
+
+        juce::Label motionBlurLabel;
+        juce::Slider motionBlurSlider;
+
+        juce::Label drawBudgetLabel;
+        juce::Slider drawBudgetSlider;
+
+        juce::Label seedLabel;
+        juce::Slider seedSlider;
+
+        juce::Label playbackPositionLabel;
+        juce::Slider playbackPositionSlider;
+        juce::Label playbackSpeedLabel;
+        juce::Slider playbackSpeedSlider;
+
         juce::Label particleShapeLabel;
         juce::ComboBox particleShapeBox;
 
+        juce::Label rendererLabel;
+        juce::ComboBox rendererBox;
+
+        juce::Label transparencyLabel;
+        juce::ComboBox transparencyBox;
+
         juce::Label colorModeLabel;
         juce::ComboBox colorModeBox;
 
@@ -164,12 +387,34 @@ private:
         juce::Slider valueSlider;
         juce::Label densityCurveLabel;
         juce::Slider densityCurveSlider;
+        juce::Label audioReactivityLabel;
+        juce::Slider audioReactivitySlider;
 
         juce::Label fpsLabel;
 
         bool collapsed = false;
         std::function<void(Params)> onParamsChanged;
         std::function<void(bool)> onFullscreenChanged;
+        std::function<void()> onTuneWorkgroupsRequested;
+        std::function<void()> onBenchmarkSortRequested;
+        std::function<void()> onRestartFlockRequested;
+        std::function<void(SnapshotFile::Encoding)> onSaveSnapshotRequested;
+        std::function<void()> onLoadSnapshotRequested;
+        std::function<void(int)> onPresetSelected;
+        std::function<void()> onSavePresetRequested;
+        std::function<void()> onOpenTimelineRequested;
+        std::function<void()> onStopTimelineRequested;
+        std::function<void(bool)> onOscToggled;
+        std::function<void(bool)> onAudioInputToggled;
+        std::function<void()> onOpenAudioFileRequested;
+        std::function<void()> onStopAudioRequested;
+        std::function<void(bool, TrajectoryFile::Encoding)> onRecordingToggled;
+        std::function<void()> onOpenRecordingRequested;
+        std::function<void()> onStopPlaybackRequested;
+        std::function<void(bool, float)> onPlaybackChanged;
+        std::function<void(int)> onPlaybackSeek;
+        std::function<int()> playbackFrameSource;
+        std::function<void(bool, FrameExporter::Format, juce::Point<int>)> onExportToggled;
         std::atomic<bool> pendingAnyChange { false };
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BoidsControlPanel)
@@ -177,30 +422,231 @@ private:
 
     std::unique_ptr<BoidsControlPanel> controlPanel;
 
+    // OSC input (see OscControl): commands are applied on the message thread, like the panel, mouse and keys, so
+    // settings reach the GL thread through applyParamsOnGLThread() and the camera through the members below.
+    // Declared after the panel, which its handlers use.
+    OscControl oscControl;
+    int oscPort = OscControl::defaultPort;
+    juce::var oscParamChanges;  // field -> value, collected over one drain and applied once
+
+    bool startOsc (int port);
+    void stopOsc();
+    void handleOscCommand (const OscControl::Command& command);
+    void applyOscParamChanges();
+
+    // Audio-reactive modulation (see AudioAnalyser): analysis frames queued by the audio thread are taken at the
+    // start of each simulation step and modulate the settings applied last, for that step only.
+    AudioAnalyser audioAnalyser;
+    std::unique_ptr<juce::FileChooser> audioChooser;
+    float audioBandEnvelopes[AudioAnalyser::numBands + 1] {};  // bands, then the level; GL thread
+    float audioOnsetEnvelope = 0.0f;
+    bool audioModulating = false;
+
+    void startAudioInput();
+    void openAudioFileAsync();
+    void stopAudio();
+    void modulateFromAudioOnGLThread (float dtSeconds);
+
+    // Settings go through clampParams() and then setSimulationParams(), at startup and from every source after.
+    static BoidsControlPanel::Params clampParams (BoidsControlPanel::Params p);
+    void setSimulationParams (const BoidsControlPanel::Params& clamped);
+    void applyParamsOnGLThread (const BoidsControlPanel::Params& p, bool restartFlock = false);
+    void loadSnapshotOnGLThread (const SnapshotFile& snapshot, const BoidsControlPanel::Params& p);
+    void applyPresetOnGLThread (const PresetFile& preset, const BoidsControlPanel::Params& p);
+
     // Camera
     juce::Draggable3DOrientation orbit;
     juce::Point<int> lastMouse;
     bool rightDragging = false;
     juce::Vector3D<float> pan { 0.0f, 0.0f, 0.0f };
-    float cameraDistance = 18.0f;
+    static constexpr float defaultCameraDistance = 18.0f;
+    float cameraDistance = defaultCameraDistance;
 
     // Shader files (compute + render)
-    juce::File computeClearFile, computeBuildFile, computeStepFile;
-    juce::File renderVertexFile, renderFragmentFile;
-    juce::Time lastClearMod, lastBuildMod, lastStepMod, lastRenderVertMod, lastRenderFragMod;
+    juce::File computeClearFile, computeBuildFile, computeStepFile, computeRebaseFile, computeCullFile, computeSortFile;
+    juce::File computeCellSortFile;
+    juce::File computePackFile;
+    juce::File computeVolumeDensityFile, volumeRaymarchFragmentFile;
+    juce::File computeTrailRecordFile, trailVertexFile, trailFragmentFile;
+    juce::File motionTileMaxFragmentFile, motionNeighbourMaxFragmentFile, motionBlurFragmentFile;
+    juce::File renderVertexFile, renderFragmentFile, quadVertexFile, quadFragmentFile, meshVertexFile, meshFragmentFile;
+    juce::File fullscreenVertexFile, oitCompositeFragmentFile, bloomDownsampleFragmentFile, bloomUpsampleFragmentFile, tonemapFragmentFile;
+    std::map<juce::String, juce::Time> shaderModTimes; // full path -> modification time at the last successful reload
 
     // GL objects
     unsigned int vao = 0;
     unsigned int particlesSSBO[2] { 0, 0 };
     unsigned int cellHeadsSSBO = 0;
     unsigned int nextIndexSSBO = 0;
+    unsigned int cellStartSSBO = 0;   // subgroup step only: per-cell counts, scanned into start offsets (+1 entry for the total)
+    unsigned int cellSlotSSBO = 0;    // subgroup step only: each particle's slot within its cell
+    unsigned int sortedIndexSSBO = 0; // subgroup step only: particle indices grouped by cell (boids_cellsort.comp)
+    unsigned int visibleIndicesSSBO = 0;  // compacted visible particle indices (cull pass output), one slice per LOD bin
+    unsigned int drawIndirectBuffer = 0;  // DrawArraysIndirectCommand(s) filled by the cull pass, one per LOD bin
+    unsigned int sortKeysSSBO[2] { 0, 0 }; // depth sort keys (ping-pong)
+    unsigned int sortValuesSSBO = 0;      // depth sort scratch for visible indices (ping-pongs with visibleIndicesSSBO)
+    unsigned int sortHistogramSSBO = 0;   // per-workgroup digit counts, scanned in place into scatter offsets
+    unsigned int packedParticlesSSBO = 0; // compact snapshot particles (particles_pack.comp), 12 bytes each
     unsigned int computeClearProgram = 0;
     unsigned int computeBuildProgram = 0;
     unsigned int computeStepProgram = 0;
+    unsigned int computeStepDeterministicProgram = 0; // boids_step.comp compiled with JF_DETERMINISTIC
+    unsigned int computeCellScanProgram = 0;    // boids_cellsort.comp compiled with JF_CELLSORT_SCAN (subgroup step only)
+    unsigned int computeCellScatterProgram = 0; // boids_cellsort.comp compiled with JF_CELLSORT_SCATTER (subgroup step only)
+    unsigned int computeRebaseProgram = 0;
+    unsigned int computeCullProgram = 0;
+    unsigned int computeLodCullProgram = 0; // particles_cull.comp compiled with JF_LOD
+    unsigned int computePackProgram = 0;    // particles_pack.comp compiled with JF_PACK
+    unsigned int computeUnpackProgram = 0;  // particles_pack.comp compiled with JF_UNPACK
     unsigned int renderProgram = 0;
+    unsigned int quadRenderProgram = 0;
+    unsigned int meshRenderProgram = 0;
+    unsigned int oitCompositeProgram = 0;
+
+    // particles_sort.comp compiled once per kernel (JF_SORT_* defines)
+    enum SortKernel { sortKernelKeys, sortKernelHistogram, sortKernelScan, sortKernelScatter, numSortKernels };
+    unsigned int computeSortPrograms[numSortKernels] {};
+
+    GpuTimer gpuTimer; // non-blocking per-section GPU timings (sort, draw, sort benchmark) for the FPS readout
+
+    // Sort benchmark ("Benchmark sort"): the depth sort over synthetic keys, GL thread only (see startSortBenchmarkOnGLThread()).
+    struct SortBenchmark
+    {
+        unsigned int keysSSBO[3] { 0, 0, 0 }; // ping-pong pair + the shuffled keys each run starts from
+        unsigned int valuesSSBO[2] { 0, 0 };
+        unsigned int histogramSSBO = 0;
+        unsigned int commandBuffer = 0;       // cmd[0] = key count, like the cull pass's draw command
+        std::vector<unsigned int> originalKeys; // CPU copy for checking the first run
+        int framesLeft = 0;
+        int orderErrors = 0;
+        juce::String result; // shown in the FPS readout
+    };
+
+    SortBenchmark sortBenchmark;
+    std::atomic<bool> sortBenchmarkRequested { false };
+
+    // Weighted blended OIT: RGBA16F accumulation + R8 revealage (+ depth for opaque occluders), sized to the viewport.
+    GLRenderTarget oitTarget;
+    unsigned int oitSceneFrameBuffer = 0; // framebuffer render() was drawing into before the OIT pass
+
+    // HDR: RGBA16F scene colour + depth at viewport size, and the bloom mip chain (one target per level, see kBloom*).
+    GLRenderTarget hdrTarget;
+    juce::OwnedArray<GLRenderTarget> bloomLevels;
+    unsigned int hdrSceneFrameBuffer = 0; // framebuffer the tone-mapped result goes to
+    unsigned int bloomDownProgram = 0;
+    unsigned int bloomUpProgram = 0;
+    unsigned int tonemapProgram = 0;
+
+    // Motion blur: the HDR scene target gets an RG16F velocity attachment (pixels/frame, fragment location 2);
+    // per-tile max and 3x3 neighbour max at 1/kMotionBlurTileSize, and the blurred scene that bloom/tone map then read.
+    GLRenderTarget motionTileMax, motionNeighbourMax, motionBlurTarget;
+    unsigned int motionTileMaxProgram = 0;
+    unsigned int motionNeighbourMaxProgram = 0;
+    unsigned int motionBlurProgram = 0;
+    juce::Matrix3D<float> previousViewProj; // last frame's, for the camera part of the screen velocity
+    bool previousViewProjValid = false;
+    float frameStepSeconds = 0.0f;          // simulated seconds this frame (dt * simSpeed)
+    int frameViewportWidth = 0, frameViewportHeight = 0;
+
+    // Volume render mode (particleShape 4): per-cell count + summed colour at grid resolution, raymarched fullscreen.
+    unsigned int volumeTexture = 0;       // RGBA16F 3D texture, recreated when gridDims changes
+    juce::Vector3D<int> volumeTextureDims { 0, 0, 0 };
+    unsigned int volumeAccumulatorSSBO = 0; // 4 uints per cell, splatted into with atomics (binding 13)
+    unsigned int computeVolumeSplatProgram = 0;
+    unsigned int computeVolumeResolveProgram = 0;
+    unsigned int volumeRaymarchProgram = 0;
+
+    // Motion trails: trailHistoryLength slots x trailHistoryCapacity particles of vec4 (slot-major), see trails_record.comp.
+    unsigned int trailHistorySSBO = 0;
+    int trailHistoryLength = 0;
+    int trailHistoryCapacity = 0;
+    int trailHead = 0;               // newest slot
+    int trailFramesSinceSample = 0;
+    bool trailsNeedReset = true;     // refill every slot with the current positions (new particles, origin rebase)
+    unsigned int computeTrailRecordProgram = 0;
+    unsigned int trailRenderProgram = 0;
+
+    // Persistently mapped CPU<->GPU transfer rings (sized to particleCapacity; recreated when it grows).
+    ParticleStream particleStream;
+
+    // Snapshot save in progress: waits for its tagged readback through particleStream, then is written off-thread.
+    std::unique_ptr<juce::FileChooser> snapshotChooser;
+    std::shared_ptr<SnapshotFile> pendingSnapshot;
+    juce::File pendingSnapshotFile;
+    bool pendingSnapshotQueued = false; // readback enqueued (header filled); cleared if the ring is reallocated
+
+    // Presets (message thread): every file in the Presets folder, parsed up front so switching never reads the disk.
+    std::vector<PresetFile> presets;
+    juce::StringArray presetFileStamps;  // path + modification time of each file at the last rescan
+    std::unique_ptr<juce::FileChooser> presetChooser;
+
+    // Parameter automation (see ParamTimeline): while set, evaluated before every simulation step, over the settings
+    // applied last. GL thread, like the simulation state it drives.
+    std::shared_ptr<ParamTimeline> timeline;
+    double timelineStartSeconds = 0.0;          // simulationTimeSeconds when it started
+    BoidsControlPanel::Params appliedParams;    // the last settings through applyParamsOnGLThread(), from any source
+    std::unique_ptr<juce::FileChooser> timelineChooser;
+
+    // Trajectory recording: shares the per-frame readback with streamParticles. Frames stay retained in the ring
+    // until the recorder's writer thread has encoded them into the file (no CPU copy on this side).
+    TrajectoryRecorder trajectoryRecorder;
+    std::unique_ptr<juce::FileChooser> recordingChooser;
+    double recordingStartSeconds = 0.0;
+
+    // Simulated time and origin of each per-frame readback still in the ring, oldest first (delivery is in order).
+    struct StreamFrameInfo
+    {
+        double timeSeconds = 0.0;
+        juce::Vector3D<double> worldOrigin;
+    };
+
+    std::deque<StreamFrameInfo> streamFrameInfo;
+    double simulationTimeSeconds = 0.0; // sum of dt * simSpeed
+
+    // Trajectory playback: while a player is set, render() uploads recorded frames instead of running the simulation.
+    std::shared_ptr<TrajectoryPlayer> trajectoryPlayer;
+    std::unique_ptr<juce::FileChooser> playbackChooser;
+    double playheadSeconds = 0.0;       // recording time shown (advances by dt * playbackSpeed)
+    int playbackFrame = -1;             // frame currently in particlesSSBO[0]
+    std::atomic<bool> playbackPaused { false };
+    std::atomic<float> playbackSpeed { 1.0f };
+    std::atomic<int> playbackSeekFrame { -1 };      // from the position slider, taken by the next frame
+    std::atomic<int> playbackFrameForUi { -1 };
+
+    // Frame export: while exporting, render() draws into exportTarget at the export size, steps the simulation by a
+    // fixed 1 / fps per frame and hands every frame to frameExporter; the window shows it scaled to fit.
+    FrameExporter frameExporter;
+    GLRenderTarget exportTarget;
+    std::unique_ptr<juce::FileChooser> exportChooser;
+    float outputPixelScale = 1.0f;                  // output pixels per window pixel this frame (for pixel-sized sprites)
+    FrameExporter::Settings launchExportSettings;   // see exportOnLaunch(); written before launchExportRequested
+    std::atomic<bool> launchExportRequested { false };
+    bool quitWhenExportFinished = false;
+    BoidsControlPanel::Params launchParams;         // see runDeterministicOnLaunch(); written before launchParamsRequested
+    std::atomic<bool> launchParamsRequested { false };
+    std::shared_ptr<ParamTimeline> launchTimeline;  // see runTimelineOnLaunch(); written before launchTimelineRequested
+    std::atomic<bool> launchTimelineRequested { false };
+
+    bool streamParticles = false;
+    juce::int64 streamBytesAtLastFpsUpdate = 0;
+    float streamMeanSpeed = 0.0f;                 // CPU-side analytics computed from the latest read-back frame
+    juce::Vector3D<float> streamCentroid { 0.0f, 0.0f, 0.0f };
+
+    // Compute workgroup sizes (local_size_x) per kernel; injected as JF_LOCAL_SIZE and used for dispatch math.
+    struct WorkgroupConfig
+    {
+        int clear = 256;
+        int build = 256;
+        int step = 256;
+    };
+
+    WorkgroupConfig workgroupConfig;
+    std::atomic<bool> workgroupTuneRequested { false };
+    juce::String gpuIdentity; // "vendor | renderer | version", key for persisted per-GPU settings
 
     // Simulation parameters are initialised from BoidsControlPanel::Params defaults in MainComponent::MainComponent().
     int currentParticleCount = 0;
+    int particleCapacity = 0;  // allocated particle slots (>= currentParticleCount, grows with headroom)
     std::atomic<int> requestedParticleCount { 0 };
     std::atomic<bool> buffersReady { false };
 
@@ -210,8 +656,15 @@ private:
     float cellSize = 2.0f; // typically ~= neighbor radius
     juce::Vector3D<int> gridDims { 10, 10, 10 };
     int cellCount = 1000;
+    int cellHeadsCapacity = 0; // allocated CellHeads entries (>= cellCount), reused across small radius changes
     int maxCellCount = 1 << 20; // safety clamp to avoid clearing/building huge grids per-frame (e.g. very small neighborRadius)
 
+    // Floating origin: GPU positions are stored relative to worldOrigin (absolute, CPU-side only), which follows the
+    // camera focus in whole-unit steps once it drifts further than originRebaseDistance. Keeps float precision near the
+    // viewer independent of how far worldMin/worldMax extend.
+    juce::Vector3D<double> worldOrigin { 0.0, 0.0, 0.0 };
+    double originRebaseDistance = 512.0;
+
     float neighborRadius = 0.0f;
     float separationRadius = 0.0f;
     float maxSpeed = 0.0f;
@@ -225,9 +678,24 @@ private:
     float boundaryMargin = 0.0f;
     float boundaryStrength = 0.0f;
     bool wrapBounds = false;
+    bool frustumCull = true;
     float pointSize = 0.0f;
     float alphaMul = 0.0f;
-    int particleShape = 1; // matches shader u_shape mapping
+    int particleShape = 1; // matches shader u_shape mapping (0..3); 4 = volume
+    int particleRenderer = 0; // 0 points, 1 screen-aligned quads, 2 velocity-aligned quads, 3 LOD meshes
+    int transparencyMode = 0; // 0 straight alpha, 1 weighted blended OIT, 2 GPU depth sort + straight alpha, 3 additive
+    bool hdrBloom = false;
+    float bloomStrength = 0.0f;
+    float exposure = 1.0f;
+    int trailLength = 0;  // history slots per boid, one trail segment each (0 = trails off)
+    int trailStride = 1;  // frames between samples
+    float motionBlurShutter = 0.0f; // 0 = motion blur off
+    float drawBudgetMs = 0.0f;      // 0 = dynamic resolution off
+    bool deterministic = false;     // see Params::deterministic
+    int seed = 1;
+    PresetFile::Distribution flockDistribution = PresetFile::Distribution::uniform; // where reseeded particles go
+    float renderScale = 1.0f;       // scene resolution / window resolution, per axis (see updateRenderScaleOnGLThread())
+    int renderScaleFramesSinceChange = 0;
 
     // Coloring
     int colorMode = 0;
@@ -236,6 +704,7 @@ private:
     float saturation = 0.0f;
     float value = 0.0f;
     float densityCurve = 0.0f;
+    float audioReactivity = 0.0f;
 
     double lastFrameTimeSeconds = 0.0;
     int framesSinceFpsUpdate = 0;
@@ -244,6 +713,8 @@ private:
     float startTime = 0.0f;
     bool shadersLoaded = false;
     bool computeAvailable = false;
+    bool subgroupsAvailable = false;  // GL_KHR_shader_subgroup with vote/arithmetic/ballot/shuffle in compute
+    bool stepUsesSubgroups = false;   // current boids_step program was compiled with JF_SUBGROUP (and the grid passes with JF_CELL_SORT)
     juce::String lastShaderError;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
@@ -0,0 +1,183 @@
+#include "OscControl.h"
+
+namespace
+{
+    bool isNumber (const juce::OSCArgument& argument)
+    {
+        return argument.isFloat32() || argument.isInt32();
+    }
+
+    float toFloat (const juce::OSCArgument& argument)
+    {
+        return argument.isFloat32() ? argument.getFloat32() : (float) argument.getInt32();
+    }
+
+    void copyName (const juce::String& source, char (&destination)[48])
+    {
+        source.copyToUTF8 (destination, sizeof (destination));
+    }
+}
+
+//==============================================================================
+OscControl::OscControl()
+{
+    receiver.addListener (this);
+}
+
+OscControl::~OscControl()
+{
+    stop();
+    receiver.removeListener (this);
+    cancelPendingUpdate();
+}
+
+bool OscControl::start (int port, juce::String& error)
+{
+    stop();
+
+    if (port < 1 || port > 65535)
+    {
+        error = "OSC port " + juce::String (port) + " is out of range (1-65535)";
+        return false;
+    }
+
+    if (! receiver.connect (port))
+    {
+        error = "Can't listen for OSC on UDP port " + juce::String (port) + " (is another program using it?)";
+        return false;
+    }
+
+    listeningPort.store (port);
+    return true;
+}
+
+void OscControl::stop()
+{
+    if (listeningPort.load() == 0)
+        return;
+
+    receiver.disconnect();
+    listeningPort.store (0);
+}
+
+//==============================================================================
+// Network thread: decode, queue, and ask the message thread to drain. Unknown addresses and malformed arguments are
+// ignored, as OSC receivers do; field names are checked where the command is applied.
+void OscControl::oscMessageReceived (const juce::OSCMessage& message)
+{
+    ++receivedMessages;
+
+    Command command;
+
+    if (! decode (message, command))
+        return;
+
+    if (fifo.getFreeSpace() == 0)
+    {
+        ++droppedMessages;
+        return;
+    }
+
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+    queue[(size_t) start1] = command;
+    fifo.finishedWrite (1);
+
+    triggerAsyncUpdate();
+}
+
+void OscControl::oscBundleReceived (const juce::OSCBundle& bundle)
+{
+    for (const auto& element : bundle)
+    {
+        if (element.isMessage())
+            oscMessageReceived (element.getMessage());
+        else if (element.isBundle())
+            oscBundleReceived (element.getBundle());
+    }
+}
+
+bool OscControl::decode (const juce::OSCMessage& message, Command& command)
+{
+    using Type = Command::Type;
+
+    const auto address = message.getAddressPattern().toString();
+    const auto numArguments = message.size();
+
+    const auto numbers = [&message, numArguments, &command] (int count)
+    {
+        if (numArguments < count)
+            return false;
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (! isNumber (message[i]) || ! std::isfinite (toFloat (message[i])))
+                return false;
+
+            command.values[i] = toFloat (message[i]);
+        }
+
+        return true;
+    };
+
+    if (address.startsWith ("/flock/param/"))
+    {
+        command.type = Type::param;
+        copyName (address.fromFirstOccurrenceOf ("/flock/param/", false, false), command.name);
+        return command.name[0] != 0 && numbers (1);
+    }
+
+    if (address == "/flock/preset")
+    {
+        command.type = Type::preset;
+
+        if (numArguments >= 1 && message[0].isString())
+        {
+            copyName (message[0].getString(), command.name);
+            return true;
+        }
+
+        if (! numbers (1))
+            return false;
+
+        command.index = juce::roundToInt (command.values[0]) - 1;
+        return command.index >= 0;
+    }
+
+    if (address == "/flock/restart")        { command.type = Type::restart;        return true; }
+    if (address == "/flock/camera/orbit")    { command.type = Type::cameraOrbit;    return numbers (2); }
+    if (address == "/flock/camera/distance") { command.type = Type::cameraDistance; return numbers (1); }
+    if (address == "/flock/camera/pan")      { command.type = Type::cameraPan;      return numbers (2); }
+    if (address == "/flock/camera/reset")    { command.type = Type::cameraReset;    return true; }
+
+    return false;
+}
+
+//==============================================================================
+// Message thread: everything queued since the last drain, in order.
+void OscControl::handleAsyncUpdate()
+{
+    drainCommands();
+}
+
+void OscControl::drainCommands()
+{
+    const auto numReady = fifo.getNumReady();
+
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+    if (onCommand != nullptr)
+    {
+        for (int i = 0; i < size1; ++i)
+            onCommand (queue[(size_t) (start1 + i)]);
+
+        for (int i = 0; i < size2; ++i)
+            onCommand (queue[(size_t) (start2 + i)]);
+    }
+
+    fifo.finishedRead (size1 + size2);
+
+    if (onDrained != nullptr)
+        onDrained();
+}
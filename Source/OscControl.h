@@ -0,0 +1,102 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    OSC over UDP as a control surface, for lighting desks and other live controllers.
+
+    Addresses (numbers may be sent as int32 or float32):
+
+        /flock/param/<field> <value>    any Params field by name, as in Params::toVar() (bools: 0 or 1)
+        /flock/preset <n>               preset n in the panel's order, counting from 1 like keys 1-9
+        /flock/preset <name>            the preset with that name
+        /flock/restart                  reseed the flock
+        /flock/camera/orbit <yaw> <pitch>   absolute orientation, in degrees
+        /flock/camera/distance <d>
+        /flock/camera/pan <x> <y>
+        /flock/camera/reset
+
+    Messages arrive on the receiver's network thread, which only decodes them into fixed-size Commands and pushes
+    them into a lock-free single-producer ring; a full ring drops the message (counted), so a flooding sender can't
+    stall anything. The ring is drained on the message thread, in arrival order, where onCommand applies each
+    command as the panel or a preset key would. Nothing in this class touches the GL thread; changes to state that
+    render() reads (settings, the camera) are posted to it by the owner.
+
+    start() and stop() must be called on the message thread; the getters may be called on any thread.
+*/
+class OscControl final : private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>,
+                         private juce::AsyncUpdater
+{
+public:
+    //==============================================================================
+    static constexpr int defaultPort = 9000;
+
+    struct Command
+    {
+        enum class Type
+        {
+            param,
+            preset,
+            restart,
+            cameraOrbit,
+            cameraDistance,
+            cameraPan,
+            cameraReset
+        };
+
+        Type type = Type::param;
+        char name[48] {};       // field name (param) or preset name (preset, when index < 0)
+        int index = -1;         // preset index from 0
+        float values[2] {};
+    };
+
+    OscControl();
+    ~OscControl() override;
+
+    /** Listens on a UDP port (on every interface). On failure, error says why. */
+    bool start (int port, juce::String& error);
+    void stop();
+
+    bool isListening() const noexcept               { return listeningPort.load() > 0; }
+    int getPort() const noexcept                    { return listeningPort.load(); }
+    juce::int64 getReceivedMessages() const noexcept { return receivedMessages.load(); }
+    juce::int64 getDroppedMessages() const noexcept  { return droppedMessages.load(); }
+
+    /** Called on the message thread for every queued command, oldest first, then onDrained once, so that a burst
+        of fader moves can be applied as one change.
+    */
+    std::function<void (const Command&)> onCommand;
+    std::function<void()> onDrained;
+
+    /** Drains the queue now instead of on the next message loop turn, for callers that don't run one (the tests).
+        Must be called on the thread that would otherwise drain it.
+    */
+    void drainCommands();
+
+    /** Decodes one message as the network thread does. Returns false for unknown addresses and malformed arguments
+        (missing, not a number, not finite), which are dropped; field and preset names are checked by whoever applies
+        the command.
+    */
+    static bool decode (const juce::OSCMessage& message, Command& command);
+
+private:
+    //==============================================================================
+    void oscMessageReceived (const juce::OSCMessage& message) override;
+    void oscBundleReceived (const juce::OSCBundle& bundle) override;
+    void handleAsyncUpdate() override;
+
+    static constexpr int queueSize = 1024;
+
+    juce::OSCReceiver receiver { "OSC input" };
+    std::atomic<int> listeningPort { 0 };
+
+    // Network thread -> message thread.
+    juce::AbstractFifo fifo { queueSize };
+    std::array<Command, (size_t) queueSize> queue;
+
+    std::atomic<juce::int64> receivedMessages { 0 };
+    std::atomic<juce::int64> droppedMessages { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OscControl)
+};
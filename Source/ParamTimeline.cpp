@@ -0,0 +1,198 @@
+#include "ParamTimeline.h"
+
+namespace
+{
+    constexpr const char* kFormat = "JuicyFlock timeline";
+
+    const char* const kCurveNames[] = { "linear", "smooth", "step" };
+
+    bool isNumber (const juce::var& v)
+    {
+        return v.isDouble() || v.isInt() || v.isInt64();
+    }
+}
+
+//==============================================================================
+ParamTimeline::ParamTimeline()
+    : values (new juce::DynamicObject())
+{
+}
+
+bool ParamTimeline::loadFromFile (const juce::File& newFile, juce::String& error)
+{
+    file = newFile;
+    tracks.clear();
+    duration = 0.0;
+
+    juce::var json;
+
+    if (const auto result = juce::JSON::parse (file.loadFileAsString(), json); result.failed())
+    {
+        error = file.getFileName() + " isn't valid JSON: " + result.getErrorMessage();
+        return false;
+    }
+
+    auto* object = json.getDynamicObject();
+
+    if (object == nullptr || object->getProperty ("format").toString() != kFormat)
+    {
+        error = file.getFileName() + " isn't a JuicyFlock timeline";
+        return false;
+    }
+
+    if (const auto version = (int) object->getProperty ("version"); version < 1 || version > currentVersion)
+    {
+        error = file.getFileName() + " is timeline version " + juce::String (version)
+                  + "; this build reads up to " + juce::String (currentVersion);
+        return false;
+    }
+
+    auto* tracksObject = object->getProperty ("tracks").getDynamicObject();
+
+    if (tracksObject == nullptr || tracksObject->getProperties().isEmpty())
+    {
+        error = file.getFileName() + " has no tracks";
+        return false;
+    }
+
+    for (const auto& property : tracksObject->getProperties())
+    {
+        const auto where = file.getFileName() + ", track \"" + property.name.toString() + "\"";
+        const auto* keysArray = property.value.getArray();
+
+        if (keysArray == nullptr || keysArray->isEmpty())
+        {
+            error = where + ": needs an array of keys";
+            return false;
+        }
+
+        Track track;
+        track.name = property.name;
+        track.isBool = (*keysArray)[0]["value"].isBool();
+
+        for (const auto& keyVar : *keysArray)
+        {
+            const auto time = keyVar["time"];
+            const auto value = keyVar["value"];
+            const auto curveName = keyVar["curve"];
+
+            if (! isNumber (time) || ! std::isfinite ((double) time) || (double) time < 0.0)
+            {
+                error = where + ": every key needs a \"time\" of 0 seconds or more";
+                return false;
+            }
+
+            if (track.isBool ? ! value.isBool() : ! (isNumber (value) && std::isfinite ((double) value)))
+            {
+                error = where + ": every \"value\" must be a number, or every one true/false";
+                return false;
+            }
+
+            Key key;
+            key.time = (double) time;
+            key.value = track.isBool ? ((bool) value ? 1.0 : 0.0) : (double) value;
+
+            if (! curveName.isVoid())
+            {
+                int index = 0;
+                while (index < (int) std::size (kCurveNames) && curveName.toString() != kCurveNames[index])
+                    ++index;
+
+                if (index == (int) std::size (kCurveNames))
+                {
+                    error = where + ": unknown curve \"" + curveName.toString() + "\" (linear, smooth or step)";
+                    return false;
+                }
+
+                key.curve = (Curve) index;
+            }
+
+            track.keys.push_back (key);
+        }
+
+        // Keys at the same time keep their order: the later one takes over from that instant.
+        std::stable_sort (track.keys.begin(), track.keys.end(), [] (const Key& a, const Key& b) { return a.time < b.time; });
+
+        duration = juce::jmax (duration, track.keys.back().time);
+        tracks.push_back (std::move (track));
+    }
+
+    if (const auto durationVar = object->getProperty ("duration"); ! durationVar.isVoid())
+    {
+        if (! isNumber (durationVar) || ! ((double) durationVar > 0.0))
+        {
+            error = file.getFileName() + ": \"duration\" must be a number of seconds above zero";
+            return false;
+        }
+
+        duration = (double) durationVar;
+    }
+
+    looping = (bool) object->getProperty ("loop");
+
+    if (looping && duration <= 0.0)
+    {
+        error = file.getFileName() + ": a looping timeline needs keys after 0 s, or a \"duration\"";
+        return false;
+    }
+
+    values = new juce::DynamicObject();
+    return true;
+}
+
+juce::StringArray ParamTimeline::getTrackNames() const
+{
+    juce::StringArray names;
+
+    for (const auto& track : tracks)
+        names.add (track.name.toString());
+
+    return names;
+}
+
+const juce::var& ParamTimeline::evaluate (double timeSeconds)
+{
+    if (looping)
+        timeSeconds = std::fmod (juce::jmax (0.0, timeSeconds), duration);
+
+    auto* object = values.getDynamicObject();
+
+    for (const auto& track : tracks)
+    {
+        const auto value = evaluateTrack (track, timeSeconds);
+
+        if (track.isBool)
+            object->setProperty (track.name, value >= 0.5);
+        else
+            object->setProperty (track.name, value);
+    }
+
+    return values;
+}
+
+double ParamTimeline::evaluateTrack (const Track& track, double timeSeconds)
+{
+    const auto& keys = track.keys;
+
+    if (timeSeconds <= keys.front().time)
+        return keys.front().value;
+
+    if (timeSeconds >= keys.back().time)
+        return keys.back().value;
+
+    // The segment [a, b) that holds timeSeconds; a.time <= timeSeconds < b.time, so it has a length.
+    const auto next = std::upper_bound (keys.begin(), keys.end(), timeSeconds,
+                                        [] (double t, const Key& key) { return t < key.time; });
+    const auto& a = *(next - 1);
+    const auto& b = *next;
+
+    if (a.curve == Curve::step || track.isBool)
+        return a.value;
+
+    auto x = (timeSeconds - a.time) / (b.time - a.time);
+
+    if (a.curve == Curve::smooth)
+        x = x * x * (3.0 - 2.0 * x);
+
+    return a.value + (b.value - a.value) * x;
+}
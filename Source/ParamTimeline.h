@@ -0,0 +1,85 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Keyframed automation of control panel settings over simulated time, read from a JSON file:
+
+        {
+          "format": "JuicyFlock timeline",
+          "version": 1,
+          "loop": false,
+          "tracks": {
+            "weightAlignment": [ { "time": 0, "value": 1.4 },
+                                 { "time": 20, "value": 3.0, "curve": "smooth" },
+                                 { "time": 40, "value": 1.4 } ],
+            "colorMode":       [ { "time": 0, "value": 1, "curve": "step" }, { "time": 30, "value": 3 } ],
+            "hdrBloom":        [ { "time": 0, "value": false }, { "time": 25, "value": true } ]
+          }
+        }
+
+    A track is named after a Params field (as in Params::toVar()) and holds keys at times in seconds of simulated
+    time since the timeline started. A key's curve shapes the segment from it to the next key: linear (the
+    default), smooth (eases in and out) or step (holds until the next key). Before its first key and after its last
+    a track holds the nearest key's value. Boolean tracks always step; integer settings take the interpolated value
+    rounded down, so modes want step. The timeline lasts until its last key, or "duration" if given; a looping
+    timeline starts over then.
+
+    evaluate() is a pure function of time, so a run driven by a timeline is as reproducible as the simulation
+    stepping it. It writes into one persistent object that is updated in place, so it doesn't allocate per step.
+
+    loadFromFile() may be called on any thread; after that the timeline belongs to one thread (the GL thread).
+*/
+class ParamTimeline
+{
+public:
+    //==============================================================================
+    static constexpr int currentVersion = 1;
+
+    enum class Curve
+    {
+        linear = 0,
+        smooth = 1,     // smoothstep between the two keys
+        step = 2        // this key's value until the next key
+    };
+
+    struct Key
+    {
+        double time = 0.0;
+        double value = 0.0;
+        Curve curve = Curve::linear;
+    };
+
+    ParamTimeline();
+
+    /** Reads and validates a timeline. On failure, error says why and this object is left unspecified. */
+    bool loadFromFile (const juce::File& file, juce::String& error);
+
+    const juce::File& getFile() const noexcept      { return file; }
+    double getDuration() const noexcept             { return duration; }
+    bool isLooping() const noexcept                 { return looping; }
+    juce::StringArray getTrackNames() const;
+
+    /** Every track's value at timeSeconds (wrapped when looping), by field name, for Params::fromVar(). */
+    const juce::var& evaluate (double timeSeconds);
+
+private:
+    //==============================================================================
+    struct Track
+    {
+        juce::Identifier name;
+        bool isBool = false;
+        std::vector<Key> keys; // sorted by time
+    };
+
+    static double evaluateTrack (const Track& track, double timeSeconds);
+
+    juce::File file;
+    std::vector<Track> tracks;
+    double duration = 0.0;
+    bool looping = false;
+    juce::var values;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParamTimeline)
+};
@@ -0,0 +1,249 @@
+#include "ParticleStream.h"
+
+using namespace juce::gl;
+
+//==============================================================================
+ParticleStream::~ParticleStream()
+{
+    // GL objects must be released on the GL thread (MainComponent::shutdown()) before destruction.
+    jassert (readbackBuffer == 0 && uploadBuffer == 0);
+}
+
+// Persistent mapping needs glBufferStorage: core in 4.4, otherwise via GL_ARB_buffer_storage.
+bool ParticleStream::isSupported()
+{
+    GLint major = 0, minor = 0;
+    glGetIntegerv (GL_MAJOR_VERSION, &major);
+    glGetIntegerv (GL_MINOR_VERSION, &minor);
+
+    if (major > 4 || (major == 4 && minor >= 4))
+        return true;
+
+    return juce::OpenGLHelpers::isExtensionSupported ("GL_ARB_buffer_storage");
+}
+
+// Allocates both rings as immutable storage and maps them once for the lifetime of the stream.
+bool ParticleStream::create (size_t maxBytesPerFrame, int slots)
+{
+    release();
+
+    if (maxBytesPerFrame == 0 || slots < 2 || ! isSupported())
+        return false;
+
+    slotBytes = maxBytesPerFrame;
+    numSlots = slots;
+
+    const auto totalBytes = (GLsizeiptr) (slotBytes * (size_t) numSlots);
+
+    // Readback ring: GPU writes (copy), CPU reads. CLIENT_STORAGE hints host memory, which is what readers want.
+    const GLbitfield readFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers (1, &readbackBuffer);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, readbackBuffer);
+    glBufferStorage (GL_COPY_WRITE_BUFFER, totalBytes, nullptr, readFlags | GL_CLIENT_STORAGE_BIT);
+    readbackMapping = static_cast<const juce::uint8*> (glMapBufferRange (GL_COPY_WRITE_BUFFER, 0, totalBytes, readFlags));
+
+    // Upload ring: CPU writes, GPU reads (copy source).
+    const GLbitfield writeFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers (1, &uploadBuffer);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, uploadBuffer);
+    glBufferStorage (GL_COPY_WRITE_BUFFER, totalBytes, nullptr, writeFlags);
+    uploadMapping = static_cast<juce::uint8*> (glMapBufferRange (GL_COPY_WRITE_BUFFER, 0, totalBytes, writeFlags));
+
+    glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+
+    if (readbackMapping == nullptr || uploadMapping == nullptr)
+    {
+        release();
+        return false;
+    }
+
+    readbackSlots.reset (new Slot[(size_t) numSlots]);
+    uploadFences.assign ((size_t) numSlots, nullptr);
+    nextReadbackSlot = 0;
+    oldestReadbackSlot = 0;
+    nextUploadSlot = 0;
+    return true;
+}
+
+// Deletes fences and buffers (unmapping implicitly). Any retained frames become invalid.
+void ParticleStream::release()
+{
+    if (readbackSlots != nullptr)
+    {
+        for (int i = 0; i < numSlots; ++i)
+        {
+            auto& slot = readbackSlots[(size_t) i];
+            if (slot.fence != nullptr)
+                glDeleteSync (slot.fence);
+
+            // A consumer still holding a frame here would read freed memory.
+            jassert (slot.state != SlotState::ready || slot.refCount.load() == 0);
+        }
+    }
+
+    for (auto fence : uploadFences)
+        if (fence != nullptr)
+            glDeleteSync (fence);
+
+    if (readbackBuffer != 0)
+    {
+        glBindBuffer (GL_COPY_WRITE_BUFFER, readbackBuffer);
+        glUnmapBuffer (GL_COPY_WRITE_BUFFER);
+        glDeleteBuffers (1, &readbackBuffer);
+        readbackBuffer = 0;
+    }
+
+    if (uploadBuffer != 0)
+    {
+        glBindBuffer (GL_COPY_WRITE_BUFFER, uploadBuffer);
+        glUnmapBuffer (GL_COPY_WRITE_BUFFER);
+        glDeleteBuffers (1, &uploadBuffer);
+        uploadBuffer = 0;
+    }
+
+    glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+
+    readbackSlots.reset();
+    uploadFences.clear();
+    readbackMapping = nullptr;
+    uploadMapping = nullptr;
+    slotBytes = 0;
+    numSlots = 0;
+}
+
+bool ParticleStream::isSlotReusable (const Slot& slot) const noexcept
+{
+    return slot.state == SlotState::free
+        || (slot.state == SlotState::ready && slot.refCount.load() == 0);
+}
+
+//==============================================================================
+// Slots are used strictly round-robin so frames are delivered in order; a busy slot means the reader is behind.
+bool ParticleStream::enqueueReadback (unsigned int sourceBuffer, size_t numBytes, int particleCount, int tag)
+{
+    if (! isCreated() || numBytes == 0 || numBytes > slotBytes)
+        return false;
+
+    auto& slot = readbackSlots[(size_t) nextReadbackSlot];
+
+    if (! isSlotReusable (slot))
+    {
+        droppedFrames.fetch_add (1);
+        return false;
+    }
+
+    // The source was written by compute shaders; make those writes visible to the copy.
+    glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBuffer (GL_COPY_READ_BUFFER, sourceBuffer);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, readbackBuffer);
+    glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                         (GLintptr) (slotBytes * (size_t) nextReadbackSlot), (GLsizeiptr) numBytes);
+    glBindBuffer (GL_COPY_READ_BUFFER, 0);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+
+    slot.fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.state = SlotState::inFlight;
+    slot.numBytes = numBytes;
+    slot.particleCount = particleCount;
+    slot.frameNumber = nextFrameNumber++;
+    slot.tag = tag;
+
+    nextReadbackSlot = (nextReadbackSlot + 1) % numSlots;
+    return true;
+}
+
+// Walks in-flight slots from the oldest; stops at the first fence that hasn't signalled yet (later ones can't be done either).
+void ParticleStream::pollReadbacks (const std::function<void (const Frame&)>& consumer)
+{
+    if (! isCreated())
+        return;
+
+    for (int n = 0; n < numSlots; ++n)
+    {
+        const int index = oldestReadbackSlot;
+        auto& slot = readbackSlots[(size_t) index];
+
+        if (slot.state != SlotState::inFlight)
+            break;
+
+        // Flush on the first poll so the fence is guaranteed to reach the GPU; timeout 0 = never wait.
+        const auto status = glClientWaitSync (slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+
+        glDeleteSync (slot.fence);
+        slot.fence = nullptr;
+        slot.state = SlotState::ready;
+        slot.refCount.store (1); // held for the duration of the callback
+
+        totalBytesReadBack.fetch_add ((juce::int64) slot.numBytes);
+
+        if (consumer != nullptr)
+        {
+            Frame frame;
+            frame.slot = index;
+            frame.data = readbackMapping + slotBytes * (size_t) index;
+            frame.numBytes = slot.numBytes;
+            frame.particleCount = slot.particleCount;
+            frame.frameNumber = slot.frameNumber;
+            frame.tag = slot.tag;
+            consumer (frame);
+        }
+
+        releaseFrame (index);
+        oldestReadbackSlot = (oldestReadbackSlot + 1) % numSlots;
+    }
+}
+
+void ParticleStream::retainFrame (int slot)
+{
+    jassert (readbackSlots != nullptr && juce::isPositiveAndBelow (slot, numSlots));
+    readbackSlots[(size_t) slot].refCount.fetch_add (1);
+}
+
+void ParticleStream::releaseFrame (int slot)
+{
+    jassert (readbackSlots != nullptr && juce::isPositiveAndBelow (slot, numSlots));
+    readbackSlots[(size_t) slot].refCount.fetch_sub (1);
+}
+
+//==============================================================================
+// Waits on the slot's previous fence (numSlots uploads ago, so normally long complete) and hands out its mapping.
+void* ParticleStream::beginUpload (size_t numBytes)
+{
+    if (! isCreated() || numBytes > slotBytes)
+        return nullptr;
+
+    auto& fence = uploadFences[(size_t) nextUploadSlot];
+
+    if (fence != nullptr)
+    {
+        glClientWaitSync (fence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64) 1000000000); // 1 s safety timeout
+        glDeleteSync (fence);
+        fence = nullptr;
+    }
+
+    return uploadMapping + slotBytes * (size_t) nextUploadSlot;
+}
+
+// Coherent mapping: the CPU writes are visible to the copy without an explicit flush.
+void ParticleStream::commitUpload (unsigned int destinationBuffer, size_t destinationOffset, size_t numBytes)
+{
+    if (! isCreated() || numBytes == 0)
+        return;
+
+    jassert (numBytes <= slotBytes);
+
+    glBindBuffer (GL_COPY_READ_BUFFER, uploadBuffer);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, destinationBuffer);
+    glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                         (GLintptr) (slotBytes * (size_t) nextUploadSlot), (GLintptr) destinationOffset, (GLsizeiptr) numBytes);
+    glBindBuffer (GL_COPY_READ_BUFFER, 0);
+    glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+
+    uploadFences[(size_t) nextUploadSlot] = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextUploadSlot = (nextUploadSlot + 1) % numSlots;
+
+    totalBytesUploaded.fetch_add ((juce::int64) numBytes);
+}
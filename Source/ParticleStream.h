@@ -0,0 +1,111 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Streams particle buffers between GPU and CPU through persistently mapped, fenced ring buffers
+    (glBufferStorage + GL_MAP_PERSISTENT_BIT + glFenceSync), so neither direction stalls the GL thread
+    and no intermediate CPU copies are made.
+
+    Readback: enqueueReadback() copies an SSBO range into the next free ring slot GPU-side and fences it.
+    pollReadbacks() hands every slot whose fence has signalled to a consumer, oldest first, without waiting.
+    A consumer that needs the data beyond the callback (e.g. a disk writer thread) calls retainFrame() and
+    later releaseFrame(); while a slot is retained it is not reused, so slow consumers cost dropped frames,
+    never stalls.
+
+    Upload: beginUpload() returns mapped memory for the next upload slot, commitUpload() copies it into a
+    destination buffer GPU-side and fences the slot.
+
+    Requires OpenGL 4.4 or GL_ARB_buffer_storage (see isSupported()). All methods must be called on the
+    GL thread except retainFrame(), releaseFrame() and the statistics getters.
+*/
+class ParticleStream
+{
+public:
+    //==============================================================================
+    struct Frame
+    {
+        int slot = -1;
+        const void* data = nullptr;
+        size_t numBytes = 0;
+        int particleCount = 0;
+        juce::int64 frameNumber = 0;
+        int tag = 0;                // as passed to enqueueReadback(), so several consumers can share the ring
+    };
+
+    ParticleStream() = default;
+    ~ParticleStream();
+
+    /** True if the current context supports persistent mapping (GL thread only). */
+    static bool isSupported();
+
+    /** Allocates readback + upload rings of numSlots slots, each maxBytesPerFrame bytes. */
+    bool create (size_t maxBytesPerFrame, int numSlots = 3);
+    void release();
+
+    bool isCreated() const noexcept                 { return readbackBuffer != 0; }
+    size_t getMaxBytesPerFrame() const noexcept     { return slotBytes; }
+
+    //==============================================================================
+    /** Queues a GPU-side copy of numBytes from sourceBuffer into a free slot. Returns false (and counts a drop) if all slots are busy. */
+    bool enqueueReadback (unsigned int sourceBuffer, size_t numBytes, int particleCount, int tag = 0);
+
+    /** Delivers every completed readback to the consumer (oldest first). Never blocks. */
+    void pollReadbacks (const std::function<void (const Frame&)>& consumer);
+
+    /** Keeps a delivered frame's data alive past the consumer callback. Must be paired with releaseFrame(). */
+    void retainFrame (int slot);
+    void releaseFrame (int slot);
+
+    //==============================================================================
+    /** Returns persistently mapped memory to write up to getMaxBytesPerFrame() bytes into. */
+    void* beginUpload (size_t numBytes);
+
+    /** Copies the bytes written since beginUpload() into destinationBuffer at destinationOffset. */
+    void commitUpload (unsigned int destinationBuffer, size_t destinationOffset, size_t numBytes);
+
+    //==============================================================================
+    juce::int64 getTotalBytesReadBack() const noexcept  { return totalBytesReadBack.load(); }
+    juce::int64 getTotalBytesUploaded() const noexcept  { return totalBytesUploaded.load(); }
+    juce::int64 getDroppedFrames() const noexcept       { return droppedFrames.load(); }
+
+private:
+    //==============================================================================
+    enum class SlotState { free, inFlight, ready };
+
+    struct Slot
+    {
+        juce::gl::GLsync fence = nullptr;
+        SlotState state = SlotState::free;   // GL thread only
+        std::atomic<int> refCount { 0 };     // consumer holds; the slot is reusable once this drops to 0
+        size_t numBytes = 0;
+        int particleCount = 0;
+        juce::int64 frameNumber = 0;
+        int tag = 0;
+    };
+
+    bool isSlotReusable (const Slot& slot) const noexcept;
+
+    unsigned int readbackBuffer = 0;
+    unsigned int uploadBuffer = 0;
+    const juce::uint8* readbackMapping = nullptr;
+    juce::uint8* uploadMapping = nullptr;
+
+    size_t slotBytes = 0;
+    int numSlots = 0;
+
+    std::unique_ptr<Slot[]> readbackSlots;
+    int nextReadbackSlot = 0;
+    int oldestReadbackSlot = 0;
+    juce::int64 nextFrameNumber = 0;
+
+    std::vector<juce::gl::GLsync> uploadFences;
+    int nextUploadSlot = 0;
+
+    std::atomic<juce::int64> totalBytesReadBack { 0 };
+    std::atomic<juce::int64> totalBytesUploaded { 0 };
+    std::atomic<juce::int64> droppedFrames { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParticleStream)
+};
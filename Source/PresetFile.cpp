@@ -0,0 +1,168 @@
+#include "PresetFile.h"
+
+namespace
+{
+    constexpr const char* kFormat = "JuicyFlock preset";
+
+    // Anything bigger is a typo, not a world (the grid would be clamped to a handful of huge cells).
+    constexpr float kMaxWorldExtent = 1.0e6f;
+
+    const char* const kDistributionNames[] = { "uniform", "sphere", "clusters" };
+
+    juce::var vectorToVar (juce::Vector3D<float> v)
+    {
+        return juce::Array<juce::var> { (double) v.x, (double) v.y, (double) v.z };
+    }
+
+    bool varToVector (const juce::var& v, juce::Vector3D<float>& result)
+    {
+        const auto* array = v.getArray();
+
+        if (array == nullptr || array->size() != 3)
+            return false;
+
+        for (const auto& component : *array)
+            if (! (component.isDouble() || component.isInt() || component.isInt64()))
+                return false;
+
+        result = { (float) (*array)[0], (float) (*array)[1], (float) (*array)[2] };
+        return std::isfinite (result.x) && std::isfinite (result.y) && std::isfinite (result.z);
+    }
+}
+
+//==============================================================================
+bool PresetFile::writeToFile (const juce::File& file, juce::String& error) const
+{
+    auto* object = new juce::DynamicObject();
+    const juce::var json (object);
+
+    object->setProperty ("format", kFormat);
+    object->setProperty ("version", currentVersion);
+    object->setProperty ("name", name);
+
+    if (hasWorldBox)
+    {
+        auto* world = new juce::DynamicObject();
+        world->setProperty ("min", vectorToVar (worldMin));
+        world->setProperty ("max", vectorToVar (worldMax));
+        object->setProperty ("world", juce::var (world));
+    }
+
+    if (hasDistribution)
+        object->setProperty ("distribution", kDistributionNames[(int) distribution]);
+
+    object->setProperty ("restart", restart);
+    object->setProperty ("params", params);
+
+    juce::TemporaryFile temp (file);
+
+    if (! temp.getFile().replaceWithText (juce::JSON::toString (json) + "\n"))
+    {
+        error = "Can't write " + temp.getFile().getFullPathName();
+        return false;
+    }
+
+    if (! temp.overwriteTargetFileWithTemporary())
+    {
+        error = "Can't replace " + file.getFullPathName();
+        return false;
+    }
+
+    return true;
+}
+
+bool PresetFile::readFromFile (const juce::File& file, juce::String& error)
+{
+    juce::var json;
+
+    if (const auto result = juce::JSON::parse (file.loadFileAsString(), json); result.failed())
+    {
+        error = file.getFileName() + " isn't valid JSON: " + result.getErrorMessage();
+        return false;
+    }
+
+    auto* object = json.getDynamicObject();
+
+    if (object == nullptr || object->getProperty ("format").toString() != kFormat)
+    {
+        error = file.getFileName() + " isn't a JuicyFlock preset";
+        return false;
+    }
+
+    // Only "format" is required, so a hand-written preset may leave the version out: it reads as version 1.
+    const auto versionVar = object->getProperty ("version");
+
+    if (const auto version = versionVar.isVoid() ? 1 : (int) versionVar; version < 1 || version > currentVersion)
+    {
+        error = file.getFileName() + " is preset version " + juce::String (version)
+                  + "; this build reads up to " + juce::String (currentVersion);
+        return false;
+    }
+
+    name = object->getProperty ("name").toString();
+    if (name.isEmpty())
+        name = file.getFileNameWithoutExtension();
+
+    params = object->getProperty ("params");
+
+    if (! params.isVoid() && params.getDynamicObject() == nullptr)
+    {
+        error = file.getFileName() + ": \"params\" must be an object";
+        return false;
+    }
+
+    const auto world = object->getProperty ("world");
+    hasWorldBox = ! world.isVoid();
+
+    if (hasWorldBox)
+    {
+        if (! varToVector (world["min"], worldMin) || ! varToVector (world["max"], worldMax))
+        {
+            error = file.getFileName() + ": \"world\" needs \"min\" and \"max\" as [x, y, z]";
+            return false;
+        }
+
+        const auto size = worldMax - worldMin;
+
+        if (juce::jmin (size.x, size.y, size.z) <= 0.0f || juce::jmax (size.x, size.y, size.z) > kMaxWorldExtent)
+        {
+            error = file.getFileName() + ": the world box must be larger than zero and at most "
+                      + juce::String (kMaxWorldExtent, 0) + " units on every axis";
+            return false;
+        }
+    }
+
+    const auto distributionName = object->getProperty ("distribution");
+    hasDistribution = ! distributionName.isVoid();
+
+    if (hasDistribution)
+    {
+        int index = 0;
+        while (index < (int) std::size (kDistributionNames) && distributionName.toString() != kDistributionNames[index])
+            ++index;
+
+        if (index == (int) std::size (kDistributionNames))
+        {
+            error = file.getFileName() + ": unknown distribution \"" + distributionName.toString()
+                      + "\" (uniform, sphere or clusters)";
+            return false;
+        }
+
+        distribution = (Distribution) index;
+    }
+
+    restart = (bool) object->getProperty ("restart");
+    return true;
+}
+
+juce::Array<juce::File> PresetFile::findPresetFiles (const juce::File& directory)
+{
+    auto files = directory.findChildFiles (juce::File::findFiles, false, "*.json");
+
+    std::sort (files.begin(), files.end(), [] (const juce::File& a, const juce::File& b)
+    {
+        return a.getFileName().compareNatural (b.getFileName()) < 0;
+    });
+
+    return files;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A named look for the flock, stored as JSON so presets can be written and tweaked by hand:
+
+        {
+          "format": "JuicyFlock preset",
+          "version": 1,
+          "name": "Murmuration",
+          "world": { "min": [-10, -10, -10], "max": [10, 10, 10] },
+          "distribution": "uniform",
+          "restart": false,
+          "params": { "neighborRadius": 1.6, "colorMode": 1, "seed": 7, ... }
+        }
+
+    "params" holds control panel Params by field name (Params::toVar()), seed and deterministic mode included.
+    Everything but "format" is optional, and a missing field leaves the running value alone, so a preset can be as
+    small as the one colour it changes. "distribution" is how reseeded particles are placed (a restart, or growing
+    the count); "restart" reseeds the whole flock when the preset is applied, which is the only way a distribution
+    shows on its own.
+
+    No GL in here: MainComponent applies presets, this only does the file.
+*/
+struct PresetFile
+{
+    static constexpr int currentVersion = 1;
+
+    enum class Distribution
+    {
+        uniform = 0,    // anywhere in the world box
+        sphere = 1,     // inside the largest ball the box holds
+        clusters = 2    // a few dense clumps
+    };
+
+    juce::String name;                          // shown in the panel; the file name when the preset has none
+    juce::var params;                           // Params by field name, any subset
+    bool hasWorldBox = false;
+    juce::Vector3D<float> worldMin, worldMax;
+    bool hasDistribution = false;
+    Distribution distribution = Distribution::uniform;
+    bool restart = false;
+
+    /** Writes through a temporary file, so a failed save never clobbers an existing preset. */
+    bool writeToFile (const juce::File& file, juce::String& error) const;
+
+    /** Reads and validates a preset. On failure, error says why and this object is left unspecified. */
+    bool readFromFile (const juce::File& file, juce::String& error);
+
+    /** The *.json files in directory, sorted by name (which is the order the panel lists them in). */
+    static juce::Array<juce::File> findPresetFiles (const juce::File& directory);
+};
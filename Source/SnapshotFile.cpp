@@ -0,0 +1,174 @@
+#include "SnapshotFile.h"
+
+namespace
+{
+    constexpr char kMagic[4] = { 'J', 'F', 'S', 'N' };
+
+    // Anything bigger is a corrupt header, not a flock.
+    constexpr juce::int64 kMaxParticleBytes = (juce::int64) 1 << 34;
+    constexpr int kMaxParamsBytes = 1 << 20;
+
+    void writeVector (juce::OutputStream& out, juce::Vector3D<float> v)
+    {
+        out.writeFloat (v.x);
+        out.writeFloat (v.y);
+        out.writeFloat (v.z);
+    }
+
+    juce::Vector3D<float> readFloatVector (juce::InputStream& in)
+    {
+        const auto x = in.readFloat();
+        const auto y = in.readFloat();
+        const auto z = in.readFloat();
+        return { x, y, z };
+    }
+}
+
+//==============================================================================
+bool SnapshotFile::writeToFile (const juce::File& file, juce::String& error) const
+{
+    const auto particleBytes = (size_t) particleCount * (size_t) bytesPerParticle;
+
+    if (particleCount <= 0 || bytesPerParticle <= 0 || particles.getSize() != particleBytes)
+    {
+        error = "Snapshot has no particle data";
+        return false;
+    }
+
+    juce::TemporaryFile temp (file);
+
+    {
+        juce::FileOutputStream out (temp.getFile());
+
+        if (out.failedToOpen())
+        {
+            error = "Can't write " + temp.getFile().getFullPathName() + ": " + out.getStatus().getErrorMessage();
+            return false;
+        }
+
+        const auto paramsJson = juce::JSON::toString (params, true);
+        const auto paramsBytes = (int) paramsJson.getNumBytesAsUTF8();
+
+        out.write (kMagic, sizeof (kMagic));
+        out.writeInt ((int) currentVersion);
+        out.writeInt (particleCount);
+        out.writeInt (bytesPerParticle);
+        writeVector (out, worldMin);
+        writeVector (out, worldMax);
+        out.writeFloat (cellSize);
+        out.writeInt (gridDims.x);
+        out.writeInt (gridDims.y);
+        out.writeInt (gridDims.z);
+        out.writeDouble (worldOrigin.x);
+        out.writeDouble (worldOrigin.y);
+        out.writeDouble (worldOrigin.z);
+        out.writeInt ((int) encoding);
+        writeVector (out, quantMin);
+        writeVector (out, quantMax);
+        out.writeFloat (speedRange);
+        out.writeInt (paramsBytes);
+        out.write (paramsJson.toRawUTF8(), (size_t) paramsBytes);
+
+        if (! out.write (particles.getData(), particles.getSize()))
+        {
+            error = "Write failed (disk full?): " + temp.getFile().getFullPathName();
+            return false;
+        }
+
+        out.flush();
+
+        if (out.getStatus().failed())
+        {
+            error = out.getStatus().getErrorMessage();
+            return false;
+        }
+    }
+
+    if (! temp.overwriteTargetFileWithTemporary())
+    {
+        error = "Can't replace " + file.getFullPathName();
+        return false;
+    }
+
+    return true;
+}
+
+bool SnapshotFile::readFromFile (const juce::File& file, juce::String& error)
+{
+    juce::FileInputStream in (file);
+
+    if (in.failedToOpen())
+    {
+        error = "Can't open " + file.getFullPathName() + ": " + in.getStatus().getErrorMessage();
+        return false;
+    }
+
+    char magic[4] = {};
+    if (in.read (magic, sizeof (magic)) != (int) sizeof (magic) || std::memcmp (magic, kMagic, sizeof (magic)) != 0)
+    {
+        error = file.getFileName() + " is not a JuicyFlock snapshot";
+        return false;
+    }
+
+    const auto version = (juce::uint32) in.readInt();
+    if (version == 0 || version > currentVersion)
+    {
+        error = file.getFileName() + " is snapshot version " + juce::String (version)
+              + "; this build reads up to version " + juce::String (currentVersion);
+        return false;
+    }
+
+    particleCount = in.readInt();
+    bytesPerParticle = in.readInt();
+    worldMin = readFloatVector (in);
+    worldMax = readFloatVector (in);
+    cellSize = in.readFloat();
+    const auto gx = in.readInt();
+    const auto gy = in.readInt();
+    const auto gz = in.readInt();
+    gridDims = { gx, gy, gz };
+    const auto ox = in.readDouble();
+    const auto oy = in.readDouble();
+    const auto oz = in.readDouble();
+    worldOrigin = { ox, oy, oz };
+
+    encoding = Encoding::raw;
+
+    if (version >= 2)
+    {
+        encoding = (Encoding) in.readInt();
+        quantMin = readFloatVector (in);
+        quantMax = readFloatVector (in);
+        speedRange = in.readFloat();
+    }
+
+    const auto paramsBytes = in.readInt();
+    const auto particleBytes = (juce::int64) particleCount * (juce::int64) bytesPerParticle;
+
+    if (particleCount <= 0 || bytesPerParticle <= 0 || particleBytes > kMaxParticleBytes
+        || ! juce::isPositiveAndBelow (paramsBytes, kMaxParamsBytes)
+        || (encoding != Encoding::raw && encoding != Encoding::compact)
+        || (encoding == Encoding::compact && (bytesPerParticle != bytesPerCompactParticle || ! (speedRange > 0.0f))))
+    {
+        error = file.getFileName() + " has a corrupt header";
+        return false;
+    }
+
+    juce::MemoryBlock paramsJson;
+    if (in.readIntoMemoryBlock (paramsJson, paramsBytes) != (size_t) paramsBytes
+        || juce::JSON::parse (paramsJson.toString(), params).failed())
+    {
+        error = file.getFileName() + " has unreadable settings";
+        return false;
+    }
+
+    particles.reset();
+    if (in.getTotalLength() - in.getPosition() != particleBytes
+        || in.readIntoMemoryBlock (particles, particleBytes) != (size_t) particleBytes)
+    {
+        error = file.getFileName() + " is truncated (expected " + juce::String (particleCount) + " particles)";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A versioned binary checkpoint of the whole simulation: control panel settings, world/grid configuration,
+    the floating origin and the particle buffer, so a flock can be saved and resumed.
+
+    Layout (little-endian):
+        char[4]  "JFSN"
+        uint32   version
+        int32    particleCount, bytesPerParticle
+        float    worldMin[3], worldMax[3], cellSize
+        int32    gridDims[3]
+        double   worldOrigin[3]
+        uint32   encoding                                   (version 2+; version 1 files are raw)
+        float    quantMin[3], quantMax[3], speedRange       (version 2+)
+        int32    paramsBytes, then paramsBytes of UTF-8 JSON (the control panel Params, by field name)
+        particleCount * bytesPerParticle bytes of particle data (origin-relative)
+
+    Raw particles are exactly what the GPU stores, 48 bytes each, and resume bit-for-bit. Compact particles are
+    12 bytes: position quantised to 16 bits per axis over quantMin..quantMax (relative to worldOrigin, like the
+    particles), speed to 16 bits over 0..speedRange and the heading as a 16-bit-per-component octahedral vector.
+    Colour isn't stored; the simulation recomputes it on its first step. Shaders/particles_pack.comp does both
+    directions on the GPU.
+
+    Settings are stored by name so snapshots survive Params gaining fields; the particle block is a single
+    contiguous write/read so large flocks stream at disk speed. No GL in here: MainComponent does the readback
+    and upload, this only does the file.
+*/
+struct SnapshotFile
+{
+    static constexpr juce::uint32 currentVersion = 2;
+
+    enum class Encoding : juce::uint32
+    {
+        raw = 0,        // particles as the GPU stores them (exact)
+        compact = 1     // quantised position, speed and heading (see above)
+    };
+
+    static constexpr int bytesPerCompactParticle = 12;
+
+    int particleCount = 0;
+    int bytesPerParticle = 0;
+    juce::Vector3D<float> worldMin, worldMax;
+    float cellSize = 0.0f;
+    juce::Vector3D<int> gridDims;
+    juce::Vector3D<double> worldOrigin;
+    Encoding encoding = Encoding::raw;
+    juce::Vector3D<float> quantMin, quantMax;   // compact only
+    float speedRange = 0.0f;                    // compact only
+    juce::var params;
+    juce::MemoryBlock particles; // particleCount * bytesPerParticle bytes
+
+    /** Writes through a temporary file, so a failed or interrupted save never clobbers an existing snapshot. */
+    bool writeToFile (const juce::File& file, juce::String& error) const;
+
+    /** Reads and validates a whole snapshot. On failure, error says why and this object is left unspecified. */
+    bool readFromFile (const juce::File& file, juce::String& error);
+};
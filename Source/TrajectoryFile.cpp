@@ -0,0 +1,511 @@
+#include "TrajectoryFile.h"
+
+namespace TrajectoryFile
+{
+namespace
+{
+    // Delta frames, worst case: 16-bit components take up to 3 varint bytes, 8-bit ones up to 2.
+    constexpr int quantisedDeltaBytesMax = 6 * 3 + 4 * 2;
+    constexpr int compactDeltaBytesMax = 6 * 3;
+
+    bool hasMagic (const char* magic, const char* expected) noexcept
+    {
+        return std::memcmp (magic, expected, 4) == 0;
+    }
+
+    //==============================================================================
+    juce::uint32 zigZag (int v) noexcept          { return ((juce::uint32) v << 1) ^ (juce::uint32) (v >> 31); }
+    int unZigZag (juce::uint32 v) noexcept        { return (int) (v >> 1) ^ -(int) (v & 1); }
+
+    juce::uint8* writeVarint (juce::uint8* dest, juce::uint32 v) noexcept
+    {
+        while (v >= 0x80)
+        {
+            *dest++ = (juce::uint8) (v | 0x80);
+            v >>= 7;
+        }
+
+        *dest++ = (juce::uint8) v;
+        return dest;
+    }
+
+    bool readVarint (const juce::uint8*& src, const juce::uint8* end, juce::uint32& v) noexcept
+    {
+        v = 0;
+
+        for (int shift = 0; shift < 32; shift += 7)
+        {
+            if (src == end)
+                return false;
+
+            const auto b = *src++;
+            v |= (juce::uint32) (b & 0x7f) << shift;
+
+            if ((b & 0x80) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    // Differences wrap (mod 2^16 / 2^8). When the quantisation box is the world box (see getQuantisationBox()), a boid
+    // wrapping around it is therefore still a small delta.
+    juce::uint8* writeDelta16 (juce::uint8* dest, juce::uint16 now, juce::uint16 before) noexcept
+    {
+        return writeVarint (dest, zigZag ((juce::int16) (juce::uint16) (now - before)));
+    }
+
+    juce::uint8* writeDelta8 (juce::uint8* dest, juce::uint8 now, juce::uint8 before) noexcept
+    {
+        return writeVarint (dest, zigZag ((juce::int8) (juce::uint8) (now - before)));
+    }
+
+    template <typename UnsignedType>
+    bool readDelta (const juce::uint8*& src, const juce::uint8* end, UnsignedType& value) noexcept
+    {
+        juce::uint32 v = 0;
+        if (! readVarint (src, end, v))
+            return false;
+
+        value = (UnsignedType) (value + unZigZag (v));
+        return true;
+    }
+
+    //==============================================================================
+    // Octahedral unit vectors, as in Shaders/particles_pack.comp (the compact snapshot codec), so both formats
+    // quantise headings the same way.
+    float signNotZero (float v) noexcept         { return v >= 0.0f ? 1.0f : -1.0f; }
+
+    juce::int16 toSnorm16 (float v) noexcept
+    {
+        return (juce::int16) juce::roundToInt (juce::jlimit (-1.0f, 1.0f, v) * 32767.0f);
+    }
+
+    void octEncode (const float* v, juce::int16 (&encoded)[2]) noexcept
+    {
+        const auto length = std::sqrt (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+        if (length <= 1.0e-6f)
+        {
+            encoded[0] = encoded[1] = 0; // +z, like the shader's fallback heading
+            return;
+        }
+
+        const auto l1 = (std::abs (v[0]) + std::abs (v[1]) + std::abs (v[2])) / length;
+        auto x = v[0] / length / l1, y = v[1] / length / l1;
+
+        if (v[2] < 0.0f)
+        {
+            const auto foldedX = (1.0f - std::abs (y)) * signNotZero (x);
+            y = (1.0f - std::abs (x)) * signNotZero (y);
+            x = foldedX;
+        }
+
+        encoded[0] = toSnorm16 (x);
+        encoded[1] = toSnorm16 (y);
+    }
+
+    void octDecode (const juce::int16 (&encoded)[2], float* v) noexcept
+    {
+        auto x = juce::jmax (-1.0f, encoded[0] / 32767.0f);
+        auto y = juce::jmax (-1.0f, encoded[1] / 32767.0f);
+        const auto z = 1.0f - std::abs (x) - std::abs (y);
+
+        if (z < 0.0f)
+        {
+            const auto unfoldedX = (1.0f - std::abs (y)) * signNotZero (x);
+            y = (1.0f - std::abs (x)) * signNotZero (y);
+            x = unfoldedX;
+        }
+
+        const auto length = std::sqrt (x * x + y * y + z * z);
+        v[0] = x / length;
+        v[1] = y / length;
+        v[2] = z / length;
+    }
+}
+
+//==============================================================================
+void getQuantisationBox (juce::Vector3D<float> worldMin, juce::Vector3D<float> worldMax, bool wrapBounds,
+                         juce::Vector3D<float>& quantMin, juce::Vector3D<float>& quantMax) noexcept
+{
+    const auto pad = wrapBounds ? juce::Vector3D<float>() : (worldMax - worldMin) * 0.25f;
+    quantMin = worldMin - pad;
+    quantMax = worldMax + pad;
+}
+
+size_t getMaxPayloadBytes (Encoding encoding, int particleCount, bool isKeyframe)
+{
+    if (encoding == Encoding::raw)
+        return (size_t) particleCount * (size_t) bytesPerRawParticle;
+
+    if (encoding == Encoding::compactDelta)
+        return (size_t) particleCount * (isKeyframe ? sizeof (CompactParticle) : (size_t) compactDeltaBytesMax);
+
+    return (size_t) particleCount * (isKeyframe ? sizeof (QuantisedParticle) : (size_t) quantisedDeltaBytesMax);
+}
+
+bool readIndex (const juce::File& file, FileHeader& header, std::vector<IndexEntry>& index, juce::String& error)
+{
+    juce::FileInputStream in (file);
+
+    if (in.failedToOpen())
+    {
+        error = "Can't open " + file.getFullPathName() + ": " + in.getStatus().getErrorMessage();
+        return false;
+    }
+
+    const FileHeader expected;
+    if (in.read (&header, (int) sizeof (header)) != (int) sizeof (header) || ! hasMagic (header.magic, expected.magic))
+    {
+        error = file.getFileName() + " is not a JuicyFlock trajectory recording";
+        return false;
+    }
+
+    if (header.version == 0 || header.version > currentVersion || header.encoding > (juce::uint32) Encoding::compactDelta)
+    {
+        error = file.getFileName() + " is recording version " + juce::String (header.version)
+              + "; this build reads up to version " + juce::String (currentVersion);
+        return false;
+    }
+
+    index.clear();
+    const auto fileSize = in.getTotalLength();
+
+    // Finished recording: the footer points at the index. Its fields are checked against the file size before
+    // anything is multiplied or allocated, so a damaged footer falls through to the frame walk below.
+    Footer footer;
+    const auto maxIndexEntries = juce::jmax ((juce::int64) 0, fileSize - (juce::int64) sizeof (FileHeader))
+                               / (juce::int64) sizeof (IndexEntry);
+
+    if (fileSize >= (juce::int64) (sizeof (FileHeader) + sizeof (Footer))
+        && in.setPosition (fileSize - (juce::int64) sizeof (Footer))
+        && in.read (&footer, (int) sizeof (footer)) == (int) sizeof (footer)
+        && hasMagic (footer.magic, Footer().magic)
+        && footer.indexOffset >= (juce::int64) sizeof (FileHeader)
+        && footer.numFrames >= 0
+        && footer.numFrames <= maxIndexEntries
+        && footer.indexOffset + footer.numFrames * (juce::int64) sizeof (IndexEntry) + (juce::int64) sizeof (Footer) == fileSize)
+    {
+        index.resize ((size_t) footer.numFrames);
+        const auto indexBytes = (int) (index.size() * sizeof (IndexEntry));
+
+        if (in.setPosition (footer.indexOffset) && in.read (index.data(), indexBytes) == indexBytes)
+            return true;
+
+        index.clear();
+    }
+
+    // Unfinished recording: walk the frames. The recorder writes each header after its payload, so the first
+    // header that doesn't check out (zero fill past the last frame, or a frame cut short) is the end.
+    const FrameHeader expectedFrame;
+    auto position = (juce::int64) sizeof (FileHeader);
+
+    while (position + (juce::int64) sizeof (FrameHeader) <= fileSize && in.setPosition (position))
+    {
+        FrameHeader frame;
+        if (in.read (&frame, (int) sizeof (frame)) != (int) sizeof (frame)
+            || ! hasMagic (frame.magic, expectedFrame.magic)
+            || frame.particleCount <= 0
+            || frame.payloadBytes > getMaxPayloadBytes ((Encoding) header.encoding, frame.particleCount, false)
+            || position + (juce::int64) sizeof (FrameHeader) + frame.payloadBytes > fileSize)
+            break;
+
+        index.push_back ({ position, frame.timeSeconds, frame.flags, frame.payloadBytes });
+        position += (juce::int64) sizeof (FrameHeader) + frame.payloadBytes;
+    }
+
+    DBG ("Trajectory: " + file.getFileName() + " has no index (unfinished recording); recovered "
+         + juce::String ((int) index.size()) + " frames");
+    return true;
+}
+
+//==============================================================================
+Codec::Codec (const FileHeader& header)
+    : encoding ((Encoding) header.encoding)
+{
+    for (int a = 0; a < 3; ++a)
+    {
+        quantMin[a] = header.quantMin[a];
+        positionScale[a] = 65535.0f / juce::jmax (1.0e-6f, header.quantMax[a] - header.quantMin[a]);
+    }
+
+    velocityScale = 32767.0f / juce::jmax (1.0e-6f, header.velocityRange);
+    speedScale = 65535.0f / juce::jmax (1.0e-6f, header.velocityRange);
+}
+
+size_t Codec::encode (const void* particles, int particleCount, juce::Vector3D<double> worldOrigin,
+                      bool isKeyframe, std::vector<juce::uint8>& out)
+{
+    jassert (encoding == Encoding::quantisedDelta || encoding == Encoding::compactDelta);
+
+    const auto start = out.size();
+    out.resize (start + getMaxPayloadBytes (encoding, particleCount, isKeyframe));
+
+    // GPU positions are origin-relative; the quantisation box is absolute.
+    const float offset[3] = { (float) (worldOrigin.x - quantMin[0]),
+                              (float) (worldOrigin.y - quantMin[1]),
+                              (float) (worldOrigin.z - quantMin[2]) };
+
+    const auto* src = static_cast<const float*> (particles);
+    auto* dest = out.data() + start;
+
+    if (encoding == Encoding::compactDelta)
+    {
+        jassert (isKeyframe || (int) previousCompact.size() == particleCount);
+        previousCompact.resize ((size_t) particleCount);
+
+        for (int i = 0; i < particleCount; ++i)
+        {
+            const auto* p = src + (size_t) i * 12;
+            CompactParticle q;
+
+            for (int a = 0; a < 3; ++a)
+                q.pos[a] = (juce::uint16) juce::jlimit (0, 65535, juce::roundToInt ((p[a] + offset[a]) * positionScale[a]));
+
+            const auto speed = std::sqrt (p[4] * p[4] + p[5] * p[5] + p[6] * p[6]);
+            q.speed = (juce::uint16) juce::jlimit (0, 65535, juce::roundToInt (speed * speedScale));
+            octEncode (p + 4, q.heading);
+
+            auto& before = previousCompact[(size_t) i];
+
+            if (isKeyframe)
+            {
+                std::memcpy (dest, &q, sizeof (q));
+                dest += sizeof (q);
+            }
+            else
+            {
+                for (int a = 0; a < 3; ++a)
+                    dest = writeDelta16 (dest, q.pos[a], before.pos[a]);
+
+                dest = writeDelta16 (dest, q.speed, before.speed);
+
+                for (int a = 0; a < 2; ++a)
+                    dest = writeDelta16 (dest, (juce::uint16) q.heading[a], (juce::uint16) before.heading[a]);
+            }
+
+            before = q;
+        }
+
+        out.resize ((size_t) (dest - out.data()));
+        return out.size() - start;
+    }
+
+    jassert (isKeyframe || (int) previous.size() == particleCount);
+    previous.resize ((size_t) particleCount);
+
+    for (int i = 0; i < particleCount; ++i)
+    {
+        const auto* p = src + (size_t) i * 12;
+        QuantisedParticle q;
+
+        for (int a = 0; a < 3; ++a)
+        {
+            q.pos[a] = (juce::uint16) juce::jlimit (0, 65535, juce::roundToInt ((p[a] + offset[a]) * positionScale[a]));
+            q.vel[a] = (juce::int16) juce::jlimit (-32767, 32767, juce::roundToInt (p[4 + a] * velocityScale));
+        }
+
+        for (int c = 0; c < 4; ++c)
+            q.colour[c] = (juce::uint8) juce::jlimit (0, 255, juce::roundToInt (p[8 + c] * 255.0f));
+
+        auto& before = previous[(size_t) i];
+
+        if (isKeyframe)
+        {
+            std::memcpy (dest, &q, sizeof (q));
+            dest += sizeof (q);
+        }
+        else
+        {
+            for (int a = 0; a < 3; ++a)
+                dest = writeDelta16 (dest, q.pos[a], before.pos[a]);
+
+            for (int a = 0; a < 3; ++a)
+                dest = writeDelta16 (dest, (juce::uint16) q.vel[a], (juce::uint16) before.vel[a]);
+
+            for (int c = 0; c < 4; ++c)
+                dest = writeDelta8 (dest, q.colour[c], before.colour[c]);
+        }
+
+        before = q;
+    }
+
+    out.resize ((size_t) (dest - out.data()));
+    return out.size() - start;
+}
+
+bool Codec::decode (const FrameHeader& frame, const juce::uint8* payload, juce::Vector3D<double> targetOrigin, void* particlesOut)
+{
+    const auto count = (size_t) juce::jmax (0, frame.particleCount);
+    auto* out = static_cast<float*> (particlesOut);
+
+    if (encoding == Encoding::raw)
+    {
+        if (frame.payloadBytes != count * (size_t) bytesPerRawParticle)
+            return false;
+
+        if (out == nullptr)
+            return true;
+
+        std::memcpy (out, payload, frame.payloadBytes);
+
+        const float shift[3] = { (float) (frame.worldOrigin[0] - targetOrigin.x),
+                                 (float) (frame.worldOrigin[1] - targetOrigin.y),
+                                 (float) (frame.worldOrigin[2] - targetOrigin.z) };
+
+        if (shift[0] != 0.0f || shift[1] != 0.0f || shift[2] != 0.0f)
+            for (size_t i = 0; i < count; ++i)
+                for (int a = 0; a < 3; ++a)
+                    out[i * 12 + (size_t) a] += shift[a];
+
+        return true;
+    }
+
+    if (encoding == Encoding::compactDelta)
+        return decodeCompact (frame, payload, targetOrigin, out);
+
+    if ((frame.flags & keyframe) != 0)
+    {
+        if (frame.payloadBytes != count * sizeof (QuantisedParticle))
+            return false;
+
+        previous.resize (count);
+        std::memcpy (previous.data(), payload, frame.payloadBytes);
+    }
+    else
+    {
+        if (previous.size() != count)
+            return false;
+
+        const auto* src = payload;
+        const auto* end = payload + frame.payloadBytes;
+
+        for (auto& q : previous)
+        {
+            bool ok = true;
+
+            for (int a = 0; a < 3; ++a)
+                ok = ok && readDelta (src, end, q.pos[a]);
+
+            for (int a = 0; a < 3; ++a)
+            {
+                auto v = (juce::uint16) q.vel[a];
+                ok = ok && readDelta (src, end, v);
+                q.vel[a] = (juce::int16) v;
+            }
+
+            for (int c = 0; c < 4; ++c)
+                ok = ok && readDelta (src, end, q.colour[c]);
+
+            if (! ok)
+                return false;
+        }
+
+        if (src != end)
+            return false;
+    }
+
+    if (out == nullptr)
+        return true;
+
+    const float offset[3] = { (float) (quantMin[0] - targetOrigin.x),
+                              (float) (quantMin[1] - targetOrigin.y),
+                              (float) (quantMin[2] - targetOrigin.z) };
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto& q = previous[i];
+        auto* p = out + i * 12;
+
+        for (int a = 0; a < 3; ++a)
+        {
+            p[a] = (float) q.pos[a] / positionScale[a] + offset[a];
+            p[4 + a] = (float) q.vel[a] / velocityScale;
+        }
+
+        p[3] = 1.0f;
+        p[7] = 0.0f;
+
+        for (int c = 0; c < 4; ++c)
+            p[8 + c] = (float) q.colour[c] * (1.0f / 255.0f);
+    }
+
+    return true;
+}
+
+bool Codec::decodeCompact (const FrameHeader& frame, const juce::uint8* payload, juce::Vector3D<double> targetOrigin, float* out)
+{
+    const auto count = (size_t) juce::jmax (0, frame.particleCount);
+
+    if ((frame.flags & keyframe) != 0)
+    {
+        if (frame.payloadBytes != count * sizeof (CompactParticle))
+            return false;
+
+        previousCompact.resize (count);
+        std::memcpy (previousCompact.data(), payload, frame.payloadBytes);
+    }
+    else
+    {
+        if (previousCompact.size() != count)
+            return false;
+
+        const auto* src = payload;
+        const auto* end = payload + frame.payloadBytes;
+
+        for (auto& q : previousCompact)
+        {
+            bool ok = true;
+
+            for (int a = 0; a < 3; ++a)
+                ok = ok && readDelta (src, end, q.pos[a]);
+
+            ok = ok && readDelta (src, end, q.speed);
+
+            for (int a = 0; a < 2; ++a)
+            {
+                auto v = (juce::uint16) q.heading[a];
+                ok = ok && readDelta (src, end, v);
+                q.heading[a] = (juce::int16) v;
+            }
+
+            if (! ok)
+                return false;
+        }
+
+        if (src != end)
+            return false;
+    }
+
+    if (out == nullptr)
+        return true;
+
+    const float offset[3] = { (float) (quantMin[0] - targetOrigin.x),
+                              (float) (quantMin[1] - targetOrigin.y),
+                              (float) (quantMin[2] - targetOrigin.z) };
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto& q = previousCompact[i];
+        auto* p = out + i * 12;
+
+        for (int a = 0; a < 3; ++a)
+            p[a] = (float) q.pos[a] / positionScale[a] + offset[a];
+
+        octDecode (q.heading, p + 4);
+
+        const auto speed = (float) q.speed / speedScale;
+        for (int a = 0; a < 3; ++a)
+            p[4 + a] *= speed;
+
+        p[3] = 1.0f;
+        p[7] = 0.0f;
+
+        for (int c = 0; c < 4; ++c)
+            p[8 + c] = 1.0f;
+    }
+
+    return true;
+}
+}
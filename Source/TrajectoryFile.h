@@ -0,0 +1,165 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    On-disk format of a particle trajectory recording (written by TrajectoryRecorder), plus the per-frame codec
+    shared by anything that writes or reads one.
+
+    Layout (native little-endian structs, so the recorder can write them straight into a memory mapping):
+        FileHeader                                  64 bytes
+        FrameHeader + payload, per frame            appended in recording order
+        IndexEntry[numFrames]                       written when recording stops
+        Footer                                      last 24 bytes of the file
+
+    Every frame carries its own magic and payload size, so a recording whose process died before it finished (a crash
+    or a kill) has no index or footer but can still be read by walking the frames from the start: see readIndex().
+    The mapped pages are left for the OS to write back and are never synced, so that only holds while the OS itself
+    keeps running: after a power loss or kernel panic, the frames the OS hadn't yet written are lost, and the pages
+    that did reach the disk needn't be the earliest ones.
+
+    Payloads:
+        raw               particleCount * 48 bytes, the GPU layout as is (positions relative to the frame's worldOrigin)
+        quantised key     particleCount * QuantisedParticle (16 bytes)
+        quantised delta   the same fields as differences from the previous frame (mod 2^16 / 2^8), each zig-zag and
+                          LEB128-varint coded: a boid that moved a little costs one or two bytes per component
+        compact key       particleCount * CompactParticle (12 bytes): the compact snapshot quantisation (position
+                          unorm16 over the box, speed unorm16 over 0..velocityRange, heading octahedral snorm16 x 2)
+        compact delta     its six components delta-coded like the quantised ones
+
+    Compact frames carry no colour. Colour is a function of the flock (heading, speed or neighbour density), so the
+    player recomputes it from the decoded positions and velocities with the current colour settings.
+*/
+namespace TrajectoryFile
+{
+    enum class Encoding : juce::uint32
+    {
+        raw = 0,            // 48 bytes per particle per frame
+        quantisedDelta = 1, // 16 bytes per particle on keyframes, typically 12-14 in between
+        compactDelta = 2    // 12 bytes per particle on keyframes, typically 6-9 in between; no colour (version 2+)
+    };
+
+    constexpr juce::uint32 currentVersion = 2;
+    constexpr int bytesPerRawParticle = 48; // vec4 pos, vec4 vel, vec4 colour
+
+    enum FrameFlags : juce::uint32
+    {
+        keyframe = 1 << 0 // decodable on its own (raw frames always are); seeking starts from one of these
+    };
+
+    //==============================================================================
+    struct FileHeader
+    {
+        char magic[4] { 'J', 'F', 'T', 'R' };
+        juce::uint32 version = currentVersion;
+        juce::uint32 encoding = 0;          // Encoding
+        juce::int32 keyframeInterval = 0;   // frames between forced keyframes (quantisedDelta, compactDelta)
+        float quantMin[3] {};               // quantisation box, absolute world space (quantisedDelta, compactDelta)
+        float quantMax[3] {};
+        float velocityRange = 0.0f;         // velocity components over +-velocityRange, or speed over 0..velocityRange
+        juce::uint8 reserved[20] {};
+    };
+
+    struct FrameHeader
+    {
+        char magic[4] { 'J', 'F', 'F', 'R' };
+        juce::uint32 flags = 0;             // FrameFlags
+        juce::int64 frameIndex = 0;         // 0-based within the recording
+        double timeSeconds = 0.0;           // simulated seconds since recording started
+        double worldOrigin[3] {};           // floating origin the GPU positions were relative to
+        juce::int32 particleCount = 0;
+        juce::uint32 payloadBytes = 0;
+    };
+
+    struct IndexEntry
+    {
+        juce::int64 offset = 0;             // of the FrameHeader, from the start of the file
+        double timeSeconds = 0.0;
+        juce::uint32 flags = 0;
+        juce::uint32 payloadBytes = 0;
+    };
+
+    struct Footer
+    {
+        juce::int64 indexOffset = 0;
+        juce::int64 numFrames = 0;
+        char magic[4] { 'J', 'F', 'I', 'X' };
+        juce::uint32 version = currentVersion;
+    };
+
+    struct QuantisedParticle
+    {
+        juce::uint16 pos[3];                // over quantMin..quantMax
+        juce::int16 vel[3];                 // over -velocityRange..velocityRange
+        juce::uint8 colour[4];              // RGBA8
+    };
+
+    struct CompactParticle
+    {
+        juce::uint16 pos[3];                // over quantMin..quantMax
+        juce::uint16 speed;                 // over 0..velocityRange
+        juce::int16 heading[2];             // octahedral unit vector, snorm16
+    };
+
+    static_assert (sizeof (FileHeader) == 64, "FileHeader is part of the file format");
+    static_assert (sizeof (FrameHeader) == 56, "FrameHeader is part of the file format");
+    static_assert (sizeof (IndexEntry) == 24, "IndexEntry is part of the file format");
+    static_assert (sizeof (Footer) == 24, "Footer is part of the file format");
+    static_assert (sizeof (QuantisedParticle) == 16, "QuantisedParticle is part of the file format");
+    static_assert (sizeof (CompactParticle) == 12, "CompactParticle is part of the file format");
+
+    /** False for encodings that leave colour out; their decoded particles need recolouring before they're drawn. */
+    inline bool storesColour (Encoding encoding) noexcept     { return encoding != Encoding::compactDelta; }
+
+    /** The box a recording of a flock in worldMin..worldMax quantises positions over (absolute world space). With
+        wrapBounds it's the world box itself, so a boid wrapping to the opposite face moves by a few steps mod 2^16,
+        a small delta. Otherwise it's the world box plus a quarter of its size on every side (soft bounds let boids
+        overshoot), and a wrap would cost a full-size delta.
+    */
+    void getQuantisationBox (juce::Vector3D<float> worldMin, juce::Vector3D<float> worldMax, bool wrapBounds,
+                             juce::Vector3D<float>& quantMin, juce::Vector3D<float>& quantMax) noexcept;
+
+    /** Upper bound of a frame's payload, for sizing scratch buffers. */
+    size_t getMaxPayloadBytes (Encoding encoding, int particleCount, bool isKeyframe);
+
+    /** Reads the frame index of a recording: from the footer when it was finished, otherwise by walking the frames. */
+    bool readIndex (const juce::File& file, FileHeader& header, std::vector<IndexEntry>& index, juce::String& error);
+
+    //==============================================================================
+    /**
+        Quantises and delta-codes frames (encode), and turns any payload back into the GPU particle layout (decode).
+        Delta frames are coded against the previous frame that went through the same Codec, so use one Codec per
+        direction and feed it frames in order, starting from a keyframe.
+    */
+    class Codec
+    {
+    public:
+        explicit Codec (const FileHeader& header);
+
+        /** Appends the quantisedDelta or compactDelta payload of particleCount GPU-layout particles to out and
+            returns its size.
+            A non-keyframe needs the previous encoded frame to have had the same particle count.
+        */
+        size_t encode (const void* particles, int particleCount, juce::Vector3D<double> worldOrigin,
+                       bool isKeyframe, std::vector<juce::uint8>& out);
+
+        /** Decodes one frame into particleCount GPU-layout particles with positions relative to targetOrigin
+            (compactDelta frames get white as a placeholder colour: see storesColour()). particlesOut may be nullptr
+            to only advance the delta state (seeking through frames nobody will see).
+            Returns false on a corrupt payload or a delta frame without its predecessor.
+        */
+        bool decode (const FrameHeader& frame, const juce::uint8* payload, juce::Vector3D<double> targetOrigin, void* particlesOut);
+
+        /** Forgets the previous frame (the next frame must be a keyframe). */
+        void reset()    { previous.clear(); previousCompact.clear(); }
+
+    private:
+        bool decodeCompact (const FrameHeader& frame, const juce::uint8* payload, juce::Vector3D<double> targetOrigin, float* out);
+
+        Encoding encoding;
+        float quantMin[3], positionScale[3], velocityScale, speedScale;
+        std::vector<QuantisedParticle> previous;
+        std::vector<CompactParticle> previousCompact;
+    };
+}
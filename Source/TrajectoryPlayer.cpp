@@ -0,0 +1,151 @@
+#include "TrajectoryPlayer.h"
+
+using namespace TrajectoryFile;
+
+//==============================================================================
+TrajectoryPlayer::TrajectoryPlayer()
+    : juce::Thread ("Trajectory prefetch")
+{
+}
+
+TrajectoryPlayer::~TrajectoryPlayer()
+{
+    stopThread (2000); // before the mapping goes away
+}
+
+bool TrajectoryPlayer::open (const juce::File& newFile, juce::String& error)
+{
+    jassert (mapping == nullptr);
+
+    file = newFile;
+
+    if (! readIndex (file, header, index, error))
+        return false;
+
+    if (index.empty())
+    {
+        error = file.getFileName() + " has no frames";
+        return false;
+    }
+
+    mapping = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly);
+
+    if (mapping->getData() == nullptr)
+    {
+        error = "Can't map " + file.getFullPathName();
+        return false;
+    }
+
+    const auto mappedBytes = (juce::int64) mapping->getSize();
+    const auto encoding = (Encoding) header.encoding;
+    keyframeBefore.resize (index.size());
+    int lastKeyframe = -1;
+
+    for (size_t i = 0; i < index.size(); ++i)
+    {
+        const auto& entry = index[i];
+
+        if (entry.offset < (juce::int64) sizeof (FileHeader)
+            || entry.offset + (juce::int64) sizeof (FrameHeader) + entry.payloadBytes > mappedBytes)
+        {
+            error = file.getFileName() + " is truncated (frame " + juce::String ((int) i) + " is past the end)";
+            return false;
+        }
+
+        const auto frame = getFrameHeader ((int) i);
+
+        if (frame.particleCount <= 0 || frame.payloadBytes != entry.payloadBytes
+            || frame.payloadBytes > getMaxPayloadBytes (encoding, frame.particleCount, false))
+        {
+            error = file.getFileName() + " has a corrupt frame index";
+            return false;
+        }
+
+        if ((frame.flags & keyframe) != 0 || encoding == Encoding::raw)
+            lastKeyframe = (int) i;
+
+        keyframeBefore[i] = lastKeyframe;
+        maxParticleCount = juce::jmax (maxParticleCount, frame.particleCount);
+    }
+
+    codec = std::make_unique<Codec> (header);
+    decodedFrame = -1;
+
+    startThread();
+    return true;
+}
+
+// The frame headers in the mapping aren't aligned (payload sizes are arbitrary), hence the copy.
+FrameHeader TrajectoryPlayer::getFrameHeader (int frame) const
+{
+    FrameHeader result;
+    std::memcpy (&result, static_cast<const juce::uint8*> (mapping->getData()) + index[(size_t) frame].offset, sizeof (result));
+    return result;
+}
+
+const juce::uint8* TrajectoryPlayer::getPayload (int frame) const
+{
+    return static_cast<const juce::uint8*> (mapping->getData()) + index[(size_t) frame].offset + (juce::int64) sizeof (FrameHeader);
+}
+
+bool TrajectoryPlayer::decodeFrame (int frame, juce::Vector3D<double> targetOrigin, void* particlesOut)
+{
+    jassert (juce::isPositiveAndBelow (frame, getNumFrames()));
+
+    const auto key = keyframeBefore[(size_t) frame];
+    if (key < 0)
+        return false;
+
+    // Only delta frames the codec hasn't seen need replaying; they're decoded without output.
+    auto from = (decodedFrame >= key && decodedFrame < frame) ? decodedFrame + 1 : key;
+
+    for (int f = from; f <= frame; ++f)
+    {
+        if (! codec->decode (getFrameHeader (f), getPayload (f), targetOrigin, f == frame ? particlesOut : nullptr))
+        {
+            decodedFrame = -1;
+            return false;
+        }
+    }
+
+    decodedFrame = frame;
+    return true;
+}
+
+void TrajectoryPlayer::prefetchFrom (int frame)
+{
+    if (juce::isPositiveAndBelow (frame, getNumFrames()))
+    {
+        prefetchRequest = frame;
+        notify();
+    }
+}
+
+//==============================================================================
+// Reads one byte per page, which is all it takes for the OS to fetch the page (and read ahead around it).
+void TrajectoryPlayer::run()
+{
+    constexpr juce::int64 pageBytes = 4096;
+    const auto* data = static_cast<const juce::uint8*> (mapping->getData());
+    const auto mappedBytes = (juce::int64) mapping->getSize();
+
+    while (! threadShouldExit())
+    {
+        const auto frame = prefetchRequest.exchange (-1);
+
+        if (frame < 0)
+        {
+            wait (100);
+            continue;
+        }
+
+        const auto start = index[(size_t) frame].offset;
+        const auto end = juce::jmin (mappedBytes, start + prefetchBytes);
+        volatile juce::uint8 sink = 0; // keeps the reads from being optimised away
+
+        for (auto position = start; position < end && ! threadShouldExit(); position += pageBytes)
+            sink = data[position];
+
+        juce::ignoreUnused (sink);
+    }
+}
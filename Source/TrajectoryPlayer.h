@@ -0,0 +1,68 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "TrajectoryFile.h"
+
+//==============================================================================
+/**
+    Random access to the frames of a trajectory recording (see TrajectoryFile) for playback.
+
+    The whole file is mapped read-only and the frame index is kept in memory, so finding any frame is a lookup and
+    decodeFrame() reads its payload straight out of the mapping into the caller's buffer (normally the persistently
+    mapped upload ring, i.e. one copy from page cache to GPU-visible memory). Raw and keyframes decode on their own;
+    a delta frame continues from the frame decoded last when that is on the way, otherwise from its keyframe, so a
+    seek costs at most one keyframe interval of delta decoding.
+
+    A prefetch thread touches the pages of the frames just ahead of the playhead (prefetchFrom()), so page faults -
+    the disk reads - happen off the thread that decodes and playback runs at disk speed.
+
+    open() may be called on any thread; after that the player belongs to one thread (the GL thread).
+*/
+class TrajectoryPlayer : private juce::Thread
+{
+public:
+    //==============================================================================
+    TrajectoryPlayer();
+    ~TrajectoryPlayer() override;
+
+    /** Maps file, reads its index and checks every frame lies inside the file. */
+    bool open (const juce::File& file, juce::String& error);
+
+    const juce::File& getFile() const noexcept      { return file; }
+    int getNumFrames() const noexcept               { return (int) index.size(); }
+    int getMaxParticleCount() const noexcept        { return maxParticleCount; }
+    TrajectoryFile::Encoding getEncoding() const noexcept { return (TrajectoryFile::Encoding) header.encoding; }
+
+    double getFrameTime (int frame) const           { return index[(size_t) frame].timeSeconds; }
+    double getDuration() const                      { return index.empty() ? 0.0 : index.back().timeSeconds; }
+    int getParticleCount (int frame) const          { return getFrameHeader (frame).particleCount; }
+
+    /** Decodes frame into getParticleCount (frame) particles in the GPU layout, positions relative to targetOrigin. */
+    bool decodeFrame (int frame, juce::Vector3D<double> targetOrigin, void* particlesOut);
+
+    /** Faults in the pages of the frames from frame onwards (about prefetchBytes' worth) on the prefetch thread. */
+    void prefetchFrom (int frame);
+
+private:
+    //==============================================================================
+    TrajectoryFile::FrameHeader getFrameHeader (int frame) const;
+    const juce::uint8* getPayload (int frame) const;
+    void run() override;
+
+    static constexpr juce::int64 prefetchBytes = (juce::int64) 64 << 20;
+
+    juce::File file;
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    TrajectoryFile::FileHeader header;
+    std::vector<TrajectoryFile::IndexEntry> index;
+    std::vector<int> keyframeBefore;    // per frame: the nearest keyframe at or before it (-1 if none)
+    int maxParticleCount = 0;
+
+    std::unique_ptr<TrajectoryFile::Codec> codec;
+    int decodedFrame = -1;              // frame the codec's delta state holds
+
+    std::atomic<int> prefetchRequest { -1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrajectoryPlayer)
+};
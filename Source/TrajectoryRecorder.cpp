@@ -0,0 +1,280 @@
+#include "TrajectoryRecorder.h"
+
+using namespace TrajectoryFile;
+
+namespace
+{
+    // Mapped (and grown) a window at a time: big enough that remapping is rare, small enough to stay cheap to map.
+    constexpr juce::int64 kWindowBytes = (juce::int64) 128 << 20;
+}
+
+//==============================================================================
+TrajectoryRecorder::TrajectoryRecorder()
+    : juce::Thread ("Trajectory writer")
+{
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    stop();
+}
+
+bool TrajectoryRecorder::start (const juce::File& newFile, const Settings& settings, juce::String& errorOut)
+{
+    jassert (! isRecording());
+
+    file = newFile;
+    header = FileHeader();
+    header.encoding = (juce::uint32) settings.encoding;
+    header.keyframeInterval = juce::jmax (1, settings.keyframeInterval);
+    header.quantMin[0] = settings.quantMin.x;
+    header.quantMin[1] = settings.quantMin.y;
+    header.quantMin[2] = settings.quantMin.z;
+    header.quantMax[0] = settings.quantMax.x;
+    header.quantMax[1] = settings.quantMax.y;
+    header.quantMax[2] = settings.quantMax.z;
+    header.velocityRange = settings.velocityRange;
+
+    {
+        if (file.existsAsFile() && ! file.deleteFile())
+        {
+            errorOut = "Can't replace " + file.getFullPathName();
+            return false;
+        }
+
+        juce::FileOutputStream out (file);
+
+        if (out.failedToOpen() || ! out.write (&header, sizeof (header)))
+        {
+            errorOut = "Can't write " + file.getFullPathName() + ": " + out.getStatus().getErrorMessage();
+            return false;
+        }
+    }
+
+    codec = std::make_unique<Codec> (header);
+    index.clear();
+    window.reset();
+    windowStart = 0;
+    fileSize = (juce::int64) sizeof (FileHeader);
+    writePosition = (juce::int64) sizeof (FileHeader);
+    framesSinceKeyframe = 0;
+    lastParticleCount = 0;
+    writeFailed = false;
+    error.clear();
+
+    framesWritten = 0;
+    bytesWritten = (juce::int64) sizeof (FileHeader);
+    droppedFrames = 0;
+    writeMilliseconds = 0.0f;
+
+    recording = true;
+    startThread();
+    return true;
+}
+
+bool TrajectoryRecorder::stop()
+{
+    if (! recording.exchange (false))
+        return error.isEmpty();
+
+    // The writer drains the queue before it exits, so every frame pushed so far ends up in the file.
+    signalThreadShouldExit();
+    notify();
+    stopThread (10000);
+
+    return finishFile() && ! writeFailed;
+}
+
+bool TrajectoryRecorder::pushFrame (const void* data, int particleCount, double timeSeconds, juce::Vector3D<double> worldOrigin,
+                                    std::function<void()> release)
+{
+    jassert (isRecording());
+
+    if (fifo.getFreeSpace() == 0)
+    {
+        ++droppedFrames;
+        return false;
+    }
+
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+    queue[(size_t) start1] = { data, particleCount, timeSeconds, worldOrigin, std::move (release) };
+    fifo.finishedWrite (1);
+
+    notify();
+    return true;
+}
+
+void TrajectoryRecorder::waitUntilIdle()
+{
+    while (fifo.getNumReady() > 0 && isThreadRunning())
+        juce::Thread::sleep (1);
+}
+
+//==============================================================================
+// Frames are taken off the queue only once they're written and released, so getNumReady() == 0 means idle.
+void TrajectoryRecorder::run()
+{
+    for (;;)
+    {
+        if (fifo.getNumReady() == 0)
+        {
+            if (threadShouldExit())
+                return;
+
+            wait (50);
+            continue;
+        }
+
+        int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+        fifo.prepareToRead (1, start1, size1, start2, size2);
+        auto& pending = queue[(size_t) start1];
+
+        if (! writeFailed)
+        {
+            const auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+            if (writeFrame (pending))
+                writeMilliseconds = (float) (0.9 * writeMilliseconds.load() + 0.1 * (juce::Time::getMillisecondCounterHiRes() - startMs));
+            else
+                writeFailed = true;
+        }
+
+        if (pending.release != nullptr)
+            pending.release();
+
+        pending = {};
+        fifo.finishedRead (1);
+    }
+}
+
+// Payload first, header last: a frame cut short by a crash then reads as the end of the recording (see readIndex()).
+bool TrajectoryRecorder::writeFrame (const PendingFrame& pending)
+{
+    const auto encoding = (Encoding) header.encoding;
+    const bool isKeyframe = encoding == Encoding::raw
+                         || index.empty()
+                         || pending.particleCount != lastParticleCount
+                         || framesSinceKeyframe >= header.keyframeInterval;
+
+    const void* payload = pending.data;
+    auto payloadBytes = getMaxPayloadBytes (encoding, pending.particleCount, true);
+
+    if (encoding != Encoding::raw)
+    {
+        scratch.clear();
+        payloadBytes = codec->encode (pending.data, pending.particleCount, pending.worldOrigin, isKeyframe, scratch);
+        payload = scratch.data();
+    }
+
+    FrameHeader frame;
+    frame.flags = isKeyframe ? keyframe : 0u;
+    frame.frameIndex = (juce::int64) index.size();
+    frame.timeSeconds = pending.timeSeconds;
+    frame.worldOrigin[0] = pending.worldOrigin.x;
+    frame.worldOrigin[1] = pending.worldOrigin.y;
+    frame.worldOrigin[2] = pending.worldOrigin.z;
+    frame.particleCount = pending.particleCount;
+    frame.payloadBytes = (juce::uint32) payloadBytes;
+
+    const auto frameStart = writePosition;
+
+    if (! writeAt (frameStart + (juce::int64) sizeof (frame), payload, payloadBytes)
+        || ! writeAt (frameStart, &frame, sizeof (frame)))
+        return false;
+
+    writePosition = frameStart + (juce::int64) (sizeof (frame) + payloadBytes);
+    index.push_back ({ frameStart, frame.timeSeconds, frame.flags, frame.payloadBytes });
+
+    framesSinceKeyframe = isKeyframe ? 1 : framesSinceKeyframe + 1;
+    lastParticleCount = pending.particleCount;
+
+    ++framesWritten;
+    bytesWritten += (juce::int64) (sizeof (frame) + payloadBytes);
+    return true;
+}
+
+bool TrajectoryRecorder::writeAt (juce::int64 position, const void* data, size_t numBytes)
+{
+    auto* src = static_cast<const juce::uint8*> (data);
+
+    while (numBytes > 0)
+    {
+        if (window == nullptr || position < windowStart || position >= windowStart + kWindowBytes)
+            if (! mapWindowAt (position))
+                return false;
+
+        const auto offsetInWindow = position - windowStart;
+        const auto chunk = (size_t) juce::jmin ((juce::int64) numBytes, kWindowBytes - offsetInWindow);
+
+        std::memcpy (static_cast<juce::uint8*> (window->getData()) + offsetInWindow, src, chunk);
+
+        src += chunk;
+        position += (juce::int64) chunk;
+        numBytes -= chunk;
+    }
+
+    return true;
+}
+
+// Writing through a mapping past the end of the file faults, so the file is extended (sparse where the
+// filesystem allows) to cover the whole window before it is mapped.
+bool TrajectoryRecorder::mapWindowAt (juce::int64 position)
+{
+    window.reset();
+    windowStart = position - position % kWindowBytes;
+
+    const auto windowEnd = windowStart + kWindowBytes;
+
+    if (fileSize < windowEnd)
+    {
+        juce::FileOutputStream out (file);
+
+        if (out.failedToOpen() || ! out.setPosition (windowEnd - 1) || ! out.writeByte (0))
+        {
+            error = "Can't grow " + file.getFullPathName() + " (disk full?): " + out.getStatus().getErrorMessage();
+            return false;
+        }
+
+        out.flush();
+        fileSize = windowEnd;
+    }
+
+    window = std::make_unique<juce::MemoryMappedFile> (file, juce::Range<juce::int64> (windowStart, windowEnd),
+                                                       juce::MemoryMappedFile::readWrite);
+
+    if (window->getData() == nullptr || (juce::int64) window->getSize() < kWindowBytes)
+    {
+        window.reset();
+        error = "Can't map " + file.getFullPathName();
+        return false;
+    }
+
+    return true;
+}
+
+bool TrajectoryRecorder::finishFile()
+{
+    window.reset();
+
+    juce::FileOutputStream out (file);
+
+    Footer footer;
+    footer.indexOffset = writePosition;
+    footer.numFrames = (juce::int64) index.size();
+
+    if (out.failedToOpen()
+        || ! out.setPosition (writePosition)
+        || ! out.write (index.data(), index.size() * sizeof (IndexEntry))
+        || ! out.write (&footer, sizeof (footer))
+        || out.truncate().failed())
+    {
+        if (error.isEmpty())
+            error = "Can't finish " + file.getFullPathName() + ": " + out.getStatus().getErrorMessage();
+
+        return false;
+    }
+
+    bytesWritten += (juce::int64) (index.size() * sizeof (IndexEntry) + sizeof (footer));
+    return true;
+}
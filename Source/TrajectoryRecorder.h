@@ -0,0 +1,110 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "TrajectoryFile.h"
+
+//==============================================================================
+/**
+    Appends per-frame particle state to a trajectory recording (see TrajectoryFile) from a writer thread.
+
+    The GL thread hands over frames it has read back asynchronously (pushFrame(), which never blocks); the writer
+    encodes each one (raw, or quantised + delta with periodic keyframes) and copies it into the file through a
+    read-write memory mapping of a fixed-size window at the end of the file. The file grows a window at a time, so
+    the disk sees large sequential writes from the page cache and nothing is written twice. stop() appends the
+    frame index and footer and trims the file to its real length.
+
+    Frame memory is borrowed, not copied: pushFrame() takes a release callback that the writer calls once the frame
+    is in the file, so frames can stay in a persistently mapped readback ring (ParticleStream::retainFrame()) until
+    then. A writer that falls behind costs dropped frames, never a stall.
+
+    start(), stop(), pushFrame() and waitUntilIdle() are for one thread (the GL thread); the getters are thread-safe.
+*/
+class TrajectoryRecorder : private juce::Thread
+{
+public:
+    //==============================================================================
+    struct Settings
+    {
+        TrajectoryFile::Encoding encoding = TrajectoryFile::Encoding::quantisedDelta;
+        int keyframeInterval = 60;
+        juce::Vector3D<float> quantMin, quantMax; // absolute world space; positions outside are clamped
+        float velocityRange = 1.0f;               // velocity components are clamped to +-velocityRange
+    };
+
+    TrajectoryRecorder();
+    ~TrajectoryRecorder() override;
+
+    /** Creates (or replaces) file and starts the writer. */
+    bool start (const juce::File& file, const Settings& settings, juce::String& error);
+
+    /** Writes every queued frame, then the index and footer, and closes the file. Blocks until that's done.
+        Returns false if anything failed to write (getError() says what); the frames before that are still readable.
+    */
+    bool stop();
+
+    bool isRecording() const noexcept       { return recording.load(); }
+
+    /** Queues one frame of particles in the GPU layout (positions relative to worldOrigin). data must stay valid
+        until release is called, which happens on the writer thread. Returns false and counts a drop if the queue is full.
+    */
+    bool pushFrame (const void* data, int particleCount, double timeSeconds, juce::Vector3D<double> worldOrigin,
+                    std::function<void()> release);
+
+    /** Counts a frame that never reached pushFrame() (e.g. no free readback slot), so the drop total stays honest. */
+    void addDroppedFrame() noexcept         { ++droppedFrames; }
+
+    /** Blocks until every queued frame has been written and released (call before freeing the memory they point to). */
+    void waitUntilIdle();
+
+    //==============================================================================
+    juce::int64 getFramesWritten() const noexcept       { return framesWritten.load(); }
+    juce::int64 getBytesWritten() const noexcept        { return bytesWritten.load(); }
+    juce::int64 getDroppedFrames() const noexcept       { return droppedFrames.load(); }
+    float getWriteMilliseconds() const noexcept         { return writeMilliseconds.load(); } // per frame, smoothed
+    const juce::String& getError() const noexcept       { return error; } // valid after stop()
+
+private:
+    //==============================================================================
+    struct PendingFrame
+    {
+        const void* data = nullptr;
+        int particleCount = 0;
+        double timeSeconds = 0.0;
+        juce::Vector3D<double> worldOrigin;
+        std::function<void()> release;
+    };
+
+    void run() override;
+    bool writeFrame (const PendingFrame& pending);
+    bool writeAt (juce::int64 position, const void* data, size_t numBytes);
+    bool mapWindowAt (juce::int64 position);
+    bool finishFile();
+
+    static constexpr int queueSize = 8;
+    std::array<PendingFrame, (size_t) queueSize> queue;
+    juce::AbstractFifo fifo { queueSize };
+
+    // Writer thread only (and the GL thread while the writer isn't running)
+    juce::File file;
+    TrajectoryFile::FileHeader header;
+    std::unique_ptr<TrajectoryFile::Codec> codec;
+    std::vector<TrajectoryFile::IndexEntry> index;
+    std::vector<juce::uint8> scratch;   // encoded payload of the current frame
+    std::unique_ptr<juce::MemoryMappedFile> window;
+    juce::int64 windowStart = 0;
+    juce::int64 fileSize = 0;           // allocated on disk (whole windows), trimmed by finishFile()
+    juce::int64 writePosition = 0;      // end of the last complete frame
+    int framesSinceKeyframe = 0;
+    int lastParticleCount = 0;
+    bool writeFailed = false;
+    juce::String error;
+
+    std::atomic<bool> recording { false };
+    std::atomic<juce::int64> framesWritten { 0 };
+    std::atomic<juce::int64> bytesWritten { 0 };
+    std::atomic<juce::int64> droppedFrames { 0 };
+    std::atomic<float> writeMilliseconds { 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrajectoryRecorder)
+};
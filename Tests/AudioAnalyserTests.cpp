@@ -0,0 +1,127 @@
+#include "AudioAnalyser.h"
+
+//==============================================================================
+class AudioAnalyserTests final : public juce::UnitTest
+{
+public:
+    AudioAnalyserTests() : juce::UnitTest ("Audio analyser", "JuicyFlock") {}
+
+    void runTest() override
+    {
+        constexpr int hop = AudioAnalyser::hopSize;
+
+        const auto audio = readWav (writeWav (makeTestSignal()));
+        expectEquals (audio.getNumSamples(), kLengthSamples);
+
+        AudioAnalyser analyser;
+        const auto frames = analyser.analyse (audio, kSampleRate);
+        expectEquals ((int) frames.size(), kLengthSamples / hop);
+
+        beginTest ("Bass energy follows the tone");
+        {
+            // Frames whose window lies entirely inside the tone (before its fade), then entirely after it.
+            const int toneFrames = (kToneEndSamples - kFadeSamples) / hop - 1;
+            const int silentFrom = (kToneEndSamples + AudioAnalyser::fftSize) / hop;
+
+            for (int i = 1; i < toneFrames; ++i)
+                expectGreaterThan (frames[(size_t) i].bands[0], 0.9f, "bass in frame " + juce::String (i));
+
+            for (int i = silentFrom; i < (int) frames.size(); ++i)
+            {
+                expectEquals (frames[(size_t) i].bands[0], 0.0f, "bass in frame " + juce::String (i));
+                expectEquals (frames[(size_t) i].level, 0.0f, "level in frame " + juce::String (i));
+            }
+        }
+
+        beginTest ("Onsets at the start of the tone and at each click");
+        {
+            // A click shows up in the first hop that ends after it.
+            juce::Array<int> expected { 0 };
+
+            for (auto seconds : kClickSeconds)
+                expected.add (juce::roundToInt (seconds * kSampleRate) / hop);
+
+            juce::Array<int> onsets;
+
+            for (size_t i = 0; i < frames.size(); ++i)
+                if (frames[i].onset > 0.0f)
+                    onsets.add ((int) i);
+
+            expect (onsets == expected, "onsets in frames " + toString (onsets) + ", expected " + toString (expected));
+        }
+    }
+
+private:
+    static constexpr double kSampleRate = 44100.0;
+    static constexpr int kLengthSamples = 110250;                           // 2.5 s
+    static constexpr int kToneEndSamples = 88200;                           // 2 s of tone, then silence
+    static constexpr int kFadeSamples = 2205;                               // 50 ms fade out, so the end isn't an onset
+    static constexpr double kToneHz = 2.0 * kSampleRate / AudioAnalyser::fftSize; // ~86 Hz, centred on FFT bin 2
+    static constexpr double kClickSeconds[] = { 0.5, 1.0, 1.5 };
+
+    // A bass tone centred on a bin (so its spectrum doesn't change from hop to hop) with single-sample clicks on top.
+    static juce::AudioBuffer<float> makeTestSignal()
+    {
+        juce::AudioBuffer<float> buffer (1, kLengthSamples);
+        buffer.clear();
+        auto* samples = buffer.getWritePointer (0);
+
+        for (int i = 0; i < kToneEndSamples; ++i)
+        {
+            const auto fade = juce::jmin (1.0, (double) (kToneEndSamples - i) / kFadeSamples);
+            samples[i] = (float) (0.5 * fade * std::sin (juce::MathConstants<double>::twoPi * kToneHz * i / kSampleRate));
+        }
+
+        for (auto seconds : kClickSeconds)
+            samples[juce::roundToInt (seconds * kSampleRate)] += 0.9f;
+
+        return buffer;
+    }
+
+    // 16-bit mono WAV, in memory, so the test goes through the same reader a file would.
+    juce::MemoryBlock writeWav (const juce::AudioBuffer<float>& buffer)
+    {
+        juce::MemoryBlock wav;
+        juce::WavAudioFormat format;
+        auto stream = std::make_unique<juce::MemoryOutputStream> (wav, false);
+        std::unique_ptr<juce::AudioFormatWriter> writer (format.createWriterFor (stream.get(), kSampleRate, 1, 16, {}, 0));
+        expect (writer != nullptr, "can't create a WAV writer");
+
+        if (writer != nullptr)
+        {
+            stream.release(); // the writer owns it now
+            expect (writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples()), "WAV not written");
+            writer.reset();   // finishes the header
+        }
+
+        return wav;
+    }
+
+    juce::AudioBuffer<float> readWav (const juce::MemoryBlock& wav)
+    {
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatReader> reader (format.createReaderFor (new juce::MemoryInputStream (wav, false), true));
+        juce::AudioBuffer<float> buffer;
+        expect (reader != nullptr, "can't read the WAV back");
+
+        if (reader != nullptr)
+        {
+            buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+            reader->read (&buffer, 0, buffer.getNumSamples(), 0, true, true);
+        }
+
+        return buffer;
+    }
+
+    static juce::String toString (const juce::Array<int>& frames)
+    {
+        juce::StringArray text;
+
+        for (auto frame : frames)
+            text.add (juce::String (frame));
+
+        return text.joinIntoString (", ");
+    }
+};
+
+static AudioAnalyserTests audioAnalyserTests;
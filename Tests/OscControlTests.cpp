@@ -0,0 +1,146 @@
+#include "OscControl.h"
+
+//==============================================================================
+class OscControlTests final : public juce::UnitTest
+{
+public:
+    OscControlTests() : juce::UnitTest ("OSC control", "JuicyFlock") {}
+
+    void runTest() override
+    {
+        using Type = OscControl::Command::Type;
+
+        beginTest ("Settings");
+        {
+            const auto command = expectDecodes (juce::OSCMessage ("/flock/param/neighborRadius", 1.5f), Type::param);
+            expectEquals (juce::String (command.name), juce::String ("neighborRadius"));
+            expectEquals (command.values[0], 1.5f);
+
+            const auto fromInt = expectDecodes (juce::OSCMessage ("/flock/param/colorMode", 2), Type::param);
+            expectEquals (fromInt.values[0], 2.0f);
+
+            expectIgnored (juce::OSCMessage ("/flock/param/neighborRadius"), "a setting without a value");
+            expectIgnored (juce::OSCMessage ("/flock/param/neighborRadius", juce::String ("big")), "a text value");
+            expectIgnored (juce::OSCMessage ("/flock/param/neighborRadius", std::numeric_limits<float>::quiet_NaN()),
+                           "a NaN value");
+            expectIgnored (juce::OSCMessage ("/flock/param/neighborRadius", std::numeric_limits<float>::infinity()),
+                           "an infinite value");
+        }
+
+        beginTest ("Presets");
+        {
+            const auto byNumber = expectDecodes (juce::OSCMessage ("/flock/preset", 3), Type::preset);
+            expectEquals (byNumber.index, 2);
+
+            const auto byFloat = expectDecodes (juce::OSCMessage ("/flock/preset", 1.0f), Type::preset);
+            expectEquals (byFloat.index, 0);
+
+            const auto byName = expectDecodes (juce::OSCMessage ("/flock/preset", juce::String ("Swarm")), Type::preset);
+            expectEquals (juce::String (byName.name), juce::String ("Swarm"));
+            expectEquals (byName.index, -1);
+
+            expectIgnored (juce::OSCMessage ("/flock/preset", 0), "preset 0 (they count from 1)");
+            expectIgnored (juce::OSCMessage ("/flock/preset"), "a preset without an argument");
+        }
+
+        beginTest ("Restart and the camera");
+        {
+            expectDecodes (juce::OSCMessage ("/flock/restart"), Type::restart);
+            expectDecodes (juce::OSCMessage ("/flock/camera/reset"), Type::cameraReset);
+
+            const auto orbit = expectDecodes (juce::OSCMessage ("/flock/camera/orbit", 45.0f, -10), Type::cameraOrbit);
+            expectEquals (orbit.values[0], 45.0f);
+            expectEquals (orbit.values[1], -10.0f);
+
+            const auto distance = expectDecodes (juce::OSCMessage ("/flock/camera/distance", 30.0f), Type::cameraDistance);
+            expectEquals (distance.values[0], 30.0f);
+
+            const auto pan = expectDecodes (juce::OSCMessage ("/flock/camera/pan", 1.0f, 2.0f), Type::cameraPan);
+            expectEquals (pan.values[1], 2.0f);
+
+            expectIgnored (juce::OSCMessage ("/flock/camera/orbit", 45.0f), "an orbit with one angle");
+            expectIgnored (juce::OSCMessage ("/flock/camera/pan", 1.0f, juce::String ("up")), "a pan with a text argument");
+        }
+
+        beginTest ("Unknown addresses");
+        {
+            expectIgnored (juce::OSCMessage ("/flock/explode"), "an unknown command");
+            expectIgnored (juce::OSCMessage ("/other/param/neighborRadius", 1.0f), "another namespace");
+        }
+
+        beginTest ("Messages sent over UDP arrive through the queue");
+        {
+            OscControl control;
+            std::vector<OscControl::Command> commands;
+            int drains = 0;
+            control.onCommand = [&commands] (const OscControl::Command& command) { commands.push_back (command); };
+            control.onDrained = [&drains] { ++drains; };
+
+            const auto port = startOnFreePort (control);
+
+            juce::OSCSender sender;
+            expect (sender.connect ("127.0.0.1", port), "can't send to port " + juce::String (port));
+            expect (sender.send ("/flock/param/neighborRadius", 2.5f));
+            expect (sender.send ("/flock/camera/orbit", 30.0f, -15));
+            expect (sender.send ("/flock/explode")); // received, but not queued
+
+            // The receiver counts a message before queueing it, so once the last one is counted the others are queued.
+            for (int i = 0; i < 200 && control.getReceivedMessages() < 3; ++i)
+                juce::Thread::sleep (10);
+
+            expectEquals (control.getReceivedMessages(), (juce::int64) 3);
+            expectEquals (control.getDroppedMessages(), (juce::int64) 0);
+
+            // Nothing runs a message loop here, so drain as the message thread would.
+            control.drainCommands();
+            expectEquals ((int) commands.size(), 2);
+            expectEquals (drains, 1);
+
+            if (commands.size() == 2)
+            {
+                expect (commands[0].type == OscControl::Command::Type::param);
+                expectEquals (juce::String (commands[0].name), juce::String ("neighborRadius"));
+                expectEquals (commands[0].values[0], 2.5f);
+
+                expect (commands[1].type == OscControl::Command::Type::cameraOrbit);
+                expectEquals (commands[1].values[0], 30.0f);
+                expectEquals (commands[1].values[1], -15.0f);
+            }
+
+            sender.disconnect();
+            control.stop();
+        }
+    }
+
+private:
+    OscControl::Command expectDecodes (const juce::OSCMessage& message, OscControl::Command::Type type)
+    {
+        OscControl::Command command;
+        const auto address = message.getAddressPattern().toString();
+
+        expect (OscControl::decode (message, command), "didn't decode " + address);
+        expect (command.type == type, "wrong command for " + address);
+        return command;
+    }
+
+    // Any port will do; one in the dynamic range, so the test doesn't clash with a running app on the default 9000.
+    int startOnFreePort (OscControl& control)
+    {
+        juce::String error;
+
+        for (int port = 49800; port < 49900; ++port)
+            if (control.start (port, error))
+                return port;
+
+        expect (false, "no free UDP port for OSC: " + error);
+        return 0;
+    }
+
+    void expectIgnored (const juce::OSCMessage& message, const juce::String& what)
+    {
+        OscControl::Command command;
+        expect (! OscControl::decode (message, command), "decoded " + what);
+    }
+};
+
+static OscControlTests oscControlTests;
@@ -0,0 +1,158 @@
+#include "ParamTimeline.h"
+
+//==============================================================================
+class ParamTimelineTests final : public juce::UnitTest
+{
+public:
+    ParamTimelineTests() : juce::UnitTest ("Parameter timeline", "JuicyFlock") {}
+
+    void runTest() override
+    {
+        beginTest ("Linear tracks interpolate and hold their ends");
+        {
+            ParamTimeline timeline;
+            expectLoads (timeline, R"({ "format": "JuicyFlock timeline", "version": 1,
+                                        "tracks": { "weightAlignment": [ { "time": 2, "value": 1 },
+                                                                         { "time": 12, "value": 3 } ] } })");
+
+            expectWithinAbsoluteError (valueAt (timeline, "weightAlignment", 0.0), 1.0, 1.0e-9);
+            expectWithinAbsoluteError (valueAt (timeline, "weightAlignment", 7.0), 2.0, 1.0e-9);
+            expectWithinAbsoluteError (valueAt (timeline, "weightAlignment", 9.5), 2.5, 1.0e-9);
+            expectWithinAbsoluteError (valueAt (timeline, "weightAlignment", 50.0), 3.0, 1.0e-9);
+            expectEquals (timeline.getDuration(), 12.0);
+            expect (timeline.getTrackNames() == juce::StringArray { "weightAlignment" });
+        }
+
+        beginTest ("Smooth and step curves");
+        {
+            ParamTimeline timeline;
+            expectLoads (timeline, R"({ "format": "JuicyFlock timeline", "version": 1,
+                                        "tracks": { "hueOffset": [ { "time": 0, "value": 0, "curve": "smooth" },
+                                                                   { "time": 10, "value": 1 } ],
+                                                    "colorMode": [ { "time": 0, "value": 1, "curve": "step" },
+                                                                   { "time": 30, "value": 3 } ] } })");
+
+            // smoothstep (0.25) = 0.25^2 * (3 - 2 * 0.25)
+            expectWithinAbsoluteError (valueAt (timeline, "hueOffset", 2.5), 0.15625, 1.0e-9);
+            expectWithinAbsoluteError (valueAt (timeline, "hueOffset", 5.0), 0.5, 1.0e-9);
+            expectWithinAbsoluteError (valueAt (timeline, "colorMode", 29.9), 1.0, 1.0e-9);
+            expectWithinAbsoluteError (valueAt (timeline, "colorMode", 30.0), 3.0, 1.0e-9);
+        }
+
+        beginTest ("Boolean tracks step");
+        {
+            ParamTimeline timeline;
+            expectLoads (timeline, R"({ "format": "JuicyFlock timeline", "version": 1,
+                                        "tracks": { "hdrBloom": [ { "time": 0, "value": false },
+                                                                  { "time": 25, "value": true } ] } })");
+
+            expect (timeline.evaluate (24.9)["hdrBloom"].isBool());
+            expect (! (bool) timeline.evaluate (24.9)["hdrBloom"]);
+            expect ((bool) timeline.evaluate (25.0)["hdrBloom"]);
+        }
+
+        beginTest ("Keys are sorted, and a later key at the same time takes over");
+        {
+            ParamTimeline timeline;
+            expectLoads (timeline, R"({ "format": "JuicyFlock timeline", "version": 1,
+                                        "tracks": { "maxSpeed": [ { "time": 10, "value": 4 },
+                                                                  { "time": 5, "value": 2 },
+                                                                  { "time": 5, "value": 4 },
+                                                                  { "time": 0, "value": 1 } ] } })");
+
+            expectWithinAbsoluteError (valueAt (timeline, "maxSpeed", 2.5), 1.5, 1.0e-9);
+            expectWithinAbsoluteError (valueAt (timeline, "maxSpeed", 5.0), 4.0, 1.0e-9);
+            expectWithinAbsoluteError (valueAt (timeline, "maxSpeed", 7.5), 4.0, 1.0e-9);
+        }
+
+        beginTest ("Looping and an explicit duration");
+        {
+            ParamTimeline timeline;
+            expectLoads (timeline, R"({ "format": "JuicyFlock timeline", "version": 1, "loop": true, "duration": 20,
+                                        "tracks": { "simSpeed": [ { "time": 0, "value": 1 },
+                                                                  { "time": 10, "value": 2 } ] } })");
+
+            expect (timeline.isLooping());
+            expectEquals (timeline.getDuration(), 20.0);
+            expectWithinAbsoluteError (valueAt (timeline, "simSpeed", 25.0), 1.5, 1.0e-9);
+            expectWithinAbsoluteError (valueAt (timeline, "simSpeed", 35.0), 2.0, 1.0e-9);
+        }
+
+        beginTest ("Invalid timelines are rejected");
+        {
+            expectRejected ("invalid JSON", R"({ "format": "JuicyFlock timeline", )");
+            expectRejected ("another format", R"({ "format": "JuicyFlock preset", "version": 1, "tracks": {} })");
+            expectRejected ("a newer version",
+                            R"({ "format": "JuicyFlock timeline", "version": 2,
+                                 "tracks": { "a": [ { "time": 0, "value": 1 } ] } })");
+            expectRejected ("no tracks", R"({ "format": "JuicyFlock timeline", "version": 1, "tracks": {} })");
+            expectRejected ("a track that isn't an array",
+                            R"({ "format": "JuicyFlock timeline", "version": 1, "tracks": { "a": 1 } })");
+            expectRejected ("a track without keys",
+                            R"({ "format": "JuicyFlock timeline", "version": 1, "tracks": { "a": [] } })");
+            expectRejected ("a key without a time",
+                            R"({ "format": "JuicyFlock timeline", "version": 1, "tracks": { "a": [ { "value": 1 } ] } })");
+            expectRejected ("a negative time",
+                            R"({ "format": "JuicyFlock timeline", "version": 1,
+                                 "tracks": { "a": [ { "time": -1, "value": 1 } ] } })");
+            expectRejected ("a text value",
+                            R"({ "format": "JuicyFlock timeline", "version": 1,
+                                 "tracks": { "a": [ { "time": 0, "value": "x" } ] } })");
+            expectRejected ("booleans mixed with numbers",
+                            R"({ "format": "JuicyFlock timeline", "version": 1,
+                                 "tracks": { "a": [ { "time": 0, "value": true }, { "time": 1, "value": 1 } ] } })");
+            expectRejected ("an unknown curve",
+                            R"({ "format": "JuicyFlock timeline", "version": 1,
+                                 "tracks": { "a": [ { "time": 0, "value": 1, "curve": "bounce" } ] } })");
+            expectRejected ("a zero duration",
+                            R"({ "format": "JuicyFlock timeline", "version": 1, "duration": 0,
+                                 "tracks": { "a": [ { "time": 0, "value": 1 } ] } })");
+            expectRejected ("a loop with nothing to loop",
+                            R"({ "format": "JuicyFlock timeline", "version": 1, "loop": true,
+                                 "tracks": { "a": [ { "time": 0, "value": 1 } ] } })");
+        }
+
+        beginTest ("The bundled timelines are valid");
+        {
+            const auto directory = juce::File (JUICYFLOCK_SOURCE_DIR).getChildFile ("Timelines");
+            const auto files = directory.findChildFiles (juce::File::findFiles, false, "*.json");
+            expect (! files.isEmpty(), "no bundled timelines found");
+
+            for (const auto& file : files)
+            {
+                ParamTimeline timeline;
+                juce::String error;
+                expect (timeline.loadFromFile (file, error), error);
+            }
+        }
+    }
+
+private:
+    static bool load (ParamTimeline& timeline, const juce::String& json, juce::String& error)
+    {
+        juce::TemporaryFile temp (juce::String (".json"));
+        temp.getFile().replaceWithText (json);
+        return timeline.loadFromFile (temp.getFile(), error);
+    }
+
+    void expectLoads (ParamTimeline& timeline, const juce::String& json)
+    {
+        juce::String error;
+        expect (load (timeline, json, error), error);
+    }
+
+    void expectRejected (const juce::String& what, const juce::String& json)
+    {
+        ParamTimeline timeline;
+        juce::String error;
+        expect (! load (timeline, json, error), "accepted " + what);
+        expect (error.isNotEmpty(), "no error for " + what);
+    }
+
+    static double valueAt (ParamTimeline& timeline, const char* track, double timeSeconds)
+    {
+        return (double) timeline.evaluate (timeSeconds)[track];
+    }
+};
+
+static ParamTimelineTests paramTimelineTests;
@@ -0,0 +1,130 @@
+#include "PresetFile.h"
+
+//==============================================================================
+class PresetFileTests final : public juce::UnitTest
+{
+public:
+    PresetFileTests() : juce::UnitTest ("Preset file", "JuicyFlock") {}
+
+    void runTest() override
+    {
+        beginTest ("Round trip");
+        {
+            PresetFile written;
+            written.name = "Murmuration";
+            written.hasWorldBox = true;
+            written.worldMin = { -30.0f, -10.0f, -30.0f };
+            written.worldMax = { 30.0f, 10.0f, 30.0f };
+            written.hasDistribution = true;
+            written.distribution = PresetFile::Distribution::clusters;
+            written.restart = true;
+
+            auto* params = new juce::DynamicObject();
+            params->setProperty ("neighborRadius", 1.6);
+            params->setProperty ("colorMode", 1);
+            written.params = juce::var (params);
+
+            juce::TemporaryFile temp (juce::String (".json"));
+            juce::String error;
+            expect (written.writeToFile (temp.getFile(), error), error);
+
+            PresetFile read;
+            expect (read.readFromFile (temp.getFile(), error), error);
+            expectEquals (read.name, written.name);
+            expect (read.hasWorldBox && read.hasDistribution && read.restart);
+            expectEquals (read.worldMin.x, -30.0f);
+            expectEquals (read.worldMax.y, 10.0f);
+            expect (read.distribution == PresetFile::Distribution::clusters);
+            expectEquals ((double) read.params["neighborRadius"], 1.6);
+            expectEquals ((int) read.params["colorMode"], 1);
+        }
+
+        beginTest ("Everything but the format is optional");
+        {
+            PresetFile preset;
+            juce::String error;
+            expect (readJson (preset, "Hue shift", R"({ "format": "JuicyFlock preset", "params": { "hueOffset": 0.5 } })",
+                              error), error);
+            expectEquals (preset.name, juce::String ("Hue shift"));
+            expect (! preset.hasWorldBox && ! preset.hasDistribution && ! preset.restart);
+            expectEquals ((double) preset.params["hueOffset"], 0.5);
+
+            expect (readJson (preset, "Empty", R"({ "format": "JuicyFlock preset", "version": 1 })", error), error);
+            expect (preset.params.isVoid());
+        }
+
+        beginTest ("Invalid presets are rejected");
+        {
+            expectRejected ("invalid JSON", R"({ "format": "JuicyFlock preset", )");
+            expectRejected ("another format", R"({ "format": "JuicyFlock timeline", "version": 1 })");
+            expectRejected ("a newer version", R"({ "format": "JuicyFlock preset", "version": 2 })");
+            expectRejected ("params that aren't an object", R"({ "format": "JuicyFlock preset", "params": [ 1, 2 ] })");
+            expectRejected ("a world without a max", R"({ "format": "JuicyFlock preset", "world": { "min": [ 0, 0, 0 ] } })");
+            expectRejected ("a two-component world corner",
+                            R"({ "format": "JuicyFlock preset", "world": { "min": [ 0, 0 ], "max": [ 1, 1 ] } })");
+            expectRejected ("a world corner that isn't numbers",
+                            R"({ "format": "JuicyFlock preset", "world": { "min": [ 0, 0, "a" ], "max": [ 1, 1, 1 ] } })");
+            expectRejected ("an empty world box",
+                            R"({ "format": "JuicyFlock preset", "world": { "min": [ 0, 0, 0 ], "max": [ 1, 0, 1 ] } })");
+            expectRejected ("a world box too large",
+                            R"({ "format": "JuicyFlock preset", "world": { "min": [ 0, 0, 0 ], "max": [ 1, 1, 2000000 ] } })");
+            expectRejected ("an unknown distribution", R"({ "format": "JuicyFlock preset", "distribution": "ring" })");
+        }
+
+        beginTest ("Preset files are listed in natural order");
+        {
+            const auto directory = juce::File::getSpecialLocation (juce::File::tempDirectory)
+                                       .getNonexistentChildFile ("JuicyFlockPresetTests", "", false);
+            expect (directory.createDirectory().wasOk());
+
+            for (const auto* name : { "10 Ten.json", "2 Two.json", "1 One.json", "notes.txt" })
+                directory.getChildFile (name).replaceWithText ("{}");
+
+            const auto files = PresetFile::findPresetFiles (directory);
+            expectEquals (files.size(), 3);
+
+            if (files.size() == 3)
+            {
+                expectEquals (files[0].getFileName(), juce::String ("1 One.json"));
+                expectEquals (files[1].getFileName(), juce::String ("2 Two.json"));
+                expectEquals (files[2].getFileName(), juce::String ("10 Ten.json"));
+            }
+
+            directory.deleteRecursively();
+        }
+
+        beginTest ("The bundled presets are valid");
+        {
+            const auto files = PresetFile::findPresetFiles (juce::File (JUICYFLOCK_SOURCE_DIR).getChildFile ("Presets"));
+            expect (! files.isEmpty(), "no bundled presets found");
+
+            for (const auto& file : files)
+            {
+                PresetFile preset;
+                juce::String error;
+                expect (preset.readFromFile (file, error), error);
+            }
+        }
+    }
+
+private:
+    static bool readJson (PresetFile& preset, const juce::String& name, const juce::String& json, juce::String& error)
+    {
+        const auto file = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile (name + ".json");
+        file.replaceWithText (json);
+
+        const auto ok = preset.readFromFile (file, error);
+        file.deleteFile();
+        return ok;
+    }
+
+    void expectRejected (const juce::String& what, const juce::String& json)
+    {
+        PresetFile preset;
+        juce::String error;
+        expect (! readJson (preset, "Rejected", json, error), "accepted " + what);
+        expect (error.isNotEmpty(), "no error for " + what);
+    }
+};
+
+static PresetFileTests presetFileTests;
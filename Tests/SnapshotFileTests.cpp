@@ -0,0 +1,173 @@
+#include "SnapshotFile.h"
+
+//==============================================================================
+class SnapshotFileTests final : public juce::UnitTest
+{
+public:
+    SnapshotFileTests() : juce::UnitTest ("Snapshot file", "JuicyFlock") {}
+
+    void runTest() override
+    {
+        beginTest ("Raw snapshot round trip");
+        {
+            juce::TemporaryFile temp (juce::String (".jfsnap"));
+            const auto written = makeSnapshot (SnapshotFile::Encoding::raw, 48);
+            juce::String error;
+
+            expect (written.writeToFile (temp.getFile(), error), error);
+
+            SnapshotFile read;
+            expect (read.readFromFile (temp.getFile(), error), error);
+            expectSame (read, written);
+        }
+
+        beginTest ("Compact snapshot round trip");
+        {
+            juce::TemporaryFile temp (juce::String (".jfsnap"));
+            const auto written = makeSnapshot (SnapshotFile::Encoding::compact, SnapshotFile::bytesPerCompactParticle);
+            juce::String error;
+
+            expect (written.writeToFile (temp.getFile(), error), error);
+
+            SnapshotFile read;
+            expect (read.readFromFile (temp.getFile(), error), error);
+            expectSame (read, written);
+            expect (sameVector (read.quantMin, written.quantMin) && sameVector (read.quantMax, written.quantMax));
+            expectEquals (read.speedRange, written.speedRange);
+        }
+
+        beginTest ("Version 1 files read as raw");
+        {
+            juce::TemporaryFile temp (juce::String (".jfsnap"));
+            writeFields (temp.getFile(), 1, 3, 48, 0, 0.0f, 3 * 48);
+
+            SnapshotFile read;
+            juce::String error;
+            expect (read.readFromFile (temp.getFile(), error), error);
+            expect (read.encoding == SnapshotFile::Encoding::raw);
+            expectEquals (read.particleCount, 3);
+            expectEquals ((int) read.params["seed"], 7);
+            expectEquals (read.particles.getSize(), (size_t) (3 * 48));
+            expect (sameVector (read.worldOrigin, juce::Vector3D<double> (0.5, 0.5, 0.5)));
+        }
+
+        beginTest ("Damaged files are rejected");
+        {
+            expectRejected ("a future version", 3, 3, 48, 0, 0.0f, 3 * 48);
+            expectRejected ("an unknown encoding", 2, 3, 48, 7, 1.0f, 3 * 48);
+            expectRejected ("compact with the wrong record size", 2, 3, 48, 1, 1.0f, 3 * 48);
+            expectRejected ("compact without a speed range", 2, 3, 12, 1, 0.0f, 3 * 12);
+            expectRejected ("no particles", 2, 0, 48, 0, 0.0f, 0);
+            expectRejected ("a truncated particle block", 2, 3, 48, 0, 0.0f, 3 * 48 - 1);
+            expectRejected ("trailing bytes", 2, 3, 48, 0, 0.0f, 3 * 48 + 1);
+
+            juce::TemporaryFile temp (juce::String (".jfsnap"));
+            temp.getFile().replaceWithText ("not a snapshot");
+
+            SnapshotFile read;
+            juce::String error;
+            expect (! read.readFromFile (temp.getFile(), error), "accepted a file without the magic");
+            expect (error.isNotEmpty());
+        }
+    }
+
+private:
+    template <typename Type>
+    static bool sameVector (juce::Vector3D<Type> a, juce::Vector3D<Type> b)
+    {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+
+    static SnapshotFile makeSnapshot (SnapshotFile::Encoding encoding, int bytesPerParticle)
+    {
+        SnapshotFile snapshot;
+        snapshot.particleCount = 5;
+        snapshot.bytesPerParticle = bytesPerParticle;
+        snapshot.worldMin = { -10.0f, -8.0f, -6.0f };
+        snapshot.worldMax = { 10.0f, 8.0f, 6.0f };
+        snapshot.cellSize = 1.5f;
+        snapshot.gridDims = { 14, 11, 8 };
+        snapshot.worldOrigin = { 1.0e6, -2.5, 0.125 };
+        snapshot.encoding = encoding;
+        snapshot.quantMin = { -12.0f, -10.0f, -8.0f };
+        snapshot.quantMax = { 12.0f, 10.0f, 8.0f };
+        snapshot.speedRange = 9.0f;
+
+        auto* params = new juce::DynamicObject();
+        params->setProperty ("seed", 7);
+        params->setProperty ("neighborRadius", 1.6);
+        snapshot.params = juce::var (params);
+
+        snapshot.particles.setSize ((size_t) (snapshot.particleCount * bytesPerParticle));
+
+        for (size_t i = 0; i < snapshot.particles.getSize(); ++i)
+            static_cast<juce::uint8*> (snapshot.particles.getData())[i] = (juce::uint8) (i * 37 + 11);
+
+        return snapshot;
+    }
+
+    void expectSame (const SnapshotFile& read, const SnapshotFile& written)
+    {
+        expectEquals (read.particleCount, written.particleCount);
+        expectEquals (read.bytesPerParticle, written.bytesPerParticle);
+        expect (sameVector (read.worldMin, written.worldMin) && sameVector (read.worldMax, written.worldMax));
+        expectEquals (read.cellSize, written.cellSize);
+        expect (sameVector (read.gridDims, written.gridDims));
+        expect (sameVector (read.worldOrigin, written.worldOrigin), "the floating origin lost precision");
+        expect (read.encoding == written.encoding);
+        expectEquals ((int) read.params["seed"], 7);
+        expectEquals ((double) read.params["neighborRadius"], 1.6);
+        expect (read.particles == written.particles, "the particle block changed");
+    }
+
+    // Writes a snapshot field by field, so the tests can produce version 1 files and damaged headers.
+    static void writeFields (const juce::File& file, juce::uint32 version, int particleCount, int bytesPerParticle,
+                             juce::uint32 encoding, float speedRange, size_t particleBytes)
+    {
+        file.deleteFile();
+        juce::FileOutputStream out (file);
+
+        out.write ("JFSN", 4);
+        out.writeInt ((int) version);
+        out.writeInt (particleCount);
+        out.writeInt (bytesPerParticle);
+
+        for (int i = 0; i < 7; ++i)
+            out.writeFloat (i < 3 ? -1.0f : 1.0f); // worldMin, worldMax, cellSize
+
+        for (int i = 0; i < 3; ++i)
+            out.writeInt (2); // gridDims
+
+        for (int i = 0; i < 3; ++i)
+            out.writeDouble (0.5); // worldOrigin
+
+        if (version >= 2)
+        {
+            out.writeInt ((int) encoding);
+
+            for (int i = 0; i < 6; ++i)
+                out.writeFloat (i < 3 ? -2.0f : 2.0f); // quantMin, quantMax
+
+            out.writeFloat (speedRange);
+        }
+
+        const juce::String params ("{ \"seed\": 7 }");
+        out.writeInt ((int) params.getNumBytesAsUTF8());
+        out.write (params.toRawUTF8(), params.getNumBytesAsUTF8());
+        out.writeRepeatedByte (0x5a, particleBytes);
+    }
+
+    void expectRejected (const juce::String& what, juce::uint32 version, int particleCount, int bytesPerParticle,
+                         juce::uint32 encoding, float speedRange, size_t particleBytes)
+    {
+        juce::TemporaryFile temp (juce::String (".jfsnap"));
+        writeFields (temp.getFile(), version, particleCount, bytesPerParticle, encoding, speedRange, particleBytes);
+
+        SnapshotFile read;
+        juce::String error;
+        expect (! read.readFromFile (temp.getFile(), error), "accepted " + what);
+        expect (error.isNotEmpty(), "no error for " + what);
+    }
+};
+
+static SnapshotFileTests snapshotFileTests;
@@ -0,0 +1,18 @@
+#include <JuceHeader.h>
+
+//==============================================================================
+// Runs every JuicyFlock unit test (the "JuicyFlock" category; each Tests/*.cpp registers its own) and exits with 1 if
+// any of them failed, so ctest can run it as is.
+int main()
+{
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runTestsInCategory ("JuicyFlock");
+
+    int failures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        failures += runner.getResult (i)->failures;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,398 @@
+#include "TrajectoryFile.h"
+
+using namespace TrajectoryFile;
+
+//==============================================================================
+class TrajectoryFileTests final : public juce::UnitTest
+{
+public:
+    TrajectoryFileTests() : juce::UnitTest ("Trajectory file", "JuicyFlock") {}
+
+    void runTest() override
+    {
+        beginTest ("Quantised delta round trip");
+        {
+            const auto header = makeHeader (Encoding::quantisedDelta);
+            Codec encoder (header), decoder (header);
+            auto random = getRandom();
+            auto particles = makeParticles (random, 200);
+            const juce::Vector3D<double> origin (3.0, -4.0, 0.5);
+
+            // A keyframe, small moves (one-byte deltas), then unrelated values: every varint length and both zig-zag
+            // signs, and differences that only fit 16 bits mod 2^16.
+            expectRoundTrip (Encoding::quantisedDelta, encoder, decoder, particles, origin, true, "keyframe");
+
+            nudge (random, particles);
+            expectRoundTrip (Encoding::quantisedDelta, encoder, decoder, particles, origin, false, "small moves");
+
+            particles = makeParticles (random, 200);
+            expectRoundTrip (Encoding::quantisedDelta, encoder, decoder, particles, origin, false, "unrelated frame");
+        }
+
+        beginTest ("Compact delta round trip");
+        {
+            const auto header = makeHeader (Encoding::compactDelta);
+            Codec encoder (header), decoder (header);
+            auto random = getRandom();
+            auto particles = makeParticles (random, 200);
+            const juce::Vector3D<double> origin (-1.0, 0.0, 2.0);
+
+            // A boid at rest has no heading to encode.
+            particles[4] = particles[5] = particles[6] = 0.0f;
+
+            expectRoundTrip (Encoding::compactDelta, encoder, decoder, particles, origin, true, "compact keyframe");
+
+            nudge (random, particles);
+            expectRoundTrip (Encoding::compactDelta, encoder, decoder, particles, origin, false, "compact small moves");
+
+            particles = makeParticles (random, 200);
+            expectRoundTrip (Encoding::compactDelta, encoder, decoder, particles, origin, false, "compact unrelated frame");
+
+            expect (! storesColour (Encoding::compactDelta));
+            expect (storesColour (Encoding::quantisedDelta) && storesColour (Encoding::raw));
+        }
+
+        beginTest ("With wrap bounds, a wrap across the world box is a small delta");
+        {
+            const auto header = makeHeader (Encoding::quantisedDelta, true);
+            Codec encoder (header), decoder (header);
+            auto random = getRandom();
+            auto particles = makeParticles (random, 1);
+
+            particles[0] = 19.999f;
+            expectRoundTrip (Encoding::quantisedDelta, encoder, decoder, particles, {}, true, "before the wrap");
+
+            // The recorder quantises over exactly the world box, so from its top face to its bottom one is a few
+            // quantisation steps mod 2^16: one byte, like the nine unchanged components.
+            particles[0] = -19.999f;
+            std::vector<juce::uint8> payload;
+            expectEquals (encoder.encode (particles.data(), 1, {}, false, payload), (size_t) 10);
+            expectDecoded (Encoding::quantisedDelta, decoder, payload, particles, {}, false, "after the wrap");
+        }
+
+        beginTest ("Without wrap bounds, the padded box makes the same jump a full delta");
+        {
+            const auto header = makeHeader (Encoding::quantisedDelta, false);
+            Codec encoder (header), decoder (header);
+            auto random = getRandom();
+            auto particles = makeParticles (random, 1);
+
+            particles[0] = 19.999f;
+            expectRoundTrip (Encoding::quantisedDelta, encoder, decoder, particles, {}, true, "before the jump");
+
+            // Two thirds of the padded box: three bytes.
+            particles[0] = -19.999f;
+            std::vector<juce::uint8> payload;
+            expectEquals (encoder.encode (particles.data(), 1, {}, false, payload), (size_t) 12);
+            expectDecoded (Encoding::quantisedDelta, decoder, payload, particles, {}, false, "after the jump");
+        }
+
+        beginTest ("Decoding rebases positions to the target origin");
+        {
+            const auto header = makeHeader (Encoding::quantisedDelta);
+            Codec encoder (header), decoder (header);
+            auto random = getRandom();
+            const auto particles = makeParticles (random, 16);
+            const juce::Vector3D<double> recordedOrigin (1.0, 2.0, 3.0), targetOrigin (-2.0, 2.5, 3.0);
+
+            std::vector<juce::uint8> payload;
+            encoder.encode (particles.data(), 16, recordedOrigin, true, payload);
+
+            const auto decoded = decodeInto (decoder, payload, 16, recordedOrigin, true, targetOrigin);
+
+            for (int i = 0; i < 16; ++i)
+            {
+                expectWithinAbsoluteError (decoded[(size_t) i * 12 + 0], particles[(size_t) i * 12 + 0] + 3.0f, 1.0e-3f);
+                expectWithinAbsoluteError (decoded[(size_t) i * 12 + 1], particles[(size_t) i * 12 + 1] - 0.5f, 1.0e-3f);
+                expectWithinAbsoluteError (decoded[(size_t) i * 12 + 2], particles[(size_t) i * 12 + 2], 1.0e-3f);
+            }
+        }
+
+        beginTest ("Corrupt delta payloads are rejected");
+        {
+            const auto header = makeHeader (Encoding::quantisedDelta);
+            Codec encoder (header);
+            auto random = getRandom();
+            auto particles = makeParticles (random, 8);
+            std::vector<juce::uint8> key, delta;
+
+            encoder.encode (particles.data(), 8, {}, true, key);
+            nudge (random, particles);
+            encoder.encode (particles.data(), 8, {}, false, delta);
+
+            FrameHeader keyFrame, deltaFrame;
+            keyFrame.flags = keyframe;
+            keyFrame.particleCount = deltaFrame.particleCount = 8;
+            keyFrame.payloadBytes = (juce::uint32) key.size();
+
+            {
+                Codec decoder (header);
+                deltaFrame.payloadBytes = (juce::uint32) delta.size();
+                expect (! decoder.decode (deltaFrame, delta.data(), {}, nullptr), "decoded a delta frame without its keyframe");
+            }
+
+            {
+                Codec decoder (header);
+                expect (decoder.decode (keyFrame, key.data(), {}, nullptr));
+                deltaFrame.payloadBytes = (juce::uint32) delta.size() - 1;
+                expect (! decoder.decode (deltaFrame, delta.data(), {}, nullptr), "decoded a truncated delta frame");
+            }
+
+            {
+                Codec decoder (header);
+                expect (decoder.decode (keyFrame, key.data(), {}, nullptr));
+                delta.push_back (0);
+                deltaFrame.payloadBytes = (juce::uint32) delta.size();
+                expect (! decoder.decode (deltaFrame, delta.data(), {}, nullptr), "decoded a delta frame with bytes left over");
+            }
+
+            {
+                Codec decoder (header);
+                keyFrame.payloadBytes = (juce::uint32) key.size() - 1;
+                expect (! decoder.decode (keyFrame, key.data(), {}, nullptr), "decoded a keyframe of the wrong size");
+            }
+        }
+
+        beginTest ("Finished recordings read their index");
+        {
+            expectIndex (makeRecording (5, true), 5, "a finished recording");
+        }
+
+        beginTest ("Unfinished recordings are recovered by walking the frames");
+        {
+            auto recording = makeRecording (5, false);
+            expectIndex (recording, 5, "an unfinished recording");
+
+            // The recorder grows the file a mapping window at a time, so there's zero fill after the last frame.
+            recording.setSize (recording.getSize() + 4096, true);
+            expectIndex (recording, 5, "an unfinished recording with zero fill");
+
+            // A frame cut short by the crash: its header says more payload than the file holds.
+            auto cutShort = makeRecording (5, false);
+            cutShort.setSize (cutShort.getSize() - 10);
+            expectIndex (cutShort, 4, "a recording with its last frame cut short");
+        }
+
+        beginTest ("A damaged footer falls back to walking the frames");
+        {
+            for (const auto numFrames : { (juce::int64) 1 << 40, (juce::int64) -1, (juce::int64) 4 })
+            {
+                auto recording = makeRecording (5, true);
+
+                Footer footer;
+                const auto footerOffset = recording.getSize() - sizeof (Footer);
+                recording.copyTo (&footer, (int) footerOffset, sizeof (footer));
+                footer.numFrames = numFrames;
+                recording.copyFrom (&footer, (int) footerOffset, sizeof (footer));
+
+                expectIndex (recording, 5, "a footer claiming " + juce::String (numFrames) + " frames");
+            }
+        }
+
+        beginTest ("Other files are rejected");
+        {
+            juce::TemporaryFile temp (juce::String (".jftraj"));
+            FileHeader header;
+            std::vector<IndexEntry> index;
+            juce::String error;
+
+            temp.getFile().replaceWithText ("not a recording");
+            expect (! readIndex (temp.getFile(), header, index, error), "accepted a file without the magic");
+
+            auto future = makeRecording (1, true);
+            FileHeader futureHeader;
+            futureHeader.version = currentVersion + 1;
+            future.copyFrom (&futureHeader, 0, sizeof (futureHeader));
+            temp.getFile().replaceWithData (future.getData(), future.getSize());
+            expect (! readIndex (temp.getFile(), header, index, error), "accepted a recording from a newer version");
+            expect (error.isNotEmpty());
+        }
+    }
+
+private:
+    //==============================================================================
+    // A recording of a flock in a +-20 world box, quantised over the box the recorder would use.
+    static FileHeader makeHeader (Encoding encoding, bool wrapBounds = true)
+    {
+        FileHeader header;
+        header.encoding = (juce::uint32) encoding;
+        header.keyframeInterval = 60;
+        header.velocityRange = 10.0f;
+
+        juce::Vector3D<float> quantMin, quantMax;
+        getQuantisationBox ({ -20.0f, -20.0f, -20.0f }, { 20.0f, 20.0f, 20.0f }, wrapBounds, quantMin, quantMax);
+
+        header.quantMin[0] = quantMin.x;
+        header.quantMin[1] = quantMin.y;
+        header.quantMin[2] = quantMin.z;
+        header.quantMax[0] = quantMax.x;
+        header.quantMax[1] = quantMax.y;
+        header.quantMax[2] = quantMax.z;
+        return header;
+    }
+
+    // GPU-layout particles (vec4 pos, vec4 vel, vec4 colour) inside the quantisation box around the origin used by
+    // the tests, moving at up to the velocity range.
+    static std::vector<float> makeParticles (juce::Random& random, int count)
+    {
+        std::vector<float> particles ((size_t) count * 12);
+
+        for (int i = 0; i < count; ++i)
+        {
+            auto* p = particles.data() + (size_t) i * 12;
+
+            for (int a = 0; a < 3; ++a)
+            {
+                p[a] = (random.nextFloat() * 2.0f - 1.0f) * 15.0f;
+                p[4 + a] = (random.nextFloat() * 2.0f - 1.0f) * 5.5f;
+            }
+
+            p[3] = 1.0f;
+            p[7] = 0.0f;
+
+            for (int c = 0; c < 4; ++c)
+                p[8 + c] = random.nextFloat();
+        }
+
+        return particles;
+    }
+
+    // One 60 fps step's worth of motion.
+    static void nudge (juce::Random& random, std::vector<float>& particles)
+    {
+        for (size_t i = 0; i < particles.size(); i += 12)
+        {
+            for (int a = 0; a < 3; ++a)
+            {
+                particles[i + (size_t) a] += particles[i + 4 + (size_t) a] / 60.0f;
+                particles[i + 4 + (size_t) a] += (random.nextFloat() - 0.5f) * 0.05f;
+            }
+        }
+    }
+
+    std::vector<float> decodeInto (Codec& decoder, const std::vector<juce::uint8>& payload, int count,
+                                   juce::Vector3D<double> recordedOrigin, bool isKeyframe, juce::Vector3D<double> targetOrigin)
+    {
+        FrameHeader frame;
+        frame.flags = isKeyframe ? keyframe : 0u;
+        frame.worldOrigin[0] = recordedOrigin.x;
+        frame.worldOrigin[1] = recordedOrigin.y;
+        frame.worldOrigin[2] = recordedOrigin.z;
+        frame.particleCount = count;
+        frame.payloadBytes = (juce::uint32) payload.size();
+
+        std::vector<float> decoded ((size_t) count * 12, -100.0f);
+        expect (decoder.decode (frame, payload.data(), targetOrigin, decoded.data()), "decode failed");
+        return decoded;
+    }
+
+    void expectDecoded (Encoding encoding, Codec& decoder, const std::vector<juce::uint8>& payload,
+                        const std::vector<float>& particles, juce::Vector3D<double> origin, bool isKeyframe,
+                        const juce::String& what)
+    {
+        const auto count = (int) (particles.size() / 12);
+        const auto decoded = decodeInto (decoder, payload, count, origin, isKeyframe, origin);
+
+        // Half a quantisation step: 40 / 65535 for positions, 10 / 32767 for velocities, 1 / 255 for colours. Compact
+        // velocities are a speed step of 10 / 65535 plus an octahedral heading step, under 1e-3 at these speeds, and
+        // compact colours are white placeholders.
+        const auto compact = encoding == Encoding::compactDelta;
+        float maxPositionError = 0.0f, maxVelocityError = 0.0f, maxColourError = 0.0f;
+
+        for (size_t i = 0; i < particles.size(); ++i)
+        {
+            const auto component = i % 12;
+            const auto error = std::abs (decoded[i] - (compact && component >= 8 ? 1.0f : particles[i]));
+
+            if (component < 3)
+                maxPositionError = juce::jmax (maxPositionError, error);
+            else if (component >= 4 && component < 7)
+                maxVelocityError = juce::jmax (maxVelocityError, error);
+            else if (component >= 8)
+                maxColourError = juce::jmax (maxColourError, error);
+        }
+
+        expectLessOrEqual (maxPositionError, 0.5f * 40.0f / 65535.0f + 1.0e-5f, what + ": positions");
+        expectLessOrEqual (maxVelocityError, compact ? 1.0e-3f : 0.5f * 10.0f / 32767.0f + 1.0e-5f, what + ": velocities");
+        expectLessOrEqual (maxColourError, compact ? 0.0f : 0.5f / 255.0f + 1.0e-5f, what + ": colours");
+    }
+
+    void expectRoundTrip (Encoding encoding, Codec& encoder, Codec& decoder, const std::vector<float>& particles,
+                          juce::Vector3D<double> origin, bool isKeyframe, const juce::String& what)
+    {
+        const auto count = (int) (particles.size() / 12);
+        std::vector<juce::uint8> payload;
+        const auto bytes = encoder.encode (particles.data(), count, origin, isKeyframe, payload);
+
+        expectEquals (bytes, payload.size());
+        expectLessOrEqual (bytes, getMaxPayloadBytes (encoding, count, isKeyframe), what + ": payload size");
+        expectDecoded (encoding, decoder, payload, particles, origin, isKeyframe, what);
+    }
+
+    //==============================================================================
+    // A raw recording, byte for byte as TrajectoryRecorder lays it out; finished adds the index and footer.
+    static constexpr int recordingParticles = 3;
+
+    static juce::MemoryBlock makeRecording (int numFrames, bool finished)
+    {
+        FileHeader header;
+        header.encoding = (juce::uint32) Encoding::raw;
+
+        juce::MemoryOutputStream out;
+        out.write (&header, sizeof (header));
+
+        std::vector<IndexEntry> index;
+        std::vector<float> particles ((size_t) recordingParticles * 12);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            FrameHeader frame;
+            frame.flags = keyframe;
+            frame.frameIndex = i;
+            frame.timeSeconds = i / 60.0;
+            frame.particleCount = recordingParticles;
+            frame.payloadBytes = (juce::uint32) (particles.size() * sizeof (float));
+
+            index.push_back ({ (juce::int64) out.getPosition(), frame.timeSeconds, frame.flags, frame.payloadBytes });
+            std::fill (particles.begin(), particles.end(), (float) i);
+
+            out.write (&frame, sizeof (frame));
+            out.write (particles.data(), frame.payloadBytes);
+        }
+
+        if (finished)
+        {
+            Footer footer;
+            footer.indexOffset = (juce::int64) out.getPosition();
+            footer.numFrames = numFrames;
+
+            out.write (index.data(), index.size() * sizeof (IndexEntry));
+            out.write (&footer, sizeof (footer));
+        }
+
+        return { out.getData(), out.getDataSize() };
+    }
+
+    void expectIndex (const juce::MemoryBlock& recording, int expectedFrames, const juce::String& what)
+    {
+        juce::TemporaryFile temp (juce::String (".jftraj"));
+        temp.getFile().replaceWithData (recording.getData(), recording.getSize());
+
+        FileHeader header;
+        std::vector<IndexEntry> index;
+        juce::String error;
+
+        expect (readIndex (temp.getFile(), header, index, error), what + ": " + error);
+        expectEquals ((int) index.size(), expectedFrames, what + ": frame count");
+
+        const auto frameBytes = (juce::int64) (sizeof (FrameHeader) + (size_t) (recordingParticles * bytesPerRawParticle));
+
+        for (int i = 0; i < (int) index.size(); ++i)
+        {
+            expectEquals (index[(size_t) i].offset, (juce::int64) sizeof (FileHeader) + i * frameBytes, what + ": frame offset");
+            expectEquals (index[(size_t) i].timeSeconds, i / 60.0, what + ": frame time");
+        }
+    }
+};
+
+static TrajectoryFileTests trajectoryFileTests;